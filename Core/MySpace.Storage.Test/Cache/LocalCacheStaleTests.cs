@@ -0,0 +1,98 @@
+﻿using System;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+using MySpace.Storage.Cache;
+
+namespace MySpace.Storage.Test.Cache
+{
+	/// <summary>
+	/// Tests when <see cref="LocalCache"/> lets an expired entry be served, and that only one
+	/// caller at a time refreshes it. The local cache uses the in memory storage configured in
+	/// App.config.
+	/// </summary>
+	[TestClass]
+	public class LocalCacheStaleTests
+	{
+		private static readonly DataBuffer _typeId = "LocalCacheStaleTests";
+
+		private static LocalCacheOptions CreateOptions(TimeSpan grace)
+		{
+			return new LocalCacheOptions { StaleGracePeriod = grace };
+		}
+
+		private static StorageEntry<string> CreateEntry(TimeSpan expiresFromNow)
+		{
+			var now = DateTime.Now;
+			return new StorageEntry<string>("value", now.AddMinutes(-5), now + expiresFromNow);
+		}
+
+		// Each test refreshes its own keys, since the leases are shared by the whole process.
+		private static StorageKey CreateKey()
+		{
+			return Guid.NewGuid().ToString("N");
+		}
+
+		[TestMethod]
+		public void ExpiredEntryIsServableWithinItsGrace()
+		{
+			var options = CreateOptions(TimeSpan.FromSeconds(10));
+
+			Assert.IsTrue(LocalCache.IsServableStale(CreateEntry(TimeSpan.FromSeconds(-1)), options));
+			Assert.IsFalse(LocalCache.IsServableStale(CreateEntry(TimeSpan.FromSeconds(-20)), options));
+		}
+
+		[TestMethod]
+		public void UnexpiredEntryIsNotStale()
+		{
+			Assert.IsFalse(LocalCache.IsServableStale(CreateEntry(TimeSpan.FromSeconds(5)),
+				CreateOptions(TimeSpan.FromSeconds(10))));
+		}
+
+		[TestMethod]
+		public void NoGraceServesNoExpiredEntry()
+		{
+			Assert.IsFalse(LocalCache.IsServableStale(CreateEntry(TimeSpan.FromSeconds(-1)),
+				CreateOptions(TimeSpan.Zero)));
+			Assert.IsFalse(LocalCache.IsServableStale(CreateEntry(TimeSpan.FromSeconds(-1)), LocalCacheOptions.None));
+		}
+
+		[TestMethod]
+		public void MissingEntryIsNotStale()
+		{
+			Assert.IsFalse(LocalCache.IsServableStale(StorageEntry<string>.NotFound,
+				CreateOptions(TimeSpan.FromSeconds(10))));
+		}
+
+		[TestMethod]
+		public void OnlyOneCallerRefreshesAKey()
+		{
+			Assert.IsNotNull(LocalCache.Storage, "Local caching isn't configured.");
+			var options = CreateOptions(TimeSpan.FromMinutes(1));
+			var key = CreateKey();
+
+			Assert.IsTrue(LocalCache.TryBeginRefresh(_typeId, key, options));
+			Assert.IsFalse(LocalCache.TryBeginRefresh(_typeId, key, options));
+			Assert.IsTrue(LocalCache.TryBeginRefresh(_typeId, CreateKey(), options), "Another key");
+
+			LocalCache.EndRefresh(_typeId, key);
+			Assert.IsTrue(LocalCache.TryBeginRefresh(_typeId, key, options));
+			LocalCache.EndRefresh(_typeId, key);
+		}
+
+		[TestMethod]
+		public void RefreshLeaseLapsesAfterTheGrace()
+		{
+			Assert.IsNotNull(LocalCache.Storage, "Local caching isn't configured.");
+			var options = CreateOptions(TimeSpan.FromMilliseconds(50));
+			var key = CreateKey();
+
+			Assert.IsTrue(LocalCache.TryBeginRefresh(_typeId, key, options));
+			Assert.IsFalse(LocalCache.TryBeginRefresh(_typeId, key, options));
+
+			Thread.Sleep(100);
+			Assert.IsTrue(LocalCache.TryBeginRefresh(_typeId, key, options), "The abandoned lease never lapsed.");
+			LocalCache.EndRefresh(_typeId, key);
+		}
+	}
+}
@@ -0,0 +1,245 @@
+﻿using System;
+using System.Collections.Generic;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.Storage.Test
+{
+	/// <summary>
+	/// Tests the size accounting and segmented LRU eviction of <see cref="StripedLruMap{TKey, TValue}"/>.
+	/// </summary>
+	[TestClass]
+	public class StripedLruMapTests
+	{
+		private const long _stripeBytes = 100;
+		private const long _entryBytes = 20;
+
+		/// <summary>
+		/// A key that always hashes to the first stripe, so eviction can be tested
+		/// against one stripe's share of the budget.
+		/// </summary>
+		private sealed class Key : IEquatable<Key>
+		{
+			private readonly string _name;
+
+			public Key(string name)
+			{
+				_name = name;
+			}
+
+			public bool Equals(Key other)
+			{
+				return other != null && other._name == _name;
+			}
+
+			public override bool Equals(object obj)
+			{
+				return Equals(obj as Key);
+			}
+
+			public override int GetHashCode()
+			{
+				return 0;
+			}
+
+			public override string ToString()
+			{
+				return _name;
+			}
+		}
+
+		// The map shares its budget evenly among a power of two stripes, at least four per processor.
+		private static long GetBudget(long stripeBytes)
+		{
+			var stripeCount = 1;
+			while (stripeCount < Environment.ProcessorCount * 4)
+			{
+				stripeCount <<= 1;
+			}
+			return stripeBytes * stripeCount;
+		}
+
+		private static StripedLruMap<Key, string> CreateBounded()
+		{
+			return new StripedLruMap<Key, string>(GetBudget(_stripeBytes), null);
+		}
+
+		private static List<KeyValuePair<Key, string>> Set(StripedLruMap<Key, string> map, string name)
+		{
+			return map.Set(new Key(name), name, _entryBytes);
+		}
+
+		private static bool Contains(StripedLruMap<Key, string> map, string name)
+		{
+			string value;
+			return map.TryGetValue(new Key(name), out value);
+		}
+
+		private static void AssertEvicted(List<KeyValuePair<Key, string>> evicted, params string[] names)
+		{
+			Assert.IsNotNull(evicted);
+			Assert.AreEqual(names.Length, evicted.Count);
+			for (var i = 0; i < names.Length; ++i)
+			{
+				Assert.AreEqual(new Key(names[i]), evicted[i].Key);
+				Assert.AreEqual(names[i], evicted[i].Value);
+			}
+		}
+
+		[TestMethod]
+		public void UnboundedMapNeverEvicts()
+		{
+			var map = new StripedLruMap<Key, string>(0, null);
+			Assert.IsFalse(map.IsBounded);
+
+			for (var i = 0; i < 1000; ++i)
+			{
+				Assert.IsNull(map.Set(new Key(i.ToString()), i.ToString(), long.MaxValue / 2000));
+			}
+			for (var i = 0; i < 1000; ++i)
+			{
+				Assert.IsTrue(Contains(map, i.ToString()));
+			}
+		}
+
+		[TestMethod]
+		public void LeastRecentlyAddedIsEvictedFirst()
+		{
+			var map = CreateBounded();
+			Assert.IsTrue(map.IsBounded);
+			foreach (var name in new[] { "a", "b", "c", "d", "e" })
+			{
+				Assert.IsNull(Set(map, name));
+			}
+
+			AssertEvicted(Set(map, "f"), "a");
+			AssertEvicted(map.Set(new Key("g"), "g", _entryBytes * 2), "b", "c");
+
+			Assert.IsFalse(Contains(map, "a"));
+			Assert.IsTrue(Contains(map, "d"));
+			Assert.IsTrue(Contains(map, "g"));
+		}
+
+		[TestMethod]
+		public void EntriesReadAgainOutlastOneTimeEntries()
+		{
+			var map = CreateBounded();
+			Set(map, "hot");
+			Assert.IsTrue(Contains(map, "hot"));
+
+			for (var i = 0; i < 20; ++i)
+			{
+				Set(map, "cold" + i);
+			}
+
+			Assert.IsTrue(Contains(map, "hot"));
+			Assert.IsFalse(Contains(map, "cold0"));
+			Assert.IsTrue(Contains(map, "cold19"));
+		}
+
+		[TestMethod]
+		public void ProtectedEntriesAreDemotedPastTheirShare()
+		{
+			var map = CreateBounded();
+			foreach (var name in new[] { "a", "b", "c", "d", "e" })
+			{
+				Set(map, name);
+			}
+			// reading all five protects more than the protected share, so the least
+			// recently read goes back to probation
+			foreach (var name in new[] { "a", "b", "c", "d", "e" })
+			{
+				Assert.IsTrue(Contains(map, name));
+			}
+
+			AssertEvicted(Set(map, "f"), "a");
+		}
+
+		[TestMethod]
+		public void SizeChangesAreReported()
+		{
+			var entries = 0;
+			long bytes = 0;
+			var map = new StripedLruMap<Key, string>(GetBudget(_stripeBytes), (key, entryDelta, byteDelta) =>
+			{
+				entries += entryDelta;
+				bytes += byteDelta;
+			});
+
+			Set(map, "a");
+			Set(map, "b");
+			Assert.AreEqual(2, entries);
+			Assert.AreEqual(_entryBytes * 2, bytes);
+
+			map.Set(new Key("a"), "a", _entryBytes + 5);
+			Assert.AreEqual(2, entries);
+			Assert.AreEqual(_entryBytes * 2 + 5, bytes);
+
+			map.AddSize(new Key("b"), value => value == "b", 10);
+			Assert.AreEqual(_entryBytes * 2 + 15, bytes);
+			map.AddSize(new Key("b"), value => false, 10);
+			Assert.AreEqual(_entryBytes * 2 + 15, bytes);
+
+			Assert.IsTrue(map.Remove(new Key("a")));
+			Assert.AreEqual(1, entries);
+			Assert.AreEqual(_entryBytes + 10, bytes);
+
+			// growing past the budget evicts, and the eviction is reported too
+			AssertEvicted(map.AddSize(new Key("b"), value => true, _stripeBytes), "b");
+			Assert.AreEqual(0, entries);
+			Assert.AreEqual(0, bytes);
+		}
+
+		[TestMethod]
+		public void GetOrAddCreatesOnlyMissingValues()
+		{
+			var map = CreateBounded();
+			var created = 0;
+			Func<string> creator = () => "created" + ++created;
+			Func<string, long> sizer = value => _entryBytes;
+			string value;
+
+			Assert.IsNull(map.GetOrAdd(new Key("a"), creator, sizer, out value));
+			Assert.AreEqual("created1", value);
+			Assert.IsNull(map.GetOrAdd(new Key("a"), creator, sizer, out value));
+			Assert.AreEqual("created1", value);
+			Assert.AreEqual(1, created);
+		}
+
+		[TestMethod]
+		public void TryUpdateChangesOnlyExistingValues()
+		{
+			var map = CreateBounded();
+			Set(map, "a");
+			string value;
+
+			Assert.IsTrue(map.TryUpdate(new Key("a"), old => old + "!"));
+			Assert.IsTrue(map.TryGetValue(new Key("a"), out value));
+			Assert.AreEqual("a!", value);
+
+			Assert.IsFalse(map.TryUpdate(new Key("b"), old => "b"));
+			Assert.IsFalse(Contains(map, "b"));
+		}
+
+		[TestMethod]
+		public void RemovesMatchingEntries()
+		{
+			var map = CreateBounded();
+			Set(map, "a");
+			Set(map, "b");
+			Set(map, "c");
+
+			Assert.IsFalse(map.Remove(new Key("a"), value => false));
+			Assert.IsTrue(Contains(map, "a"));
+			Assert.IsTrue(map.Remove(new Key("a"), value => value == "a"));
+			Assert.IsFalse(Contains(map, "a"));
+			Assert.IsFalse(map.Remove(new Key("a")));
+
+			map.RemoveAll(key => key.Equals(new Key("b")));
+			Assert.IsFalse(Contains(map, "b"));
+			Assert.IsTrue(Contains(map, "c"));
+
+			map.Clear();
+			Assert.IsFalse(Contains(map, "c"));
+		}
+	}
+}
@@ -34,6 +34,13 @@ namespace MySpace.Storage.Cache
 		/// </summary>
 		public IVirtualCacheType VirtualCacheObject { get; set; }
 
+		/// <summary>
+		/// Gets or sets how long after it expires an entry may still be served
+		/// while a single caller refreshes it. <see cref="TimeSpan.Zero"/>, the
+		/// default, serves no expired entries.
+		/// </summary>
+		public TimeSpan StaleGracePeriod { get; set; }
+
 		/// <summary>
 		/// Gets the instance for no options selected.
 		/// </summary>
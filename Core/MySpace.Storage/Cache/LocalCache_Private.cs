@@ -33,6 +33,9 @@ namespace MySpace.Storage.Cache
 		internal static ITypePolicy Policy { get; private set; }
 
 		private static LogWrapper _log;
+
+		private static readonly Dictionary<ObjectReference, DateTime> _refreshLeases =
+			new Dictionary<ObjectReference, DateTime>();
 		#endregion
 
 		private static List<ObjectDependency> ProcessDependencies(ObjectReference header,
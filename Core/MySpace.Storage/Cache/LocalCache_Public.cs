@@ -121,6 +121,69 @@ namespace MySpace.Storage.Cache
 		}
 		#endregion
 
+		#region Stale Entries
+		/// <summary>
+		/// Gets whether an expired entry may still be served because it is
+		/// within <see cref="LocalCacheOptions.StaleGracePeriod"/> of expiring.
+		/// Callers serving it should refresh it only if they win
+		/// <see cref="TryBeginRefresh"/>.
+		/// </summary>
+		/// <typeparam name="T">The type of the object.</typeparam>
+		/// <param name="entry">The entry retrieved from cache.</param>
+		/// <param name="options">The <see cref="LocalCacheOptions"/> holding the
+		/// grace period.</param>
+		/// <returns><see langword="true"/> if the entry is expired but may
+		/// still be served; otherwise <see langword="false"/>.</returns>
+		public static bool IsServableStale<T>(StorageEntry<T> entry, LocalCacheOptions options)
+		{
+			if (!entry.IsFound || options.StaleGracePeriod <= TimeSpan.Zero) return false;
+			var now = DateTime.Now;
+			return entry.Expires <= now && now < entry.Expires + options.StaleGracePeriod;
+		}
+
+		/// <summary>
+		/// Tries to become the one caller refreshing an expired object. The lease
+		/// lapses after <see cref="LocalCacheOptions.StaleGracePeriod"/> if
+		/// <see cref="EndRefresh"/> isn't called first.
+		/// </summary>
+		/// <param name="typeId">The type identifier of the object.</param>
+		/// <param name="key">The key of the object.</param>
+		/// <param name="options">The <see cref="LocalCacheOptions"/> holding the
+		/// grace period.</param>
+		/// <returns><see langword="true"/> if the caller should refresh the object
+		/// and then call <see cref="EndRefresh"/>; otherwise <see langword="false"/>.</returns>
+		public static bool TryBeginRefresh(DataBuffer typeId, StorageKey key, LocalCacheOptions options)
+		{
+			if (!IsLocalCachingConfigured()) return false;
+
+			var reference = new ObjectReference(typeId, key);
+			var now = DateTime.Now;
+			lock (_refreshLeases)
+			{
+				DateTime leaseExpires;
+				if (_refreshLeases.TryGetValue(reference, out leaseExpires) && leaseExpires > now)
+				{
+					return false;
+				}
+				_refreshLeases[reference] = now + options.StaleGracePeriod;
+				return true;
+			}
+		}
+
+		/// <summary>
+		/// Ends a refresh begun with <see cref="TryBeginRefresh"/>.
+		/// </summary>
+		/// <param name="typeId">The type identifier of the object.</param>
+		/// <param name="key">The key of the object.</param>
+		public static void EndRefresh(DataBuffer typeId, StorageKey key)
+		{
+			lock (_refreshLeases)
+			{
+				_refreshLeases.Remove(new ObjectReference(typeId, key));
+			}
+		}
+		#endregion
+
 		#region Save
 		/// <summary>
 		/// Stores an object to cache.
@@ -9,6 +9,8 @@ using MySpace.Common.Storage;
 using MySpace.Common.HelperObjects;
 using System.Xml;
 using System.Collections;
+using System.IO;
+using Serializer = MySpace.Common.IO.Serializer;
 
 namespace MySpace.Storage
 {
@@ -17,6 +19,10 @@ namespace MySpace.Storage
 	/// <see cref="GenericFactory{T}"/> of <see cref="IObjectStorage"/>. Useful
 	/// for testing and troubleshooting.
 	/// </summary>
+	/// <remarks>With a <c>maxBytes</c> element in its configuration the storage
+	/// holds at most that many bytes of serialized instances, evicting by
+	/// segmented LRU and raising <see cref="IObjectStorage.Dropped"/> for each
+	/// entry evicted. Without one it never evicts.</remarks>
 	public class InMemoryObjectStorageFactory : GenericFactory<IObjectStorage>
 	{
 		/// <summary>
@@ -27,10 +33,17 @@ namespace MySpace.Storage
 		public override IObjectStorage ObtainInstance()
 		{
 			var ret =  new InMemoryObjectStorage();
-			((IObjectStorage) ret).Initialize(null);
+			((IObjectStorage) ret).Initialize(new InMemoryObjectStorageConfig
+			{
+				MaxBytes = _maxBytes ?? 0
+			});
 			return ret;
 		}
 
+		private long? _maxBytes;
+
+		private const string _maxBytesElementName = "maxBytes";
+
 		/// <summary>
 		/// 	<para>Overriden. Reads the factory configuration.</para>
 		/// </summary>
@@ -39,6 +52,19 @@ namespace MySpace.Storage
 		/// </param>
 		public override void ReadXml(XmlReader reader)
 		{
+			_maxBytes = null;
+			using (var subReader = reader.ReadSubtree())
+			{
+				subReader.Read();
+				while (subReader.Read())
+				{
+					if (subReader.NodeType == XmlNodeType.Element &&
+						subReader.Name == _maxBytesElementName)
+					{
+						_maxBytes = subReader.ReadElementContentAsLong();
+					}
+				}
+			}
 		}
 
 		/// <summary>
@@ -49,6 +75,24 @@ namespace MySpace.Storage
 		/// </param>
 		public override void WriteXml(XmlWriter writer)
 		{
+			if (_maxBytes.HasValue)
+			{
+				writer.WriteStartElement(_maxBytesElementName);
+				writer.WriteValue(_maxBytes.Value);
+				writer.WriteEndElement();
+			}
+		}
+
+		/// <summary>
+		/// Configuration of an <see cref="InMemoryObjectStorage"/>.
+		/// </summary>
+		internal class InMemoryObjectStorageConfig
+		{
+			/// <summary>
+			/// Gets or sets the most bytes of serialized instances to hold before
+			/// evicting, or zero to never evict.
+			/// </summary>
+			public long MaxBytes { get; set; }
 		}
 
 		internal class InMemoryObjectStorage : IObjectStorage
@@ -74,234 +118,162 @@ namespace MySpace.Storage
 				}
 			}
 
-			enum LockType
-			{
-				Read,
-				ReadUpgradable,
-				Write
-			}
-
-			class LockingDictionary<TKey, TValue> : IEnumerable<KeyValuePair<TKey, TValue>>, IDisposable
+			struct EntryKey : IEquatable<EntryKey>
 			{
-				private readonly Dictionary<TKey, TValue> _dictionary;
+				public readonly DataBuffer KeySpace;
+				public readonly StorageKey Key;
 
-				private readonly ReaderWriterLockSlim _lock;
-
-				[ThreadStatic]
-				private static LockSpec _lastLock;
-
-				public LockingDictionary()
+				public EntryKey(DataBuffer keySpace, StorageKey key)
 				{
-					_dictionary = new Dictionary<TKey, TValue>();
-					_lock = new ReaderWriterLockSlim(
-						System.Threading.LockRecursionPolicy.NoRecursion);
+					KeySpace = keySpace;
+					Key = key;
 				}
 
-				public IDisposable Lock(LockType type)
+				public bool Equals(EntryKey other)
 				{
-					return new LockSpec(type, this);
+					return KeySpace.Equals(other.KeySpace) && Key.Equals(other.Key);
 				}
 
-				private void EnterLock()
+				public override bool Equals(object obj)
 				{
-					if (_lastLock == null)
-					{
-						throw new ApplicationException("No lock started");
-					}
-					_lastLock.Enter();
+					return obj is EntryKey && Equals((EntryKey)obj);
 				}
 
-				private void EnterWriteLock()
+				public override int GetHashCode()
 				{
-					if (_lastLock == null)
-					{
-						throw new ApplicationException("No lock started");
-					}
-					if (_lastLock.Type < LockType.Write)
-					{
-						throw new ApplicationException("Not in write lock");
-					}
-					_lastLock.Enter();
-				}
-
-				public bool TryGetValue(TKey key, out TValue value)
-				{
-					EnterLock();
-					return _dictionary.TryGetValue(key, out value);
+					return Utility.CombineHashCodes(KeySpace.GetHashCode(), Key.GetHashCode());
 				}
+			}
 
-				public TValue this[TKey key]
-				{
-					get
-					{
-						EnterLock();
-						return _dictionary[key];
-					}
-					set
-					{
-						EnterWriteLock();
-						_dictionary[key] = value;
-					}
-				}
+			/// <summary>
+			/// Bytes and entries held for one key space.
+			/// </summary>
+			internal class KeySpaceUsage
+			{
+				public long Bytes;
+				public int Count;
+			}
 
-				public void Add(TKey key, TValue value)
-				{
-					EnterWriteLock();
-					_dictionary.Add(key, value);
-				}
+			// an estimate of what an entry costs beyond its serialized instance
+			private const int _entryOverhead = 64;
 
-				public bool Remove(TKey key)
-				{
-					EnterWriteLock();
-					return _dictionary.Remove(key);
-				}
+			[ThreadStatic]
+			private static MemoryStream _sizingStream;
 
-				public void Clear()
-				{
-					EnterWriteLock();
-					_dictionary.Clear();
-				}
+			private StripedLruMap<EntryKey, ObjectDecorator> _entries;
 
-				public void Dispose()
-				{
-					_lastLock = null;
-					_lock.Dispose();
-				}
+			private Dictionary<DataBuffer, KeySpaceUsage> _usages =
+				new Dictionary<DataBuffer, KeySpaceUsage>();
 
-				public IEnumerator<KeyValuePair<TKey, TValue>> GetEnumerator()
-				{
-					EnterLock();
-					return _dictionary.GetEnumerator();
-				}
+			private readonly object _usagesLock = new object();
 
-				IEnumerator IEnumerable.GetEnumerator()
+			private KeySpaceUsage GetUsage(DataBuffer keySpace)
+			{
+				KeySpaceUsage usage;
+				if (_usages.TryGetValue(keySpace, out usage)) return usage;
+				lock (_usagesLock)
 				{
-					return GetEnumerator();
+					if (_usages.TryGetValue(keySpace, out usage)) return usage;
+					usage = new KeySpaceUsage();
+					// copy on write so readers need no lock
+					var usages = new Dictionary<DataBuffer, KeySpaceUsage>(_usages);
+					usages.Add(keySpace, usage);
+					_usages = usages;
+					return usage;
 				}
+			}
 
-				class LockSpec : IDisposable
-				{
-					public readonly LockType Type;
-
-					private readonly LockingDictionary<TKey, TValue> _dictionary;
-
-					private readonly LockSpec _previous;
-
-					private bool _started;
-
-					public LockSpec(LockType type, LockingDictionary<TKey, TValue> dictionary)
-					{
-						Type = type;
-						_dictionary = dictionary;
-						_previous = _lastLock;
-						_lastLock = this;
-					}
-
-					private void DoEnter()
-					{
-						switch (Type)
-						{
-							case LockType.Read:
-								_dictionary._lock.EnterReadLock();
-								break;
-							case LockType.ReadUpgradable:
-								_dictionary._lock.EnterUpgradeableReadLock();
-								break;
-							case LockType.Write:
-								_dictionary._lock.EnterWriteLock();
-								break;							
-						}
-					}
-
-					private void DoExit()
-					{
-						switch (Type)
-						{
-							case LockType.Read:
-								_dictionary._lock.ExitReadLock();
-								break;
-							case LockType.ReadUpgradable:
-								_dictionary._lock.ExitUpgradeableReadLock();
-								break;
-							case LockType.Write:
-								_dictionary._lock.ExitWriteLock();
-								break;
-						}
-					}
-
-					public void Enter()
-					{
-						if (_started) return;
-						try
-						{
-						}
-						finally
-						{
-							DoEnter();
-							_started = true;
-						}
-					}
+			private void UsageChanged(EntryKey key, int countDelta, long bytesDelta)
+			{
+				var usage = GetUsage(key.KeySpace);
+				if (countDelta != 0) Interlocked.Add(ref usage.Count, countDelta);
+				if (bytesDelta != 0) Interlocked.Add(ref usage.Bytes, bytesDelta);
+			}
 
-					void IDisposable.Dispose()
-					{
-						if (!_started) return;
-						try
-						{
-							DoExit();
-						}
-						finally
-						{
-							_started = false;
-							_lastLock = _previous;
-						}
-					}
-				}
+			/// <summary>
+			/// Gets the bytes and entries held for a key space.
+			/// </summary>
+			/// <param name="keySpace">The key space.</param>
+			/// <returns>The <see cref="KeySpaceUsage"/>; never <see langword="null"/>.</returns>
+			internal KeySpaceUsage GetKeySpaceUsage(DataBuffer keySpace)
+			{
+				return GetUsage(keySpace);
 			}
 
-			private LockingDictionary<int, LockingDictionary<StorageKey, ObjectDecorator>> _keySpaces =
-				new LockingDictionary<int, LockingDictionary<StorageKey, ObjectDecorator>>();
+			/// <summary>
+			/// Gets the size an instance is accounted at: its serialized length, or
+			/// for a list the measured length of its header and items, plus
+			/// <see cref="_entryOverhead"/>. Only measured when there is a byte budget.
+			/// </summary>
+			private long GetSize<T>(T instance)
+			{
+				if (!_entries.IsBounded) return 0;
+				var list = instance as IMeasuredList;
+				if (list != null) return list.Bytes + _entryOverhead;
+				return Measure(instance) + _entryOverhead;
+			}
 
-			private LockingDictionary<StorageKey, ObjectDecorator> GetSingleKeySpace(DataBuffer keySpace)
+			/// <summary>
+			/// Gets the serialized length of an instance, or zero if it is
+			/// <see langword="null"/> or can't be serialized.
+			/// </summary>
+			internal static long Measure<T>(T instance)
 			{
-				var hash = keySpace.GetHashCode();
-				LockingDictionary<StorageKey, ObjectDecorator> keySpaceDct;
-				// upgradeable blocks other upgradeable, so try read first
-				using(_keySpaces.Lock(LockType.Read))
+				if (instance == null) return 0;
+				var stream = _sizingStream;
+				if (stream == null)
 				{
-					if (_keySpaces.TryGetValue(hash, out keySpaceDct))
-					{
-						return keySpaceDct;
-					}					
+					_sizingStream = stream = new MemoryStream();
 				}
-				// didn't find it, so now try upgradeable to write if need be
-				using (_keySpaces.Lock(LockType.ReadUpgradable))
+				stream.SetLength(0);
+				try
 				{
-					if (!_keySpaces.TryGetValue(hash, out keySpaceDct))
-					{
-						using(_keySpaces.Lock(LockType.Write))
-						{
-							keySpaceDct = new LockingDictionary<StorageKey, ObjectDecorator>();
-							_keySpaces.Add(hash, keySpaceDct);							
-						}
-					}
-					return keySpaceDct;					
+					Serializer.Serialize(stream, instance);
+				}
+				catch (Exception)
+				{
+					stream.SetLength(0);
 				}
+				return stream.Length;
+			}
+
+			/// <summary>
+			/// Starts accounting a list's size, so items added to it after it is
+			/// stored count against the byte budget.
+			/// </summary>
+			private void TrackList<T, THeader>(EntryKey key, MockObjectList<T, THeader> list)
+			{
+				if (!_entries.IsBounded) return;
+				list.Measure(delta => RaiseDropped(_entries.AddSize(key,
+					dec => ReferenceEquals(dec.Instance, list), delta)));
 			}
 
 			private StorageEntry<T> GetCore<T>(DataBuffer keySpace, StorageKey key)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				using(space.Lock(LockType.Read))
+				ObjectDecorator dec;
+				if (_entries.TryGetValue(new EntryKey(keySpace, key), out dec))
 				{
-					ObjectDecorator dec;
-					if (space.TryGetValue(key, out dec))
-					{
-						return dec.ToEntry<T>();
-					}
-					return new StorageEntry<T>();					
+					return dec.ToEntry<T>();
 				}
+				return new StorageEntry<T>();
 			}
 
+			private EventHandler<ObjectEventArgs> _dropped;
+
+			private void RaiseDropped(List<KeyValuePair<EntryKey, ObjectDecorator>> evicted)
+			{
+				if (evicted == null) return;
+				var dropped = _dropped;
+				if (dropped == null) return;
+				foreach (var entry in evicted)
+				{
+					var instance = entry.Value.Instance;
+					var isList = instance != null && instance.GetType().IsGenericType &&
+						instance.GetType().GetGenericTypeDefinition() == typeof(MockObjectList<,>);
+					dropped(this, new ObjectEventArgs(new ObjectReference(
+						entry.Key.KeySpace, entry.Key.Key), isList, instance));
+				}
+			}
 
 			#region IObjectStorage Members
 
@@ -317,75 +289,41 @@ namespace MySpace.Storage
 
 			StorageEntry<T> IObjectStorage.GetOrCreate<T>(DataBuffer keySpace, StorageKey key, Func<StorageEntry<T>> creator)
 			{
-				var space = GetSingleKeySpace(keySpace);
+				StorageEntry<T> ret = new StorageEntry<T>();
+				var created = false;
 				ObjectDecorator dec;
-				// get
-				using(space.Lock(LockType.Read))
-				{
-					if (space.TryGetValue(key, out dec))
+				var evicted = _entries.GetOrAdd(new EntryKey(keySpace, key),
+					() =>
 					{
-						return dec.ToEntry<T>();
-					}					
-				}
-				// not found, so create
-				using(space.Lock(LockType.ReadUpgradable))
-				{
-					if (space.TryGetValue(key, out dec))
-					{
-						return dec.ToEntry<T>();
-					}
-					using(space.Lock(LockType.Write))
-					{
-						var ret = creator();
-						dec = ObjectDecorator.FromEntry(ret);
-						space.Add(key, dec);
-						return ret;						
-					}
-				}
+						ret = creator();
+						created = true;
+						return ObjectDecorator.FromEntry(ret);
+					},
+					d => GetSize((T)d.Instance), out dec);
+				RaiseDropped(evicted);
+				return created ? ret : dec.ToEntry<T>();
 			}
 
 			void IObjectStorage.Put<T>(DataBuffer keySpace, StorageKey key, StorageEntry<T> entry)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				using(space.Lock(LockType.Write))
+				var evicted = _entries.Set(new EntryKey(keySpace, key), new ObjectDecorator
 				{
-					space[key] = new ObjectDecorator
-					{
-						Instance = entry.Instance,
-						Expires = entry.Expires,
-						Updated = entry.Updated
-					};					
-				}
+					Instance = entry.Instance,
+					Expires = entry.Expires,
+					Updated = entry.Updated
+				}, GetSize(entry.Instance));
+				RaiseDropped(evicted);
 			}
 
 			bool IObjectStorage.Delete(DataBuffer keySpace, StorageKey key)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				using(space.Lock(LockType.Write))
-				{
-					return space.Remove(key);					
-				}
+				return _entries.Remove(new EntryKey(keySpace, key));
 			}
 
 			bool IObjectStorage.DeleteVersion(DataBuffer keySpace, StorageKey key, DateTime updated)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				ObjectDecorator dec;
-				using(space.Lock(LockType.ReadUpgradable))
-				{
-					if (space.TryGetValue(key, out dec))
-					{
-						if (dec.Updated.CompareTo(updated) <= 0)
-						{
-							using(space.Lock(LockType.Write))
-							{
-								space.Remove(key);
-								return true;								
-							}
-						}
-					}					
-				}
-				return false;
+				return _entries.Remove(new EntryKey(keySpace, key),
+					dec => dec.Updated.CompareTo(updated) <= 0);
 			}
 
 			bool IObjectStorage.Exists(DataBuffer keySpace, StorageKey key)
@@ -405,21 +343,11 @@ namespace MySpace.Storage
 
 			bool IObjectStorage.SetExpires(DataBuffer keySpace, StorageKey key, DateTime ttl)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				using(space.Lock(LockType.ReadUpgradable))
+				return _entries.TryUpdate(new EntryKey(keySpace, key), dec =>
 				{
-					ObjectDecorator dec;
-					if (space.TryGetValue(key, out dec))
-					{
-						using(space.Lock(LockType.Write))
-						{
-							dec.Expires = ttl;
-							space[key] = dec;
-							return true;							
-						}
-					}
-				}
-				return false;
+					dec.Expires = ttl;
+					return dec;
+				});
 			}
 
 			private IObjectStorage Iface { get { return this; } }
@@ -432,6 +360,7 @@ namespace MySpace.Storage
 			IObjectList<T, THeader> IObjectStorage.CreateList<T, THeader>(DataBuffer keySpace, StorageKey key, THeader header, DateTime ttl, Func<T> creator)
 			{
 				var ret = new MockObjectList<T, THeader>(header);
+				TrackList(new EntryKey(keySpace, key), ret);
 				Iface.Put(keySpace, key, new StorageEntry<MockObjectList<T, THeader>>(ret, DateTime.Now, ttl));
 				return ret;
 			}
@@ -439,8 +368,11 @@ namespace MySpace.Storage
 			StorageEntry<IObjectList<T, THeader>> IObjectStorage.GetOrCreateList<T, THeader>(DataBuffer keySpace, StorageKey key, THeader header, DateTime expires, Func<T> creator, Func<THeader> headerCreator)
 			{
 				return Iface.GetOrCreate(keySpace, key, () =>
-					new StorageEntry<IObjectList<T, THeader>>(
-					new MockObjectList<T, THeader>(header), DateTime.Now, expires));
+				{
+					var list = new MockObjectList<T, THeader>(header);
+					TrackList(new EntryKey(keySpace, key), list);
+					return new StorageEntry<IObjectList<T, THeader>>(list, DateTime.Now, expires);
+				});
 			}
 
 			bool IObjectStorage.DeleteList(DataBuffer keySpace, StorageKey key)
@@ -460,17 +392,14 @@ namespace MySpace.Storage
 
 			void IObjectStorage.Clear(DataBuffer keySpace)
 			{
-				var space = GetSingleKeySpace(keySpace);
-				using(space.Lock(LockType.Write))
-				{
-					space.Clear();
-				}
+				if (GetUsage(keySpace).Count == 0) return;
+				_entries.RemoveAll(entryKey => entryKey.KeySpace.Equals(keySpace));
 			}
 
 			event EventHandler<ObjectEventArgs> IObjectStorage.Dropped
 			{
-				add { }
-				remove { }
+				add { _dropped += value; }
+				remove { _dropped -= value; }
 			}
 
 			bool IStorage.SupportsKeySpaces
@@ -505,19 +434,23 @@ namespace MySpace.Storage
 
 			OutOfSpacePolicy IStorage.OutOfSpacePolicy
 			{
-				get { return OutOfSpacePolicy.Exception; }
+				get { return _entries.IsBounded ? OutOfSpacePolicy.DropEntries : OutOfSpacePolicy.Exception; }
 			}
 
 			void IStorage.Initialize(object config)
 			{
+				var specConfig = config as InMemoryObjectStorageConfig;
+				var maxBytes = specConfig != null ? specConfig.MaxBytes : 0;
+				lock (_usagesLock)
+				{
+					_usages = new Dictionary<DataBuffer, KeySpaceUsage>();
+				}
+				_entries = new StripedLruMap<EntryKey, ObjectDecorator>(maxBytes, UsageChanged);
 			}
 
 			void IStorage.Reinitialize(object config)
 			{
-				using(_keySpaces.Lock(LockType.Write))
-				{
-					_keySpaces.Clear();
-				}
+				((IStorage)this).Initialize(config);
 			}
 
 			#endregion
@@ -526,34 +459,83 @@ namespace MySpace.Storage
 
 			void IDisposable.Dispose()
 			{
-				var keySpaces = Interlocked.Exchange(ref _keySpaces, null);
-				if (keySpaces == null) return;
-				using(keySpaces.Lock(LockType.Read))
-				{
-					foreach (var entry in keySpaces)
-					{
-						entry.Value.Dispose();
-					}					
-				}
-				keySpaces.Dispose();
+				var entries = Interlocked.Exchange(ref _entries, null);
+				if (entries == null) return;
+				entries.Clear();
 			}
 
 			#endregion
 		}
 
-		class MockObjectList<T, THeader> : IObjectList<T, THeader>
+		/// <summary>
+		/// A stored list whose size changes after it is stored.
+		/// </summary>
+		interface IMeasuredList
+		{
+			/// <summary>
+			/// Gets the measured length of the list's header and items.
+			/// </summary>
+			long Bytes { get; }
+		}
+
+		class MockObjectList<T, THeader> : IObjectList<T, THeader>, IMeasuredList
 		{
 			private List<T> _list = new List<T>();
 
+			private THeader _header;
+
+			private long _headerBytes;
+
+			private long _bytes;
+
+			private Action<long> _resized;
+
+			public long Bytes { get { return Interlocked.Read(ref _bytes); } }
+
+			/// <summary>
+			/// Measures the list and starts reporting changes in its length to
+			/// <paramref name="resized"/>.
+			/// </summary>
+			public void Measure(Action<long> resized)
+			{
+				_headerBytes = InMemoryObjectStorage.Measure(_header);
+				long bytes = _headerBytes;
+				foreach (var item in _list)
+				{
+					bytes += InMemoryObjectStorage.Measure(item);
+				}
+				Interlocked.Exchange(ref _bytes, bytes);
+				_resized = resized;
+			}
+
+			private void Resize(long delta)
+			{
+				if (delta == 0) return;
+				Interlocked.Add(ref _bytes, delta);
+				_resized(delta);
+			}
+
 			public void Add(T instance)
 			{
 				_list.Add(instance);
+				if (_resized != null) Resize(InMemoryObjectStorage.Measure(instance));
 			}
 
 			public void AddRange(IEnumerable<T> instances)
 			{
 				if (instances == null) throw new ArgumentNullException("instances");
-				_list.AddRange(instances);
+				if (_resized == null)
+				{
+					_list.AddRange(instances);
+					return;
+				}
+				long delta = 0;
+				foreach (var instance in instances)
+				{
+					_list.Add(instance);
+					delta += InMemoryObjectStorage.Measure(instance);
+				}
+				Resize(delta);
 			}
 
 			public IEnumerator<T> GetEnumerator()
@@ -570,16 +552,29 @@ namespace MySpace.Storage
 			{
 			}
 
-			public THeader Header { get; set; }
+			public THeader Header
+			{
+				get { return _header; }
+				set
+				{
+					_header = value;
+					if (_resized == null) return;
+					var headerBytes = InMemoryObjectStorage.Measure(value);
+					var delta = headerBytes - _headerBytes;
+					_headerBytes = headerBytes;
+					Resize(delta);
+				}
+			}
 
 			public MockObjectList(THeader header)
 			{
-				Header = header;
+				_header = header;
 			}
 
 			public void Clear()
 			{
 				_list.Clear();
+				if (_resized != null) Resize(_headerBytes - Bytes);
 			}
 		}
 	}
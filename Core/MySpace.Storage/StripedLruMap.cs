@@ -0,0 +1,374 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace MySpace.Storage
+{
+	/// <summary>
+	/// A map split into independently locked stripes, each evicting by
+	/// segmented LRU once its share of a byte budget is used up.
+	/// </summary>
+	/// <remarks>
+	/// 	<para>New entries enter a stripe's probation segment. An entry read
+	///		again moves to the protected segment, which is held to
+	///		<see cref="ProtectedRatio"/> of the stripe's budget by demoting its
+	///		least recently used entries back to probation. Entries are evicted
+	///		from the end of probation first, so a burst of one-time reads can't
+	///		push out entries that are read repeatedly.</para>
+	/// 	<para>Sizes are supplied by the caller. Entries evicted by a write are
+	///		handed back to the caller rather than raised from under the stripe's
+	///		lock.</para>
+	/// </remarks>
+	/// <typeparam name="TKey">The type of the keys.</typeparam>
+	/// <typeparam name="TValue">The type of the values.</typeparam>
+	internal sealed class StripedLruMap<TKey, TValue>
+	{
+		/// <summary>
+		/// The share of a stripe's budget the protected segment may hold.
+		/// </summary>
+		public const double ProtectedRatio = 0.8;
+
+		private readonly Stripe[] _stripes;
+
+		private readonly int _stripeMask;
+
+		private readonly IEqualityComparer<TKey> _comparer;
+
+		private readonly Action<TKey, int, long> _sizeChanged;
+
+		/// <summary>
+		/// 	<para>Initializes a new instance of the <see cref="StripedLruMap{TKey, TValue}"/> class.</para>
+		/// </summary>
+		/// <param name="maxBytes">
+		/// 	<para>The byte budget shared evenly by the stripes, or zero for no budget.</para>
+		/// </param>
+		/// <param name="sizeChanged">
+		/// 	<para>Called under the stripe's lock with the change in entries and
+		///		in bytes as a key is added, replaced, removed or evicted. May be
+		///		<see langword="null"/>.</para>
+		/// </param>
+		public StripedLruMap(long maxBytes, Action<TKey, int, long> sizeChanged)
+		{
+			var stripeCount = 1;
+			while (stripeCount < Environment.ProcessorCount * 4)
+			{
+				stripeCount <<= 1;
+			}
+			_stripeMask = stripeCount - 1;
+			_comparer = EqualityComparer<TKey>.Default;
+			_sizeChanged = sizeChanged;
+			MaxBytes = maxBytes > 0 ? maxBytes : 0;
+			var stripeBytes = MaxBytes / stripeCount;
+			if (MaxBytes > 0 && stripeBytes == 0) stripeBytes = 1;
+			_stripes = new Stripe[stripeCount];
+			for (var i = 0; i < stripeCount; ++i)
+			{
+				_stripes[i] = new Stripe(_comparer, stripeBytes);
+			}
+		}
+
+		/// <summary>
+		/// Gets the byte budget, or zero if there is none.
+		/// </summary>
+		public long MaxBytes { get; private set; }
+
+		/// <summary>
+		/// Gets whether entries are evicted to stay within <see cref="MaxBytes"/>.
+		/// </summary>
+		public bool IsBounded { get { return MaxBytes > 0; } }
+
+		private Stripe GetStripe(TKey key)
+		{
+			var hash = _comparer.GetHashCode(key);
+			// spread the high bits so keys differing only there don't share stripes
+			hash ^= (hash >> 16);
+			return _stripes[hash & _stripeMask];
+		}
+
+		/// <summary>
+		/// Gets the value for a key, marking it as recently used.
+		/// </summary>
+		public bool TryGetValue(TKey key, out TValue value)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (stripe.Nodes.TryGetValue(key, out node))
+				{
+					stripe.Touch(node);
+					value = node.Value;
+					return true;
+				}
+			}
+			value = default(TValue);
+			return false;
+		}
+
+		/// <summary>
+		/// Adds or replaces the value for a key.
+		/// </summary>
+		/// <returns>The entries evicted to make room, or <see langword="null"/> if none were.</returns>
+		public List<KeyValuePair<TKey, TValue>> Set(TKey key, TValue value, long size)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (stripe.Nodes.TryGetValue(key, out node))
+				{
+					node.Value = value;
+					Resize(stripe, node, size);
+					stripe.Touch(node);
+				}
+				else
+				{
+					Insert(stripe, key, value, size);
+				}
+				return Evict(stripe);
+			}
+		}
+
+		/// <summary>
+		/// Gets the value for a key, adding one from <paramref name="creator"/> if there is none.
+		/// </summary>
+		/// <param name="key">The key.</param>
+		/// <param name="creator">Creates the value; called under the stripe's lock.</param>
+		/// <param name="sizer">Gives the size of a created value.</param>
+		/// <param name="value">The value found or created.</param>
+		/// <returns>The entries evicted to make room, or <see langword="null"/> if none were.</returns>
+		public List<KeyValuePair<TKey, TValue>> GetOrAdd(TKey key, Func<TValue> creator,
+			Func<TValue, long> sizer, out TValue value)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (stripe.Nodes.TryGetValue(key, out node))
+				{
+					stripe.Touch(node);
+					value = node.Value;
+					return null;
+				}
+				value = creator();
+				Insert(stripe, key, value, sizer(value));
+				return Evict(stripe);
+			}
+		}
+
+		/// <summary>
+		/// Replaces the value for a key if there is one, keeping its size and recency.
+		/// </summary>
+		/// <returns><see langword="true"/> if the key was found; otherwise <see langword="false"/>.</returns>
+		public bool TryUpdate(TKey key, Func<TValue, TValue> updater)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (!stripe.Nodes.TryGetValue(key, out node)) return false;
+				node.Value = updater(node.Value);
+				return true;
+			}
+		}
+
+		/// <summary>
+		/// Changes the size of a key's value in place, such as a list that has
+		/// grown, if the value matches <paramref name="match"/>.
+		/// </summary>
+		/// <returns>The entries evicted to make room, or <see langword="null"/> if none were.</returns>
+		public List<KeyValuePair<TKey, TValue>> AddSize(TKey key, Func<TValue, bool> match, long delta)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (!stripe.Nodes.TryGetValue(key, out node)) return null;
+				if (!match(node.Value)) return null;
+				Resize(stripe, node, node.Size + delta);
+				return Evict(stripe);
+			}
+		}
+
+		/// <summary>
+		/// Removes a key.
+		/// </summary>
+		/// <returns><see langword="true"/> if the key was found; otherwise <see langword="false"/>.</returns>
+		public bool Remove(TKey key)
+		{
+			return Remove(key, null);
+		}
+
+		/// <summary>
+		/// Removes a key if its value matches <paramref name="match"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the key was found and removed; otherwise <see langword="false"/>.</returns>
+		public bool Remove(TKey key, Func<TValue, bool> match)
+		{
+			var stripe = GetStripe(key);
+			lock (stripe)
+			{
+				Node node;
+				if (!stripe.Nodes.TryGetValue(key, out node)) return false;
+				if (match != null && !match(node.Value)) return false;
+				Unlink(stripe, node);
+				return true;
+			}
+		}
+
+		/// <summary>
+		/// Removes every key that matches <paramref name="match"/>.
+		/// </summary>
+		public void RemoveAll(Func<TKey, bool> match)
+		{
+			foreach (var stripe in _stripes)
+			{
+				lock (stripe)
+				{
+					List<Node> removed = null;
+					foreach (var node in stripe.Nodes.Values)
+					{
+						if (match(node.Key))
+						{
+							if (removed == null) removed = new List<Node>();
+							removed.Add(node);
+						}
+					}
+					if (removed == null) continue;
+					foreach (var node in removed)
+					{
+						Unlink(stripe, node);
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Removes every key.
+		/// </summary>
+		public void Clear()
+		{
+			RemoveAll(key => true);
+		}
+
+		private void Insert(Stripe stripe, TKey key, TValue value, long size)
+		{
+			var node = new Node { Key = key, Value = value, Size = size };
+			stripe.Nodes.Add(key, node);
+			stripe.Probation.AddFirst(node);
+			if (_sizeChanged != null) _sizeChanged(key, 1, size);
+		}
+
+		private void Resize(Stripe stripe, Node node, long size)
+		{
+			var delta = size - node.Size;
+			if (delta == 0) return;
+			node.Size = size;
+			(node.IsProtected ? stripe.Protected : stripe.Probation).Bytes += delta;
+			if (_sizeChanged != null) _sizeChanged(node.Key, 0, delta);
+		}
+
+		private void Unlink(Stripe stripe, Node node)
+		{
+			stripe.Nodes.Remove(node.Key);
+			(node.IsProtected ? stripe.Protected : stripe.Probation).Remove(node);
+			if (_sizeChanged != null) _sizeChanged(node.Key, -1, -node.Size);
+		}
+
+		private List<KeyValuePair<TKey, TValue>> Evict(Stripe stripe)
+		{
+			if (stripe.MaxBytes == 0) return null;
+			List<KeyValuePair<TKey, TValue>> evicted = null;
+			while (stripe.Probation.Bytes + stripe.Protected.Bytes > stripe.MaxBytes)
+			{
+				var victim = stripe.Probation.Tail ?? stripe.Protected.Tail;
+				if (victim == null) break;
+				Unlink(stripe, victim);
+				if (evicted == null) evicted = new List<KeyValuePair<TKey, TValue>>();
+				evicted.Add(new KeyValuePair<TKey, TValue>(victim.Key, victim.Value));
+			}
+			return evicted;
+		}
+
+		private sealed class Node
+		{
+			public TKey Key;
+			public TValue Value;
+			public long Size;
+			public bool IsProtected;
+			public Node Previous;
+			public Node Next;
+		}
+
+		/// <summary>
+		/// A list of nodes from most (head) to least (tail) recently used.
+		/// </summary>
+		private sealed class Segment
+		{
+			public Node Head;
+			public Node Tail;
+			public long Bytes;
+
+			public void AddFirst(Node node)
+			{
+				node.Previous = null;
+				node.Next = Head;
+				if (Head != null) Head.Previous = node;
+				Head = node;
+				if (Tail == null) Tail = node;
+				Bytes += node.Size;
+			}
+
+			public void Remove(Node node)
+			{
+				if (node.Previous != null) node.Previous.Next = node.Next;
+				else Head = node.Next;
+				if (node.Next != null) node.Next.Previous = node.Previous;
+				else Tail = node.Previous;
+				node.Previous = null;
+				node.Next = null;
+				Bytes -= node.Size;
+			}
+		}
+
+		private sealed class Stripe
+		{
+			public readonly Dictionary<TKey, Node> Nodes;
+			public readonly Segment Probation = new Segment();
+			public readonly Segment Protected = new Segment();
+			public readonly long MaxBytes;
+			private readonly long _maxProtectedBytes;
+
+			public Stripe(IEqualityComparer<TKey> comparer, long maxBytes)
+			{
+				Nodes = new Dictionary<TKey, Node>(comparer);
+				MaxBytes = maxBytes;
+				_maxProtectedBytes = (long)(maxBytes * ProtectedRatio);
+			}
+
+			/// <summary>
+			/// Marks a node as read again, promoting it out of probation.
+			/// </summary>
+			public void Touch(Node node)
+			{
+				if (MaxBytes == 0) return;
+				if (node.IsProtected)
+				{
+					if (Protected.Head == node) return;
+					Protected.Remove(node);
+					Protected.AddFirst(node);
+					return;
+				}
+				Probation.Remove(node);
+				node.IsProtected = true;
+				Protected.AddFirst(node);
+				while (Protected.Bytes > _maxProtectedBytes && Protected.Tail != node)
+				{
+					var demoted = Protected.Tail;
+					Protected.Remove(demoted);
+					demoted.IsProtected = false;
+					Probation.AddFirst(demoted);
+				}
+			}
+		}
+	}
+}
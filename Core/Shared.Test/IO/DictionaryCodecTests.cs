@@ -0,0 +1,137 @@
+﻿using System;
+using System.Text;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.IO;
+
+namespace MySpace.Shared.Test.IO
+{
+	/// <summary>
+	/// Tests <see cref="DictionaryCodec"/>. Dictionaries are registered process wide, so each
+	/// test uses its own type ids.
+	/// </summary>
+	[TestClass]
+	public class DictionaryCodecTests
+	{
+		private static readonly byte[] _dictionary = Encoding.UTF8.GetBytes(
+			"{\"userId\":0,\"displayName\":\"\",\"status\":\"online\",\"friends\":[],\"lastLogin\":\"2010-01-01T00:00:00\"}");
+
+		private static byte[] Payload(int userId)
+		{
+			return Encoding.UTF8.GetBytes(string.Format(
+				"{{\"userId\":{0},\"displayName\":\"user{0}\",\"status\":\"online\",\"friends\":[],\"lastLogin\":\"2010-01-01T00:00:00\"}}",
+				userId));
+		}
+
+		private static byte[] Decompress(byte[] framed)
+		{
+			byte[] buffer = null;
+			var decompressed = Compressor.Instance.Decompress(new ArraySegment<byte>(framed), CompressionImplementation.ManagedZLib, ref buffer);
+			var ret = new byte[decompressed.Count];
+			Buffer.BlockCopy(decompressed.Array, decompressed.Offset, ret, 0, decompressed.Count);
+			return ret;
+		}
+
+		[TestMethod]
+		public void PayloadRoundTripsSmallerThanWithoutDictionary()
+		{
+			DictionaryCodec.SetDictionaries(new[] { new CompressionDictionary(1001, 1, _dictionary) });
+			var payload = Payload(12345);
+
+			var withDictionary = Compressor.Instance.Compress(DictionaryCodec.GetCodec(1001), new ArraySegment<byte>(payload));
+			var withoutDictionary = Compressor.Instance.Compress(new Lz4Codec(), new ArraySegment<byte>(payload));
+
+			Assert.IsTrue(withDictionary.Length < withoutDictionary.Length,
+				string.Format("{0} bytes with the dictionary, {1} without", withDictionary.Length, withoutDictionary.Length));
+			CollectionAssert.AreEqual(payload, Decompress(withDictionary));
+		}
+
+		[TestMethod]
+		public void MatchRunningFromDictionaryIntoPayloadRoundTrips()
+		{
+			// the payload repeats the dictionary's tail and carries on repeating it, so a
+			// match starts in the dictionary and runs on into the payload's own output
+			var tail = Encoding.UTF8.GetBytes("abcdefgh");
+			var dictionary = new byte[1000];
+			new Random(5).NextBytes(dictionary);
+			Buffer.BlockCopy(tail, 0, dictionary, dictionary.Length - tail.Length, tail.Length);
+			DictionaryCodec.SetDictionaries(new[] { new CompressionDictionary(1002, 1, dictionary) });
+			var payload = new byte[200];
+			for (var i = 0; i < payload.Length; ++i)
+			{
+				payload[i] = tail[i % tail.Length];
+			}
+
+			var compressed = Compressor.Instance.Compress(DictionaryCodec.GetCodec(1002), new ArraySegment<byte>(payload));
+
+			CollectionAssert.AreEqual(payload, Decompress(compressed));
+		}
+
+		[TestMethod]
+		public void RandomPayloadsRoundTrip()
+		{
+			var random = new Random(9);
+			var dictionary = new byte[CompressionDictionary.MaxLength];
+			random.NextBytes(dictionary);
+			DictionaryCodec.SetDictionaries(new[] { new CompressionDictionary(1003, 1, dictionary) });
+			var codec = DictionaryCodec.GetCodec(1003);
+			for (var i = 0; i < 50; ++i)
+			{
+				// half the payload copied from the dictionary, half random
+				var payload = new byte[random.Next(1, 2000)];
+				random.NextBytes(payload);
+				var copied = payload.Length / 2;
+				Buffer.BlockCopy(dictionary, random.Next(dictionary.Length - copied), payload, 0, copied);
+
+				var compressed = Compressor.Instance.Compress(codec, new ArraySegment<byte>(payload));
+
+				CollectionAssert.AreEqual(payload, Decompress(compressed), "Payload " + i);
+			}
+		}
+
+		[TestMethod]
+		public void OldVersionStaysReadableAfterNewOne()
+		{
+			var payload = Payload(7);
+			DictionaryCodec.SetDictionaries(new[] { new CompressionDictionary(1004, 1, _dictionary) });
+			var compressedWithOld = Compressor.Instance.Compress(DictionaryCodec.GetCodec(1004), new ArraySegment<byte>(payload));
+
+			var newDictionary = Encoding.UTF8.GetBytes("something else entirely");
+			DictionaryCodec.SetDictionaries(new[]
+			{
+				new CompressionDictionary(1004, 1, _dictionary),
+				new CompressionDictionary(1004, 2, newDictionary)
+			});
+			var compressedWithNew = Compressor.Instance.Compress(DictionaryCodec.GetCodec(1004), new ArraySegment<byte>(payload));
+
+			CollectionAssert.AreEqual(payload, Decompress(compressedWithOld));
+			CollectionAssert.AreEqual(payload, Decompress(compressedWithNew));
+			CollectionAssert.AreNotEqual(compressedWithOld, compressedWithNew);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void UnknownVersionThrows()
+		{
+			DictionaryCodec.SetDictionaries(new[] { new CompressionDictionary(1005, 1, _dictionary) });
+			var compressed = Compressor.Instance.Compress(DictionaryCodec.GetCodec(1005), new ArraySegment<byte>(Payload(1)));
+			// the version is the second ushort after the 6 byte frame header
+			compressed[8] = 99;
+
+			Decompress(compressed);
+		}
+
+		[TestMethod]
+		public void TypeWithoutDictionaryHasNoCodec()
+		{
+			Assert.IsNull(DictionaryCodec.GetCodec(1006));
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(InvalidOperationException))]
+		public void RegisteredCodecOnlyDecompresses()
+		{
+			var codec = Compressor.GetCodec(DictionaryCodec.Id);
+			codec.Compress(new byte[10], 0, 10, new byte[codec.GetMaxCompressedLength(10)], 0);
+		}
+	}
+}
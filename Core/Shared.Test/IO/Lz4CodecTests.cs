@@ -0,0 +1,179 @@
+﻿using System;
+using System.Text;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.IO;
+
+namespace MySpace.Shared.Test.IO
+{
+	/// <summary>
+	/// Tests <see cref="Lz4Codec"/> and how <see cref="Compressor"/> frames its output.
+	/// </summary>
+	[TestClass]
+	public class Lz4CodecTests
+	{
+		private static byte[] RoundTrip(byte[] data)
+		{
+			var codec = new Lz4Codec();
+			var compressed = new byte[codec.GetMaxCompressedLength(data.Length)];
+			var compressedLength = codec.Compress(data, 0, data.Length, compressed, 0);
+			Assert.IsTrue(compressedLength <= compressed.Length);
+			var decompressed = new byte[data.Length];
+			Assert.AreEqual(data.Length, codec.Decompress(compressed, 0, compressedLength, decompressed, 0, data.Length));
+			return decompressed;
+		}
+
+		private static byte[] Random(int length, int seed)
+		{
+			var data = new byte[length];
+			new Random(seed).NextBytes(data);
+			return data;
+		}
+
+		[TestMethod]
+		public void RandomDataRoundTrips()
+		{
+			foreach (var length in new[] { 1, 4, 12, 13, 100, 4096, 100000 })
+			{
+				var data = Random(length, length);
+				CollectionAssert.AreEqual(data, RoundTrip(data), "Length " + length);
+			}
+		}
+
+		[TestMethod]
+		public void EmptyDataRoundTrips()
+		{
+			CollectionAssert.AreEqual(new byte[0], RoundTrip(new byte[0]));
+		}
+
+		[TestMethod]
+		public void RepetitiveDataRoundTripsSmaller()
+		{
+			var data = Encoding.UTF8.GetBytes(new StringBuilder().Insert(0, "<item id=\"1\">value</item>", 400).ToString());
+			var codec = new Lz4Codec();
+			var compressed = new byte[codec.GetMaxCompressedLength(data.Length)];
+
+			var compressedLength = codec.Compress(data, 0, data.Length, compressed, 0);
+
+			Assert.IsTrue(compressedLength < data.Length / 10, "Compressed to " + compressedLength);
+			CollectionAssert.AreEqual(data, RoundTrip(data));
+		}
+
+		[TestMethod]
+		public void LongRunsRoundTrip()
+		{
+			// runs longer than 255 need extra length bytes, and overlap their own output
+			var data = new byte[70000];
+			for (var i = 30000; i < data.Length; ++i)
+			{
+				data[i] = (byte)(i % 3);
+			}
+			CollectionAssert.AreEqual(data, RoundTrip(data));
+		}
+
+		[TestMethod]
+		public void OffsetsAreHonored()
+		{
+			var codec = new Lz4Codec();
+			var data = Random(1000, 7);
+			Array.Copy(data, 0, data, 500, 400);
+			var compressed = new byte[10 + codec.GetMaxCompressedLength(600)];
+			var compressedLength = codec.Compress(data, 400, 600, compressed, 10);
+			var decompressed = new byte[20 + 600];
+
+			codec.Decompress(compressed, 10, compressedLength, decompressed, 20, 600);
+
+			for (var i = 0; i < 600; ++i)
+			{
+				Assert.AreEqual(data[400 + i], decompressed[20 + i], "Byte " + i);
+			}
+		}
+
+		[TestMethod]
+		public void FramedDataRoundTripsThroughCompressor()
+		{
+			var data = Random(3000, 11);
+			byte[] buffer = null;
+			var compressed = Compressor.Instance.Compress(new ArraySegment<byte>(data), CompressionImplementation.LZ4, ref buffer);
+			var framed = new byte[compressed.Count];
+			Buffer.BlockCopy(compressed.Array, compressed.Offset, framed, 0, compressed.Count);
+
+			byte[] outBuffer = null;
+			// framed data names its codec, so the implementation passed doesn't matter
+			var decompressed = Compressor.Instance.Decompress(new ArraySegment<byte>(framed), CompressionImplementation.ManagedZLib, ref outBuffer);
+
+			Assert.AreEqual(data.Length, decompressed.Count);
+			for (var i = 0; i < data.Length; ++i)
+			{
+				Assert.AreEqual(data[i], decompressed.Array[decompressed.Offset + i]);
+			}
+		}
+
+		// Asserts uncompressed data is given back as it was by both Decompress overloads.
+		private static void AssertReturnedUnchanged(byte[] data)
+		{
+			CollectionAssert.AreEqual(data, Compressor.Instance.Decompress(data, CompressionImplementation.ManagedZLib));
+
+			byte[] buffer = null;
+			var decompressed = Compressor.Instance.Decompress(new ArraySegment<byte>(data), CompressionImplementation.LZ4, ref buffer);
+			Assert.AreEqual(data.Length, decompressed.Count);
+			for (var i = 0; i < data.Length; ++i)
+			{
+				Assert.AreEqual(data[i], decompressed.Array[decompressed.Offset + i], "Byte " + i);
+			}
+		}
+
+		[TestMethod]
+		public void UnknownCodecIdIsNotAFrame()
+		{
+			var data = Random(100, 5);
+			data[0] = 0xC7;
+			data[1] = 0x7F;
+
+			AssertReturnedUnchanged(data);
+		}
+
+		[TestMethod]
+		public void LengthThatDoesNotFitIsNotAFrame()
+		{
+			var data = Random(100, 9);
+			data[0] = 0xC7;
+			data[1] = Lz4Codec.Id;
+			// 94 bytes can't be the LZ4 output for 2 bytes
+			Buffer.BlockCopy(BitConverter.GetBytes(2), 0, data, 2, sizeof(int));
+			AssertReturnedUnchanged(data);
+
+			Buffer.BlockCopy(BitConverter.GetBytes(-1), 0, data, 2, sizeof(int));
+			AssertReturnedUnchanged(data);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void MatchBeforeStartIsCorrupt()
+		{
+			// no literals, then a match one byte back from the start of the output
+			var corrupt = new byte[] { 0x00, 0x01, 0x00 };
+			new Lz4Codec().Decompress(corrupt, 0, corrupt.Length, new byte[16], 0, 16);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void TruncatedLengthIsCorrupt()
+		{
+			// the literal length says more length bytes follow, but the data ends
+			var corrupt = new byte[] { 0xF0 };
+			new Lz4Codec().Decompress(corrupt, 0, corrupt.Length, new byte[64], 0, 64);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void OutputPastDecompressedLengthIsCorrupt()
+		{
+			var data = Random(100, 3);
+			var codec = new Lz4Codec();
+			var compressed = new byte[codec.GetMaxCompressedLength(data.Length)];
+			var compressedLength = codec.Compress(data, 0, data.Length, compressed, 0);
+
+			codec.Decompress(compressed, 0, compressedLength, new byte[100], 0, 50);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+
+namespace MySpace.Shared.Test.Storage
+{
+	[TestClass]
+	public unsafe class UnmanagedMemoryViewTests
+	{
+		private static readonly byte[] _data = new byte[] { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+		private IntPtr _block;
+		private int _frees;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_block = Marshal.AllocHGlobal(_data.Length);
+			Marshal.Copy(_data, 0, _block, _data.Length);
+			_frees = 0;
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			if (_frees == 0)
+			{
+				Marshal.FreeHGlobal(_block);
+			}
+		}
+
+		private void Free(void* pointer)
+		{
+			Assert.AreEqual(_block, new IntPtr(pointer));
+			if (++_frees == 1)
+			{
+				Marshal.FreeHGlobal(_block);
+			}
+		}
+
+		private UnmanagedMemoryView CreateView()
+		{
+			return new UnmanagedMemoryView((byte*)_block.ToPointer(), _data.Length, Free);
+		}
+
+		[TestMethod]
+		public void DisposeFreesTheBlockOnce()
+		{
+			var view = CreateView();
+
+			view.Dispose();
+			view.Dispose();
+
+			Assert.AreEqual(1, _frees);
+		}
+
+		[TestMethod]
+		public void StreamKeepsTheBlockAfterTheViewIsDisposed()
+		{
+			var view = CreateView();
+			var stream = view.CreateStream();
+
+			view.Dispose();
+			Assert.AreEqual(0, _frees);
+			var read = new byte[_data.Length];
+			Assert.AreEqual(_data.Length, stream.Read(read, 0, read.Length));
+			CollectionAssert.AreEqual(_data, read);
+
+			stream.Dispose();
+			Assert.AreEqual(1, _frees);
+		}
+
+		[TestMethod]
+		public void EveryReferenceMustBeReleased()
+		{
+			var view = CreateView();
+			Assert.AreSame(view, view.AddReference());
+			var first = view.CreateStream();
+			var second = view.CreateStream();
+
+			view.Dispose();
+			first.Dispose();
+			view.Release();
+			Assert.AreEqual(0, _frees);
+
+			second.Dispose();
+			Assert.AreEqual(1, _frees);
+		}
+
+		[TestMethod]
+		public void ReleasedViewRefusesAccess()
+		{
+			var view = CreateView();
+			view.Dispose();
+
+			foreach (var access in new Action[]
+			{
+				() => view.AddReference(),
+				() => view.CreateStream(),
+				() => view.ToArray(),
+				() => { var pointer = view.Pointer; }
+			})
+			{
+				try
+				{
+					access();
+					Assert.Fail("A released view was accessed");
+				}
+				catch (ObjectDisposedException)
+				{
+				}
+			}
+		}
+
+		[TestMethod]
+		public void CopiesRangesOfTheBlock()
+		{
+			using (var view = CreateView())
+			{
+				CollectionAssert.AreEqual(_data, view.ToArray());
+				var buffer = new byte[4];
+				view.CopyTo(5, buffer, 1, 3);
+				CollectionAssert.AreEqual(new byte[] { 0, 6, 7, 8 }, buffer);
+				try
+				{
+					view.CopyTo(6, buffer, 0, 3);
+					Assert.Fail("Copied past the end of the block");
+				}
+				catch (ArgumentOutOfRangeException)
+				{
+				}
+			}
+		}
+
+		[TestMethod]
+		public void StreamReadsFromAnyPosition()
+		{
+			using (var view = CreateView())
+			using (var stream = view.CreateStream())
+			{
+				Assert.AreEqual(_data.Length, stream.Length);
+				stream.Seek(6, SeekOrigin.Begin);
+				Assert.AreEqual(7, stream.ReadByte());
+				Assert.AreEqual(8, stream.ReadByte());
+				Assert.AreEqual(-1, stream.ReadByte());
+			}
+		}
+	}
+}
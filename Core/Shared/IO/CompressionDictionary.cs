@@ -0,0 +1,58 @@
+using System;
+
+namespace MySpace.Common.IO
+{
+	/// <summary>
+	/// A shared dictionary that small payloads of one type are compressed against by
+	/// <see cref="DictionaryCodec"/>, so each doesn't start from an empty window.
+	/// </summary>
+	public sealed class CompressionDictionary
+	{
+		/// <summary>
+		/// The longest dictionary that can be referred back to.
+		/// </summary>
+		public const int MaxLength = ushort.MaxValue;
+
+		/// <summary>
+		/// Initializes a new instance of the <see cref="CompressionDictionary"/> class.
+		/// </summary>
+		/// <param name="typeId">The type id of the payloads the dictionary is for.</param>
+		/// <param name="version">The version of the dictionary; written with each payload
+		/// compressed against it, so a new version must never reuse an old one's number.</param>
+		/// <param name="content">The dictionary bytes, most useful last.</param>
+		public CompressionDictionary(short typeId, ushort version, byte[] content)
+		{
+			if (content == null) throw new ArgumentNullException("content");
+			if (content.Length > MaxLength)
+			{
+				throw new ArgumentException(string.Format("Dictionary is {0} bytes; at most {1} are allowed",
+					content.Length, MaxLength), "content");
+			}
+			TypeId = typeId;
+			Version = version;
+			Content = content;
+			HashTable = Lz4Codec.HashDictionary(content);
+		}
+
+		/// <summary>
+		/// Gets the type id of the payloads the dictionary is for.
+		/// </summary>
+		public short TypeId { get; private set; }
+
+		/// <summary>
+		/// Gets the version of the dictionary.
+		/// </summary>
+		public ushort Version { get; private set; }
+
+		/// <summary>
+		/// Gets the dictionary bytes.
+		/// </summary>
+		public byte[] Content { get; private set; }
+
+		/// <summary>
+		/// Gets the hash table of the dictionary's positions, built once for every block
+		/// compressed against it.
+		/// </summary>
+		internal int[] HashTable { get; private set; }
+	}
+}
@@ -0,0 +1,168 @@
+using System;
+using System.Collections.Generic;
+
+namespace MySpace.Common.IO
+{
+	/// <summary>
+	/// Builds <see cref="CompressionDictionary"/> content from sample payloads.
+	/// </summary>
+	/// <remarks>
+	/// Samples are cut into fixed length segments, each scored by how many samples share the
+	/// 8 byte sequences in it. The best segments are taken greedily; once a segment is taken its
+	/// sequences stop counting, so the dictionary doesn't fill up with copies of the same bytes.
+	/// </remarks>
+	public static class CompressionDictionaryTrainer
+	{
+		/// <summary>
+		/// The dictionary length used when none is given.
+		/// </summary>
+		public const int DefaultLength = 16 * 1024;
+
+		private const int sequenceLength = 8;
+		private const int segmentLength = 64;
+
+		private class Segment
+		{
+			public byte[] Sample;
+			public int Offset;
+			public int Length;
+			public long Score;
+		}
+
+		/// <summary>
+		/// Trains dictionary content of at most <see cref="DefaultLength"/> bytes.
+		/// </summary>
+		/// <param name="samples">Uncompressed sample payloads of one type.</param>
+		/// <returns>The dictionary content; empty if the samples share nothing.</returns>
+		public static byte[] Train(IEnumerable<byte[]> samples)
+		{
+			return Train(samples, DefaultLength);
+		}
+
+		/// <summary>
+		/// Trains dictionary content.
+		/// </summary>
+		/// <param name="samples">Uncompressed sample payloads of one type.</param>
+		/// <param name="maxLength">The most bytes of content, up to <see cref="CompressionDictionary.MaxLength"/>.</param>
+		/// <returns>The dictionary content; empty if the samples share nothing.</returns>
+		public static byte[] Train(IEnumerable<byte[]> samples, int maxLength)
+		{
+			if (samples == null) throw new ArgumentNullException("samples");
+			if (maxLength < 0 || maxLength > CompressionDictionary.MaxLength)
+			{
+				throw new ArgumentOutOfRangeException("maxLength");
+			}
+
+			// count the samples each sequence appears in
+			Dictionary<ulong, int> frequencies = new Dictionary<ulong, int>();
+			List<byte[]> sampleList = new List<byte[]>();
+			HashSet<ulong> seen = new HashSet<ulong>();
+			foreach (byte[] sample in samples)
+			{
+				if (sample == null || sample.Length < sequenceLength) continue;
+				sampleList.Add(sample);
+				seen.Clear();
+				for (int i = 0; i + sequenceLength <= sample.Length; ++i)
+				{
+					ulong sequence = BitConverter.ToUInt64(sample, i);
+					if (seen.Add(sequence))
+					{
+						int frequency;
+						frequencies.TryGetValue(sequence, out frequency);
+						frequencies[sequence] = frequency + 1;
+					}
+				}
+			}
+
+			List<Segment> candidates = new List<Segment>();
+			foreach (byte[] sample in sampleList)
+			{
+				for (int offset = 0; offset + sequenceLength <= sample.Length; offset += segmentLength)
+				{
+					Segment segment = new Segment
+					{
+						Sample = sample,
+						Offset = offset,
+						Length = Math.Min(segmentLength, sample.Length - offset)
+					};
+					segment.Score = Score(segment, frequencies, seen);
+					if (segment.Score > 0)
+					{
+						candidates.Add(segment);
+					}
+				}
+			}
+			candidates.Sort((x, y) => y.Score.CompareTo(x.Score));
+
+			// lazy greedy: a segment's score only drops as others are taken, so rescore just the best
+			List<Segment> taken = new List<Segment>();
+			int length = 0;
+			while (candidates.Count > 0 && length < maxLength)
+			{
+				Segment best = candidates[0];
+				candidates.RemoveAt(0);
+				best.Score = Score(best, frequencies, seen);
+				if (best.Score == 0) continue;
+				if (candidates.Count > 0 && best.Score < candidates[0].Score)
+				{
+					Insert(candidates, best);
+					continue;
+				}
+				taken.Add(best);
+				length += best.Length;
+				for (int i = best.Offset; i + sequenceLength <= best.Offset + best.Length; ++i)
+				{
+					frequencies[BitConverter.ToUInt64(best.Sample, i)] = 0;
+				}
+			}
+
+			// the best segments go last, nearest the data compressed against them
+			byte[] content = new byte[Math.Min(length, maxLength)];
+			int position = content.Length;
+			foreach (Segment segment in taken)
+			{
+				int count = Math.Min(segment.Length, position);
+				position -= count;
+				Buffer.BlockCopy(segment.Sample, segment.Offset, content, position, count);
+				if (position == 0) break;
+			}
+			return content;
+		}
+
+		private static long Score(Segment segment, Dictionary<ulong, int> frequencies, HashSet<ulong> seen)
+		{
+			long score = 0;
+			seen.Clear();
+			for (int i = segment.Offset; i + sequenceLength <= segment.Offset + segment.Length; ++i)
+			{
+				ulong sequence = BitConverter.ToUInt64(segment.Sample, i);
+				int frequency;
+				// a sequence only one sample has is no use to the others
+				if (seen.Add(sequence) && frequencies.TryGetValue(sequence, out frequency) && frequency > 1)
+				{
+					score += frequency;
+				}
+			}
+			return score;
+		}
+
+		private static void Insert(List<Segment> candidates, Segment segment)
+		{
+			int low = 0;
+			int high = candidates.Count;
+			while (low < high)
+			{
+				int middle = (low + high) / 2;
+				if (candidates[middle].Score > segment.Score)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
+			candidates.Insert(low, segment);
+		}
+	}
+}
@@ -6,7 +6,12 @@ namespace MySpace.Common.IO
 {
 	public enum CompressionImplementation
 	{
-		ManagedZLib
+		ManagedZLib,
+		/// <summary>
+		/// The managed <see cref="Lz4Codec"/>. Data is framed with its codec id, so
+		/// readers must have this version before any writer is switched to it.
+		/// </summary>
+		LZ4
 	}
 
 	public class Compressor
@@ -117,24 +122,227 @@ namespace MySpace.Common.IO
 		}
 		
 
-		private const int zLibCompressionAmount = 6;
-		private static byte[] InternalCompress(byte[] bytes, bool useHeader, CompressionImplementation compressionImplementation)
+		/// <summary>
+		/// Compress bytes into <paramref name="buffer"/> using the supplied compression implementation and no header.
+		/// </summary>
+		/// <param name="source">The bytes to compress.</param>
+		/// <param name="compressionImplementation">The compression implementation.</param>
+		/// <param name="buffer">A caller-supplied or pooled buffer to compress into; replaced
+		/// with a larger one if it is <see langword="null"/> or too small.</param>
+		/// <returns>The compressed bytes. They are in <paramref name="buffer"/> unless the
+		/// implementation can only return a new array, as zlib does.</returns>
+		public ArraySegment<byte> Compress(ArraySegment<byte> source, CompressionImplementation compressionImplementation, ref byte[] buffer)
+		{
+			ICompressionCodec codec = GetCodec(compressionImplementation);
+			if (codec == null)
+			{
+				return new ArraySegment<byte>(InternalCompress(ToArray(source), false, compressionImplementation));
+			}
+			int maxLength = frameHeaderLength + codec.GetMaxCompressedLength(source.Count);
+			if (buffer == null || buffer.Length < maxLength)
+			{
+				buffer = new byte[maxLength];
+			}
+			return new ArraySegment<byte>(buffer, 0, CompressFramed(codec, source, buffer));
+		}
+
+		/// <summary>
+		/// Decompress bytes into <paramref name="buffer"/> using the supplied compression implementation and no header.
+		/// Data framed with a codec id is decompressed by that codec whatever the supplied implementation.
+		/// </summary>
+		/// <param name="source">The bytes to decompress.</param>
+		/// <param name="compressionImplementation">The compression implementation for data without a codec id.</param>
+		/// <param name="buffer">A caller-supplied or pooled buffer to decompress into; replaced
+		/// with a larger one if it is <see langword="null"/> or too small.</param>
+		/// <returns>The decompressed bytes. They are in <paramref name="buffer"/> unless the
+		/// implementation can only return a new array, as zlib does.</returns>
+		public ArraySegment<byte> Decompress(ArraySegment<byte> source, CompressionImplementation compressionImplementation, ref byte[] buffer)
+		{
+			ICompressionCodec codec;
+			int decompressedLength;
+			if (!TryReadFrameHeader(source, out codec, out decompressedLength))
+			{
+				return new ArraySegment<byte>(InternalDecompress(ToArray(source), false, compressionImplementation));
+			}
+			if (buffer == null || buffer.Length < decompressedLength)
+			{
+				buffer = new byte[decompressedLength];
+			}
+			DecompressFramed(codec, source, decompressedLength, buffer);
+			return new ArraySegment<byte>(buffer, 0, decompressedLength);
+		}
+
+		#region Codecs
+
+		// Framed data is (byte)frameMarker, (byte)CodecId, (int)DecompressedLength and then the
+		// codec's output. The marker can't start gzip, zlib or raw deflate data, so data
+		// compressed before codecs were framed still decompresses as zlib, and data that
+		// isn't a valid frame gets the zlib handling, which returns uncompressed data as it was.
+		private const byte frameMarker = 0xC7;
+		private const int frameHeaderLength = 2 + sizeof(int);
+
+		private static ICompressionCodec[] codecs = CreateCodecs();
+
+		private static readonly object codecsLock = new object();
+
+		private static ICompressionCodec[] CreateCodecs()
+		{
+			ICompressionCodec[] ret = new ICompressionCodec[byte.MaxValue + 1];
+			ret[Lz4Codec.Id] = new Lz4Codec();
+			ret[DictionaryCodec.Id] = new DictionaryCodec();
+			return ret;
+		}
+
+		/// <summary>
+		/// Registers a codec so data framed with its id can be decompressed.
+		/// </summary>
+		/// <param name="codec">The codec.</param>
+		/// <exception cref="ArgumentException">A different codec is registered with the same id.</exception>
+		public static void RegisterCodec(ICompressionCodec codec)
+		{
+			if (codec == null) throw new ArgumentNullException("codec");
+			lock (codecsLock)
+			{
+				ICompressionCodec registered = codecs[codec.CodecId];
+				if (registered == codec) return;
+				if (registered != null)
+				{
+					throw new ArgumentException(string.Format("Codec id {0} is already registered to {1}",
+						codec.CodecId, registered.GetType().FullName), "codec");
+				}
+				// copy on write so readers need no lock
+				ICompressionCodec[] newCodecs = (ICompressionCodec[])codecs.Clone();
+				newCodecs[codec.CodecId] = codec;
+				codecs = newCodecs;
+			}
+		}
+
+		/// <summary>
+		/// Gets the codec registered with an id.
+		/// </summary>
+		/// <returns>The codec, or <see langword="null"/> if none is registered.</returns>
+		public static ICompressionCodec GetCodec(byte codecId)
+		{
+			return codecs[codecId];
+		}
+
+		/// <summary>
+		/// Compresses with a codec, framing the output with the codec's id.
+		/// </summary>
+		/// <param name="codec">The codec.</param>
+		/// <param name="source">The bytes to compress.</param>
+		/// <returns>The framed bytes.</returns>
+		public byte[] Compress(ICompressionCodec codec, ArraySegment<byte> source)
+		{
+			if (codec == null) throw new ArgumentNullException("codec");
+			byte[] buffer = new byte[frameHeaderLength + codec.GetMaxCompressedLength(source.Count)];
+			int length = CompressFramed(codec, source, buffer);
+			if (length == buffer.Length) return buffer;
+			byte[] ret = new byte[length];
+			Buffer.BlockCopy(buffer, 0, ret, 0, length);
+			return ret;
+		}
+
+		private static ICompressionCodec GetCodec(CompressionImplementation compressionImplementation)
 		{
 			switch (compressionImplementation)
 			{
 				case CompressionImplementation.ManagedZLib:
-					return ManagedZLibWrapper.Compress(bytes, zLibCompressionAmount, useHeader);                    
+					return null;
+				case CompressionImplementation.LZ4:
+					return codecs[Lz4Codec.Id];
 				default:
 					throw new ApplicationException(string.Format("Unknown compression implementation {0}", compressionImplementation));
 			}
 		}
 
+		private static int CompressFramed(ICompressionCodec codec, ArraySegment<byte> source, byte[] buffer)
+		{
+			buffer[0] = frameMarker;
+			buffer[1] = codec.CodecId;
+			buffer[2] = (byte)source.Count;
+			buffer[3] = (byte)(source.Count >> 8);
+			buffer[4] = (byte)(source.Count >> 16);
+			buffer[5] = (byte)(source.Count >> 24);
+			return frameHeaderLength + codec.Compress(source.Array, source.Offset, source.Count, buffer, frameHeaderLength);
+		}
+
+		private static bool TryReadFrameHeader(ArraySegment<byte> source, out ICompressionCodec codec, out int decompressedLength)
+		{
+			codec = null;
+			decompressedLength = 0;
+			if (source.Count < frameHeaderLength || source.Array[source.Offset] != frameMarker)
+			{
+				return false;
+			}
+			// not a frame we could have written; leave it to the zlib handling
+			codec = codecs[source.Array[source.Offset + 1]];
+			if (codec == null)
+			{
+				return false;
+			}
+			decompressedLength = BitConverter.ToInt32(source.Array, source.Offset + 2);
+			if (decompressedLength < 0
+				|| source.Count - frameHeaderLength > codec.GetMaxCompressedLength(decompressedLength))
+			{
+				codec = null;
+				decompressedLength = 0;
+				return false;
+			}
+			return true;
+		}
+
+		private static void DecompressFramed(ICompressionCodec codec, ArraySegment<byte> source, int decompressedLength, byte[] buffer)
+		{
+			int written = codec.Decompress(source.Array, source.Offset + frameHeaderLength, source.Count - frameHeaderLength,
+				buffer, 0, decompressedLength);
+			if (written != decompressedLength)
+			{
+				throw new ApplicationException(string.Format("Compressed data decompressed to {0} bytes instead of {1}",
+					written, decompressedLength));
+			}
+		}
+
+		private static byte[] ToArray(ArraySegment<byte> segment)
+		{
+			if (segment.Offset == 0 && segment.Count == segment.Array.Length)
+			{
+				return segment.Array;
+			}
+			byte[] ret = new byte[segment.Count];
+			Buffer.BlockCopy(segment.Array, segment.Offset, ret, 0, segment.Count);
+			return ret;
+		}
+
+		#endregion
+
+		private const int zLibCompressionAmount = 6;
+		private static byte[] InternalCompress(byte[] bytes, bool useHeader, CompressionImplementation compressionImplementation)
+		{
+			ICompressionCodec codec = GetCodec(compressionImplementation);
+			if (codec != null)
+			{
+				return Instance.Compress(codec, new ArraySegment<byte>(bytes));
+			}
+			return ManagedZLibWrapper.Compress(bytes, zLibCompressionAmount, useHeader);
+		}
+
 		
 		private static byte[] InternalDecompress(byte[] bytes, bool useHeader, CompressionImplementation compressionImplementation)
 		{
+			ICompressionCodec codec;
+			int decompressedLength;
+			if (bytes != null && TryReadFrameHeader(new ArraySegment<byte>(bytes), out codec, out decompressedLength))
+			{
+				byte[] buffer = new byte[decompressedLength];
+				DecompressFramed(codec, new ArraySegment<byte>(bytes), decompressedLength, buffer);
+				return buffer;
+			}
 			switch (compressionImplementation)
 			{
 				case CompressionImplementation.ManagedZLib:
+				case CompressionImplementation.LZ4:
+					// data without a codec id was written by zlib
 					byte[] decompressed = null;
 					try
 					{
@@ -0,0 +1,149 @@
+using System;
+using System.Collections.Generic;
+
+namespace MySpace.Common.IO
+{
+	/// <summary>
+	/// Compresses with <see cref="Lz4Codec"/> against a type's shared <see cref="CompressionDictionary"/>.
+	/// </summary>
+	/// <remarks>
+	/// Output is (short)TypeId, (ushort)Version and then the compressed bytes, so every dictionary
+	/// version still registered can be read after a newer one takes over writing. The instance
+	/// registered with <see cref="Compressor"/> only decompresses; get one that compresses from
+	/// <see cref="GetCodec"/>.
+	/// </remarks>
+	public sealed class DictionaryCodec : ICompressionCodec
+	{
+		/// <summary>
+		/// The codec id written in the compression header.
+		/// </summary>
+		public const byte Id = 2;
+
+		private const int headerLength = sizeof(short) + sizeof(ushort);
+
+		private static readonly object dictionariesLock = new object();
+
+		// all dictionaries ever set, by type id and version, so stored data stays readable
+		private static Dictionary<int, CompressionDictionary> dictionaries = new Dictionary<int, CompressionDictionary>();
+
+		// the codec writing each type id, with its newest dictionary
+		private static Dictionary<short, DictionaryCodec> writers = new Dictionary<short, DictionaryCodec>();
+
+		private readonly CompressionDictionary dictionary;
+
+		/// <summary>
+		/// Initializes a new instance of the <see cref="DictionaryCodec"/> class that only decompresses.
+		/// </summary>
+		internal DictionaryCodec()
+		{
+		}
+
+		private DictionaryCodec(CompressionDictionary dictionary)
+		{
+			this.dictionary = dictionary;
+		}
+
+		/// <summary>
+		/// Sets the dictionaries in use. The newest version for each type id is used to compress
+		/// that type; every dictionary ever set stays available to decompress with.
+		/// </summary>
+		/// <param name="compressionDictionaries">The dictionaries.</param>
+		public static void SetDictionaries(IEnumerable<CompressionDictionary> compressionDictionaries)
+		{
+			if (compressionDictionaries == null) throw new ArgumentNullException("compressionDictionaries");
+			lock (dictionariesLock)
+			{
+				// copy on write so readers need no lock
+				Dictionary<int, CompressionDictionary> newDictionaries = new Dictionary<int, CompressionDictionary>(dictionaries);
+				Dictionary<short, DictionaryCodec> newWriters = new Dictionary<short, DictionaryCodec>();
+				foreach (CompressionDictionary compressionDictionary in compressionDictionaries)
+				{
+					newDictionaries[GetKey(compressionDictionary.TypeId, compressionDictionary.Version)] = compressionDictionary;
+					DictionaryCodec writer;
+					if (!newWriters.TryGetValue(compressionDictionary.TypeId, out writer) ||
+						writer.dictionary.Version < compressionDictionary.Version)
+					{
+						newWriters[compressionDictionary.TypeId] = new DictionaryCodec(compressionDictionary);
+					}
+				}
+				dictionaries = newDictionaries;
+				writers = newWriters;
+			}
+		}
+
+		/// <summary>
+		/// Gets the codec that compresses a type against its newest dictionary.
+		/// </summary>
+		/// <param name="typeId">The type id.</param>
+		/// <returns>The codec, or <see langword="null"/> if the type has no dictionary.</returns>
+		public static DictionaryCodec GetCodec(short typeId)
+		{
+			DictionaryCodec writer;
+			return writers.TryGetValue(typeId, out writer) ? writer : null;
+		}
+
+		private static int GetKey(short typeId, ushort version)
+		{
+			return (typeId << 16) | version;
+		}
+
+		#region ICompressionCodec Members
+
+		/// <summary>
+		/// Gets the id written in the compression header.
+		/// </summary>
+		public byte CodecId
+		{
+			get { return Id; }
+		}
+
+		/// <summary>
+		/// Gets the most bytes <see cref="Compress"/> can write for <paramref name="length"/> input bytes.
+		/// </summary>
+		public int GetMaxCompressedLength(int length)
+		{
+			return headerLength + length + (length / 255) + 16;
+		}
+
+		/// <summary>
+		/// Compresses bytes into a caller-supplied buffer.
+		/// </summary>
+		/// <exception cref="InvalidOperationException">The codec has no dictionary; get one from <see cref="GetCodec"/>.</exception>
+		public int Compress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset)
+		{
+			if (dictionary == null)
+			{
+				throw new InvalidOperationException("This DictionaryCodec only decompresses; use DictionaryCodec.GetCodec to compress");
+			}
+			destination[destinationOffset] = (byte)dictionary.TypeId;
+			destination[destinationOffset + 1] = (byte)(dictionary.TypeId >> 8);
+			destination[destinationOffset + 2] = (byte)dictionary.Version;
+			destination[destinationOffset + 3] = (byte)(dictionary.Version >> 8);
+			return headerLength + Lz4Codec.Compress(dictionary, source, sourceOffset, count,
+				destination, destinationOffset + headerLength);
+		}
+
+		/// <summary>
+		/// Decompresses bytes into a caller-supplied buffer, using the dictionary they name.
+		/// </summary>
+		public int Decompress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset, int decompressedLength)
+		{
+			if (count < headerLength)
+			{
+				throw new ApplicationException("Dictionary compressed data is too short");
+			}
+			short typeId = (short)(source[sourceOffset] | (source[sourceOffset + 1] << 8));
+			ushort version = (ushort)(source[sourceOffset + 2] | (source[sourceOffset + 3] << 8));
+			CompressionDictionary compressionDictionary;
+			if (!dictionaries.TryGetValue(GetKey(typeId, version), out compressionDictionary))
+			{
+				throw new ApplicationException(string.Format("No compression dictionary version {0} for type id {1}",
+					version, typeId));
+			}
+			return Lz4Codec.Decompress(compressionDictionary.Content, source, sourceOffset + headerLength, count - headerLength,
+				destination, destinationOffset, decompressedLength);
+		}
+
+		#endregion
+	}
+}
@@ -0,0 +1,44 @@
+namespace MySpace.Common.IO
+{
+	/// <summary>
+	/// A block compression codec that <see cref="Compressor"/> can frame with a codec id,
+	/// so data it writes can be told apart from other codecs' and from unframed zlib data.
+	/// </summary>
+	public interface ICompressionCodec
+	{
+		/// <summary>
+		/// Gets the id written in the compression header. Ids are never reused for a
+		/// different format, since stored data must stay readable.
+		/// </summary>
+		byte CodecId { get; }
+
+		/// <summary>
+		/// Gets the most bytes <see cref="Compress"/> can write for <paramref name="length"/> input bytes.
+		/// </summary>
+		int GetMaxCompressedLength(int length);
+
+		/// <summary>
+		/// Compresses bytes into a caller-supplied buffer.
+		/// </summary>
+		/// <param name="source">The buffer holding the bytes to compress.</param>
+		/// <param name="sourceOffset">The offset of the first byte to compress.</param>
+		/// <param name="count">The number of bytes to compress.</param>
+		/// <param name="destination">The buffer to write to; must have room for
+		/// <see cref="GetMaxCompressedLength"/> bytes.</param>
+		/// <param name="destinationOffset">The offset to start writing at.</param>
+		/// <returns>The number of bytes written.</returns>
+		int Compress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset);
+
+		/// <summary>
+		/// Decompresses bytes into a caller-supplied buffer.
+		/// </summary>
+		/// <param name="source">The buffer holding the compressed bytes.</param>
+		/// <param name="sourceOffset">The offset of the first compressed byte.</param>
+		/// <param name="count">The number of compressed bytes.</param>
+		/// <param name="destination">The buffer to write to.</param>
+		/// <param name="destinationOffset">The offset to start writing at.</param>
+		/// <param name="decompressedLength">The number of bytes the data decompresses to.</param>
+		/// <returns>The number of bytes written.</returns>
+		int Decompress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset, int decompressedLength);
+	}
+}
@@ -0,0 +1,353 @@
+using System;
+
+namespace MySpace.Common.IO
+{
+	/// <summary>
+	/// A managed codec for the LZ4 block format: greedy matching over a 4K entry hash
+	/// table, trading compression ratio for far less CPU than zlib.
+	/// </summary>
+	public sealed class Lz4Codec : ICompressionCodec
+	{
+		/// <summary>
+		/// The codec id written in the compression header.
+		/// </summary>
+		public const byte Id = 1;
+
+		private const int MinMatch = 4;
+		private const int HashLog = 12;
+		private const int MaxDistance = ushort.MaxValue;
+		// the format ends every block with at least this many literals...
+		private const int LastLiterals = 5;
+		// ...and starts no match closer than this to the end
+		private const int MatchFindLimit = 12;
+		private const int RunMask = 15;
+
+		[ThreadStatic]
+		private static int[] _hashTable;
+
+		#region ICompressionCodec Members
+
+		/// <summary>
+		/// Gets the id written in the compression header.
+		/// </summary>
+		public byte CodecId
+		{
+			get { return Id; }
+		}
+
+		/// <summary>
+		/// Gets the most bytes <see cref="Compress"/> can write for <paramref name="length"/> input bytes.
+		/// </summary>
+		public int GetMaxCompressedLength(int length)
+		{
+			return length + (length / 255) + 16;
+		}
+
+		/// <summary>
+		/// Compresses bytes into a caller-supplied buffer.
+		/// </summary>
+		public int Compress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset)
+		{
+			return CompressBlock(null, source, sourceOffset, sourceOffset + count, destination, destinationOffset);
+		}
+
+		/// <summary>
+		/// Compresses bytes that may refer back into a dictionary, as if the dictionary preceded them.
+		/// </summary>
+		internal static int Compress(CompressionDictionary dictionary, byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset)
+		{
+			return CompressBlock(dictionary, source, sourceOffset, sourceOffset + count, destination, destinationOffset);
+		}
+
+		/// <summary>
+		/// Builds the hash table of a dictionary's positions, which every block compressed
+		/// against the dictionary looks up in place of hashing the dictionary again.
+		/// </summary>
+		/// <returns>The table; entries are a position plus one, or zero for none.</returns>
+		internal static int[] HashDictionary(byte[] dictionary)
+		{
+			var table = new int[1 << HashLog];
+			// later positions overwrite earlier ones, so each entry is the closest
+			for (int p = 0; p + MinMatch <= dictionary.Length; ++p)
+			{
+				table[Hash(ReadUInt32(dictionary, p))] = p + 1;
+			}
+			return table;
+		}
+
+		/// <summary>
+		/// Compresses source[start, end), finding matches back into <paramref name="dictionary"/>,
+		/// which may be <see langword="null"/>, as if it preceded the source.
+		/// </summary>
+		private static int CompressBlock(CompressionDictionary dictionary, byte[] source, int start, int end, byte[] destination, int destinationOffset)
+		{
+			var table = _hashTable;
+			if (table == null)
+			{
+				_hashTable = table = new int[1 << HashLog];
+			}
+			else
+			{
+				Array.Clear(table, 0, table.Length);
+			}
+
+			byte[] dictionaryContent = dictionary != null ? dictionary.Content : null;
+			int[] dictionaryTable = dictionary != null ? dictionary.HashTable : null;
+			int dictionaryLength = dictionaryContent != null ? dictionaryContent.Length : 0;
+
+			int ip = start;
+			int anchor = ip;
+			int op = destinationOffset;
+
+			if (end - start > MatchFindLimit)
+			{
+				int matchFindLimit = end - MatchFindLimit;
+				int matchLimit = end - LastLiterals;
+				if (dictionaryLength == 0)
+				{
+					++ip;
+				}
+				while (ip < matchFindLimit)
+				{
+					uint sequence = ReadUInt32(source, ip);
+					int hash = Hash(sequence);
+					// table entries are offsets from start plus one, so a cleared entry is empty
+					int entry = table[hash];
+					table[hash] = ip - start + 1;
+					int offset;
+					int matchLength = MinMatch;
+					if (entry != 0)
+					{
+						int candidate = start + entry - 1;
+						offset = ip - candidate;
+						if (offset > MaxDistance || ReadUInt32(source, candidate) != sequence)
+						{
+							// step faster through data that isn't matching
+							ip += 1 + ((ip - anchor) >> 6);
+							continue;
+						}
+						while (ip > anchor && candidate > start && source[ip - 1] == source[candidate - 1])
+						{
+							--ip;
+							--candidate;
+						}
+						while (ip + matchLength < matchLimit && source[ip + matchLength] == source[candidate + matchLength])
+						{
+							++matchLength;
+						}
+					}
+					else if (dictionaryTable != null && (entry = dictionaryTable[hash]) != 0)
+					{
+						// match against the dictionary where it is, as if it ended at start
+						int candidate = entry - 1;
+						offset = ip - start + dictionaryLength - candidate;
+						if (offset > MaxDistance || ReadUInt32(dictionaryContent, candidate) != sequence)
+						{
+							ip += 1 + ((ip - anchor) >> 6);
+							continue;
+						}
+						while (ip > anchor && candidate > 0 && source[ip - 1] == dictionaryContent[candidate - 1])
+						{
+							--ip;
+							--candidate;
+						}
+						while (ip + matchLength < matchLimit && candidate + matchLength < dictionaryLength &&
+							source[ip + matchLength] == dictionaryContent[candidate + matchLength])
+						{
+							++matchLength;
+						}
+						if (candidate + matchLength == dictionaryLength)
+						{
+							// the match runs off the end of the dictionary into the start of the source
+							int next = start;
+							while (ip + matchLength < matchLimit && source[ip + matchLength] == source[next])
+							{
+								++matchLength;
+								++next;
+							}
+						}
+					}
+					else
+					{
+						ip += 1 + ((ip - anchor) >> 6);
+						continue;
+					}
+
+					int token = op++;
+					destination[token] = WriteLength(destination, ref op, ip - anchor, 4);
+					Buffer.BlockCopy(source, anchor, destination, op, ip - anchor);
+					op += ip - anchor;
+					destination[op++] = (byte)offset;
+					destination[op++] = (byte)(offset >> 8);
+					destination[token] |= WriteLength(destination, ref op, matchLength - MinMatch, 0);
+
+					ip += matchLength;
+					anchor = ip;
+					if (ip < matchFindLimit)
+					{
+						table[Hash(ReadUInt32(source, ip - 2))] = ip - 2 - start + 1;
+					}
+				}
+			}
+
+			int lastToken = op++;
+			destination[lastToken] = WriteLength(destination, ref op, end - anchor, 4);
+			Buffer.BlockCopy(source, anchor, destination, op, end - anchor);
+			op += end - anchor;
+			return op - destinationOffset;
+		}
+
+		/// <summary>
+		/// Decompresses bytes into a caller-supplied buffer.
+		/// </summary>
+		public int Decompress(byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset, int decompressedLength)
+		{
+			return Decompress(null, source, sourceOffset, count, destination, destinationOffset, decompressedLength);
+		}
+
+		/// <summary>
+		/// Decompresses bytes compressed against a dictionary, which may be <see langword="null"/>.
+		/// </summary>
+		internal static int Decompress(byte[] dictionary, byte[] source, int sourceOffset, int count, byte[] destination, int destinationOffset, int decompressedLength)
+		{
+			if (destinationOffset + decompressedLength > destination.Length)
+			{
+				throw new ArgumentException("Destination buffer is too small", "destination");
+			}
+			return DecompressBlock(dictionary, source, sourceOffset, count, destination, destinationOffset, decompressedLength);
+		}
+
+		/// <summary>
+		/// Decompresses into destination from <paramref name="start"/>, resolving matches before
+		/// <paramref name="start"/> into the end of <paramref name="dictionary"/>.
+		/// </summary>
+		private static int DecompressBlock(byte[] dictionary, byte[] source, int sourceOffset, int count, byte[] destination, int start, int decompressedLength)
+		{
+			int dictionaryLength = dictionary != null ? dictionary.Length : 0;
+			int ip = sourceOffset;
+			int sourceEnd = sourceOffset + count;
+			int op = start;
+			int destinationEnd = start + decompressedLength;
+
+			while (ip < sourceEnd)
+			{
+				int token = source[ip++];
+
+				int literalLength = ReadLength(source, ref ip, sourceEnd, token >> 4);
+				if (literalLength > sourceEnd - ip || literalLength > destinationEnd - op)
+				{
+					throw CorruptData();
+				}
+				Buffer.BlockCopy(source, ip, destination, op, literalLength);
+				ip += literalLength;
+				op += literalLength;
+				if (ip == sourceEnd)
+				{
+					// the last sequence has literals only
+					break;
+				}
+
+				if (sourceEnd - ip < 2)
+				{
+					throw CorruptData();
+				}
+				int offset = source[ip] | (source[ip + 1] << 8);
+				ip += 2;
+				int match = op - offset;
+				if (offset == 0 || match < start - dictionaryLength)
+				{
+					throw CorruptData();
+				}
+
+				int matchLength = ReadLength(source, ref ip, sourceEnd, token & RunMask) + MinMatch;
+				if (matchLength > destinationEnd - op)
+				{
+					throw CorruptData();
+				}
+				if (match < start)
+				{
+					// the match starts in the dictionary and may run on into the output
+					int fromDictionary = Math.Min(matchLength, start - match);
+					Buffer.BlockCopy(dictionary, dictionaryLength - (start - match), destination, op, fromDictionary);
+					op += fromDictionary;
+					matchLength -= fromDictionary;
+					match = start;
+				}
+				if (op - match >= matchLength)
+				{
+					Buffer.BlockCopy(destination, match, destination, op, matchLength);
+					op += matchLength;
+				}
+				else
+				{
+					// overlapping copy repeats the last offset bytes
+					for (int i = 0; i < matchLength; ++i)
+					{
+						destination[op++] = destination[match++];
+					}
+				}
+			}
+			return op - start;
+		}
+
+		#endregion
+
+		private static int Hash(uint sequence)
+		{
+			return (int)((sequence * 2654435761U) >> (32 - HashLog));
+		}
+
+		private static uint ReadUInt32(byte[] buffer, int offset)
+		{
+			return (uint)(buffer[offset] | (buffer[offset + 1] << 8) | (buffer[offset + 2] << 16) | (buffer[offset + 3] << 24));
+		}
+
+		/// <summary>
+		/// Writes the extra bytes of a length that doesn't fit in its half of the token.
+		/// </summary>
+		/// <returns>The token bits for the length, already shifted by <paramref name="shift"/>.</returns>
+		private static byte WriteLength(byte[] destination, ref int op, int length, int shift)
+		{
+			if (length < RunMask)
+			{
+				return (byte)(length << shift);
+			}
+			length -= RunMask;
+			while (length >= 255)
+			{
+				destination[op++] = 255;
+				length -= 255;
+			}
+			destination[op++] = (byte)length;
+			return (byte)(RunMask << shift);
+		}
+
+		private static int ReadLength(byte[] source, ref int ip, int sourceEnd, int length)
+		{
+			if (length != RunMask)
+			{
+				return length;
+			}
+			int next;
+			do
+			{
+				if (ip >= sourceEnd)
+				{
+					throw CorruptData();
+				}
+				next = source[ip++];
+				length += next;
+				if (length < 0)
+				{
+					throw CorruptData();
+				}
+			} while (next == 255);
+			return length;
+		}
+
+		private static ApplicationException CorruptData()
+		{
+			return new ApplicationException("LZ4 compressed data is corrupt");
+		}
+	}
+}
@@ -343,14 +343,43 @@ namespace MySpace.Common.IO
 			//  Compress result if requested
 			if ((flags & SerializerFlags.Compress) != 0)
 			{
-				byte[] bytes = stream.ToArray();
-
-				bytes = Compressor.GetInstance().Compress(bytes, compression);
+				ArraySegment<byte> compressed = Compressor.GetInstance().Compress(
+					GetContents(stream), compression, ref _compressionBuffer);
 
 				stream.Seek(0, SeekOrigin.Begin);
-				stream.SetLength(bytes.Length);
-				stream.Write(bytes, 0, bytes.Length);
+				stream.SetLength(compressed.Count);
+				stream.Write(compressed.Array, compressed.Offset, compressed.Count);
+				if (_compressionBuffer != null && _compressionBuffer.Length > maxPooledCompressionBufferLength)
+				{
+					// don't hold on to the odd huge buffer for the life of the thread
+					_compressionBuffer = null;
+				}
+			}
+		}
+
+		private const int maxPooledCompressionBufferLength = 1 << 20;
+
+		[ThreadStatic]
+		private static byte[] _compressionBuffer;
+
+		/// <summary>
+		/// Gets the whole of a stream's contents, without copying them if it's a <see cref="MemoryStream"/>.
+		/// </summary>
+		private static ArraySegment<byte> GetContents(Stream stream)
+		{
+			MemoryStream memoryStream = stream as MemoryStream;
+			if (memoryStream != null)
+			{
+				try
+				{
+					return new ArraySegment<byte>(memoryStream.GetBuffer(), 0, (int)memoryStream.Length);
+				}
+				catch (UnauthorizedAccessException)
+				{
+					// the stream was created over a buffer it doesn't expose
+				}
 			}
+			return new ArraySegment<byte>(stream.ToArray());
 		}
 
 		#endregion // Serialize Overloads
@@ -0,0 +1,225 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Security;
+using System.Threading;
+
+namespace MySpace.Common.Storage
+{
+	/// <summary>
+	/// A reference counted, read-only view over a block of unmanaged memory
+	/// that is cleaned up once the last reference is released.
+	/// </summary>
+	/// <remarks>
+	/// <para>The view owns one reference when created; <see cref="Dispose"/>
+	/// releases it. Each <see cref="AddReference"/> and each stream from
+	/// <see cref="CreateStream"/> holds another, so a view can be handed to
+	/// a writer that outlives the reader that obtained it.</para>
+	/// </remarks>
+	[SuppressUnmanagedCodeSecurity]
+	public unsafe sealed class UnmanagedMemoryView : IDisposable
+	{
+		private readonly byte* _pointer;
+		private readonly int _length;
+		private PostAccessUnmanagedMemoryCleanup _cleanup;
+		private PostAccessUnmanagedMemoryCleanup _releaseStream;
+		private int _references;
+		private int _disposed;
+
+		/// <summary>
+		/// 	<para>Initializes a new instance of the <see cref="UnmanagedMemoryView"/> class.</para>
+		/// </summary>
+		/// <param name="pointer">
+		/// 	<para>Pointer to the unmanaged binary data block.</para>
+		/// </param>
+		/// <param name="length">
+		/// 	<para>Length of the block.</para>
+		/// </param>
+		/// <param name="cleanup">
+		/// 	<para>Action that cleans up block once the last reference is released.</para>
+		/// </param>
+		/// <exception cref="ArgumentNullException">
+		/// <para><paramref name="pointer"/> is <see langword="null"/>.</para>
+		/// <para>-or-</para>
+		/// <para><paramref name="cleanup"/> is <see langword="null"/>.</para>
+		/// </exception>
+		/// <exception cref="ArgumentOutOfRangeException">
+		/// <para><paramref name="length"/> is less than 0.</para>
+		/// </exception>
+		public UnmanagedMemoryView(byte* pointer, int length, PostAccessUnmanagedMemoryCleanup cleanup)
+		{
+			if (pointer == null) throw new ArgumentNullException("pointer");
+			if (length < 0) throw new ArgumentOutOfRangeException("length");
+			if (cleanup == null) throw new ArgumentNullException("cleanup");
+			_pointer = pointer;
+			_length = length;
+			_cleanup = cleanup;
+			_references = 1;
+		}
+
+		~UnmanagedMemoryView()
+		{
+			// only reached once no stream or holder can still reach the block
+			Free();
+		}
+
+		/// <summary>
+		/// 	<para>Gets the pointer to the start of the block.</para>
+		/// </summary>
+		/// <exception cref="ObjectDisposedException">
+		/// 	<para>All references have been released.</para>
+		/// </exception>
+		public IntPtr Pointer
+		{
+			get
+			{
+				AssertAlive();
+				return new IntPtr(_pointer);
+			}
+		}
+
+		/// <summary>
+		/// 	<para>Gets the length in bytes of the block.</para>
+		/// </summary>
+		public int Length
+		{
+			get { return _length; }
+		}
+
+		/// <summary>
+		/// 	<para>Adds a reference that must be matched by a call to
+		///		<see cref="Release"/>.</para>
+		/// </summary>
+		/// <returns>
+		/// 	<para>This instance.</para>
+		/// </returns>
+		/// <exception cref="ObjectDisposedException">
+		/// 	<para>All references have been released.</para>
+		/// </exception>
+		public UnmanagedMemoryView AddReference()
+		{
+			int references;
+			do
+			{
+				references = _references;
+				if (references <= 0) throw new ObjectDisposedException(typeof(UnmanagedMemoryView).Name);
+			} while (Interlocked.CompareExchange(ref _references, references + 1, references) != references);
+			return this;
+		}
+
+		/// <summary>
+		/// 	<para>Releases a reference; the block is cleaned up when the last
+		///		one is released.</para>
+		/// </summary>
+		public void Release()
+		{
+			if (Interlocked.Decrement(ref _references) == 0)
+			{
+				Free();
+				GC.SuppressFinalize(this);
+			}
+		}
+
+		/// <summary>
+		/// 	<para>Releases the reference owned by the creator of the view. Further
+		///		calls do nothing.</para>
+		/// </summary>
+		public void Dispose()
+		{
+			if (Interlocked.Exchange(ref _disposed, 1) == 0)
+			{
+				Release();
+			}
+		}
+
+		/// <summary>
+		/// 	<para>Creates a stream over the block that holds a reference
+		///		until it is closed.</para>
+		/// </summary>
+		/// <returns>
+		/// 	<para>A <see cref="SafeUnmanagedMemoryStream"/> positioned at the start of the block.</para>
+		/// </returns>
+		/// <exception cref="ObjectDisposedException">
+		/// 	<para>All references have been released.</para>
+		/// </exception>
+		public SafeUnmanagedMemoryStream CreateStream()
+		{
+			AddReference();
+			if (_releaseStream == null)
+			{
+				_releaseStream = ReleaseStream;
+			}
+			return new SafeUnmanagedMemoryStream(_pointer, _length, _releaseStream);
+		}
+
+		/// <summary>
+		/// 	<para>Copies a portion of the block into a managed array.</para>
+		/// </summary>
+		/// <param name="sourceOffset">
+		/// 	<para>The offset in the block at which to start copying.</para>
+		/// </param>
+		/// <param name="buffer">
+		/// 	<para>The array to copy into.</para>
+		/// </param>
+		/// <param name="offset">
+		/// 	<para>The offset in <paramref name="buffer"/> at which to start writing.</para>
+		/// </param>
+		/// <param name="count">
+		/// 	<para>The number of bytes to copy.</para>
+		/// </param>
+		/// <exception cref="ArgumentNullException">
+		/// 	<para><paramref name="buffer"/> is <see langword="null"/>.</para>
+		/// </exception>
+		/// <exception cref="ArgumentOutOfRangeException">
+		/// 	<para>The source or destination range is outside the block or array.</para>
+		/// </exception>
+		/// <exception cref="ObjectDisposedException">
+		/// 	<para>All references have been released.</para>
+		/// </exception>
+		public void CopyTo(int sourceOffset, byte[] buffer, int offset, int count)
+		{
+			if (buffer == null) throw new ArgumentNullException("buffer");
+			if (sourceOffset < 0 || sourceOffset > _length) throw new ArgumentOutOfRangeException("sourceOffset");
+			if (offset < 0) throw new ArgumentOutOfRangeException("offset");
+			if (count < 0 || sourceOffset + count > _length || offset + count > buffer.Length)
+				throw new ArgumentOutOfRangeException("count");
+			AssertAlive();
+			if (count == 0) return;
+			Marshal.Copy(new IntPtr(_pointer + sourceOffset), buffer, offset, count);
+		}
+
+		/// <summary>
+		/// 	<para>Copies the block into a new managed array.</para>
+		/// </summary>
+		/// <returns>
+		/// 	<para>A <see cref="Byte"/> array with the contents of the block.</para>
+		/// </returns>
+		/// <exception cref="ObjectDisposedException">
+		/// 	<para>All references have been released.</para>
+		/// </exception>
+		public byte[] ToArray()
+		{
+			var ret = new byte[_length];
+			CopyTo(0, ret, 0, _length);
+			return ret;
+		}
+
+		private void ReleaseStream(void* pointer)
+		{
+			Release();
+		}
+
+		private void AssertAlive()
+		{
+			if (_references <= 0) throw new ObjectDisposedException(typeof(UnmanagedMemoryView).Name);
+		}
+
+		private void Free()
+		{
+			var cleanup = Interlocked.Exchange(ref _cleanup, null);
+			if (cleanup != null)
+			{
+				cleanup(_pointer);
+			}
+		}
+	}
+}
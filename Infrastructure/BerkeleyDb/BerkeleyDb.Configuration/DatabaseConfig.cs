@@ -419,6 +419,7 @@ namespace MySpace.BerkeleyDb.Configuration
 	{
 		None = 0,
 		PerCall = 1,
+		GroupCommit = 2,
 	}
 
 	
@@ -15,6 +15,8 @@ namespace MySpace.BerkeleyDb.Facade
 	/// Backups database for restoration. Backups are not necessarily complete in themselves, since
 	/// databases without transactions in logs won't be copied. That's why Restore copies the files
 	/// back to the home directory without deleting existing files, just copying over as necessary.
+	/// An incremental backup adds delta files holding only the pages changed since the previous
+	/// backup; Restore applies them in order over the copied data files.
 	/// </summary>
 	public class BackupSet
 	{
@@ -36,6 +38,8 @@ namespace MySpace.BerkeleyDb.Facade
 			dataFilesCopied = new List<string>();
 			logFilesCopied = new List<string>();
 			lastCheckpointLogNumber = -1;
+			deltaSinceLsn = 0;
+			baseCheckpointLsn = 0;
 			copyLogFiles = backupConfig.CopyLogs;
 			backupMethod = backupConfig.Method;
 			dataCopyBufferSize = backupConfig.DataCopyBufferKByte * 1024;
@@ -53,6 +57,7 @@ namespace MySpace.BerkeleyDb.Facade
 		public string HomeDirectory { get { return homeDir; } }
 		public string BackupDirectory { get { return backupDir; } }
 		public byte[] CopyBuffer { get { return copyBuffer; } set { copyBuffer = value; } }
+		public int IncrementalBackupCount { get { return incrementalBackupCount; } }
 
 		static BackupSet()
 		{
@@ -111,6 +116,11 @@ namespace MySpace.BerkeleyDb.Facade
 				if (!IsInitialized)
 				{
 					ClearDirectory(backupDir);
+					// deltas of a previous set don't apply to the data files about to be copied
+					string deltaDir = Path.Combine(backupDir, deltaDirectoryName);
+					if (Directory.Exists(deltaDir)) Directory.Delete(deltaDir, true);
+					deltaSinceLsn = storage.Environment.GetLastCheckpointLsn();
+					baseCheckpointLsn = deltaSinceLsn;
 				}
 
 				// Get log of last checkpoint for last checkpoint
@@ -236,6 +246,91 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		/// <summary>
+		/// Brings an initialized backup up to date without recopying its data files. Every data file
+		/// already copied gets a delta file of the pages changed since the previous full or
+		/// incremental backup, then new data files and the log files are handled as in
+		/// <see cref="Backup"/>. Catastrophic recovery of the base data files with the deltas applied
+		/// can need any log from the base backup's checkpoint on, so only the backup log files
+		/// preceding that checkpoint are removed.
+		/// </summary>
+		public void BackupIncremental()
+		{
+			if (!IsInitialized)
+			{
+				Backup();
+				return;
+			}
+			Log("BackupIncremental", "Starting incremental backup {0} to {1}", incrementalBackupCount + 1,
+				backupDir);
+			try
+			{
+				long newDeltaSinceLsn = storage.Environment.GetLastCheckpointLsn();
+				string deltaDir = Path.Combine(backupDir, deltaDirectoryName);
+				if (!Directory.Exists(deltaDir))
+				{
+					Directory.CreateDirectory(deltaDir);
+				}
+				if (dataCopyBufferSize > 0)
+				{
+					if (copyBuffer == null || copyBuffer.Length < dataCopyBufferSize)
+					{
+						copyBuffer = new byte[dataCopyBufferSize];
+					}
+				}
+				DatabaseConfig config = new DatabaseConfig
+										{
+											Type = DatabaseType.Unknown,
+											OpenFlags = DbOpenFlags.ReadOnly,
+											Id = -1 // to avoid appending federation index to extension
+										};
+				++deltaSequence;
+				foreach (string dataFile in dataFilesCopied)
+				{
+					if (!File.Exists(dataFile)) continue;
+					config.FileName = dataFile;
+					string deltaFile = Path.Combine(deltaDir, string.Format("{0:D6}.{1}{2}", deltaSequence,
+						Path.GetFileName(dataFile), deltaExtension));
+					int pages;
+					using (Database db = storage.Environment.OpenDatabase(config))
+					{
+						pages = db.BackupDeltaFromMpf(deltaFile, deltaSinceLsn, copyBuffer);
+					}
+					Log("BackupIncremental", "{0} changed pages of {1} written to {2}", pages, dataFile,
+						deltaFile);
+				}
+
+				// Prune log files older than anything recovery of the base files could replay
+				if (copyLogFiles)
+				{
+					int keepFromLogNumber = (int)(baseCheckpointLsn >> 32);
+					for (int idx = logFilesCopied.Count - 1; idx >= 0; --idx)
+					{
+						int logNumber = GetLogNumber(logFilesCopied[idx]);
+						if (logNumber >= 0 && logNumber < keepFromLogNumber)
+						{
+							string backupLogFile = MakeRelativeToNewFolder(backupDir, logFilesCopied[idx]);
+							if (File.Exists(backupLogFile)) File.Delete(backupLogFile);
+							logFilesCopied.RemoveAt(idx);
+						}
+					}
+				}
+
+				Backup();
+
+				// the deltas rebase the set, so reinitialization intervals restart from here
+				deltaSinceLsn = newDeltaSinceLsn;
+				firstBackupTime = lastUpdateTime;
+				++incrementalBackupCount;
+				LogCompleted("BackupIncremental");
+			}
+			catch (Exception ex)
+			{
+				LogError("BackupIncremental", ex);
+				throw;
+			}
+		}
+
 		void RestoreFileType(string pattern, ICollection<string> fileNames)
 		{
 			// copy data files
@@ -275,6 +370,8 @@ namespace MySpace.BerkeleyDb.Facade
 				RestoreFileType("*.bdb*", dataFilesCopied);
 				// copy log files
 				RestoreFileType("log.*", logFilesCopied);
+				// apply incremental backups over the copied data files
+				RestoreDeltas();
 				// initialize 
 				if (BerkeleyDbStorage.Log.IsInfoEnabled)
 				{
@@ -293,6 +390,78 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		void RestoreDeltas()
+		{
+			string deltaDir = Path.Combine(backupDir, deltaDirectoryName);
+			if (!Directory.Exists(deltaDir)) return;
+			string[] deltaFiles = Directory.GetFiles(deltaDir, "*" + deltaExtension);
+			// names start with the zero padded sequence number, so this is the order they were taken in
+			Array.Sort(deltaFiles, StringComparer.OrdinalIgnoreCase);
+			foreach (string deltaFile in deltaFiles)
+			{
+				string deltaName = Path.GetFileName(deltaFile);
+				string dataName = deltaName.Substring(deltaName.IndexOf('.') + 1);
+				dataName = dataName.Substring(0, dataName.Length - deltaExtension.Length);
+				string file = Path.Combine(homeDir, dataName);
+				int pages = ApplyDelta(deltaFile, file);
+				if (BerkeleyDbStorage.Log.IsInfoEnabled)
+				{
+					BerkeleyDbStorage.Log.InfoFormat("Restore() {0} pages of {1} applied to {2}"
+						, pages, deltaFile, file);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Writes the pages of a delta file, in the layout produced by
+		/// <see cref="Database.BackupDeltaFromMpf"/>, over a data file.
+		/// </summary>
+		internal static int ApplyDelta(string deltaFile, string dataFile)
+		{
+			int pages = 0;
+			using (BinaryReader reader = new BinaryReader(new FileStream(deltaFile, FileMode.Open,
+				FileAccess.Read, FileShare.Read, 65536, FileOptions.SequentialScan)))
+			using (FileStream target = new FileStream(dataFile, FileMode.OpenOrCreate, FileAccess.Write,
+				FileShare.None))
+			{
+				byte[] magic = reader.ReadBytes(deltaMagic.Length);
+				if (Encoding.ASCII.GetString(magic) != deltaMagic)
+				{
+					throw new ApplicationException(string.Format("{0} is not a delta file", deltaFile));
+				}
+				uint version = reader.ReadUInt32();
+				if (version != deltaVersion)
+				{
+					throw new ApplicationException(string.Format("{0} has unsupported delta version {1}",
+						deltaFile, version));
+				}
+				int pageSize = reader.ReadInt32();
+				reader.ReadInt64(); // lsn the delta was taken since
+				byte[] page = new byte[pageSize];
+				while (true)
+				{
+					uint pageNumber = reader.ReadUInt32();
+					if (pageNumber == deltaEndMarker)
+					{
+						// the database may have been compacted since the previous backup
+						uint pageCount = reader.ReadUInt32();
+						target.SetLength((long)pageCount * pageSize);
+						break;
+					}
+					int read = reader.Read(page, 0, pageSize);
+					if (read < pageSize)
+					{
+						throw new ApplicationException(string.Format("{0} is truncated at page {1}",
+							deltaFile, pageNumber));
+					}
+					target.Position = (long)pageNumber * pageSize;
+					target.Write(page, 0, pageSize);
+					++pages;
+				}
+			}
+			return pages;
+		}
+
 		static readonly Regex rePath = new Regex("^(?<root>.*?)([(](?<index>[0-9]+)[)])?$",
 			RegexOptions.Compiled | RegexOptions.ExplicitCapture);
 		public bool Move(string newBackupDir, bool allowNameSerializing)
@@ -395,6 +564,17 @@ namespace MySpace.BerkeleyDb.Facade
 			
 		}
 
+		static int GetLogNumber(string logFile)
+		{
+			string extension = Path.GetExtension(logFile);
+			int logNumber;
+			if (string.IsNullOrEmpty(extension) || !int.TryParse(extension.Substring(1), out logNumber))
+			{
+				return -1;
+			}
+			return logNumber;
+		}
+
 		static string MakeRelativeToNewFolder(string newFolderPath, string path)
 		{
 			return Path.Combine(newFolderPath, Path.GetFileName(path));
@@ -418,6 +598,17 @@ namespace MySpace.BerkeleyDb.Facade
 		readonly BackupMethod backupMethod;
 		byte[] copyBuffer;
 		List<string> unusedLogFiles;
+		long deltaSinceLsn;
+		long baseCheckpointLsn;
+		int deltaSequence;
+		int incrementalBackupCount;
+
+		// must match the delta file layout written by DatabaseImpl::BackupDeltaFromMpf
+		const string deltaDirectoryName = "Deltas";
+		const string deltaExtension = ".delta";
+		const string deltaMagic = "BDBDELTA";
+		const uint deltaVersion = 1;
+		const uint deltaEndMarker = 0xFFFFFFFF;
 		#endregion
 		
 		#endregion
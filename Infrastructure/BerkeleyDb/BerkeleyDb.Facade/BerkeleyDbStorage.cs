@@ -1,5 +1,6 @@
 using System;
 using System.Collections;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
 using System.Diagnostics;
 using System.IO;
@@ -12,12 +13,17 @@ using MySpace.BerkeleyDb.Configuration;
 using MySpace.Logging;
 using MySpace.ResourcePool;
 using MySpace.Common.HelperObjects;
+using MySpace.Common.Storage;
 
 
 namespace MySpace.BerkeleyDb.Facade
 {
 	public delegate void DatabaseEntryMapper(DatabaseEntry databaseEntry);
 
+	public delegate void BatchDatabaseEntryMapper(int index, DatabaseEntry databaseEntry);
+
+	public delegate void RecordPageHandler(int federationIndex, BulkRecordBuffer page);
+
 	public enum FederatedDatabaseSelectionStrategy
 	{
 		Sequential = 0,
@@ -91,6 +97,11 @@ namespace MySpace.BerkeleyDb.Facade
 		private ConfigurableCallbackTimer dbStatTimer;
 		private ConfigurableCallbackTimer dbLockStatCounterTimer;
 		private ConfigurableCallbackTimer dbCompactTimer;
+		private ConfigurableCallbackTimer maintenanceTimer;
+		private MaintenanceScheduler maintenanceScheduler;
+		private int compactTypeIndex;
+		private int compactFederationIndex;
+		private readonly CompactProgress compactProgress = new CompactProgress();
 		private const int maxDbEntryReuse = 5;
 		private readonly ResourcePool<DatabaseEntry> dbEntryPool;
 		private const int initialBufferSize = 1048;
@@ -530,6 +541,14 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		private void SetGroupCommitCounters(BerkeleyDbWrapper.Environment envToSet)
+		{
+			envToSet.GroupCommitSize = GroupCommitSize;
+			envToSet.GroupCommitSizeBase = GroupCommitSizeBase;
+			envToSet.GroupCommitWaitTime = GroupCommitWaitTime;
+			envToSet.GroupCommitWaitTimeBase = GroupCommitWaitTimeBase;
+		}
+
 		private bool DeleteRecord(Database db, int key)
 		{
 			try
@@ -1439,6 +1458,202 @@ namespace MySpace.BerkeleyDb.Facade
 			return GetRecords(typeId, FederatedDatabaseSelectionStrategy.Sequential);
 		}
 
+		IEnumerable<BulkRecordBuffer> GetRecordPagesCore(int typeId, BulkRecordBuffer buffer)
+		{
+			var fedSize = envConfig.DatabaseConfigs.GetConfigFor(typeId).FederationSize;
+			if (fedSize < 1) fedSize = 1;
+			for (var idx = 0; idx < fedSize; ++idx)
+			{
+				var db = GetDatabase(typeId, idx);
+				if (db == null) continue;
+				foreach (var page in db.GetBulkRecords(buffer))
+				{
+					yield return page;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Reads all records of a type in bulk, one federated database after another.
+		/// </summary>
+		/// <param name="typeId">The type id of the records.</param>
+		/// <param name="buffer">The <see cref="BulkRecordBuffer"/> refilled for each step.</param>
+		/// <returns>An <see cref="IEnumerable{BulkRecordBuffer}"/> that yields <paramref name="buffer"/>
+		/// each time it holds the next records. Keys and values are only valid until the next step.</returns>
+		public IEnumerable<BulkRecordBuffer> GetRecordPages(int typeId, BulkRecordBuffer buffer)
+		{
+			if (buffer == null) throw new ArgumentNullException("buffer");
+			return new EnumerableWrapper<BulkRecordBuffer>(this, GetRecordPagesCore(typeId, buffer));
+		}
+
+		/// <summary>
+		/// Reads all records of a type in bulk with one cursor per federated database,
+		/// on up to one worker per processor.
+		/// </summary>
+		/// <param name="typeId">The type id of the records.</param>
+		/// <param name="filter">The <see cref="BulkRecordFilter"/> applied natively, or null.</param>
+		/// <param name="handler">Called on the calling thread with each page of records.</param>
+		/// <returns>The number of records handed to <paramref name="handler"/>.</returns>
+		public long ScanRecordsParallel(int typeId, BulkRecordFilter filter, RecordPageHandler handler)
+		{
+			return ScanRecordsParallel(typeId, filter, System.Environment.ProcessorCount, 2, handler);
+		}
+
+		/// <summary>
+		/// Reads all records of a type in bulk with one cursor per federated database,
+		/// on a bounded set of workers.
+		/// </summary>
+		/// <param name="typeId">The type id of the records.</param>
+		/// <param name="filter">The <see cref="BulkRecordFilter"/> applied natively, or null.</param>
+		/// <param name="maxWorkers">The most federated databases read at once.</param>
+		/// <param name="buffersPerWorker">The pages each worker may have waiting for
+		/// <paramref name="handler"/> before it stops reading.</param>
+		/// <param name="handler">Called on the calling thread with each page of records.
+		/// The page is reused once the call returns.</param>
+		/// <returns>The number of records handed to <paramref name="handler"/>.</returns>
+		/// <remarks>Pages of different federated databases are interleaved. If
+		/// <paramref name="handler"/> throws, the workers are stopped and the exception is rethrown.</remarks>
+		public long ScanRecordsParallel(int typeId, BulkRecordFilter filter, int maxWorkers,
+			int buffersPerWorker, RecordPageHandler handler)
+		{
+			if (handler == null) throw new ArgumentNullException("handler");
+			var fedSize = Math.Max(envConfig.DatabaseConfigs.GetConfigFor(typeId).FederationSize, 1);
+			var workerCount = Math.Max(1, Math.Min(maxWorkers, fedSize));
+			var bufferCount = workerCount * Math.Max(buffersPerWorker, 1);
+			var startingHandleIteration = HandleIteration;
+			var nextFederationIndex = -1;
+			var runningWorkers = workerCount;
+			Exception failure = null;
+			long records = 0;
+
+			using (var cancel = new CancellationTokenSource())
+			using (var freePages = new BlockingCollection<BulkRecordBuffer>())
+			using (var fullPages = new BlockingCollection<KeyValuePair<int, BulkRecordBuffer>>(bufferCount))
+			{
+				for (var idx = 0; idx < bufferCount; ++idx)
+				{
+					freePages.Add(new BulkRecordBuffer());
+				}
+				var workers = new Thread[workerCount];
+				for (var idx = 0; idx < workerCount; ++idx)
+				{
+					workers[idx] = new Thread(() =>
+					{
+						try
+						{
+							int federationIndex;
+							while ((federationIndex = Interlocked.Increment(ref nextFederationIndex)) < fedSize)
+							{
+								ScanFederatedDatabase(typeId, federationIndex, filter, startingHandleIteration,
+									freePages, fullPages, cancel.Token);
+							}
+						}
+						catch (OperationCanceledException)
+						{
+						}
+						catch (Exception ex)
+						{
+							Interlocked.CompareExchange(ref failure, ex, null);
+							cancel.Cancel();
+						}
+						finally
+						{
+							if (Interlocked.Decrement(ref runningWorkers) == 0)
+							{
+								fullPages.CompleteAdding();
+							}
+						}
+					});
+					workers[idx].IsBackground = true;
+					workers[idx].Name = string.Format("BerkeleyDbStorage.ScanRecordsParallel {0}.{1}", typeId, idx);
+					workers[idx].Start();
+				}
+
+				try
+				{
+					foreach (var page in fullPages.GetConsumingEnumerable(cancel.Token))
+					{
+						try
+						{
+							handler(page.Key, page.Value);
+							records += page.Value.Count;
+						}
+						finally
+						{
+							freePages.Add(page.Value);
+						}
+					}
+				}
+				catch (OperationCanceledException)
+				{
+					// a worker failed; reported below
+				}
+				finally
+				{
+					cancel.Cancel();
+					foreach (var worker in workers)
+					{
+						worker.Join();
+					}
+				}
+			}
+
+			if (failure != null)
+			{
+				if (failure is BdbException)
+				{
+					HandleBdbError((BdbException)failure);
+				}
+				throw new ApplicationException(string.Format(
+					"ScanRecordsParallel() failed reading TypeId={0}", typeId), failure);
+			}
+			return records;
+		}
+
+		private void ScanFederatedDatabase(int typeId, int federationIndex, BulkRecordFilter filter,
+			int startingHandleIteration, BlockingCollection<BulkRecordBuffer> freePages,
+			BlockingCollection<KeyValuePair<int, BulkRecordBuffer>> fullPages, CancellationToken cancel)
+		{
+			var db = GetDatabase(typeId, federationIndex);
+			if (db == null) return;
+			var position = filter != null && filter.KeyStart != null ? CursorPosition.SetRange : CursorPosition.Next;
+			using (var cursor = db.GetCursor())
+			{
+				while (!db.Disposed)
+				{
+					if (HandleIteration != startingHandleIteration)
+					{
+						throw new ApplicationException(
+							"Bdb storage has started re-initialization since the enumeration started");
+					}
+					// waits here while the handler is behind
+					var page = freePages.Take(cancel);
+					int count;
+					bool exhausted;
+					try
+					{
+						count = cursor.GetBulk(page, filter, position, GetOpFlags.Default);
+						exhausted = page.Exhausted;
+					}
+					catch
+					{
+						freePages.Add(page);
+						throw;
+					}
+					position = CursorPosition.Next;
+					if (count > 0)
+					{
+						fullPages.Add(new KeyValuePair<int, BulkRecordBuffer>(federationIndex, page), cancel);
+					}
+					else
+					{
+						freePages.Add(page);
+					}
+					if (count < 0 || exhausted) return;
+				}
+			}
+		}
+
 		/// <summary>
 		/// A wrapper of <see cref="IEnumerable{T}"/> that ends prematurely if
 		/// the master <see cref="BerkeleyDbStorage"/> cycles.
@@ -1911,6 +2126,7 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 			env = CreateEnvironment(newEnvConfig);
 				SetLockCounters(env);
+				SetGroupCommitCounters(env);
 			}
 
 		/// <summary>
@@ -2197,6 +2413,13 @@ namespace MySpace.BerkeleyDb.Facade
 
 		private void TrickleCache()
 		{
+			int pagesCleaned;
+			TrickleCache(out pagesCleaned);
+		}
+
+		private bool TrickleCache(out int pagesCleaned)
+		{
+			pagesCleaned = 0;
 			CacheTrickle cacheTrickle = envConfig.CacheTrickle;
 			if (cacheTrickle != null && cacheTrickle.Enabled)
 			{
@@ -2204,7 +2427,7 @@ namespace MySpace.BerkeleyDb.Facade
 				{
 					Log.DebugFormat("TrickleCache() CacheTrickling started ...");
 				}
-				int pagesCleaned = env.MempoolTrickle(cacheTrickle.Percentage);
+				pagesCleaned = env.MempoolTrickle(cacheTrickle.Percentage);
 				
 				if (TrickledPagesCounter != null)
 				{
@@ -2215,6 +2438,7 @@ namespace MySpace.BerkeleyDb.Facade
 					Log.DebugFormat("TrickleCache() CacheTrickling is complete. {0} pages cleaned.", pagesCleaned);
 				}
 			}
+			return false;
 		}
 
 		private void CompactDatabases()
@@ -2273,6 +2497,131 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		/// <summary>
+		/// Compacts the next slice of the current database of a compaction pass over all
+		/// databases, so the pass is spread over many maintenance ticks.
+		/// </summary>
+		private bool CompactNextSlice(out int pagesExamined)
+		{
+			pagesExamined = 0;
+			Compact compact = envConfig.Compact;
+			if (compact == null || !compact.Enabled) return false;
+			Database[,] databasesToCompact = databases;
+			if (databasesToCompact == null) return false;
+			if (compactTypeIndex >= databasesToCompact.GetLength(0) ||
+				compactFederationIndex >= databasesToCompact.GetLength(1))
+			{
+				// databases were reloaded mid pass
+				compactTypeIndex = 0;
+				compactFederationIndex = 0;
+				compactProgress.Reset();
+			}
+			if (compactTypeIndex == 0 && compactFederationIndex == 0 && compactProgress.PagesExamined == 0 &&
+				Log.IsInfoEnabled)
+			{
+				Log.InfoFormat("CompactNextSlice() pass started ...");
+			}
+			while (compactTypeIndex < databasesToCompact.GetLength(0))
+			{
+				Database db = databasesToCompact[compactTypeIndex, compactFederationIndex];
+				if (db != null)
+				{
+					DatabaseConfig dbConfig = db.GetDatabaseConfig();
+					DatabaseCompact dbCompact = dbConfig.Compact;
+					if (dbCompact != null && dbCompact.Enabled)
+					{
+						int examinedBefore = compactProgress.PagesExamined;
+						int freedBefore = compactProgress.PagesFreed;
+						bool finished;
+						try
+						{
+							db.CompactSlice(dbCompact.Percentage, envConfig.Maintenance.CompactSlicePages,
+								envConfig.Maintenance.CompactSliceKeys, dbCompact.Timeout, compactProgress);
+							finished = compactProgress.Completed ||
+								(dbCompact.MaxPages > 0 && compactProgress.PagesFreed >= dbCompact.MaxPages);
+						}
+						catch (BdbException exc)
+						{
+							finished = true;
+							switch (exc.Code)
+							{
+								case (int)DbRetVal.PAGE_NOTFOUND: // ignore page not found
+									break;
+								default:
+									HandleBdbError(exc, db);
+									break;
+							}
+						}
+						pagesExamined = compactProgress.PagesExamined - examinedBefore;
+						if (MaintenanceCompactPagesFreed != null)
+						{
+							MaintenanceCompactPagesFreed.IncrementBy(compactProgress.PagesFreed - freedBefore);
+						}
+						if (!finished) return true;
+						if (compactProgress.PagesFreed > 1 && Log.IsInfoEnabled)
+						{
+							Log.InfoFormat("CompactNextSlice() Freed {0} pages from {1}", compactProgress.PagesFreed,
+								dbConfig.FileName);
+						}
+						compactProgress.Reset();
+						NextCompactDatabase(databasesToCompact);
+						return compactTypeIndex < databasesToCompact.GetLength(0) || FinishCompactPass();
+					}
+				}
+				NextCompactDatabase(databasesToCompact);
+			}
+			return FinishCompactPass();
+		}
+
+		private void NextCompactDatabase(Database[,] databasesToCompact)
+		{
+			if (++compactFederationIndex >= databasesToCompact.GetLength(1))
+			{
+				compactFederationIndex = 0;
+				++compactTypeIndex;
+			}
+		}
+
+		private bool FinishCompactPass()
+		{
+			compactTypeIndex = 0;
+			compactFederationIndex = 0;
+			lastCompactTime = DateTime.Now;
+			if (Log.IsInfoEnabled)
+			{
+				Log.InfoFormat("CompactNextSlice() pass completed ...");
+			}
+			return false;
+		}
+
+		private bool DeadlockDetect(out int pages)
+		{
+			pages = 0;
+			DeadlockDetect();
+			return false;
+		}
+
+		private bool Checkpoint(out int pages)
+		{
+			pages = 0;
+			Checkpoint();
+			return false;
+		}
+
+		/// <summary>
+		/// Reports the time a foreground request took, so background maintenance can hold back
+		/// while requests are slow. Ignored unless maintenance scheduling is enabled.
+		/// </summary>
+		/// <param name="elapsedTicks">The <see cref="Stopwatch"/> ticks the request took.</param>
+		public void ReportRequestLatency(long elapsedTicks)
+		{
+			MaintenanceScheduler scheduler = maintenanceScheduler;
+			if (scheduler != null)
+			{
+				scheduler.ReportLatency(elapsedTicks);
+			}
+		}
+
 		private static bool HaveMillisecondsElapsed(DateTime referenceTime, int milliseconds)
 		{
 			return DateTime.Now >= referenceTime + TimeSpan.FromMilliseconds(milliseconds);
@@ -2312,7 +2661,22 @@ namespace MySpace.BerkeleyDb.Facade
 						|| (backupConfig.ReinitializeLogFileCount > 0 &&
 							backupSet.GetRemovableLogFileCount() >= backupConfig.ReinitializeLogFileCount);
 					
-					if (reinitBackup)
+					if (reinitBackup && backupConfig.Incremental &&
+						backupSet.IncrementalBackupCount < backupConfig.MaxIncrementalBackups)
+					{
+						// only pages changed since the last backup are written, the data files stay in place
+						if (Log.IsDebugEnabled)
+						{
+							Log.DebugFormat("Incremental backup() started ...");
+						}
+						backupSet.BackupIncremental();
+						backupSet.DeleteUnusedLogFiles();
+						if (Log.IsDebugEnabled)
+						{
+							Log.DebugFormat("Incremental backup() is complete");
+						}
+					}
+					else if (reinitBackup)
 					{
 						string oldBackupDirectory = backupSet.BackupDirectory;
 						string newBackupDirectory = backupConfig.Directory + "__new";
@@ -2375,6 +2739,7 @@ namespace MySpace.BerkeleyDb.Facade
 
 		private void LockStatisticsMonitor()
 		{
+			UpdateContentionCounters();
 			LockStatistics lockStatistics = envConfig.LockStatistics;
 			if (lockStatistics != null && lockStatistics.Enabled)
 			{
@@ -2386,6 +2751,28 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		private void UpdateContentionCounters()
+		{
+			ContentionStatistics contention = GetContentionStatistics();
+			if (contention == null) return;
+			if (ContentionDeadlocks != null)
+			{
+				ContentionDeadlocks.RawValue = contention.Deadlocks;
+			}
+			if (ContentionRetries != null)
+			{
+				ContentionRetries.RawValue = contention.Retries;
+			}
+			if (ContentionRetriesExhausted != null)
+			{
+				ContentionRetriesExhausted.RawValue = contention.RetriesExhausted;
+			}
+			if (ContentionRetryTime != null)
+			{
+				ContentionRetryTime.RawValue = (long)contention.RetryTime.TotalMilliseconds;
+			}
+		}
+
         private static int GetExpandedBufferSize(int recLen)
         {
             return (int)(recLen * expandBufferSizeMultiplier);
@@ -2473,6 +2860,34 @@ namespace MySpace.BerkeleyDb.Facade
 
 		public PerformanceCounter LockStatRegionNoWait { get; set; }
 
+		public PerformanceCounter GroupCommitSize { get; set; }
+
+		public PerformanceCounter GroupCommitSizeBase { get; set; }
+
+		public PerformanceCounter GroupCommitWaitTime { get; set; }
+
+		public PerformanceCounter GroupCommitWaitTimeBase { get; set; }
+
+		public PerformanceCounter MaintenanceJobs { get; set; }
+
+		public PerformanceCounter MaintenanceDeferrals { get; set; }
+
+		public PerformanceCounter MaintenanceJobTime { get; set; }
+
+		public PerformanceCounter MaintenanceJobTimeBase { get; set; }
+
+		public PerformanceCounter MaintenanceCompactPagesFreed { get; set; }
+
+		public PerformanceCounter MaintenanceForegroundLatency { get; set; }
+
+		public PerformanceCounter ContentionDeadlocks { get; set; }
+
+		public PerformanceCounter ContentionRetries { get; set; }
+
+		public PerformanceCounter ContentionRetryTime { get; set; }
+
+		public PerformanceCounter ContentionRetriesExhausted { get; set; }
+
 		#endregion
 
 
@@ -2637,6 +3052,34 @@ namespace MySpace.BerkeleyDb.Facade
 			return DeleteRecord(db, objectId);
 		}
 
+		/// <summary>
+		/// Deletes several objects, one transaction per federated database touched.
+		/// </summary>
+		/// <returns>Whether each object was deleted.</returns>
+		public bool[] DeleteObjects(IList<short> typeIds, IList<int> objectIds, IList<byte[]> keys)
+		{
+			int count = typeIds.Count;
+			var results = new bool[count];
+			var dbKeys = new DataBuffer[count];
+			for (int i = 0; i < count; ++i)
+			{
+				dbKeys[i] = keys[i] != null ? (DataBuffer)keys[i] : objectIds[i];
+			}
+			foreach (var batch in GroupByDatabase(count, i => GetDatabase(typeIds[i], objectIds[i])))
+			{
+				if (batch.Database.GetDatabaseType() == DatabaseType.Queue)
+				{
+					foreach (var index in batch.Indexes)
+					{
+						results[index] = DeleteObject(typeIds[index], objectIds[index], keys[index]);
+					}
+					continue;
+				}
+				DeleteBatch(batch, dbKeys, results);
+			}
+			return results;
+		}
+
 		/// <summary>
 		/// Remove the object id in all known types
 		/// </summary>
@@ -2751,6 +3194,103 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		/// <summary>
+		/// Retrieves several objects, one transaction per federated database touched.
+		/// </summary>
+		/// <remarks>
+		/// <paramref name="batchDatabaseEntryMapper"/> is called with the index of each
+		/// object found; entries that don't fit the pooled buffer are re-read singly.
+		/// </remarks>
+		public void GetDbObjects(IList<short> typeIds, IList<int> objectIds, IList<byte[]> keys,
+			BatchDatabaseEntryMapper batchDatabaseEntryMapper)
+		{
+			if (batchDatabaseEntryMapper == null)
+			{
+				return;
+			}
+
+			int count = typeIds.Count;
+			foreach (var batch in GroupByDatabase(count, i => GetDatabase(typeIds[i], objectIds[i])))
+			{
+				if (batch.Database.GetDatabaseType() == DatabaseType.Queue)
+				{
+					foreach (var index in batch.Indexes)
+					{
+						int itemIndex = index;
+						GetDbObject(typeIds[itemIndex], objectIds[itemIndex], keys[itemIndex],
+							entry => batchDatabaseEntryMapper(itemIndex, entry));
+					}
+					continue;
+				}
+				GetBatch(batch, typeIds, objectIds, keys, batchDatabaseEntryMapper);
+			}
+		}
+
+		private void GetBatch(DatabaseBatch batch, IList<short> typeIds, IList<int> objectIds,
+			IList<byte[]> keys, BatchDatabaseEntryMapper batchDatabaseEntryMapper)
+		{
+			int batchCount = batch.Indexes.Count;
+			var pooledDbEntries = new ResourcePoolItem<DatabaseEntry>[batchCount];
+			try
+			{
+				var dbKeys = new DataBuffer[batchCount];
+				var buffers = new DataBuffer[batchCount];
+				var lengths = new int[batchCount];
+				for (int i = 0; i < batchCount; ++i)
+				{
+					int index = batch.Indexes[i];
+					pooledDbEntries[i] = dbEntryPool.GetItem();
+					dbKeys[i] = keys[index] != null ? (DataBuffer)keys[index] : objectIds[index];
+					buffers[i] = pooledDbEntries[i].Item.Buffer;
+					// missing until GetMany says otherwise; 0 is a stored empty record
+					lengths[i] = -1;
+				}
+				try
+				{
+					batch.Database.GetMany(dbKeys, buffers, lengths, GetOpFlags.Default);
+				}
+				catch (BdbException ex)
+				{
+					HandleBdbError(ex, batch.Database);
+					return;
+				}
+				for (int i = 0; i < batchCount; ++i)
+				{
+					int index = batch.Indexes[i];
+					DatabaseEntry data = pooledDbEntries[i].Item;
+					if (lengths[i] > data.Buffer.Length)
+					{
+						GetDbObject(typeIds[index], objectIds[index], keys[index],
+							entry => batchDatabaseEntryMapper(index, entry));
+					}
+					else if (lengths[i] >= 0)
+					{
+						data.StartPosition = 0;
+						data.Length = lengths[i];
+						batchDatabaseEntryMapper(index, data);
+					}
+				}
+			}
+			catch (Exception ex)
+			{
+				if (Log.IsErrorEnabled)
+				{
+					Log.Error("GetDbObjects() Error getting records", ex);
+				}
+				throw;
+			}
+			finally
+			{
+				foreach (var pooledDbEntry in pooledDbEntries)
+				{
+					if (pooledDbEntry != null)
+					{
+						pooledDbEntry.Release();
+					}
+				}
+			}
+		}
+
 		public int GetKeyCount(DbStatFlags dbStatFlags)
 		{
 			return GetKeyCount(databases, dbStatFlags);
@@ -2810,6 +3350,44 @@ namespace MySpace.BerkeleyDb.Facade
 		public void GetStats()
 		{
 			GetStats(databases);
+			BerkeleyDbWrapper.Environment environment = env;
+			if (environment != null && Log.IsInfoEnabled)
+			{
+				Log.InfoFormat("GetStats() {0}", environment.GetAllocatorStatistics());
+			}
+		}
+
+		/// <summary>
+		/// Gets the statistics of the native allocator serving Berkeley Db memory.
+		/// </summary>
+		/// <returns>The <see cref="AllocatorStatistics"/>, or null if there is no environment.</returns>
+		public AllocatorStatistics GetAllocatorStatistics()
+		{
+			BerkeleyDbWrapper.Environment environment = env;
+			return environment == null ? null : environment.GetAllocatorStatistics();
+		}
+
+		/// <summary>
+		/// Gets the deadlock retry statistics summed over all open databases.
+		/// </summary>
+		/// <returns>The <see cref="ContentionStatistics"/>, or null if no database is open.</returns>
+		public ContentionStatistics GetContentionStatistics()
+		{
+			Database[,] databasesToRead = databases;
+			ContentionStatistics total = null;
+			if (databasesToRead == null) return total;
+			for (int typeIndex = 0; typeIndex < databasesToRead.GetLength(0); typeIndex++)
+			{
+				for (int federationIndex = 0; federationIndex < databasesToRead.GetLength(1); federationIndex++)
+				{
+					Database db = databasesToRead[typeIndex, federationIndex];
+					if (db != null && !db.Disposed)
+					{
+						total = ContentionStatistics.Add(total, db.GetContentionStatistics());
+					}
+				}
+			}
+			return total;
 		}
 
 		private static void GetStats(Database[,] databaseArrays)
@@ -3132,14 +3710,173 @@ namespace MySpace.BerkeleyDb.Facade
 			return AddRecord(db, objectId, key, startPosition, length, rmwDelegate);
 		}
 
+		/// <summary>
+		/// Adds to a 32 bit counter held in a record, in place under the record's write lock.
+		/// </summary>
+		/// <param name="initialData">What the record starts with if it doesn't exist.</param>
+		/// <param name="counterOffset">The offset of the counter in the record, at or after the end of
+		/// <paramref name="initialData"/>.</param>
+		/// <param name="incrementBy">The amount added; negative to decrement.</param>
+		/// <param name="minimum">The lowest value the counter is left with.</param>
+		/// <param name="maximum">The highest value the counter is left with.</param>
+		/// <returns>Whether the counter was updated.</returns>
+		public bool IncrementCounter(short typeId, int objectId, byte[] key, byte[] initialData, int counterOffset,
+			int incrementBy, int minimum, int maximum)
+		{
+			if (Log.IsDebugEnabled)
+			{
+				Log.DebugFormat("IncrementCounter() updates counter (TypeId={0}, ObjectId={1})", typeId, objectId);
+			}
+			Database db = GetDatabase(typeId, objectId);
+			try
+			{
+				db.IncrementCounter(key != null ? (DataBuffer)key : objectId, initialData, counterOffset, incrementBy,
+					minimum, maximum);
+				return true;
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+			}
+			catch (Exception ex)
+			{
+				if (Log.IsErrorEnabled)
+				{
+					Log.Error("IncrementCounter() Error updating counter", ex);
+				}
+				throw;
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// Saves an object only if it isn't stored yet or is stored with an older timestamp.
+		/// </summary>
+		/// <param name="data">The record to save.</param>
+		/// <param name="ticksOffset">The offset of the timestamp in <paramref name="data"/> and in the
+		/// stored record.</param>
+		/// <param name="saved">Set to whether <paramref name="data"/> was saved.</param>
+		/// <param name="storedTicks">Set to the stored timestamp if <paramref name="data"/> wasn't saved.</param>
+		/// <returns>Whether the operation succeeded, saved or not.</returns>
+		public bool CompareAndSetObject(short typeId, int objectId, byte[] key, byte[] data, int ticksOffset,
+			out bool saved, out long storedTicks)
+		{
+			if (Log.IsDebugEnabled)
+			{
+				Log.DebugFormat("CompareAndSetObject() saves newer object (TypeId={0}, ObjectId={1})", typeId, objectId);
+			}
+			saved = false;
+			storedTicks = 0;
+			Database db = GetDatabase(typeId, objectId);
+			try
+			{
+				saved = db.CompareAndSet(key != null ? (DataBuffer)key : objectId, data, ticksOffset, out storedTicks);
+				return true;
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+			}
+			catch (Exception ex)
+			{
+				if (Log.IsErrorEnabled)
+				{
+					Log.Error("CompareAndSetObject() Error Adding record", ex);
+				}
+				throw;
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// Appends data to the end of a record under the record's write lock.
+		/// </summary>
+		/// <param name="initialData">What the record starts with if it doesn't exist.</param>
+		/// <param name="data">The data appended.</param>
+		/// <returns>Whether the data was appended.</returns>
+		public bool AppendObject(short typeId, int objectId, byte[] key, byte[] initialData, byte[] data)
+		{
+			if (Log.IsDebugEnabled)
+			{
+				Log.DebugFormat("AppendObject() appends to object (TypeId={0}, ObjectId={1})", typeId, objectId);
+			}
+			Database db = GetDatabase(typeId, objectId);
+			try
+			{
+				db.Append(key != null ? (DataBuffer)key : objectId, initialData, data);
+				return true;
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+			}
+			catch (Exception ex)
+			{
+				if (Log.IsErrorEnabled)
+				{
+					Log.Error("AppendObject() Error appending to record", ex);
+				}
+				throw;
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// Saves several objects, one transaction per federated database touched.
+		/// </summary>
+		/// <returns>Whether each object was saved.</returns>
+		public bool[] SaveObjects(IList<short> typeIds, IList<int> objectIds, IList<byte[]> keys,
+			IList<byte[]> data)
+		{
+			int count = typeIds.Count;
+			var results = new bool[count];
+			var dbKeys = new DataBuffer[count];
+			var buffers = new DataBuffer[count];
+			for (int i = 0; i < count; ++i)
+			{
+				dbKeys[i] = keys[i] != null ? (DataBuffer)keys[i] : objectIds[i];
+				buffers[i] = data[i];
+			}
+			foreach (var batch in GroupByDatabase(count, i => GetDatabase(typeIds[i], objectIds[i])))
+			{
+				if (batch.Database.GetDatabaseType() == DatabaseType.Queue)
+				{
+					foreach (var index in batch.Indexes)
+					{
+						results[index] = SaveObject(typeIds[index], objectIds[index], keys[index],
+							data[index]);
+					}
+					continue;
+				}
+				SaveBatch(batch, dbKeys, buffers, results);
+			}
+			return results;
+		}
+
 		void StartTimers()
 		{
 			// set up the lock statistics stuff after the CreateEnvironment call. 
 			// CreateEnvironment is where environment open() is called.
-			dbLockStatCounterTimer = new ConfigurableCallbackTimer(this, envConfig.LockStatistics,
+			// The timer runs even with lock statistics off, since it also publishes the
+			// deadlock contention counters.
+			LockStatistics lockStatistics = envConfig.LockStatistics;
+			ITimerConfig lockStatTimerConfig = lockStatistics != null && lockStatistics.Enabled
+				? lockStatistics : new LockStatistics { Enabled = true, TimerInterval = 10000 };
+			dbLockStatCounterTimer = new ConfigurableCallbackTimer(this, lockStatTimerConfig,
 				"Lock Statistics Counter", 10000,
 				LockStatisticsMonitor);
 
+			dbStatTimer = new ConfigurableCallbackTimer(this, bdbConfig.StatTimer,
+				"Stat Timer", 10000,
+				DbStatPrint);
+
+			Maintenance maintenance = envConfig.Maintenance;
+			if (maintenance != null && maintenance.Enabled)
+			{
+				StartMaintenanceScheduler(maintenance);
+				return;
+			}
+
 			trickleTimer = new ConfigurableCallbackTimer(this, envConfig.CacheTrickle,
 				"Cache Trickle", 10000,
 				TrickleCache);
@@ -3157,10 +3894,6 @@ namespace MySpace.BerkeleyDb.Facade
 					DeadlockDetect);
 			}
 
-			dbStatTimer = new ConfigurableCallbackTimer(this, bdbConfig.StatTimer,
-				"Stat Timer", 10000,
-				DbStatPrint);
-
 			// compaction has to be co-ordinated with any backups
 			if (envConfig.Checkpoint == null || !envConfig.Checkpoint.Enabled ||
 				envConfig.Checkpoint.Backup == null || !envConfig.Checkpoint.Backup.Enabled)
@@ -3170,6 +3903,47 @@ namespace MySpace.BerkeleyDb.Facade
 			}
 		}
 
+		/// <summary>
+		/// Runs deadlock detection, checkpoints, cache trickle and compaction from one
+		/// <see cref="MaintenanceScheduler"/> in place of their separate timers.
+		/// </summary>
+		void StartMaintenanceScheduler(Maintenance maintenance)
+		{
+			MaintenanceScheduler scheduler = new MaintenanceScheduler(this, maintenance);
+			DeadlockDetection deadlockDetection = envConfig.DeadlockDetection;
+			if (deadlockDetection != null && deadlockDetection.Enabled &&
+				deadlockDetection.Mode == DeadlockDetectionMode.OnTimer)
+			{
+				// resolving deadlocks only ever helps foreground latency
+				scheduler.Add("Deadlock Detection", deadlockDetection.TimerInterval, MaintenancePriority.Critical,
+					DeadlockDetect);
+			}
+			backupSet = MakeBackupSet();
+			Checkpoint checkpoint = envConfig.Checkpoint;
+			if (checkpoint != null && checkpoint.Enabled)
+			{
+				scheduler.Add("Checkpoint", checkpoint.Interval > 0 ? checkpoint.Interval : 10000,
+					MaintenancePriority.Bounded, Checkpoint);
+			}
+			CacheTrickle cacheTrickle = envConfig.CacheTrickle;
+			if (cacheTrickle != null && cacheTrickle.Enabled)
+			{
+				scheduler.Add("Cache Trickle", cacheTrickle.Interval > 0 ? cacheTrickle.Interval : 10000,
+					MaintenancePriority.Deferrable, TrickleCache);
+			}
+			// compaction has to be co-ordinated with any backups
+			Compact compact = envConfig.Compact;
+			if (compact != null && compact.Enabled && (checkpoint == null || !checkpoint.Enabled ||
+				checkpoint.Backup == null || !checkpoint.Backup.Enabled))
+			{
+				scheduler.Add("Compact", compact.Interval > 0 ? compact.Interval : 60000,
+					MaintenancePriority.Deferrable, CompactNextSlice);
+			}
+			maintenanceScheduler = scheduler;
+			maintenanceTimer = new ConfigurableCallbackTimer(this, maintenance, "Maintenance", 1000,
+				scheduler.Tick);
+		}
+
 		void ShutdownTimers()
 		{
 			ShutdownTimer(ref trickleTimer);
@@ -3179,6 +3953,8 @@ namespace MySpace.BerkeleyDb.Facade
 			ShutdownTimer(ref deadlockDetectTimer);
 			ShutdownTimer(ref dbStatTimer);
 			ShutdownTimer(ref dbCompactTimer);
+			ShutdownTimer(ref maintenanceTimer);
+			maintenanceScheduler = null;
 		}
 
 		static void ShutdownTimer(ref ConfigurableCallbackTimer timer)
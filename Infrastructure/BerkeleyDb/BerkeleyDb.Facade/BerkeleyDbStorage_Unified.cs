@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Collections.Generic;
 using System.IO;
 using BerkeleyDbWrapper;
 using MySpace.Common.Storage;
@@ -316,6 +317,73 @@ namespace MySpace.BerkeleyDb.Facade
 			return GetEntryStream(typeId, key.GetObjectId(), key, options);
 		}
 
+		/// <summary>
+		/// Reads data from a BerkeleyDb store entry without copying it into managed memory.
+		/// </summary>
+		/// <param name="typeId">The type of the store accessed.</param>
+		/// <param name="objectId">The object id used for store access.</param>
+		/// <param name="key">The key of the store entry accessed.</param>
+		/// <param name="options">The options for the read.</param>
+		/// <returns>An <see cref="UnmanagedMemoryView"/> over the entry data in pooled native
+		/// memory. The caller must dispose it; streams created from it keep the memory alive
+		/// until they are closed.</returns>
+		/// <exception cref="ArgumentOutOfRangeException">
+		/// <para><paramref name="options"/> has a negative offset.</para>
+		/// </exception>
+		/// <remarks>
+		/// <para>Return value is null if</para>
+		/// <para>Entry is not found in store.</para>
+		/// <para>-or-</para>
+		/// <para><paramref name="typeId"/> isn't valid.</para>
+		/// <para>-or-</para>
+		/// <para>A <see cref="BdbException"/> was thrown from the underlying store
+		/// (Exception is logged but not rethrown).</para>
+		/// </remarks>
+		public UnmanagedMemoryView GetEntryView(short typeId, int objectId,
+			DataBuffer key, GetOptions options)
+		{
+			options.AssertValid("options");
+			DebugLog("GetEntryView()", typeId, objectId);
+			Database db = GetDatabase(typeId, objectId);
+			try
+			{
+				return db.GetView(key, options.Offset, options.Length, options.Flags);
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+				return null;
+			}
+			catch (Exception ex)
+			{
+				ErrorLog("GetEntryView()", ex);
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Reads data from a BerkeleyDb store entry without copying it into managed memory.
+		/// </summary>
+		/// <param name="typeId">The type of the store accessed.</param>
+		/// <param name="key">The key of the store entry accessed.</param>
+		/// <param name="options">The options for the read.</param>
+		/// <returns>An <see cref="UnmanagedMemoryView"/> over the entry data in pooled native
+		/// memory. The caller must dispose it.</returns>
+		/// <exception cref="ArgumentOutOfRangeException">
+		/// <para><paramref name="options"/> has a negative offset.</para>
+		/// </exception>
+		/// <remarks>
+		/// <para><see cref="DataBuffer.GetHashCode"/> of <paramref name="key"/> is used
+		/// as the object id.</para>
+		/// <para>Return value is null under the same conditions as
+		/// <see cref="GetEntryView(short, int, DataBuffer, GetOptions)"/>.</para>
+		/// </remarks>
+		public UnmanagedMemoryView GetEntryView(short typeId, DataBuffer key,
+			GetOptions options)
+		{
+			return GetEntryView(typeId, key.GetObjectId(), key, options);
+		}
+
 		/// <summary>
 		/// Reads data from a BerkeleyDb store entry.
 		/// </summary>
@@ -794,5 +862,277 @@ namespace MySpace.BerkeleyDb.Facade
 		{
 			return GetEntryLength(typeId, key.GetObjectId(), key);
 		}
+
+		#region Batch
+
+		/// <summary>
+		/// The items of a batch call that resolve to the same <see cref="Database"/>.
+		/// </summary>
+		private sealed class DatabaseBatch
+		{
+			public readonly Database Database;
+			public readonly List<int> Indexes = new List<int>();
+
+			public DatabaseBatch(Database database)
+			{
+				Database = database;
+			}
+
+			public T[] Select<T>(IList<T> items)
+			{
+				var selected = new T[Indexes.Count];
+				for (int i = 0; i < selected.Length; ++i)
+				{
+					selected[i] = items[Indexes[i]];
+				}
+				return selected;
+			}
+
+			public void Scatter<T>(T[] batchValues, IList<T> values)
+			{
+				for (int i = 0; i < batchValues.Length; ++i)
+				{
+					values[Indexes[i]] = batchValues[i];
+				}
+			}
+
+			public void Fill<T>(IList<T> values, T value)
+			{
+				foreach (var index in Indexes)
+				{
+					values[index] = value;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Groups the items of a batch call by the database they resolve to,
+		/// preserving the order of items within each group.
+		/// </summary>
+		private static List<DatabaseBatch> GroupByDatabase(int count, Func<int, Database> resolve)
+		{
+			var batches = new List<DatabaseBatch>();
+			var lookup = new Dictionary<Database, DatabaseBatch>();
+			for (int i = 0; i < count; ++i)
+			{
+				var db = resolve(i);
+				DatabaseBatch batch;
+				if (!lookup.TryGetValue(db, out batch))
+				{
+					batch = new DatabaseBatch(db);
+					lookup.Add(db, batch);
+					batches.Add(batch);
+				}
+				batch.Indexes.Add(i);
+			}
+			return batches;
+		}
+
+		private static void AssertBatchArguments(int[] objectIds, DataBuffer[] keys,
+			DataBuffer[] buffers, Array results)
+		{
+			if (objectIds == null) throw new ArgumentNullException("objectIds");
+			if (keys == null) throw new ArgumentNullException("keys");
+			if (results == null) throw new ArgumentNullException("results");
+			if (keys.Length != objectIds.Length)
+				throw new ArgumentException("An object id is required for each key", "objectIds");
+			if (buffers != null && buffers.Length != keys.Length)
+				throw new ArgumentException("A buffer is required for each key", "buffers");
+			if (results.Length < keys.Length)
+				throw new ArgumentException("A result slot is required for each key", "results");
+		}
+
+		private static void BatchDebugLog(string callDescr, int typeId, int count)
+		{
+			if (Log.IsDebugEnabled)
+			{
+				Log.DebugFormat("[{0} (TypeId={1}, Count={2})", callDescr,
+					typeId, count);
+			}
+		}
+
+		private void GetBatch(DatabaseBatch batch, IList<DataBuffer> keys,
+			IList<DataBuffer> buffers, IList<int> results)
+		{
+			Database db = batch.Database;
+			var batchResults = new int[batch.Indexes.Count];
+			try
+			{
+				db.GetMany(batch.Select(keys), batch.Select(buffers), batchResults,
+					GetOpFlags.Default);
+				batch.Scatter(batchResults, results);
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+				batch.Fill(results, -1);
+			}
+			catch (Exception ex)
+			{
+				ErrorLog("GetEntries()", ex);
+				throw;
+			}
+		}
+
+		private void SaveBatch(DatabaseBatch batch, IList<DataBuffer> keys,
+			IList<DataBuffer> buffers, IList<bool> results)
+		{
+			Database db = batch.Database;
+			var batchBuffers = batch.Select(buffers);
+			var sizes = new int[batchBuffers.Length];
+			try
+			{
+				db.PutMany(batch.Select(keys), batchBuffers, sizes, PutOpFlags.Default);
+				for (int i = 0; i < sizes.Length; ++i)
+				{
+					results[batch.Indexes[i]] = sizes[i] == batchBuffers[i].ByteLength;
+				}
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+				batch.Fill(results, false);
+			}
+			catch (Exception ex)
+			{
+				ErrorLog("SaveEntries()", ex);
+				throw;
+			}
+		}
+
+		private void DeleteBatch(DatabaseBatch batch, IList<DataBuffer> keys,
+			IList<bool> results)
+		{
+			Database db = batch.Database;
+			var retVals = new DbRetVal[batch.Indexes.Count];
+			try
+			{
+				db.DeleteMany(batch.Select(keys), retVals, DeleteOpFlags.Default);
+				for (int i = 0; i < retVals.Length; ++i)
+				{
+					results[batch.Indexes[i]] = retVals[i] == DbRetVal.SUCCESS;
+				}
+			}
+			catch (BdbException ex)
+			{
+				HandleBdbError(ex, db);
+				batch.Fill(results, false);
+			}
+			catch (Exception ex)
+			{
+				ErrorLog("DeleteEntries()", ex);
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Reads data from several BerkeleyDb store entries.
+		/// </summary>
+		/// <param name="typeId">The type of the stores accessed.</param>
+		/// <param name="objectIds">The object ids used for store access, one per key.</param>
+		/// <param name="keys">The keys of the store entries accessed.</param>
+		/// <param name="buffers">The buffers receiving the entry data, one per key.</param>
+		/// <param name="results">Receives the length of each entry.</param>
+		/// <exception cref="ArgumentNullException">
+		/// <para><paramref name="objectIds"/>, <paramref name="keys"/>,
+		/// <paramref name="buffers"/> or <paramref name="results"/> is
+		/// <see langword="null"/>.</para>
+		/// </exception>
+		/// <exception cref="ArgumentOutOfRangeException">
+		/// <para>An element of <paramref name="buffers"/> isn't writable.</para>
+		/// </exception>
+		/// <remarks>
+		/// <para>Keys that map to the same federated database are read in a single
+		/// call and transaction.</para>
+		/// <para>A result is negative if</para>
+		/// <para>Entry is not found in store.</para>
+		/// <para>-or-</para>
+		/// <para>A <see cref="BdbException"/> was thrown from the underlying store
+		/// (Exception is logged but not rethrown).</para>
+		/// <para>A result greater than the length of its buffer means the buffer
+		/// was too small to hold the entry.</para>
+		/// </remarks>
+		public void GetEntries(short typeId, int[] objectIds, DataBuffer[] keys,
+			DataBuffer[] buffers, int[] results)
+		{
+			if (buffers == null) throw new ArgumentNullException("buffers");
+			AssertBatchArguments(objectIds, keys, buffers, results);
+			for (int i = 0; i < buffers.Length; ++i)
+			{
+				if (!buffers[i].IsWritable) throw new ArgumentOutOfRangeException("buffers");
+			}
+			BatchDebugLog("GetEntries()", typeId, keys.Length);
+			foreach (var batch in GroupByDatabase(keys.Length,
+				i => GetDatabase(typeId, objectIds[i])))
+			{
+				GetBatch(batch, keys, buffers, results);
+			}
+		}
+
+		/// <summary>
+		/// Writes data to several BerkeleyDb store entries.
+		/// </summary>
+		/// <param name="typeId">The type of the stores accessed.</param>
+		/// <param name="objectIds">The object ids used for store access, one per key.</param>
+		/// <param name="keys">The keys of the store entries accessed.</param>
+		/// <param name="buffers">The buffers supplying the write data, one per key.</param>
+		/// <param name="results">Receives whether each write succeeded.</param>
+		/// <exception cref="ArgumentNullException">
+		/// <para><paramref name="objectIds"/>, <paramref name="keys"/>,
+		/// <paramref name="buffers"/> or <paramref name="results"/> is
+		/// <see langword="null"/>.</para>
+		/// </exception>
+		/// <remarks>
+		/// <para>Keys that map to the same federated database are written in a single
+		/// call and transaction.</para>
+		/// <para>A result is <see langword="false"/> if a <see cref="BdbException"/>
+		/// was thrown from the underlying store (Exception is logged but not
+		/// rethrown).</para>
+		/// </remarks>
+		public void SaveEntries(short typeId, int[] objectIds, DataBuffer[] keys,
+			DataBuffer[] buffers, bool[] results)
+		{
+			if (buffers == null) throw new ArgumentNullException("buffers");
+			AssertBatchArguments(objectIds, keys, buffers, results);
+			BatchDebugLog("SaveEntries()", typeId, keys.Length);
+			foreach (var batch in GroupByDatabase(keys.Length,
+				i => GetDatabase(typeId, objectIds[i])))
+			{
+				SaveBatch(batch, keys, buffers, results);
+			}
+		}
+
+		/// <summary>
+		/// Deletes several BerkeleyDb store entries.
+		/// </summary>
+		/// <param name="typeId">The type of the stores accessed.</param>
+		/// <param name="objectIds">The object ids used for store access, one per key.</param>
+		/// <param name="keys">The keys of the store entries accessed.</param>
+		/// <param name="results">Receives whether each deletion succeeded.</param>
+		/// <exception cref="ArgumentNullException">
+		/// <para><paramref name="objectIds"/>, <paramref name="keys"/> or
+		/// <paramref name="results"/> is <see langword="null"/>.</para>
+		/// </exception>
+		/// <remarks>
+		/// <para>Keys that map to the same federated database are deleted in a single
+		/// call and transaction.</para>
+		/// <para>A result is <see langword="false"/> if:</para>
+		/// <para>The entry specified by the key didn't exist within the store.</para>
+		/// <para>-or-</para>
+		/// <para>A <see cref="BdbException"/> was thrown from the underlying store
+		/// (Exception is logged but not rethrown).</para>
+		/// </remarks>
+		public void DeleteEntries(short typeId, int[] objectIds, DataBuffer[] keys,
+			bool[] results)
+		{
+			AssertBatchArguments(objectIds, keys, null, results);
+			BatchDebugLog("DeleteEntries()", typeId, keys.Length);
+			foreach (var batch in GroupByDatabase(keys.Length,
+				i => GetDatabase(typeId, objectIds[i])))
+			{
+				DeleteBatch(batch, keys, results);
+			}
+		}
+		#endregion
 	}
 }
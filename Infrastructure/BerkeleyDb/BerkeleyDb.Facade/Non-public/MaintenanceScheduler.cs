@@ -0,0 +1,180 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using MySpace.BerkeleyDb.Configuration;
+
+namespace MySpace.BerkeleyDb.Facade
+{
+	/// <summary>
+	/// Runs one step of a maintenance job.
+	/// </summary>
+	/// <param name="pages">The pages the step wrote or examined, charged to the page budget.</param>
+	/// <returns>True if the job's pass isn't finished and it wants the next tick rather than
+	/// waiting out its interval.</returns>
+	internal delegate bool MaintenanceJobDelegate(out int pages);
+
+	internal enum MaintenancePriority
+	{
+		/// <summary>Runs when due regardless of latency or budget.</summary>
+		Critical,
+		/// <summary>Held back by latency or budget for at most the configured maximum deferral.</summary>
+		Bounded,
+		/// <summary>Held back by latency or budget for as long as necessary.</summary>
+		Deferrable
+	}
+
+	/// <summary>
+	/// Runs background maintenance jobs from a single tick, within a share of wall clock time
+	/// and a page budget, pausing them while the foreground request latency is above threshold.
+	/// </summary>
+	internal class MaintenanceScheduler
+	{
+		class Job
+		{
+			public string Name;
+			public int Interval;
+			public MaintenancePriority Priority;
+			public MaintenanceJobDelegate Callback;
+			public DateTime NextDue;
+		}
+
+		// bursts are limited to what this many ticks accrue
+		const int burstTicks = 4;
+
+		readonly BerkeleyDbStorage storage;
+		readonly Maintenance config;
+		readonly List<Job> jobs = new List<Job>();
+		readonly double maxTimeBudget;
+		readonly long latencyThresholdTicks;
+		double timeBudget;
+		double pageBudget;
+		long lastTick;
+		long averageLatency;
+		int latencySamples;
+
+		public MaintenanceScheduler(BerkeleyDbStorage storage, Maintenance config)
+		{
+			this.storage = storage;
+			this.config = config;
+			maxTimeBudget = (double)config.TickInterval * config.BudgetPercent / 100 * burstTicks;
+			latencyThresholdTicks = config.LatencyThreshold * Stopwatch.Frequency / 1000;
+			timeBudget = maxTimeBudget;
+			pageBudget = config.PagesPerSecond;
+			lastTick = Stopwatch.GetTimestamp();
+		}
+
+		/// <summary>
+		/// Adds a job. Jobs due on the same tick run in the order they were added.
+		/// </summary>
+		public void Add(string name, int interval, MaintenancePriority priority, MaintenanceJobDelegate callback)
+		{
+			jobs.Add(new Job { Name = name, Interval = interval, Priority = priority, Callback = callback,
+				NextDue = DateTime.Now.AddMilliseconds(interval) });
+			if (BerkeleyDbStorage.Log.IsInfoEnabled)
+			{
+				BerkeleyDbStorage.Log.InfoFormat("Initialize() Maintenance {0} Interval = {1} milliseconds, {2}",
+					name, interval, priority);
+			}
+		}
+
+		/// <summary>
+		/// Folds the latency of a foreground request into the average that pauses maintenance.
+		/// </summary>
+		/// <param name="elapsedTicks">The <see cref="Stopwatch"/> ticks the request took.</param>
+		public void ReportLatency(long elapsedTicks)
+		{
+			Interlocked.Increment(ref latencySamples);
+			long current, updated;
+			do
+			{
+				current = Interlocked.Read(ref averageLatency);
+				updated = current + ((elapsedTicks - current) >> 3);
+			} while (Interlocked.CompareExchange(ref averageLatency, updated, current) != current);
+		}
+
+		public void Tick()
+		{
+			long now = Stopwatch.GetTimestamp();
+			double elapsedMs = (now - lastTick) * 1000.0 / Stopwatch.Frequency;
+			lastTick = now;
+			timeBudget = Math.Min(timeBudget + elapsedMs * config.BudgetPercent / 100, maxTimeBudget);
+			if (config.PagesPerSecond > 0)
+			{
+				pageBudget = Math.Min(pageBudget + elapsedMs * config.PagesPerSecond / 1000, config.PagesPerSecond);
+			}
+
+			// an idle store has no latency to protect
+			if (Interlocked.Exchange(ref latencySamples, 0) == 0)
+			{
+				Interlocked.Exchange(ref averageLatency, 0);
+			}
+			long latency = Interlocked.Read(ref averageLatency);
+			if (storage.MaintenanceForegroundLatency != null)
+			{
+				storage.MaintenanceForegroundLatency.RawValue = latency * 1000000 / Stopwatch.Frequency;
+			}
+			bool slow = latencyThresholdTicks > 0 && latency > latencyThresholdTicks;
+
+			foreach (Job job in jobs)
+			{
+				DateTime dueTime = DateTime.Now;
+				if (dueTime < job.NextDue) continue;
+				bool mustRun = job.Priority == MaintenancePriority.Critical ||
+					(job.Priority == MaintenancePriority.Bounded &&
+						(dueTime - job.NextDue).TotalMilliseconds >= config.MaxDeferral);
+				if (!mustRun && (slow || timeBudget <= 0 || (config.PagesPerSecond > 0 && pageBudget <= 0)))
+				{
+					if (storage.MaintenanceDeferrals != null)
+					{
+						storage.MaintenanceDeferrals.Increment();
+					}
+					if (BerkeleyDbStorage.Log.IsDebugEnabled)
+					{
+						BerkeleyDbStorage.Log.DebugFormat(
+							"Maintenance() {0} deferred, latency {1:0.0} ms, time budget {2:0.0} ms, page budget {3:0}",
+							job.Name, latency * 1000.0 / Stopwatch.Frequency, timeBudget, pageBudget);
+					}
+					continue;
+				}
+
+				// advance first so a failing job waits out its interval rather than retrying every tick
+				job.NextDue = dueTime.AddMilliseconds(job.Interval);
+				long started = Stopwatch.GetTimestamp();
+				int pages;
+				bool more;
+				try
+				{
+					more = job.Callback(out pages);
+				}
+				finally
+				{
+					long spent = Stopwatch.GetTimestamp() - started;
+					timeBudget -= spent * 1000.0 / Stopwatch.Frequency;
+					Count(spent);
+				}
+				pageBudget -= pages;
+				if (more)
+				{
+					job.NextDue = dueTime;
+				}
+			}
+		}
+
+		void Count(long spent)
+		{
+			if (storage.MaintenanceJobs != null)
+			{
+				storage.MaintenanceJobs.Increment();
+			}
+			if (storage.MaintenanceJobTime != null)
+			{
+				storage.MaintenanceJobTime.IncrementBy(spent);
+			}
+			if (storage.MaintenanceJobTimeBase != null)
+			{
+				storage.MaintenanceJobTimeBase.Increment();
+			}
+		}
+	}
+}
@@ -0,0 +1,87 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Xml.Serialization;
+using BerkeleyDbWrapper;
+using MySpace.BerkeleyDb.Configuration;
+using MySpace.BerkeleyDb.Facade;
+
+namespace MySpace.BerkeleyDb.ScanBenchmark
+{
+	/// <summary>
+	/// Scans every record of a type once with <see cref="BerkeleyDbStorage.GetRecords(int)"/>
+	/// and once with <see cref="BerkeleyDbStorage.GetRecordPages"/>, and reports the records
+	/// per second of each.
+	/// </summary>
+	class Program
+	{
+		static int Main(string[] args)
+		{
+			short typeId;
+			if (args.Length != 2 || !short.TryParse(args[1], out typeId))
+			{
+				Console.WriteLine("Usage: MySpace.BerkeleyDb.ScanBenchmark <BerkeleyDbConfig file> <type id>");
+				return 1;
+			}
+
+			BerkeleyDbConfig config;
+			using (var reader = File.OpenRead(args[0]))
+			{
+				config = (BerkeleyDbConfig)new XmlSerializer(typeof(BerkeleyDbConfig)).Deserialize(reader);
+			}
+			var storage = new BerkeleyDbStorage();
+			storage.Initialize("ScanBenchmark", config);
+			try
+			{
+				var enumeratorRate = ScanWithEnumerator(storage, typeId);
+				var bulkRate = ScanInBulk(storage, typeId);
+				Console.WriteLine("Bulk reads are {0:F1}x the enumerator",
+					enumeratorRate > 0 ? bulkRate / enumeratorRate : 0);
+			}
+			finally
+			{
+				storage.Shutdown();
+			}
+			return 0;
+		}
+
+		static double ScanWithEnumerator(BerkeleyDbStorage storage, short typeId)
+		{
+			long bytes = 0;
+			long records = 0;
+			var watch = Stopwatch.StartNew();
+			foreach (var record in storage.GetRecords(typeId))
+			{
+				bytes += record.Value.Length;
+				++records;
+			}
+			watch.Stop();
+			return Report("Enumerator", records, bytes, watch);
+		}
+
+		static double ScanInBulk(BerkeleyDbStorage storage, short typeId)
+		{
+			long bytes = 0;
+			long records = 0;
+			var watch = Stopwatch.StartNew();
+			foreach (var page in storage.GetRecordPages(typeId, new BulkRecordBuffer()))
+			{
+				for (var idx = 0; idx < page.Count; ++idx)
+				{
+					bytes += page.GetValue(idx).Count;
+				}
+				records += page.Count;
+			}
+			watch.Stop();
+			return Report("Bulk", records, bytes, watch);
+		}
+
+		static double Report(string method, long records, long bytes, Stopwatch watch)
+		{
+			var rate = records / Math.Max(watch.Elapsed.TotalSeconds, 0.001);
+			Console.WriteLine("{0}: {1} records, {2} bytes in {3} ms ({4:F0} records/s)",
+				method, records, bytes, watch.ElapsedMilliseconds, rate);
+			return rate;
+		}
+	}
+}
@@ -0,0 +1,193 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace BerkeleyDbWrapper
+{
+	/// <summary>
+	/// Usage statistics of the native allocator that serves memory Berkeley Db hands to the wrapper.
+	/// </summary>
+	public class AllocatorStatistics
+	{
+		// Fields
+		private readonly long _bytesLive;
+		private readonly long _slabBytes;
+		private readonly long _largeAllocations;
+		private readonly long _largeBytes;
+		private readonly SizeClassStatistics[] _sizeClasses;
+
+		// Methods
+		/// <summary>
+		/// Initializes a new instance of the <see cref="AllocatorStatistics"/> class.
+		/// </summary>
+		/// <param name="bytesLive">The requested bytes of all live allocations.</param>
+		/// <param name="slabBytes">The bytes currently held in slabs.</param>
+		/// <param name="largeAllocations">The number of live allocations too large for a size class.</param>
+		/// <param name="largeBytes">The bytes of the live large allocations.</param>
+		/// <param name="sizeClasses">The statistics of each size class.</param>
+		public AllocatorStatistics(long bytesLive, long slabBytes, long largeAllocations, long largeBytes,
+			SizeClassStatistics[] sizeClasses)
+		{
+			_bytesLive = bytesLive;
+			_slabBytes = slabBytes;
+			_largeAllocations = largeAllocations;
+			_largeBytes = largeBytes;
+			_sizeClasses = sizeClasses ?? new SizeClassStatistics[0];
+		}
+
+		/// <summary>
+		/// Gets the requested bytes of all live allocations.
+		/// </summary>
+		public long BytesLive { get { return _bytesLive; } }
+
+		/// <summary>
+		/// Gets the bytes currently held in slabs. Empty slabs beyond one per size class are given back.
+		/// </summary>
+		public long SlabBytes { get { return _slabBytes; } }
+
+		/// <summary>
+		/// Gets the number of live allocations too large for a size class.
+		/// </summary>
+		public long LargeAllocations { get { return _largeAllocations; } }
+
+		/// <summary>
+		/// Gets the bytes of the live large allocations.
+		/// </summary>
+		public long LargeBytes { get { return _largeBytes; } }
+
+		/// <summary>
+		/// Gets the statistics of each size class.
+		/// </summary>
+		public IList<SizeClassStatistics> SizeClasses { get { return _sizeClasses; } }
+
+		/// <summary>
+		/// Gets the fraction of the memory held by the allocator that is not live data.
+		/// </summary>
+		public double Fragmentation
+		{
+			get
+			{
+				long held = _slabBytes + _largeBytes;
+				return held > 0 ? 1.0 - (double)_bytesLive / held : 0.0;
+			}
+		}
+
+		/// <summary>
+		/// Returns a <see cref="String"/> that represents the statistics.
+		/// </summary>
+		public override string ToString()
+		{
+			StringBuilder sb = new StringBuilder();
+			sb.AppendFormat("Allocator: {0} bytes live, {1} slab bytes, {2} large allocations ({3} bytes), {4:P1} fragmentation",
+				_bytesLive, _slabBytes, _largeAllocations, _largeBytes, Fragmentation);
+			foreach (SizeClassStatistics sizeClass in _sizeClasses)
+			{
+				if (sizeClass.BlocksReserved == 0)
+				{
+					continue;
+				}
+				sb.AppendLine();
+				sb.Append("  ").Append(sizeClass);
+			}
+			return sb.ToString();
+		}
+	}
+
+	/// <summary>
+	/// Usage statistics of one size class of the native allocator.
+	/// </summary>
+	public class SizeClassStatistics
+	{
+		// Fields
+		private readonly int _blockSize;
+		private readonly long _hits;
+		private readonly long _misses;
+		private readonly long _blocksInUse;
+		private readonly long _blocksReserved;
+		private readonly long _bytesLive;
+
+		// Methods
+		/// <summary>
+		/// Initializes a new instance of the <see cref="SizeClassStatistics"/> class.
+		/// </summary>
+		/// <param name="blockSize">The largest allocation the class serves.</param>
+		/// <param name="hits">The allocations served from a thread cache.</param>
+		/// <param name="misses">The allocations that had to refill a thread cache.</param>
+		/// <param name="blocksInUse">The blocks currently allocated.</param>
+		/// <param name="blocksReserved">The blocks carved from slabs.</param>
+		/// <param name="bytesLive">The requested bytes of the blocks in use.</param>
+		public SizeClassStatistics(int blockSize, long hits, long misses, long blocksInUse, long blocksReserved,
+			long bytesLive)
+		{
+			_blockSize = blockSize;
+			_hits = hits;
+			_misses = misses;
+			_blocksInUse = blocksInUse;
+			_blocksReserved = blocksReserved;
+			_bytesLive = bytesLive;
+		}
+
+		/// <summary>
+		/// Gets the largest allocation the class serves.
+		/// </summary>
+		public int BlockSize { get { return _blockSize; } }
+
+		/// <summary>
+		/// Gets the number of allocations served from a thread cache.
+		/// </summary>
+		public long Hits { get { return _hits; } }
+
+		/// <summary>
+		/// Gets the number of allocations that had to refill a thread cache.
+		/// </summary>
+		public long Misses { get { return _misses; } }
+
+		/// <summary>
+		/// Gets the number of blocks currently allocated.
+		/// </summary>
+		public long BlocksInUse { get { return _blocksInUse; } }
+
+		/// <summary>
+		/// Gets the number of blocks carved from slabs.
+		/// </summary>
+		public long BlocksReserved { get { return _blocksReserved; } }
+
+		/// <summary>
+		/// Gets the requested bytes of the blocks in use.
+		/// </summary>
+		public long BytesLive { get { return _bytesLive; } }
+
+		/// <summary>
+		/// Gets the fraction of allocations served from a thread cache.
+		/// </summary>
+		public double HitRate
+		{
+			get
+			{
+				long total = _hits + _misses;
+				return total > 0 ? (double)_hits / total : 0.0;
+			}
+		}
+
+		/// <summary>
+		/// Gets the fraction of the reserved block bytes that is not live data.
+		/// </summary>
+		public double Fragmentation
+		{
+			get
+			{
+				long held = _blocksReserved * _blockSize;
+				return held > 0 ? 1.0 - (double)_bytesLive / held : 0.0;
+			}
+		}
+
+		/// <summary>
+		/// Returns a <see cref="String"/> that represents the statistics.
+		/// </summary>
+		public override string ToString()
+		{
+			return string.Format("{0,5} bytes: {1} in use of {2} reserved, {3} bytes live, {4:P1} hit rate, {5:P1} fragmentation",
+				_blockSize, _blocksInUse, _blocksReserved, _bytesLive, HitRate, Fragmentation);
+		}
+	}
+}
@@ -0,0 +1,167 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace BerkeleyDbWrapper
+{
+	/// <summary>
+	/// A reusable buffer that a <see cref="Cursor"/> fills with as many entries as fit,
+	/// read in one call, and that hands out the keys and values as slices of itself.
+	/// </summary>
+	public class BulkRecordBuffer
+	{
+		// Fields
+		/// <summary>
+		/// The default capacity in bytes.
+		/// </summary>
+		public const int DefaultCapacity = 1024 * 1024;
+		private const int capacityUnit = 1024;
+		private const int sliceFields = 4;
+		private byte[] _buffer;
+		private int[] _slices;
+		private int _count;
+		private bool _exhausted;
+
+		// Methods
+		/// <summary>
+		/// Initializes a new instance of the <see cref="BulkRecordBuffer"/> class with
+		/// <see cref="DefaultCapacity"/>.
+		/// </summary>
+		public BulkRecordBuffer() : this(DefaultCapacity)
+		{
+		}
+
+		/// <summary>
+		/// Initializes a new instance of the <see cref="BulkRecordBuffer"/> class.
+		/// </summary>
+		/// <param name="capacity">The capacity in bytes; rounded up to a multiple of 1024
+		/// as Berkeley Db requires. It must be at least the database page size.</param>
+		public BulkRecordBuffer(int capacity)
+		{
+			if (capacity <= 0) throw new ArgumentOutOfRangeException("capacity");
+			_buffer = new byte[RoundCapacity(capacity)];
+			_slices = new int[64 * sliceFields];
+		}
+
+		/// <summary>
+		/// Gets the underlying buffer the slices refer to.
+		/// </summary>
+		public byte[] Buffer { get { return _buffer; } }
+
+		/// <summary>
+		/// Gets the number of entries in the buffer.
+		/// </summary>
+		public int Count { get { return _count; } }
+
+		/// <summary>
+		/// Gets whether the last fill reached the end of the range being read, so no
+		/// further reads are needed.
+		/// </summary>
+		public bool Exhausted { get { return _exhausted; } }
+
+		/// <summary>
+		/// Gets the key of an entry.
+		/// </summary>
+		/// <param name="index">The index of the entry.</param>
+		/// <returns>The key as a slice of <see cref="Buffer"/>, valid until the buffer is refilled.</returns>
+		public ArraySegment<byte> GetKey(int index)
+		{
+			int slice = GetSlice(index);
+			return new ArraySegment<byte>(_buffer, _slices[slice], _slices[slice + 1]);
+		}
+
+		/// <summary>
+		/// Gets the value of an entry.
+		/// </summary>
+		/// <param name="index">The index of the entry.</param>
+		/// <returns>The value as a slice of <see cref="Buffer"/>, valid until the buffer is refilled.</returns>
+		public ArraySegment<byte> GetValue(int index)
+		{
+			int slice = GetSlice(index);
+			return new ArraySegment<byte>(_buffer, _slices[slice + 2], _slices[slice + 3]);
+		}
+
+		/// <summary>
+		/// Copies an entry into a new <see cref="DatabaseRecord"/>.
+		/// </summary>
+		/// <param name="index">The index of the entry.</param>
+		/// <returns>A <see cref="DatabaseRecord"/> that does not refer to the buffer.</returns>
+		public DatabaseRecord CreateRecord(int index)
+		{
+			return new DatabaseRecord(new DatabaseEntry(ToArray(GetKey(index))),
+				new DatabaseEntry(ToArray(GetValue(index))));
+		}
+
+		/// <summary>
+		/// Removes all entries. Called by <see cref="Cursor"/> implementations before a fill.
+		/// </summary>
+		public void Clear()
+		{
+			_count = 0;
+			_exhausted = false;
+		}
+
+		/// <summary>
+		/// Marks the range being read as finished. Called by <see cref="Cursor"/>
+		/// implementations when a filter's upper bound is passed.
+		/// </summary>
+		public void MarkExhausted()
+		{
+			_exhausted = true;
+		}
+
+		/// <summary>
+		/// Records an entry written into <see cref="Buffer"/>. Called by <see cref="Cursor"/>
+		/// implementations during a fill.
+		/// </summary>
+		/// <param name="keyOffset">The offset of the key in <see cref="Buffer"/>.</param>
+		/// <param name="keyLength">The length of the key.</param>
+		/// <param name="valueOffset">The offset of the value in <see cref="Buffer"/>.</param>
+		/// <param name="valueLength">The length of the value.</param>
+		public void Add(int keyOffset, int keyLength, int valueOffset, int valueLength)
+		{
+			int slice = _count * sliceFields;
+			if (slice == _slices.Length)
+			{
+				Array.Resize(ref _slices, _slices.Length * 2);
+			}
+			_slices[slice] = keyOffset;
+			_slices[slice + 1] = keyLength;
+			_slices[slice + 2] = valueOffset;
+			_slices[slice + 3] = valueLength;
+			++_count;
+		}
+
+		/// <summary>
+		/// Grows the buffer to hold at least <paramref name="capacity"/> bytes, discarding
+		/// its entries. Called by <see cref="Cursor"/> implementations when a single entry
+		/// doesn't fit.
+		/// </summary>
+		/// <param name="capacity">The needed capacity in bytes.</param>
+		public void Resize(int capacity)
+		{
+			Clear();
+			if (capacity > _buffer.Length)
+			{
+				_buffer = new byte[RoundCapacity(capacity)];
+			}
+		}
+
+		private int GetSlice(int index)
+		{
+			if (index < 0 || index >= _count) throw new ArgumentOutOfRangeException("index");
+			return index * sliceFields;
+		}
+
+		private static int RoundCapacity(int capacity)
+		{
+			return (capacity + capacityUnit - 1) / capacityUnit * capacityUnit;
+		}
+
+		private static byte[] ToArray(ArraySegment<byte> segment)
+		{
+			var ret = new byte[segment.Count];
+			Array.Copy(segment.Array, segment.Offset, ret, 0, segment.Count);
+			return ret;
+		}
+	}
+}
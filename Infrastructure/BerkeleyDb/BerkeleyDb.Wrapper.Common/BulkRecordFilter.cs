@@ -0,0 +1,78 @@
+﻿using System;
+
+namespace BerkeleyDbWrapper
+{
+	/// <summary>
+	/// Conditions a <see cref="Cursor"/> applies natively to each entry of a bulk read, so
+	/// entries that fail them never reach a <see cref="BulkRecordBuffer"/>'s slices.
+	/// </summary>
+	/// <remarks>
+	/// Key bounds compare bytes the way the default BTree ordering does. On BTree databases
+	/// the scan starts at <see cref="KeyStart"/> and stops at <see cref="KeyEnd"/>; on other
+	/// databases every entry is read and tested.
+	/// </remarks>
+	public class BulkRecordFilter
+	{
+		/// <summary>
+		/// Gets or sets the smallest key accepted, or null for no lower bound.
+		/// </summary>
+		public byte[] KeyStart { get; set; }
+
+		/// <summary>
+		/// Gets or sets the key above all accepted keys, or null for no upper bound.
+		/// </summary>
+		public byte[] KeyEnd { get; set; }
+
+		/// <summary>
+		/// Gets or sets the bytes a value must contain at <see cref="ValueOffset"/>,
+		/// or null to accept any value.
+		/// </summary>
+		public byte[] ValuePattern { get; set; }
+
+		/// <summary>
+		/// Gets or sets the offset within the value of <see cref="ValuePattern"/>.
+		/// </summary>
+		public int ValueOffset { get; set; }
+
+		/// <summary>
+		/// Determines whether an entry passes the filter. Used by <see cref="Cursor"/>
+		/// implementations that can't test entries natively.
+		/// </summary>
+		/// <param name="key">The entry key.</param>
+		/// <param name="value">The entry value.</param>
+		/// <returns><see langword="true"/> if the entry passes; otherwise <see langword="false"/>.</returns>
+		public bool Matches(ArraySegment<byte> key, ArraySegment<byte> value)
+		{
+			if (KeyStart != null && CompareKey(key, KeyStart) < 0) return false;
+			if (KeyEnd != null && CompareKey(key, KeyEnd) >= 0) return false;
+			var pattern = ValuePattern;
+			if (pattern != null)
+			{
+				if (ValueOffset < 0 || ValueOffset + pattern.Length > value.Count) return false;
+				for (int i = 0; i < pattern.Length; ++i)
+				{
+					if (value.Array[value.Offset + ValueOffset + i] != pattern[i]) return false;
+				}
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Compares a key to a bound in default BTree order.
+		/// </summary>
+		/// <param name="key">The key.</param>
+		/// <param name="bound">The bound.</param>
+		/// <returns>Less than 0 if <paramref name="key"/> sorts first, 0 if equal,
+		/// otherwise greater than 0.</returns>
+		public static int CompareKey(ArraySegment<byte> key, byte[] bound)
+		{
+			int length = Math.Min(key.Count, bound.Length);
+			for (int i = 0; i < length; ++i)
+			{
+				int diff = key.Array[key.Offset + i] - bound[i];
+				if (diff != 0) return diff;
+			}
+			return key.Count - bound.Length;
+		}
+	}
+}
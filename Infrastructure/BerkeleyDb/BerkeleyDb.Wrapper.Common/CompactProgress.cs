@@ -0,0 +1,64 @@
+﻿using System;
+
+namespace BerkeleyDbWrapper
+{
+	/// <summary>
+	/// Carries a compaction pass across calls to <see cref="Database.CompactSlice"/>, so a
+	/// database can be compacted a few pages at a time.
+	/// </summary>
+	public class CompactProgress
+	{
+		/// <summary>
+		/// Gets or sets the key the next slice starts at, or null to start at the beginning.
+		/// </summary>
+		public byte[] ResumeKey { get; set; }
+
+		/// <summary>
+		/// Gets whether the last slice reached the end of the database.
+		/// </summary>
+		public bool Completed { get; private set; }
+
+		/// <summary>
+		/// Gets the pages freed by the slices of this pass.
+		/// </summary>
+		public int PagesFreed { get; private set; }
+
+		/// <summary>
+		/// Gets the pages examined by the slices of this pass.
+		/// </summary>
+		public int PagesExamined { get; private set; }
+
+		/// <summary>
+		/// Gets the pages returned to the file system by the slices of this pass.
+		/// </summary>
+		public int PagesTruncated { get; private set; }
+
+		/// <summary>
+		/// Records the outcome of a slice.
+		/// </summary>
+		/// <param name="resumeKey">The key the slice stopped at, or null if it reached the end.</param>
+		/// <param name="pagesFreed">The pages the slice freed.</param>
+		/// <param name="pagesExamined">The pages the slice examined.</param>
+		/// <param name="pagesTruncated">The pages the slice returned to the file system.</param>
+		public void AddSlice(byte[] resumeKey, int pagesFreed, int pagesExamined, int pagesTruncated)
+		{
+			ResumeKey = resumeKey;
+			Completed = resumeKey == null;
+			PagesFreed += pagesFreed;
+			PagesExamined += pagesExamined;
+			PagesTruncated += pagesTruncated;
+		}
+
+		/// <summary>
+		/// Starts a new pass from the beginning of the database.
+		/// </summary>
+		public void Reset()
+		{
+			ResumeKey = null;
+			Completed = false;
+			PagesFreed = 0;
+			PagesExamined = 0;
+			PagesTruncated = 0;
+		}
+	}
+}
@@ -29,6 +29,7 @@ namespace MySpace.BerkeleyDb.Configuration
 		private int maxDeadlockRetries = 1;
 		private DatabaseTransactionMode transactionMode = DatabaseTransactionMode.None;
 		private DatabaseCompact compact;
+		private DeadlockRetry deadlockRetry = new DeadlockRetry();
 
 		private static string GetFilePath(string directory, string fileName)
 		{
@@ -272,6 +273,9 @@ namespace MySpace.BerkeleyDb.Configuration
 
 		[XmlElement("TransactionMode")]
 		public DatabaseTransactionMode TransactionMode { get { return transactionMode; } set { transactionMode = value; } }
+
+		[XmlElement("DeadlockRetry")]
+		public DeadlockRetry DeadlockRetry { get { return deadlockRetry; } set { deadlockRetry = value ?? new DeadlockRetry(); } }
 		
 		public DatabaseConfig Clone(int newId)
 		{
@@ -289,7 +293,14 @@ namespace MySpace.BerkeleyDb.Configuration
 											 HashSize = hashSize,
 											 RecordLength = recordLength,
 											 MaxDeadlockRetries = maxDeadlockRetries,
-											 TransactionMode = transactionMode
+											 TransactionMode = transactionMode,
+											 DeadlockRetry = new DeadlockRetry
+															 {
+																 BaseDelay = deadlockRetry.BaseDelay,
+																 MaxDelay = deadlockRetry.MaxDelay,
+																 Jitter = deadlockRetry.Jitter,
+																 RetryLockTimeout = deadlockRetry.RetryLockTimeout
+															 }
 										 };
 			
 			if (compact != null)
@@ -420,6 +431,7 @@ namespace MySpace.BerkeleyDb.Configuration
 	{
 		None = 0,
 		PerCall = 1,
+		GroupCommit = 2,
 	}
 
 	
@@ -439,4 +451,45 @@ namespace MySpace.BerkeleyDb.Configuration
 		[XmlElement("Timeout")]
 		public int Timeout { get { return timeout; } set { timeout = value; } }
 	}
+
+	/// <summary>
+	/// How a database waits between retries of an operation chosen as a deadlock victim.
+	/// Retry n waits a random time up to <see cref="BaseDelay"/> * 2^(n-1), capped at
+	/// <see cref="MaxDelay"/>. Cursor operations retry at once, since their transaction
+	/// keeps its locks while it waits.
+	/// </summary>
+	public class DeadlockRetry
+	{
+		private int baseDelay = 100;//Microseconds
+		private int maxDelay = 20000;//Microseconds
+		private bool jitter = true;
+		private int retryLockTimeout;//Microseconds
+
+		/// <summary>
+		/// The delay, in microseconds, before the first retry. If 0 then retries are immediate.
+		/// </summary>
+		[XmlElement("BaseDelay")]
+		public int BaseDelay { get { return baseDelay; } set { baseDelay = value; } }
+
+		/// <summary>
+		/// The longest delay, in microseconds, between retries.
+		/// </summary>
+		[XmlElement("MaxDelay")]
+		public int MaxDelay { get { return maxDelay; } set { maxDelay = value; } }
+
+		/// <summary>
+		/// Whether each delay is drawn at random up to its limit, so victims of the same
+		/// deadlock don't retry in step.
+		/// </summary>
+		[XmlElement("Jitter")]
+		public bool Jitter { get { return jitter; } set { jitter = value; } }
+
+		/// <summary>
+		/// The lock timeout, in microseconds, of a retried transaction, so a retry that runs
+		/// into the same contention gives up quickly and backs off again rather than waiting
+		/// out the environment's lock timeout. If 0 then the environment's timeout is kept.
+		/// </summary>
+		[XmlElement("RetryLockTimeout")]
+		public int RetryLockTimeout { get { return retryLockTimeout; } set { retryLockTimeout = value; } }
+	}
 }
@@ -61,6 +61,7 @@ namespace MySpace.BerkeleyDb.Configuration
 			TempDirectory = defaultFolder;
 			LockStatistics = new LockStatistics();
 			DeadlockDetection = new DeadlockDetection();
+			GroupCommit = new GroupCommit();
 		}
 
 		private void InitOpenFlags()
@@ -293,6 +294,12 @@ namespace MySpace.BerkeleyDb.Configuration
 		[XmlElement("LockStatistics")]
 		public LockStatistics LockStatistics { get; set; }
 
+		[XmlElement("GroupCommit")]
+		public GroupCommit GroupCommit { get; set; }
+
+		[XmlElement("Maintenance")]
+		public Maintenance Maintenance { get; set; }
+
 		[XmlElement("TempDirectory")]
 		public string TempDirectory { get; set; }
 
@@ -388,6 +395,8 @@ namespace MySpace.BerkeleyDb.Configuration
 		private int dataCopyBufferKByte;
 		private string directory = "Bkp";
 		private BackupMethod method = BackupMethod.MpoolFile;
+		private bool incremental;
+		private int maxIncrementalBackups = 8;
 
 		[XmlElement("Enabled")]
 		public bool Enabled { get { return enabled; } set { enabled = value; } }
@@ -405,6 +414,18 @@ namespace MySpace.BerkeleyDb.Configuration
 		public int ReinitializeLogFileCount { get { return reinitializeLogFileCount; } set { reinitializeLogFileCount = value; } }
 		[XmlElement("Method")]
 		public BackupMethod Method { get { return method; } set { method = value; } }
+		/// <summary>
+		/// When set, reinitializing the backup writes only the pages changed since the previous
+		/// backup into delta files instead of copying every data file again.
+		/// </summary>
+		[XmlElement("Incremental")]
+		public bool Incremental { get { return incremental; } set { incremental = value; } }
+		/// <summary>
+		/// The number of incremental backups taken on top of a full backup before the next
+		/// reinitialization makes a full copy again.
+		/// </summary>
+		[XmlElement("MaxIncrementalBackups")]
+		public int MaxIncrementalBackups { get { return maxIncrementalBackups; } set { maxIncrementalBackups = value; } }
 	}
 
 	/// <remarks/>
@@ -447,6 +468,96 @@ namespace MySpace.BerkeleyDb.Configuration
 		int ITimerConfig.Interval { get { return timerInterval; } set { timerInterval = value; } }
 	}
 
+	/// <summary>
+	/// Bounds the commit window shared by databases using
+	/// <see cref="DatabaseTransactionMode.GroupCommit"/>.
+	/// </summary>
+	public class GroupCommit
+	{
+		private int maxWait = 2;//Milliseconds
+		private int maxOperations = 64;
+
+		/// <summary>
+		/// The longest time, in milliseconds, the first writer of a group waits for
+		/// others to join before the group's log flush.
+		/// </summary>
+		[XmlElement("MaxWait")]
+		public int MaxWait { get { return maxWait; } set { maxWait = value; } }
+
+		/// <summary>
+		/// The number of commits that closes a group without waiting out
+		/// <see cref="MaxWait"/>.
+		/// </summary>
+		[XmlElement("MaxOperations")]
+		public int MaxOperations { get { return maxOperations; } set { maxOperations = value; } }
+	}
+
+	/// <summary>
+	/// Replaces the separate checkpoint, cache trickle, compaction and deadlock detection
+	/// timers with one scheduler that runs them within a time and page budget, and holds
+	/// them back while foreground requests are slow.
+	/// </summary>
+	public class Maintenance : ITimerConfig
+	{
+		private int tickInterval = 1000;//Milliseconds
+		private int budgetPercent = 10;
+		private int pagesPerSecond = 2000;
+		private int latencyThreshold = 20;//Milliseconds
+		private int maxDeferral = 60000;//Milliseconds
+		private int compactSlicePages = 64;
+		private int compactSliceKeys = 10000;
+
+		[XmlElement("Enabled")]
+		public bool Enabled { get; set; }
+
+		/// <summary>
+		/// How often, in milliseconds, the scheduler looks for due jobs.
+		/// </summary>
+		[XmlElement("TickInterval")]
+		public int TickInterval { get { return tickInterval; } set { tickInterval = value; } }
+		int ITimerConfig.Interval { get { return tickInterval; } set { tickInterval = value; } }
+
+		/// <summary>
+		/// The share of wall clock time, in percent, maintenance jobs may run for.
+		/// </summary>
+		[XmlElement("BudgetPercent")]
+		public int BudgetPercent { get { return budgetPercent; } set { budgetPercent = value; } }
+
+		/// <summary>
+		/// The pages per second trickle and compaction may write or examine. If 0 then
+		/// not limited.
+		/// </summary>
+		[XmlElement("PagesPerSecond")]
+		public int PagesPerSecond { get { return pagesPerSecond; } set { pagesPerSecond = value; } }
+
+		/// <summary>
+		/// The average foreground request latency, in milliseconds, above which maintenance
+		/// is paused. If 0 then never paused for latency.
+		/// </summary>
+		[XmlElement("LatencyThreshold")]
+		public int LatencyThreshold { get { return latencyThreshold; } set { latencyThreshold = value; } }
+
+		/// <summary>
+		/// The longest time, in milliseconds, a due checkpoint is held back by latency or
+		/// budget before it runs regardless.
+		/// </summary>
+		[XmlElement("MaxDeferral")]
+		public int MaxDeferral { get { return maxDeferral; } set { maxDeferral = value; } }
+
+		/// <summary>
+		/// The most pages freed by one compaction slice before it yields.
+		/// </summary>
+		[XmlElement("CompactSlicePages")]
+		public int CompactSlicePages { get { return compactSlicePages; } set { compactSlicePages = value; } }
+
+		/// <summary>
+		/// The most records one compaction slice spans before it yields, however few pages
+		/// it frees. If 0 then slices are limited only by <see cref="CompactSlicePages"/>.
+		/// </summary>
+		[XmlElement("CompactSliceKeys")]
+		public int CompactSliceKeys { get { return compactSliceKeys; } set { compactSliceKeys = value; } }
+	}
+
 	/// <remarks/>
 	public class Compact : ITimerConfig
 	{
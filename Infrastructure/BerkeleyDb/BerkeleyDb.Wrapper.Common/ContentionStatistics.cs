@@ -0,0 +1,65 @@
+﻿using System;
+
+namespace BerkeleyDbWrapper
+{
+	/// <summary>
+	/// Deadlock retry statistics of a database since it was opened.
+	/// </summary>
+	public class ContentionStatistics
+	{
+		// Fields
+		private readonly long _deadlocks;
+		private readonly long _retries;
+		private readonly long _retriesExhausted;
+		private readonly TimeSpan _retryTime;
+
+		// Methods
+		/// <summary>
+		/// Initializes a new instance of the <see cref="ContentionStatistics"/> class.
+		/// </summary>
+		/// <param name="deadlocks">The number of operations chosen as deadlock victims.</param>
+		/// <param name="retries">The number of retries made after deadlocks.</param>
+		/// <param name="retriesExhausted">The number of operations that gave up after their last retry.</param>
+		/// <param name="retryTime">The time from the first deadlock of an operation to its completion,
+		/// summed over all operations that deadlocked.</param>
+		public ContentionStatistics(long deadlocks, long retries, long retriesExhausted, TimeSpan retryTime)
+		{
+			_deadlocks = deadlocks;
+			_retries = retries;
+			_retriesExhausted = retriesExhausted;
+			_retryTime = retryTime;
+		}
+
+		/// <summary>
+		/// Gets the number of operations chosen as deadlock victims.
+		/// </summary>
+		public long Deadlocks { get { return _deadlocks; } }
+
+		/// <summary>
+		/// Gets the number of retries made after deadlocks.
+		/// </summary>
+		public long Retries { get { return _retries; } }
+
+		/// <summary>
+		/// Gets the number of operations that gave up after their last retry.
+		/// </summary>
+		public long RetriesExhausted { get { return _retriesExhausted; } }
+
+		/// <summary>
+		/// Gets the time spent retrying, from the first deadlock of each operation to its completion.
+		/// </summary>
+		public TimeSpan RetryTime { get { return _retryTime; } }
+
+		/// <summary>
+		/// Combines two sets of statistics, such as those of the databases of a federation.
+		/// </summary>
+		/// <returns>The sum of <paramref name="first"/> and <paramref name="second"/>.</returns>
+		public static ContentionStatistics Add(ContentionStatistics first, ContentionStatistics second)
+		{
+			if (first == null) return second;
+			if (second == null) return first;
+			return new ContentionStatistics(first._deadlocks + second._deadlocks, first._retries + second._retries,
+				first._retriesExhausted + second._retriesExhausted, first._retryTime + second._retryTime);
+		}
+	}
+}
@@ -144,6 +144,59 @@ namespace BerkeleyDbWrapper
 		/// </returns>
 		public abstract Buffers GetBuffers(DataBuffer key, int offset, int length, CursorPosition position, GetOpFlags flags);
 		/// <summary>
+		/// <para>Reads as many entries as fit into a buffer in one call.</para>
+		/// </summary>
+		/// <param name="buffer">
+		/// <para>The <see cref="BulkRecordBuffer" /> whose entries are replaced. It grows
+		/// if the next entry alone doesn't fit.</para>
+		/// </param>
+		/// <param name="position">
+		/// <para>The <see cref="CursorPosition" /> specifying the position at
+		/// which to start reading, such as <see cref="CursorPosition.Next" />. The
+		/// cursor is left on the last entry read.</para>
+		/// </param>
+		/// <param name="flags">
+		/// <para>The <see cref="GetOpFlags" /> specifying the read options.</para>
+		/// </param>
+		/// <returns>
+		/// <para>The number of entries read, or <see cref="Lengths.NotFound" /> if
+		/// there are no more entries.</para>
+		/// </returns>
+		/// <exception cref="NotSupportedException">
+		/// <para>The database has record number keys.</para>
+		/// </exception>
+		public int GetBulk(BulkRecordBuffer buffer, CursorPosition position, GetOpFlags flags)
+		{
+			return GetBulk(buffer, null, position, flags);
+		}
+		/// <summary>
+		/// <para>Reads as many entries as fit into a buffer in one call, keeping only
+		/// those that pass a filter.</para>
+		/// </summary>
+		/// <param name="buffer">
+		/// <para>The <see cref="BulkRecordBuffer" /> whose entries are replaced. It grows
+		/// if the next entry alone doesn't fit.</para>
+		/// </param>
+		/// <param name="filter">
+		/// <para>The <see cref="BulkRecordFilter" /> entries must pass, or null to keep all.</para>
+		/// </param>
+		/// <param name="position">
+		/// <para>The <see cref="CursorPosition" /> specifying the position at
+		/// which to start reading. <see cref="CursorPosition.SetRange" /> starts at the
+		/// filter's <see cref="BulkRecordFilter.KeyStart" />.</para>
+		/// </param>
+		/// <param name="flags">
+		/// <para>The <see cref="GetOpFlags" /> specifying the read options.</para>
+		/// </param>
+		/// <returns>
+		/// <para>The number of entries kept, which can be 0, or <see cref="Lengths.NotFound" />
+		/// if there are no more entries.</para>
+		/// </returns>
+		/// <exception cref="NotSupportedException">
+		/// <para>The database has record number keys.</para>
+		/// </exception>
+		public abstract int GetBulk(BulkRecordBuffer buffer, BulkRecordFilter filter, CursorPosition position, GetOpFlags flags);
+		/// <summary>
 		/// <para>Writes a cursor entry.</para>
 		/// </summary>
 		/// <param name="key">
@@ -45,6 +45,18 @@ namespace BerkeleyDbWrapper
 		/// <param name="copyBuffer">The copy buffer to use.</param>
 		public abstract void BackupFromMpf(string backupFile, byte[] copyBuffer);
 		/// <summary>
+		/// Backs up only the pages of the database changed since a given log sequence number, reading
+		/// them from the database memory pool. The delta file holds a header, then each changed page
+		/// preceded by its page number, then a trailer with the number of pages in the database.
+		/// </summary>
+		/// <param name="deltaFile">The delta file to write.</param>
+		/// <param name="sinceLsn">The log sequence number of the previous backup, as returned by
+		/// <see cref="BerkeleyDbWrapper.Environment.GetLastCheckpointLsn"/>. Pages with an older
+		/// log sequence number are skipped.</param>
+		/// <param name="copyBuffer">The copy buffer to use for writing.</param>
+		/// <returns>The number of pages written to the delta file.</returns>
+		public abstract int BackupDeltaFromMpf(string deltaFile, long sinceLsn, byte[] copyBuffer);
+		/// <summary>
 		/// Compacts the database.
 		/// </summary>
 		/// <param name="fillPercentage">The targetted fill percentage for pages to be considered for
@@ -55,6 +67,21 @@ namespace BerkeleyDbWrapper
 		/// <returns>The number of pages freed.</returns>
 		public abstract int Compact(int fillPercentage, int maxPagesFreed, int implicitTxnTimeoutMsecs);
 		/// <summary>
+		/// Compacts part of the database, starting where the previous slice of the pass stopped.
+		/// </summary>
+		/// <param name="fillPercentage">The targetted fill percentage for pages to be considered for
+		/// compaction. If 0 then every page is a candidate</param>
+		/// <param name="maxPagesFreed">The number of pages freed after which the slice stops.
+		/// If 0 then the slice runs to the end of the database.</param>
+		/// <param name="maxKeys">The number of records the slice spans, counted from where it
+		/// starts. If 0 then the slice is limited only by <paramref name="maxPagesFreed"/>.</param>
+		/// <param name="implicitTxnTimeoutMsecs">The timeout in milliseconds of the implicit
+		/// transaction used for the compaction. If 0 then ignored.</param>
+		/// <param name="progress">The <see cref="CompactProgress"/> of the pass, updated with
+		/// the outcome of the slice.</param>
+		public abstract void CompactSlice(int fillPercentage, int maxPagesFreed, int maxKeys,
+			int implicitTxnTimeoutMsecs, CompactProgress progress);
+		/// <summary>
 		/// Deletes an entry.
 		/// </summary>
 		/// <param name="key">The <see cref="Int32"/> key of the entry to delete.</param>
@@ -179,11 +206,31 @@ namespace BerkeleyDbWrapper
 		/// partial reads. Otherwise, <see langword="null"/>.</returns>
 		public abstract byte[] GetBuffer(DataBuffer key, int offset, int length, GetOpFlags flags);
 		/// <summary>
+		/// Gets entry data without copying it into managed memory.
+		/// </summary>
+		/// <param name="key">The <see cref="DataBuffer"/> key.</param>
+		/// <param name="offset">The <see cref="Int32"/> offset. If greater than or equal to 0
+		/// then it does a partial read, starting at this offset and of the length of
+		/// <paramref name="length"/>.</param>
+		/// <param name="length">The <see cref="Int32"/> length. If greater than or equal to 0
+		/// then it does a partial read, starting at this offset and of the length of
+		/// <paramref name="length"/>.</param>
+		/// <param name="flags">The <see cref="GetOpFlags"/>.</param>
+		/// <returns>If found, then an <see cref="UnmanagedMemoryView"/> over a native copy of the entry
+		/// data, or a portion thereof for partial reads, that the caller must dispose. Otherwise,
+		/// <see langword="null"/>.</returns>
+		public abstract UnmanagedMemoryView GetView(DataBuffer key, int offset, int length, GetOpFlags flags);
+		/// <summary>
 		/// Gets the size of the cache.
 		/// </summary>
 		/// <returns>A <see cref="CacheSize"/> specifying the size.</returns>
 		public abstract CacheSize GetCacheSize();
 		/// <summary>
+		/// Gets the deadlock retry statistics of the database, summed over the threads using it.
+		/// </summary>
+		/// <returns>The <see cref="ContentionStatistics"/> since the database was opened.</returns>
+		public abstract ContentionStatistics GetContentionStatistics();
+		/// <summary>
 		/// Gets the configuration for this instance.
 		/// </summary>
 		/// <returns>The <see cref="DatabaseConfig"/> used to open this instance.</returns>
@@ -236,6 +283,44 @@ namespace BerkeleyDbWrapper
 				}
 		}
 		/// <summary>
+		/// Reads the records in this instance in bulk, a buffer at a time.
+		/// </summary>
+		/// <param name="buffer">The <see cref="BulkRecordBuffer"/> refilled for each step.</param>
+		/// <returns>An <see cref="IEnumerable{BulkRecordBuffer}"/> that yields <paramref name="buffer"/>
+		/// each time it has been refilled with the next records.</returns>
+		/// <remarks>Unlike <see cref="GetEnumerator"/>, nothing is allocated per record; the keys and
+		/// values are slices of <paramref name="buffer"/> that are only valid until the next step.</remarks>
+		public IEnumerable<BulkRecordBuffer> GetBulkRecords(BulkRecordBuffer buffer)
+		{
+			return GetBulkRecords(buffer, null);
+		}
+		/// <summary>
+		/// Reads the records in this instance that pass a filter in bulk, a buffer at a time.
+		/// </summary>
+		/// <param name="buffer">The <see cref="BulkRecordBuffer"/> refilled for each step.</param>
+		/// <param name="filter">The <see cref="BulkRecordFilter"/> applied natively, or null.</param>
+		/// <returns>An <see cref="IEnumerable{BulkRecordBuffer}"/> that yields <paramref name="buffer"/>
+		/// each time it has been refilled with the next records that pass.</returns>
+		public IEnumerable<BulkRecordBuffer> GetBulkRecords(BulkRecordBuffer buffer, BulkRecordFilter filter)
+		{
+			if (buffer == null) throw new ArgumentNullException("buffer");
+			return GetBulkRecordsCore(buffer, filter);
+		}
+		private IEnumerable<BulkRecordBuffer> GetBulkRecordsCore(BulkRecordBuffer buffer, BulkRecordFilter filter)
+		{
+			if (Disposed) yield break;
+			var position = filter != null && filter.KeyStart != null ? CursorPosition.SetRange : CursorPosition.Next;
+			using (var cursor = GetCursor())
+				while (!Disposed)
+				{
+					var count = cursor.GetBulk(buffer, filter, position, GetOpFlags.Default);
+					if (count < 0) yield break;
+					position = CursorPosition.Next;
+					if (count > 0) yield return buffer;
+					if (buffer.Exhausted) yield break;
+				}
+		}
+		/// <summary>
 		/// Returns an enumerator that iterates through a collection.
 		/// </summary>
 		/// <returns>
@@ -361,6 +446,72 @@ namespace BerkeleyDbWrapper
 		/// <returns>The length of the data written.</returns>
 		public abstract int Put(DataBuffer key, int offset, int count, DataBuffer buffer, PutOpFlags flags);
 		/// <summary>
+		/// Gets the data of several entries in one batch.
+		/// </summary>
+		/// <param name="keys">The <see cref="DataBuffer"/> keys of the entries.</param>
+		/// <param name="buffers">The <see cref="DataBuffer"/>s that receive the entry data, one per key.</param>
+		/// <param name="results">Receives, per key, the length of the entry if found; otherwise a negative
+		/// value. As with <see cref="Get(DataBuffer, int, DataBuffer, GetOpFlags)"/>, a length greater than
+		/// the length of the corresponding buffer means the buffer was too small.</param>
+		/// <param name="flags">The <see cref="GetOpFlags"/> for the operation.</param>
+		/// <remarks>The whole batch runs under a single transaction if the database is transactional.
+		/// On deadlock only the items whose effects were rolled back are retried.</remarks>
+		public abstract void GetMany(DataBuffer[] keys, DataBuffer[] buffers, int[] results, GetOpFlags flags);
+		/// <summary>
+		/// Writes the data of several entries in one batch.
+		/// </summary>
+		/// <param name="keys">The <see cref="DataBuffer"/> keys of the entries.</param>
+		/// <param name="buffers">The <see cref="DataBuffer"/>s containing the data to be written, one per key.</param>
+		/// <param name="results">Receives, per key, the length of the data written.</param>
+		/// <param name="flags">The <see cref="PutOpFlags"/> for the operation.</param>
+		/// <remarks>The whole batch runs under a single transaction if the database is transactional.
+		/// On deadlock only the items whose effects were rolled back are retried.</remarks>
+		public abstract void PutMany(DataBuffer[] keys, DataBuffer[] buffers, int[] results, PutOpFlags flags);
+		/// <summary>
+		/// Deletes several entries in one batch.
+		/// </summary>
+		/// <param name="keys">The <see cref="DataBuffer"/> keys of the entries to delete.</param>
+		/// <param name="results">Receives, per key, <see cref="DbRetVal.SUCCESS"/> if the entry existed
+		/// and was deleted; otherwise <see cref="DbRetVal.NOTFOUND"/> or <see cref="DbRetVal.KEYEMPTY"/>.</param>
+		/// <param name="flags">The <see cref="DeleteOpFlags"/> for the operation.</param>
+		/// <remarks>The whole batch runs under a single transaction if the database is transactional.
+		/// On deadlock only the items whose effects were rolled back are retried.</remarks>
+		public abstract void DeleteMany(DataBuffer[] keys, DbRetVal[] results, DeleteOpFlags flags);
+		/// <summary>
+		/// Adds to a 32 bit counter held in an entry, in place, under the entry's write lock.
+		/// </summary>
+		/// <param name="key">The <see cref="DataBuffer"/> key.</param>
+		/// <param name="initialData">The <see cref="DataBuffer"/> the entry starts with if it doesn't exist,
+		/// or is shorter than this.</param>
+		/// <param name="counterOffset">The <see cref="Int32"/> offset of the counter in the entry. Must not
+		/// be less than the length of <paramref name="initialData"/>. An entry that ends before the counter
+		/// is extended with zeros.</param>
+		/// <param name="incrementBy">The <see cref="Int32"/> amount added; negative to decrement.</param>
+		/// <param name="minimum">The <see cref="Int32"/> lowest value the counter is left with.</param>
+		/// <param name="maximum">The <see cref="Int32"/> highest value the counter is left with.</param>
+		/// <returns>The new value of the counter.</returns>
+		public abstract int IncrementCounter(DataBuffer key, DataBuffer initialData, int counterOffset,
+			int incrementBy, int minimum, int maximum);
+		/// <summary>
+		/// Writes entry data only if the entry doesn't exist or holds an older timestamp, checking and
+		/// writing under the entry's write lock.
+		/// </summary>
+		/// <param name="key">The <see cref="DataBuffer"/> key.</param>
+		/// <param name="buffer">The <see cref="DataBuffer"/> containing the data to be written.</param>
+		/// <param name="ticksOffset">The <see cref="Int64"/> offset of the timestamp, in both
+		/// <paramref name="buffer"/> and the stored entry.</param>
+		/// <param name="storedTicks">Set to the stored timestamp if the write was refused.</param>
+		/// <returns>true if the data was written; false if the stored timestamp is the same or newer.</returns>
+		public abstract bool CompareAndSet(DataBuffer key, DataBuffer buffer, int ticksOffset, out long storedTicks);
+		/// <summary>
+		/// Appends data to the end of an entry under the entry's write lock.
+		/// </summary>
+		/// <param name="key">The <see cref="DataBuffer"/> key.</param>
+		/// <param name="initialData">The <see cref="DataBuffer"/> the entry starts with if it doesn't exist.</param>
+		/// <param name="buffer">The <see cref="DataBuffer"/> containing the data to be appended.</param>
+		/// <returns>The length of the entry after the append.</returns>
+		public abstract int Append(DataBuffer key, DataBuffer initialData, DataBuffer buffer);
+		/// <summary>
 		/// Flushes any cached changes to the database.
 		/// </summary>
 		public abstract void Sync();
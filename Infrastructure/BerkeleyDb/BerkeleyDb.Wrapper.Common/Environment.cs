@@ -109,6 +109,17 @@ namespace BerkeleyDbWrapper
 		/// <returns>The <see cref="Int32"/> number of the last checkpointed log.</returns>
 		public abstract int GetLastCheckpointLogNumber();
 		/// <summary>
+		/// Gets the log sequence number of the last checkpoint.
+		/// </summary>
+		/// <returns>The <see cref="Int64"/> log sequence number of the last checkpoint, with the log file
+		/// number in the high 32 bits and the offset within that file in the low 32 bits.</returns>
+		public abstract long GetLastCheckpointLsn();
+		/// <summary>
+		/// Gets the statistics of the native allocator serving Berkeley Db memory.
+		/// </summary>
+		/// <returns>The <see cref="AllocatorStatistics"/> of the allocator, shared by all environments.</returns>
+		public abstract AllocatorStatistics GetAllocatorStatistics();
+		/// <summary>
 		/// Gets the lock statistics.
 		/// </summary>
 		public abstract void GetLockStatistics();
@@ -449,6 +460,26 @@ namespace BerkeleyDbWrapper
 		/// <value>The lock stat TXN timeout.</value>
 		public PerformanceCounter LockStatTxnTimeout { get; set; }
 		/// <summary>
+		/// Gets or sets the average number of commits made durable by one group commit flush.
+		/// </summary>
+		/// <value>The group commit size.</value>
+		public PerformanceCounter GroupCommitSize { get; set; }
+		/// <summary>
+		/// Gets or sets the base of <see cref="GroupCommitSize"/>.
+		/// </summary>
+		/// <value>The group commit size base.</value>
+		public PerformanceCounter GroupCommitSizeBase { get; set; }
+		/// <summary>
+		/// Gets or sets the average time a group commit writer waits for its group to be flushed.
+		/// </summary>
+		/// <value>The group commit wait time.</value>
+		public PerformanceCounter GroupCommitWaitTime { get; set; }
+		/// <summary>
+		/// Gets or sets the base of <see cref="GroupCommitWaitTime"/>.
+		/// </summary>
+		/// <value>The group commit wait time base.</value>
+		public PerformanceCounter GroupCommitWaitTimeBase { get; set; }
+		/// <summary>
 		/// Gets the pre open set flags.
 		/// </summary>
 		/// <value>The pre open set flags.</value>
@@ -0,0 +1,200 @@
+﻿using System;
+using System.IO;
+using System.Text;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.BerkeleyDb.Facade;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests writing the pages changed since a checkpoint to a delta file, and applying delta
+	/// files over a data file as <see cref="BackupSet"/> restore does.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class BackupDeltaTests
+	{
+		private const int _pageSize = 16;
+		private const uint _endMarker = 0xFFFFFFFF;
+
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("BackupDeltaTests");
+			_db = _environment.OpenDatabase("Delta.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private string GetPath(string fileName)
+		{
+			return Path.Combine(_environment.Home, fileName);
+		}
+
+		private static byte[] Page(byte fill)
+		{
+			var page = new byte[_pageSize];
+			for (var i = 0; i < page.Length; ++i)
+			{
+				page[i] = fill;
+			}
+			return page;
+		}
+
+		// Writes a delta file in the layout Database.BackupDeltaFromMpf produces.
+		private static void WriteDelta(string path, string magic, uint version, uint pageCount,
+			params uint[] pageNumbers)
+		{
+			using (var writer = new BinaryWriter(File.Create(path)))
+			{
+				writer.Write(Encoding.ASCII.GetBytes(magic));
+				writer.Write(version);
+				writer.Write(_pageSize);
+				writer.Write(0L);
+				foreach (var pageNumber in pageNumbers)
+				{
+					writer.Write(pageNumber);
+					writer.Write(Page((byte)(0xA0 + pageNumber)));
+				}
+				writer.Write(_endMarker);
+				writer.Write(pageCount);
+			}
+		}
+
+		private static void WriteDataFile(string path, int pageCount)
+		{
+			using (var stream = File.Create(path))
+			{
+				for (var i = 0; i < pageCount; ++i)
+				{
+					stream.Write(Page((byte)i), 0, _pageSize);
+				}
+			}
+		}
+
+		private static void AssertPage(byte[] file, int pageNumber, byte fill)
+		{
+			for (var i = 0; i < _pageSize; ++i)
+			{
+				Assert.AreEqual(fill, file[pageNumber * _pageSize + i], "Page " + pageNumber);
+			}
+		}
+
+		[TestMethod]
+		public void DeltaPagesReplaceTheirPagesOnly()
+		{
+			var dataFile = GetPath("Data.bdb");
+			var deltaFile = GetPath("Data.delta");
+			WriteDataFile(dataFile, 4);
+			WriteDelta(deltaFile, "BDBDELTA", 1, 4, 1, 3);
+
+			Assert.AreEqual(2, BackupSet.ApplyDelta(deltaFile, dataFile));
+
+			var data = File.ReadAllBytes(dataFile);
+			Assert.AreEqual(4 * _pageSize, data.Length);
+			AssertPage(data, 0, 0);
+			AssertPage(data, 1, 0xA1);
+			AssertPage(data, 2, 2);
+			AssertPage(data, 3, 0xA3);
+		}
+
+		[TestMethod]
+		public void DataFileTakesThePageCountOfTheDelta()
+		{
+			var dataFile = GetPath("Data.bdb");
+			var deltaFile = GetPath("Data.delta");
+
+			// compacted since the base backup
+			WriteDataFile(dataFile, 4);
+			WriteDelta(deltaFile, "BDBDELTA", 1, 2);
+			Assert.AreEqual(0, BackupSet.ApplyDelta(deltaFile, dataFile));
+			Assert.AreEqual(2 * _pageSize, new FileInfo(dataFile).Length);
+
+			// grown since the base backup
+			WriteDelta(deltaFile, "BDBDELTA", 1, 6, 4, 5);
+			Assert.AreEqual(2, BackupSet.ApplyDelta(deltaFile, dataFile));
+			var data = File.ReadAllBytes(dataFile);
+			Assert.AreEqual(6 * _pageSize, data.Length);
+			AssertPage(data, 1, 1);
+			AssertPage(data, 5, 0xA5);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void OtherFilesAreNotApplied()
+		{
+			var deltaFile = GetPath("Data.delta");
+			WriteDelta(deltaFile, "NOTDELTA", 1, 1);
+
+			BackupSet.ApplyDelta(deltaFile, GetPath("Data.bdb"));
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void UnsupportedVersionsAreNotApplied()
+		{
+			var deltaFile = GetPath("Data.delta");
+			WriteDelta(deltaFile, "BDBDELTA", 2, 1);
+
+			BackupSet.ApplyDelta(deltaFile, GetPath("Data.bdb"));
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ApplicationException))]
+		public void TruncatedDeltaIsAnError()
+		{
+			var deltaFile = GetPath("Data.delta");
+			WriteDelta(deltaFile, "BDBDELTA", 1, 2, 0, 1);
+			var length = new FileInfo(deltaFile).Length;
+			using (var stream = new FileStream(deltaFile, FileMode.Open))
+			{
+				// cut into the last page, losing the trailer
+				stream.SetLength(length - 8 - _pageSize / 2);
+			}
+
+			BackupSet.ApplyDelta(deltaFile, GetPath("Data.bdb"));
+		}
+
+		[TestMethod]
+		public void FullBackupWithDeltaMatchesALaterFullBackup()
+		{
+			var copyBuffer = new byte[64 * 1024];
+			for (var i = 0; i < 1000; ++i)
+			{
+				_db.Put(BulkScanTests.Key(i), BulkScanTests.Value(i, 100));
+			}
+			_environment.Environment.Checkpoint(0, 0, true);
+			var baseFile = GetPath("Base.backup");
+			_db.BackupFromMpf(baseFile, copyBuffer);
+			var sinceLsn = _environment.Environment.GetLastCheckpointLsn();
+
+			for (var i = 0; i < 1000; i += 100)
+			{
+				_db.Put(BulkScanTests.Key(i), BulkScanTests.Value(i + 1, 100));
+			}
+			_db.Put(BulkScanTests.Key(5000), BulkScanTests.Value(5000, 2000));
+			var deltaFile = GetPath("Base.delta");
+			var changed = _db.BackupDeltaFromMpf(deltaFile, sinceLsn, copyBuffer);
+			var laterFile = GetPath("Later.backup");
+			_db.BackupFromMpf(laterFile, copyBuffer);
+
+			var pageSize = _db.GetPageSize();
+			var pageCount = new FileInfo(laterFile).Length / pageSize;
+			Assert.IsTrue(changed > 0, "No pages changed");
+			Assert.IsTrue(changed < pageCount, "Every page changed");
+			Assert.AreEqual(changed, BackupSet.ApplyDelta(deltaFile, baseFile));
+			CollectionAssert.AreEqual(File.ReadAllBytes(laterFile), File.ReadAllBytes(baseFile));
+		}
+	}
+}
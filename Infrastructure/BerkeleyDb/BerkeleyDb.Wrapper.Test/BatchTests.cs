@@ -0,0 +1,140 @@
+﻿using System;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class BatchTests
+	{
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("BatchTests");
+			_db = _environment.OpenDatabase("Batch.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private static byte[] Value(int key, int length)
+		{
+			var value = new byte[length];
+			for (var i = 0; i < length; ++i)
+			{
+				value[i] = (byte)(key + i);
+			}
+			return value;
+		}
+
+		// Read buffers of length bytes each, and the arrays behind them.
+		private static DataBuffer[] Buffers(int count, int length, out byte[][] arrays)
+		{
+			arrays = new byte[count][];
+			var buffers = new DataBuffer[count];
+			for (var i = 0; i < count; ++i)
+			{
+				arrays[i] = new byte[length];
+				buffers[i] = arrays[i];
+			}
+			return buffers;
+		}
+
+		private static DataBuffer[] Buffers(int count, int length)
+		{
+			byte[][] arrays;
+			return Buffers(count, length, out arrays);
+		}
+
+		[TestMethod]
+		public void PutManyThenGetManyRoundTrips()
+		{
+			var keys = new DataBuffer[] { 1, 2, 3 };
+			var values = new[] { Value(1, 10), Value(2, 100), Value(3, 1) };
+			var written = new int[3];
+
+			_db.PutMany(keys, new DataBuffer[] { values[0], values[1], values[2] }, written, PutOpFlags.Default);
+
+			CollectionAssert.AreEqual(new[] { 10, 100, 1 }, written);
+			byte[][] arrays;
+			var buffers = Buffers(3, 128, out arrays);
+			var lengths = new int[3];
+			_db.GetMany(keys, buffers, lengths, GetOpFlags.Default);
+			for (var i = 0; i < 3; ++i)
+			{
+				Assert.AreEqual(values[i].Length, lengths[i]);
+				var read = new byte[lengths[i]];
+				Array.Copy(arrays[i], read, lengths[i]);
+				CollectionAssert.AreEqual(values[i], read);
+			}
+		}
+
+		[TestMethod]
+		public void GetManyTellsEmptyRecordsFromMissingOnes()
+		{
+			_db.Put(1, new byte[0]);
+			_db.Put(2, Value(2, 8));
+
+			var lengths = new int[3];
+			_db.GetMany(new DataBuffer[] { 1, 2, 3 }, Buffers(3, 16), lengths, GetOpFlags.Default);
+
+			Assert.AreEqual(0, lengths[0]);
+			Assert.AreEqual(8, lengths[1]);
+			Assert.IsTrue(lengths[2] < 0, "Missing record read with length " + lengths[2]);
+		}
+
+		[TestMethod]
+		public void GetManyReportsLengthOfRecordsThatDoNotFit()
+		{
+			_db.Put(1, Value(1, 64));
+			_db.Put(2, Value(2, 4));
+
+			byte[][] arrays;
+			var lengths = new int[2];
+			_db.GetMany(new DataBuffer[] { 1, 2 }, Buffers(2, 16, out arrays), lengths, GetOpFlags.Default);
+
+			Assert.AreEqual(64, lengths[0]);
+			Assert.AreEqual(4, lengths[1]);
+			CollectionAssert.AreEqual(Value(2, 4), new[] { arrays[1][0], arrays[1][1], arrays[1][2], arrays[1][3] });
+		}
+
+		[TestMethod]
+		public void DeleteManyReportsEachKey()
+		{
+			_db.Put(1, Value(1, 8));
+			_db.Put(3, Value(3, 8));
+
+			var keys = new DataBuffer[] { 1, 2, 3 };
+			var results = new DbRetVal[3];
+			_db.DeleteMany(keys, results, DeleteOpFlags.Default);
+
+			Assert.AreEqual(DbRetVal.SUCCESS, results[0]);
+			Assert.AreEqual(DbRetVal.NOTFOUND, results[1]);
+			Assert.AreEqual(DbRetVal.SUCCESS, results[2]);
+			var lengths = new int[3];
+			_db.GetMany(keys, Buffers(3, 16), lengths, GetOpFlags.Default);
+			foreach (var length in lengths)
+			{
+				Assert.IsTrue(length < 0);
+			}
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ArgumentException))]
+		public void ResultsMustCoverEveryKey()
+		{
+			_db.GetMany(new DataBuffer[] { 1, 2 }, Buffers(2, 16), new int[1], GetOpFlags.Default);
+		}
+	}
+}
@@ -0,0 +1,168 @@
+﻿using System;
+using System.Collections.Generic;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests which entries a <see cref="BulkRecordFilter"/> lets into a bulk read.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class BulkRecordFilterTests
+	{
+		private const int _bufferCapacity = 8192;
+		private const int _count = 500;
+		private const int _valueLength = 16;
+
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("BulkRecordFilterTests");
+			_db = _environment.OpenDatabase("Filter.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private static ArraySegment<byte> Segment(params byte[] bytes)
+		{
+			// offset into a larger array, so the slice bounds are honoured
+			var array = new byte[bytes.Length + 2];
+			Buffer.BlockCopy(bytes, 0, array, 1, bytes.Length);
+			return new ArraySegment<byte>(array, 1, bytes.Length);
+		}
+
+		private void PutAll()
+		{
+			for (var i = 0; i < _count; ++i)
+			{
+				_db.Put(BulkScanTests.Key(i), BulkScanTests.Value(i, _valueLength));
+			}
+		}
+
+		private List<int> ReadAll(BulkRecordFilter filter)
+		{
+			var keys = new List<int>();
+			foreach (var filled in _db.GetBulkRecords(new BulkRecordBuffer(_bufferCapacity), filter))
+			{
+				for (var i = 0; i < filled.Count; ++i)
+				{
+					var key = BulkScanTests.ToInt(filled.GetKey(i));
+					BulkScanTests.AssertValue(key, _valueLength, filled.GetValue(i));
+					keys.Add(key);
+				}
+			}
+			return keys;
+		}
+
+		private static void AssertRange(int start, int end, List<int> keys)
+		{
+			Assert.AreEqual(end - start, keys.Count);
+			for (var i = 0; i < keys.Count; ++i)
+			{
+				Assert.AreEqual(start + i, keys[i]);
+			}
+		}
+
+		[TestMethod]
+		public void CompareKeyUsesByteOrderThenLength()
+		{
+			Assert.AreEqual(0, BulkRecordFilter.CompareKey(Segment(1, 2), new byte[] { 1, 2 }));
+			Assert.IsTrue(BulkRecordFilter.CompareKey(Segment(1, 2), new byte[] { 1, 3 }) < 0);
+			Assert.IsTrue(BulkRecordFilter.CompareKey(Segment(0xFF), new byte[] { 1, 0 }) > 0, "Unsigned bytes");
+			Assert.IsTrue(BulkRecordFilter.CompareKey(Segment(1), new byte[] { 1, 0 }) < 0, "Prefix");
+			Assert.IsTrue(BulkRecordFilter.CompareKey(Segment(1, 0), new byte[] { 1 }) > 0, "Longer");
+			Assert.IsTrue(BulkRecordFilter.CompareKey(Segment(), new byte[] { 0 }) < 0, "Empty");
+		}
+
+		[TestMethod]
+		public void EmptyFilterMatchesEverything()
+		{
+			var filter = new BulkRecordFilter();
+
+			Assert.IsTrue(filter.Matches(Segment(), Segment()));
+			Assert.IsTrue(filter.Matches(Segment(1, 2, 3), Segment(4, 5, 6)));
+		}
+
+		[TestMethod]
+		public void KeyRangeIncludesStartAndExcludesEnd()
+		{
+			var filter = new BulkRecordFilter { KeyStart = new byte[] { 2 }, KeyEnd = new byte[] { 4 } };
+			var value = Segment();
+
+			Assert.IsFalse(filter.Matches(Segment(1), value));
+			Assert.IsFalse(filter.Matches(Segment(1, 0xFF), value));
+			Assert.IsTrue(filter.Matches(Segment(2), value));
+			Assert.IsTrue(filter.Matches(Segment(3, 0xFF), value));
+			Assert.IsFalse(filter.Matches(Segment(4), value));
+			Assert.IsFalse(filter.Matches(Segment(4, 0), value));
+		}
+
+		[TestMethod]
+		public void ValuePatternMustFitAtItsOffset()
+		{
+			var filter = new BulkRecordFilter { ValuePattern = new byte[] { 7, 8 }, ValueOffset = 1 };
+			var key = Segment(1);
+
+			Assert.IsTrue(filter.Matches(key, Segment(0, 7, 8)));
+			Assert.IsTrue(filter.Matches(key, Segment(0, 7, 8, 9)));
+			Assert.IsFalse(filter.Matches(key, Segment(7, 8, 0)));
+			Assert.IsFalse(filter.Matches(key, Segment(0, 7)), "Too short");
+
+			filter.ValueOffset = -1;
+			Assert.IsFalse(filter.Matches(key, Segment(7, 8)), "Negative offset");
+
+			filter.ValueOffset = 0;
+			filter.ValuePattern = new byte[0];
+			Assert.IsTrue(filter.Matches(key, Segment()), "Empty pattern");
+		}
+
+		[TestMethod]
+		public void ScanReadsOnlyTheKeyRange()
+		{
+			PutAll();
+
+			AssertRange(100, 300, ReadAll(new BulkRecordFilter
+			{
+				KeyStart = BulkScanTests.Key(100),
+				KeyEnd = BulkScanTests.Key(300)
+			}));
+			AssertRange(450, _count, ReadAll(new BulkRecordFilter { KeyStart = BulkScanTests.Key(450) }));
+			AssertRange(0, 50, ReadAll(new BulkRecordFilter { KeyEnd = BulkScanTests.Key(50) }));
+		}
+
+		[TestMethod]
+		public void ScanOfAnEmptyRangeYieldsNothing()
+		{
+			PutAll();
+
+			AssertRange(0, 0, ReadAll(new BulkRecordFilter
+			{
+				KeyStart = BulkScanTests.Key(200),
+				KeyEnd = BulkScanTests.Key(200)
+			}));
+			AssertRange(0, 0, ReadAll(new BulkRecordFilter { KeyStart = BulkScanTests.Key(_count) }));
+		}
+
+		[TestMethod]
+		public void ScanReadsOnlyMatchingValues()
+		{
+			PutAll();
+			// the value's second byte is (key + 1) mod 256
+			var filter = new BulkRecordFilter { ValuePattern = new byte[] { 11 }, ValueOffset = 1 };
+
+			CollectionAssert.AreEqual(new List<int> { 10, 266 }, ReadAll(filter));
+		}
+	}
+}
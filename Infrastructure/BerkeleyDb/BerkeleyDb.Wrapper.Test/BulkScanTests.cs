@@ -0,0 +1,166 @@
+﻿using System;
+using System.Collections.Generic;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests reading a whole database a <see cref="BulkRecordBuffer"/> at a time.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class BulkScanTests
+	{
+		private const int _bufferCapacity = 8192;
+
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("BulkScanTests");
+			_db = _environment.OpenDatabase("Scan.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		// Big endian, so the default BTree order is numeric order.
+		internal static byte[] Key(int key)
+		{
+			return new[] { (byte)(key >> 24), (byte)(key >> 16), (byte)(key >> 8), (byte)key };
+		}
+
+		internal static int ToInt(ArraySegment<byte> key)
+		{
+			Assert.AreEqual(4, key.Count);
+			return (key.Array[key.Offset] << 24) | (key.Array[key.Offset + 1] << 16) |
+				(key.Array[key.Offset + 2] << 8) | key.Array[key.Offset + 3];
+		}
+
+		internal static byte[] Value(int key, int length)
+		{
+			var value = new byte[length];
+			for (var i = 0; i < length; ++i)
+			{
+				value[i] = (byte)(key + i);
+			}
+			return value;
+		}
+
+		internal static void AssertValue(int key, int length, ArraySegment<byte> value)
+		{
+			Assert.AreEqual(length, value.Count, "Length of " + key);
+			for (var i = 0; i < length; ++i)
+			{
+				Assert.AreEqual((byte)(key + i), value.Array[value.Offset + i], "Value of " + key);
+			}
+		}
+
+		// Reads every record, checking each value, and returns the keys in the order read.
+		private List<int> ReadAll(BulkRecordBuffer buffer, int valueLength)
+		{
+			var keys = new List<int>();
+			foreach (var filled in _db.GetBulkRecords(buffer))
+			{
+				Assert.AreSame(buffer, filled);
+				Assert.IsTrue(filled.Count > 0);
+				for (var i = 0; i < filled.Count; ++i)
+				{
+					var key = ToInt(filled.GetKey(i));
+					AssertValue(key, valueLength, filled.GetValue(i));
+					keys.Add(key);
+				}
+			}
+			return keys;
+		}
+
+		[TestMethod]
+		public void EmptyDatabaseYieldsNothing()
+		{
+			CollectionAssert.AreEqual(new int[0], ReadAll(new BulkRecordBuffer(_bufferCapacity), 0));
+		}
+
+		[TestMethod]
+		public void RecordsAreReadInKeyOrderAcrossFills()
+		{
+			const int count = 1000;
+			const int valueLength = 100;
+			// inserted out of order
+			for (var i = count - 1; i >= 0; --i)
+			{
+				_db.Put(Key(i), Value(i, valueLength));
+			}
+			var fills = 0;
+			var buffer = new BulkRecordBuffer(_bufferCapacity);
+			foreach (var filled in _db.GetBulkRecords(buffer))
+			{
+				++fills;
+			}
+
+			var keys = ReadAll(buffer, valueLength);
+
+			Assert.IsTrue(fills > 1, "Read in " + fills + " fills");
+			Assert.AreEqual(count, keys.Count);
+			for (var i = 0; i < count; ++i)
+			{
+				Assert.AreEqual(i, keys[i]);
+			}
+		}
+
+		[TestMethod]
+		public void EntryLargerThanTheBufferGrowsIt()
+		{
+			const int largeLength = _bufferCapacity * 4;
+			_db.Put(Key(1), Value(1, 10));
+			_db.Put(Key(2), Value(2, largeLength));
+			_db.Put(Key(3), Value(3, 10));
+			var buffer = new BulkRecordBuffer(_bufferCapacity);
+
+			var lengths = new Dictionary<int, int>();
+			foreach (var filled in _db.GetBulkRecords(buffer))
+			{
+				for (var i = 0; i < filled.Count; ++i)
+				{
+					lengths.Add(ToInt(filled.GetKey(i)), filled.GetValue(i).Count);
+				}
+			}
+
+			Assert.AreEqual(3, lengths.Count);
+			Assert.AreEqual(largeLength, lengths[2]);
+			Assert.IsTrue(buffer.Buffer.Length >= largeLength);
+		}
+
+		[TestMethod]
+		public void CreatedRecordOutlivesTheNextFill()
+		{
+			_db.Put(Key(1), Value(1, 10));
+			var buffer = new BulkRecordBuffer(_bufferCapacity);
+			DatabaseRecord record = null;
+			foreach (var filled in _db.GetBulkRecords(buffer))
+			{
+				record = filled.CreateRecord(0);
+			}
+			Array.Clear(buffer.Buffer, 0, buffer.Buffer.Length);
+
+			Assert.IsNotNull(record);
+			CollectionAssert.AreEqual(Key(1), record.Key.Buffer);
+			CollectionAssert.AreEqual(Value(1, 10), record.Value.Buffer);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ArgumentNullException))]
+		public void BufferIsRequired()
+		{
+			_db.GetBulkRecords(null);
+		}
+	}
+}
@@ -0,0 +1,157 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.BerkeleyDb.Configuration;
+using MySpace.Common.Storage;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests deadlock retries against a private transactional environment, where two writers
+	/// take the same two pages in opposite orders until deadlocks are detected.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class DeadlockRetryTests
+	{
+		private const int recordCount = 1000;
+		private const int valueLength = 256;
+
+		private TestEnvironment _environment;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("DeadlockRetryTests");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_environment.Dispose();
+		}
+
+		private Database OpenDatabase(int maxDeadlockRetries)
+		{
+			var config = new DatabaseConfig
+			{
+				FileName = "Contention.bdb",
+				Type = DatabaseType.BTree,
+				PageSize = 4096,
+				TransactionMode = DatabaseTransactionMode.PerCall,
+				MaxDeadlockRetries = maxDeadlockRetries
+			};
+			// short delays keep the test quick
+			config.DeadlockRetry.BaseDelay = 10;
+			config.DeadlockRetry.MaxDelay = 1000;
+			var db = _environment.Environment.OpenDatabase(config);
+			for (var key = 0; key < recordCount; ++key)
+			{
+				db.Put(key, new byte[valueLength]);
+			}
+			return db;
+		}
+
+		// Writes the first and last keys, which sit on different leaf pages, in the given order
+		// until stop is set or an operation fails.
+		private static Thread StartWriter(Database db, bool reversed, ManualResetEvent stop, List<Exception> failures)
+		{
+			var first = reversed ? recordCount - 1 : 0;
+			var last = reversed ? 0 : recordCount - 1;
+			var thread = new Thread(() =>
+			{
+				var keys = new DataBuffer[] { first, last };
+				var values = new DataBuffer[] { new byte[valueLength], new byte[valueLength] };
+				var results = new int[2];
+				try
+				{
+					while (!stop.WaitOne(0))
+					{
+						db.PutMany(keys, values, results, PutOpFlags.Default);
+					}
+				}
+				catch (Exception ex)
+				{
+					lock (failures)
+					{
+						failures.Add(ex);
+					}
+					stop.Set();
+				}
+			});
+			thread.Start();
+			return thread;
+		}
+
+		// Runs opposed writers until the database has seen minDeadlocks deadlocks, one of the
+		// writers fails, or the time runs out.
+		private static List<Exception> RunOpposedWriters(Database db, int minDeadlocks)
+		{
+			var failures = new List<Exception>();
+			using (var stop = new ManualResetEvent(false))
+			{
+				var writers = new[]
+				{
+					StartWriter(db, false, stop, failures),
+					StartWriter(db, true, stop, failures)
+				};
+				var watch = Stopwatch.StartNew();
+				while (!stop.WaitOne(10) && watch.Elapsed < TimeSpan.FromSeconds(30))
+				{
+					if (db.GetContentionStatistics().Deadlocks >= minDeadlocks)
+					{
+						break;
+					}
+				}
+				stop.Set();
+				foreach (var writer in writers)
+				{
+					Assert.IsTrue(writer.Join(30000), "A writer did not stop");
+				}
+			}
+			return failures;
+		}
+
+		[TestMethod]
+		public void DeadlockedBatchesAreRetried()
+		{
+			using (var db = OpenDatabase(1000))
+			{
+				var failures = RunOpposedWriters(db, 20);
+
+				Assert.AreEqual(0, failures.Count, failures.Count > 0 ? failures[0].ToString() : null);
+				var statistics = db.GetContentionStatistics();
+				Assert.IsTrue(statistics.Deadlocks >= 20, "Too few deadlocks: " + statistics.Deadlocks);
+				Assert.AreEqual(statistics.Deadlocks, statistics.Retries);
+				Assert.AreEqual(0, statistics.RetriesExhausted);
+				Assert.IsTrue(statistics.RetryTime > TimeSpan.Zero);
+			}
+		}
+
+		[TestMethod]
+		public void RetriesStopAtMaxDeadlockRetries()
+		{
+			using (var db = OpenDatabase(1))
+			{
+				Assert.AreEqual(1, db.MaxDeadlockRetries);
+
+				var failures = RunOpposedWriters(db, int.MaxValue);
+
+				Assert.IsTrue(failures.Count > 0, "No operation gave up");
+				foreach (var failure in failures)
+				{
+					Assert.IsInstanceOfType(failure, typeof(BdbException));
+					Assert.AreEqual((int)DbRetVal.LOCK_DEADLOCK, ((BdbException)failure).Code);
+				}
+				var statistics = db.GetContentionStatistics();
+				Assert.AreEqual(0, statistics.Retries);
+				Assert.AreEqual(statistics.Deadlocks, statistics.RetriesExhausted);
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+﻿using System.Collections.Generic;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class GetViewTests
+	{
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("GetViewTests");
+			_db = _environment.OpenDatabase("View.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private static byte[] Value(int length)
+		{
+			var value = new byte[length];
+			for (var i = 0; i < length; ++i)
+			{
+				value[i] = (byte)i;
+			}
+			return value;
+		}
+
+		[TestMethod]
+		public void ViewHoldsTheRecord()
+		{
+			_db.Put(1, Value(100));
+
+			using (var view = _db.GetView(1, -1, -1, GetOpFlags.Default))
+			{
+				Assert.AreEqual(100, view.Length);
+				CollectionAssert.AreEqual(Value(100), view.ToArray());
+			}
+		}
+
+		[TestMethod]
+		public void PartialViewHoldsOnlyItsRange()
+		{
+			_db.Put(1, Value(100));
+
+			using (var view = _db.GetView(1, 10, 4, GetOpFlags.Default))
+			{
+				CollectionAssert.AreEqual(new byte[] { 10, 11, 12, 13 }, view.ToArray());
+			}
+		}
+
+		[TestMethod]
+		public void MissingRecordHasNoView()
+		{
+			Assert.IsNull(_db.GetView(1, -1, -1, GetOpFlags.Default));
+		}
+
+		[TestMethod]
+		public void StreamOutlivesItsView()
+		{
+			_db.Put(1, Value(100));
+
+			var view = _db.GetView(1, -1, -1, GetOpFlags.Default);
+			using (var stream = view.CreateStream())
+			{
+				view.Dispose();
+				var read = new byte[100];
+				Assert.AreEqual(100, stream.Read(read, 0, read.Length));
+				CollectionAssert.AreEqual(Value(100), read);
+			}
+		}
+
+		[TestMethod]
+		public void ReleasedViewsGiveTheirBlocksBack()
+		{
+			const int count = 100;
+			const int length = 1000;
+			for (var key = 0; key < count; ++key)
+			{
+				_db.Put(key, Value(length));
+			}
+			var allocator = _environment.Environment;
+
+			var views = new List<UnmanagedMemoryView>();
+			for (var key = 0; key < count; ++key)
+			{
+				views.Add(_db.GetView(key, -1, -1, GetOpFlags.Default));
+			}
+			var held = allocator.GetAllocatorStatistics().BytesLive;
+			foreach (var view in views)
+			{
+				view.Dispose();
+			}
+			var released = allocator.GetAllocatorStatistics().BytesLive;
+
+			Assert.IsTrue(held - released >= count * length, "Disposed views kept their memory");
+		}
+	}
+}
@@ -0,0 +1,191 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Reflection;
+using System.Threading;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests the group commit of the wrapper, which is internal to the platform specific
+	/// wrapper assembly and so is reached through reflection.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	public class GroupCommitterTests
+	{
+		private static Type _committerType;
+
+		[ClassInitialize]
+		public static void ClassInitialize(TestContext context)
+		{
+			var platform = IntPtr.Size == 8 ? "x64" : "Win32";
+			var wrapper = Assembly.LoadFrom(string.Format("MySpace.BerkeleyDb.Wrapper.{0}.exe", platform));
+			_committerType = wrapper.GetType("BerkeleyDbWrapper.GroupCommitter", true);
+		}
+
+		private static object CreateCommitter(Action flush, int maxWaitMilliseconds, int maxOperations)
+		{
+			return Activator.CreateInstance(_committerType, flush, maxWaitMilliseconds, maxOperations);
+		}
+
+		private static void Join(object committer)
+		{
+			try
+			{
+				_committerType.GetMethod("Join").Invoke(committer, null);
+			}
+			catch (TargetInvocationException ex)
+			{
+				throw ex.InnerException;
+			}
+		}
+
+		// Joins from count threads at once and returns what each join threw, null for success.
+		private static Exception[] JoinAll(object committer, int count)
+		{
+			var failures = new Exception[count];
+			var threads = new List<Thread>();
+			for (var i = 0; i < count; ++i)
+			{
+				var index = i;
+				var thread = new Thread(() =>
+				{
+					try
+					{
+						Join(committer);
+					}
+					catch (Exception ex)
+					{
+						failures[index] = ex;
+					}
+				});
+				thread.Start();
+				threads.Add(thread);
+			}
+			foreach (var thread in threads)
+			{
+				Assert.IsTrue(thread.Join(10000), "Join did not return");
+			}
+			return failures;
+		}
+
+		[TestMethod]
+		public void FullGroupSharesOneFlush()
+		{
+			var flushes = 0;
+			var committer = CreateCommitter(() => Interlocked.Increment(ref flushes), 5000, 4);
+
+			var failures = JoinAll(committer, 4);
+
+			foreach (var failure in failures)
+			{
+				Assert.IsNull(failure);
+			}
+			Assert.AreEqual(1, flushes);
+		}
+
+		[TestMethod]
+		public void LoneCommitFlushesAfterMaxWait()
+		{
+			var flushes = 0;
+			var committer = CreateCommitter(() => Interlocked.Increment(ref flushes), 20, 100);
+
+			Join(committer);
+
+			Assert.AreEqual(1, flushes);
+		}
+
+		[TestMethod]
+		public void FailedFlushFailsEveryMember()
+		{
+			var committer = CreateCommitter(() => { throw new BdbException(5, "flush failed"); }, 5000, 3);
+
+			var failures = JoinAll(committer, 3);
+
+			foreach (var failure in failures)
+			{
+				Assert.IsInstanceOfType(failure, typeof(BdbException));
+				Assert.AreEqual(5, ((BdbException)failure).Code);
+			}
+		}
+
+		[TestMethod]
+		public void NonBdbFailureIsReportedAsBdbException()
+		{
+			var committer = CreateCommitter(() => { throw new InvalidOperationException("disk gone"); }, 5000, 2);
+
+			var failures = JoinAll(committer, 2);
+
+			foreach (var failure in failures)
+			{
+				Assert.IsInstanceOfType(failure, typeof(BdbException));
+				StringAssert.Contains(failure.Message, "disk gone");
+			}
+		}
+
+		[TestMethod]
+		public void GroupAfterFailureSucceeds()
+		{
+			var fail = true;
+			var committer = CreateCommitter(() =>
+			{
+				if (fail)
+				{
+					fail = false;
+					throw new BdbException(5, "flush failed");
+				}
+			}, 5000, 2);
+
+			var failed = JoinAll(committer, 2);
+			var succeeded = JoinAll(committer, 2);
+
+			Assert.IsNotNull(failed[0]);
+			Assert.IsNotNull(failed[1]);
+			Assert.IsNull(succeeded[0]);
+			Assert.IsNull(succeeded[1]);
+		}
+
+		[TestMethod]
+		public void GroupGatheringDuringFailedFlushIsNotFailed()
+		{
+			var flushing = new ManualResetEvent(false);
+			var release = new ManualResetEvent(false);
+			var flushes = 0;
+			var committer = CreateCommitter(() =>
+			{
+				if (Interlocked.Increment(ref flushes) == 1)
+				{
+					flushing.Set();
+					release.WaitOne();
+					throw new BdbException(5, "flush failed");
+				}
+			}, 5000, 1);
+
+			Exception firstFailure = null;
+			var first = new Thread(() =>
+			{
+				try
+				{
+					Join(committer);
+				}
+				catch (Exception ex)
+				{
+					firstFailure = ex;
+				}
+			});
+			first.Start();
+			Assert.IsTrue(flushing.WaitOne(10000), "The first group never flushed");
+
+			// the first group's flush is still running; the next group flushes on its own
+			Join(committer);
+			release.Set();
+			Assert.IsTrue(first.Join(10000), "The first group never finished");
+
+			Assert.IsInstanceOfType(firstFailure, typeof(BdbException));
+			Assert.AreEqual(2, flushes);
+		}
+	}
+}
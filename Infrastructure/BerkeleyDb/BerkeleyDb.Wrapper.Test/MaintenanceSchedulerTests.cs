@@ -0,0 +1,181 @@
+﻿using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.BerkeleyDb.Configuration;
+using MySpace.BerkeleyDb.Facade;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests when <see cref="MaintenanceScheduler"/> runs its jobs, and what holds them back.
+	/// </summary>
+	[TestClass]
+	public class MaintenanceSchedulerTests
+	{
+		private const int _interval = 30;
+
+		private List<string> _ran;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_ran = new List<string>();
+		}
+
+		// Unlimited pages and no latency threshold unless a test sets them.
+		private static Maintenance CreateConfig()
+		{
+			return new Maintenance
+			{
+				TickInterval = 1000,
+				BudgetPercent = 10,
+				PagesPerSecond = 0,
+				LatencyThreshold = 0,
+				MaxDeferral = 60000
+			};
+		}
+
+		private static MaintenanceScheduler CreateScheduler(Maintenance config)
+		{
+			return new MaintenanceScheduler(new BerkeleyDbStorage(), config);
+		}
+
+		private MaintenanceJobDelegate Job(string name, int pages, bool more)
+		{
+			return (out int spent) =>
+			{
+				_ran.Add(name);
+				spent = pages;
+				return more;
+			};
+		}
+
+		// Lets jobs added with _interval come due.
+		private static void WaitForInterval()
+		{
+			Thread.Sleep(_interval * 2);
+		}
+
+		[TestMethod]
+		public void DueJobsRunInTheOrderAdded()
+		{
+			var scheduler = CreateScheduler(CreateConfig());
+			scheduler.Add("first", 0, MaintenancePriority.Deferrable, Job("first", 0, false));
+			scheduler.Add("second", 0, MaintenancePriority.Deferrable, Job("second", 0, false));
+
+			scheduler.Tick();
+
+			CollectionAssert.AreEqual(new[] { "first", "second" }, _ran);
+		}
+
+		[TestMethod]
+		public void JobWaitsOutItsInterval()
+		{
+			var scheduler = CreateScheduler(CreateConfig());
+			scheduler.Add("job", _interval, MaintenancePriority.Deferrable, Job("job", 0, false));
+
+			scheduler.Tick();
+			Assert.AreEqual(0, _ran.Count, "Ran before its interval");
+
+			WaitForInterval();
+			scheduler.Tick();
+			scheduler.Tick();
+			Assert.AreEqual(1, _ran.Count);
+		}
+
+		[TestMethod]
+		public void UnfinishedJobRunsOnTheNextTick()
+		{
+			var scheduler = CreateScheduler(CreateConfig());
+			var slices = 0;
+			scheduler.Add("job", _interval, MaintenancePriority.Deferrable, (out int pages) =>
+			{
+				pages = 0;
+				return ++slices < 3;
+			});
+
+			WaitForInterval();
+			for (var i = 0; i < 5; ++i)
+			{
+				scheduler.Tick();
+			}
+
+			Assert.AreEqual(3, slices);
+		}
+
+		[TestMethod]
+		public void SlowForegroundHoldsBackAllButCriticalJobs()
+		{
+			var config = CreateConfig();
+			config.LatencyThreshold = 1;
+			var scheduler = CreateScheduler(config);
+			scheduler.Add("critical", 0, MaintenancePriority.Critical, Job("critical", 0, false));
+			scheduler.Add("bounded", 0, MaintenancePriority.Bounded, Job("bounded", 0, false));
+			scheduler.Add("deferrable", 0, MaintenancePriority.Deferrable, Job("deferrable", 0, false));
+
+			scheduler.ReportLatency(Stopwatch.Frequency);
+			scheduler.Tick();
+
+			CollectionAssert.AreEqual(new[] { "critical" }, _ran);
+		}
+
+		[TestMethod]
+		public void IdleForegroundIsNotSlow()
+		{
+			var config = CreateConfig();
+			config.LatencyThreshold = 1;
+			var scheduler = CreateScheduler(config);
+			scheduler.Add("job", 0, MaintenancePriority.Deferrable, Job("job", 0, false));
+
+			scheduler.ReportLatency(Stopwatch.Frequency);
+			scheduler.Tick();
+			Assert.AreEqual(0, _ran.Count);
+
+			// no requests since the last tick
+			scheduler.Tick();
+			Assert.AreEqual(1, _ran.Count);
+		}
+
+		[TestMethod]
+		public void SpentPageBudgetHoldsBackJobsUntilBounded()
+		{
+			var config = CreateConfig();
+			config.PagesPerSecond = 10;
+			config.MaxDeferral = _interval;
+			var scheduler = CreateScheduler(config);
+			scheduler.Add("spender", 0, MaintenancePriority.Deferrable, Job("spender", 1000, false));
+			scheduler.Tick();
+			_ran.Clear();
+			scheduler.Add("bounded", 0, MaintenancePriority.Bounded, Job("bounded", 0, false));
+
+			scheduler.Tick();
+			Assert.AreEqual(0, _ran.Count, "Ran over the page budget");
+
+			WaitForInterval();
+			scheduler.Tick();
+			CollectionAssert.AreEqual(new[] { "bounded" }, _ran);
+		}
+
+		[TestMethod]
+		public void SpentTimeBudgetHoldsBackJobs()
+		{
+			var config = CreateConfig();
+			config.TickInterval = 100;
+			// a burst of four ticks at 10% is 40 milliseconds
+			var scheduler = CreateScheduler(config);
+			scheduler.Add("slow", 0, MaintenancePriority.Deferrable, (out int pages) =>
+			{
+				_ran.Add("slow");
+				Thread.Sleep(100);
+				pages = 0;
+				return false;
+			});
+
+			scheduler.Tick();
+			scheduler.Tick();
+
+			Assert.AreEqual(1, _ran.Count);
+		}
+	}
+}
@@ -0,0 +1,139 @@
+﻿using System;
+using System.Threading;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class RmwOperatorTests
+	{
+		private const int headerLength = 8;
+		private const int ticksOffset = 1;
+
+		private static readonly byte[] _header = new byte[] { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("RmwOperatorTests");
+			_db = _environment.OpenDatabase("Rmw.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private byte[] Read(int key)
+		{
+			return _db.GetBuffer(key, -1, -1, GetOpFlags.Default);
+		}
+
+		private int Increment(int incrementBy, int minimum, int maximum)
+		{
+			return _db.IncrementCounter(1, _header, headerLength, incrementBy, minimum, maximum);
+		}
+
+		// A record of length bytes with ticks stored at ticksOffset.
+		private static byte[] Stamped(long ticks, int length)
+		{
+			var record = new byte[length];
+			Array.Copy(BitConverter.GetBytes(ticks), 0, record, ticksOffset, sizeof(long));
+			record[length - 1] = (byte)ticks;
+			return record;
+		}
+
+		[TestMethod]
+		public void IncrementStartsFromInitialData()
+		{
+			Assert.AreEqual(5, Increment(5, 0, int.MaxValue));
+
+			var record = Read(1);
+			Assert.AreEqual(headerLength + sizeof(int), record.Length);
+			for (var i = 0; i < headerLength; ++i)
+			{
+				Assert.AreEqual(_header[i], record[i]);
+			}
+			Assert.AreEqual(5, BitConverter.ToInt32(record, headerLength));
+		}
+
+		[TestMethod]
+		public void IncrementAddsToTheStoredCounterWithinItsLimits()
+		{
+			Increment(5, 0, 100);
+
+			Assert.AreEqual(8, Increment(3, 0, 100));
+			Assert.AreEqual(0, Increment(-20, 0, 100));
+			Assert.AreEqual(100, Increment(250, 0, 100));
+			Assert.AreEqual(100, BitConverter.ToInt32(Read(1), headerLength));
+		}
+
+		[TestMethod]
+		public void ConcurrentIncrementsAreNotLost()
+		{
+			const int threadCount = 4;
+			const int perThread = 250;
+			var threads = new Thread[threadCount];
+			for (var i = 0; i < threadCount; ++i)
+			{
+				threads[i] = new Thread(() =>
+				{
+					for (var n = 0; n < perThread; ++n)
+					{
+						Increment(1, 0, int.MaxValue);
+					}
+				});
+				threads[i].Start();
+			}
+			foreach (var thread in threads)
+			{
+				thread.Join();
+			}
+
+			Assert.AreEqual(threadCount * perThread, BitConverter.ToInt32(Read(1), headerLength));
+		}
+
+		[TestMethod]
+		public void CompareAndSetWritesOnlyNewerRecords()
+		{
+			long storedTicks;
+
+			Assert.IsTrue(_db.CompareAndSet(1, Stamped(100, 16), ticksOffset, out storedTicks));
+			Assert.IsFalse(_db.CompareAndSet(1, Stamped(50, 16), ticksOffset, out storedTicks));
+			Assert.AreEqual(100, storedTicks);
+			Assert.IsFalse(_db.CompareAndSet(1, Stamped(100, 20), ticksOffset, out storedTicks));
+			CollectionAssert.AreEqual(Stamped(100, 16), Read(1));
+
+			Assert.IsTrue(_db.CompareAndSet(1, Stamped(200, 20), ticksOffset, out storedTicks));
+			CollectionAssert.AreEqual(Stamped(200, 20), Read(1));
+		}
+
+		[TestMethod]
+		public void AppendStartsFromInitialDataAndGrowsTheRecord()
+		{
+			Assert.AreEqual(headerLength + 2, _db.Append(1, _header, new byte[] { 9, 10 }));
+			Assert.AreEqual(headerLength + 5, _db.Append(1, _header, new byte[] { 11, 12, 13 }));
+
+			CollectionAssert.AreEqual(new byte[] { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 }, Read(1));
+		}
+
+		[TestMethod]
+		public void AppendToAStoredRecordIgnoresInitialData()
+		{
+			_db.Put(1, new byte[] { 42 });
+
+			Assert.AreEqual(3, _db.Append(1, _header, new byte[] { 43, 44 }));
+			CollectionAssert.AreEqual(new byte[] { 42, 43, 44 }, Read(1));
+		}
+	}
+}
@@ -0,0 +1,149 @@
+﻿using System.Collections.Generic;
+using System.IO;
+using BerkeleyDbWrapper;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.Storage;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// Tests the native allocator through records read with Berkeley Db allocated memory,
+	/// which is held by the returned stream until it is closed. The allocator is shared by
+	/// the whole process, so the tests only count what their own reads must have added.
+	/// </summary>
+	[TestClass]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.Win32.exe")]
+	[DeploymentItem("MySpace.BerkeleyDb.Wrapper.x64.exe")]
+	[DeploymentItem("MySpace.Logging.dll")]
+	public class SlabAllocatorTests
+	{
+		private const int smallLength = 1000;
+		private const int largeLength = 64 * 1024;
+		private const int recordCount = 100;
+
+		private TestEnvironment _environment;
+		private Database _db;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_environment = new TestEnvironment("SlabAllocatorTests");
+			_db = _environment.OpenDatabase("Slab.bdb");
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			_db.Dispose();
+			_environment.Dispose();
+		}
+
+		private AllocatorStatistics GetStatistics()
+		{
+			return _environment.Environment.GetAllocatorStatistics();
+		}
+
+		private static SizeClassStatistics GetSizeClass(AllocatorStatistics statistics, int length)
+		{
+			foreach (var sizeClass in statistics.SizeClasses)
+			{
+				if (sizeClass.BlockSize >= length)
+				{
+					return sizeClass;
+				}
+			}
+			return null;
+		}
+
+		private List<Stream> ReadAll(int count)
+		{
+			var streams = new List<Stream>();
+			for (var key = 0; key < count; ++key)
+			{
+				streams.Add(_db.Get(key, 0, -1, GetOpFlags.Default));
+			}
+			return streams;
+		}
+
+		private static void CloseAll(IEnumerable<Stream> streams)
+		{
+			foreach (var stream in streams)
+			{
+				stream.Dispose();
+			}
+		}
+
+		[TestMethod]
+		public void SizeClassesAscendToLargestSlabBlock()
+		{
+			var sizeClasses = GetStatistics().SizeClasses;
+
+			Assert.AreEqual(28, sizeClasses.Count);
+			for (var i = 1; i < sizeClasses.Count; ++i)
+			{
+				Assert.IsTrue(sizeClasses[i].BlockSize > sizeClasses[i - 1].BlockSize);
+			}
+			Assert.AreEqual(16384, sizeClasses[sizeClasses.Count - 1].BlockSize);
+		}
+
+		[TestMethod]
+		public void SmallRecordsAreServedFromTheirSizeClass()
+		{
+			for (var key = 0; key < recordCount; ++key)
+			{
+				_db.Put(key, new byte[smallLength]);
+			}
+			var before = GetSizeClass(GetStatistics(), smallLength);
+
+			var streams = ReadAll(recordCount);
+			var held = GetSizeClass(GetStatistics(), smallLength);
+			CloseAll(streams);
+			var after = GetSizeClass(GetStatistics(), smallLength);
+
+			Assert.IsTrue(held.Hits + held.Misses - before.Hits - before.Misses >= recordCount,
+				"Reads were not served from the size class");
+			Assert.IsTrue(held.BlocksInUse - before.BlocksInUse >= recordCount);
+			Assert.IsTrue(held.BlocksInUse - after.BlocksInUse >= recordCount, "Closed reads kept their blocks");
+			Assert.IsTrue(after.BlocksReserved >= after.BlocksInUse);
+		}
+
+		[TestMethod]
+		public void RepeatedReadsReuseFreedBlocks()
+		{
+			for (var key = 0; key < recordCount; ++key)
+			{
+				_db.Put(key, new byte[smallLength]);
+			}
+			CloseAll(ReadAll(recordCount));
+			var before = GetStatistics();
+
+			for (var pass = 0; pass < 10; ++pass)
+			{
+				CloseAll(ReadAll(recordCount));
+			}
+			var after = GetStatistics();
+
+			// a thousand reads of blocks freed right away need no more slab memory
+			Assert.IsTrue(after.SlabBytes <= before.SlabBytes, "Reads took more slabs");
+			Assert.IsTrue(GetSizeClass(after, smallLength).Hits - GetSizeClass(before, smallLength).Hits >=
+				10 * recordCount / 2, "Reads missed the thread cache");
+		}
+
+		[TestMethod]
+		public void LargeRecordsBypassTheSlabs()
+		{
+			_db.Put(0, new byte[largeLength]);
+			var before = GetStatistics();
+
+			var streams = ReadAll(1);
+			var held = GetStatistics();
+			Assert.AreEqual(largeLength, streams[0].Length);
+			CloseAll(streams);
+			var after = GetStatistics();
+
+			Assert.IsTrue(held.LargeAllocations > before.LargeAllocations);
+			Assert.IsTrue(held.LargeBytes - before.LargeBytes >= largeLength);
+			Assert.IsTrue(held.LargeBytes - after.LargeBytes >= largeLength, "A closed read kept its block");
+		}
+	}
+}
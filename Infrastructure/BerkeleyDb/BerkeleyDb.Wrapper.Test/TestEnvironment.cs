@@ -0,0 +1,77 @@
+﻿using System;
+using System.IO;
+using BerkeleyDbWrapper;
+using MySpace.BerkeleyDb.Configuration;
+using Environment = BerkeleyDbWrapper.Environment;
+
+namespace MySpace.BerkeleyDb.Wrapper.Test
+{
+	/// <summary>
+	/// A private transactional environment in its own temporary home directory, which is
+	/// deleted again on dispose.
+	/// </summary>
+	internal sealed class TestEnvironment : IDisposable
+	{
+		private readonly string _home;
+		private Environment _environment;
+
+		public TestEnvironment(string name)
+		{
+			_home = Path.Combine(Path.GetTempPath(), name + Guid.NewGuid().ToString("N"));
+			Directory.CreateDirectory(_home);
+			var config = new EnvironmentConfig
+			{
+				HomeDirectory = _home,
+				TempDirectory = _home,
+				OpenFlags = EnvOpenFlags.Create | EnvOpenFlags.Private | EnvOpenFlags.ThreadSafe |
+					EnvOpenFlags.InitMPool | EnvOpenFlags.InitLock | EnvOpenFlags.InitLog | EnvOpenFlags.InitTxn,
+				Flags = EnvFlags.TxnNoSync
+			};
+			config.DeadlockDetection.Enabled = true;
+			config.DeadlockDetection.Mode = DeadlockDetectionMode.OnTransaction;
+			_environment = Environment.Create(config);
+		}
+
+		public Environment Environment
+		{
+			get { return _environment; }
+		}
+
+		/// <summary>
+		/// Gets the home directory, where databases are created.
+		/// </summary>
+		public string Home
+		{
+			get { return _home; }
+		}
+
+		/// <summary>
+		/// Opens a BTree database with one transaction per call.
+		/// </summary>
+		public Database OpenDatabase(string fileName)
+		{
+			return _environment.OpenDatabase(new DatabaseConfig
+			{
+				FileName = fileName,
+				Type = DatabaseType.BTree,
+				TransactionMode = DatabaseTransactionMode.PerCall
+			});
+		}
+
+		public void Dispose()
+		{
+			if (_environment != null)
+			{
+				_environment.Dispose();
+				_environment = null;
+			}
+			try
+			{
+				Directory.Delete(_home, true);
+			}
+			catch (IOException)
+			{
+			}
+		}
+	}
+}
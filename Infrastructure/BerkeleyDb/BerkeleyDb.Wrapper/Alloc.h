@@ -1,6 +1,8 @@
 #pragma once
 #include "stdafx.h"
 
+#if defined(USE_CRT_ALLOC)
+
 #if (defined(_DEBUG) || defined(USE_EXPLICIT_ALLOC)) && !defined(DONT_USE_EXPLICIT_ALLOC)
 
 inline void *malloc_wrapper(size_t size) { return malloc(size); }
@@ -14,3 +16,13 @@ inline void free_wrapper(void *p) { return free(p); }
 #define free_wrapper free
 
 #endif
+
+#else
+
+#include "SlabAllocator.h"
+
+#define malloc_wrapper slab_malloc
+#define realloc_wrapper slab_realloc
+#define free_wrapper slab_free
+
+#endif
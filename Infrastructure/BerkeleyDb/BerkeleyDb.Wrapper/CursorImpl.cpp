@@ -70,6 +70,8 @@ int CursorImpl::DeadlockLoop(String ^methodName, Dbt *key,
 	int ret = 0;
 	bool deadlock_occurred;
 	int retry_count = 0;
+	ContentionCounters *contention = _db->Contention();
+	LARGE_INTEGER firstDeadlock;
 	try
 	{
 		do 
@@ -86,13 +88,27 @@ int CursorImpl::DeadlockLoop(String ^methodName, Dbt *key,
 			} 
 			if (deadlock_occurred) 
 			{
-				_db->Log(intDeadlockValue, "Deadlock"); 
+				if (retry_count == 0)
+				{
+					QueryPerformanceCounter(&firstDeadlock);
+				}
+				contention->Deadlock();
 				++retry_count; 
 				if (retry_count >= _db->MaxDeadlockRetries) break; 
+				// no backoff: the cursor and its transaction still hold every lock taken
+				// before the deadlock, so sleeping here would only prolong the conflict
+				contention->Retry();
 			} 
 		} while(deadlock_occurred);
+		if (retry_count > 0)
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			contention->RetryTime(now.QuadPart - firstDeadlock.QuadPart);
+		}
 		if (deadlock_occurred) 
 		{
+			contention->Exhausted();
 			ConvStr msg("Get exceeded retry limit. Giving up."); 
 			_db->InternalEnvironment->Handle->errx(msg.Str()); 
 			throw BdbExceptionFactory::Create(intDeadlockValue, gcnew String(db_strerror(intDeadlockValue))); 
@@ -272,6 +288,116 @@ Buffers CursorImpl::GetBuffers(DataBuffer key,
 		dbtBuffer.CreateBuffer(), 0);
 }
 
+namespace
+{
+	// default BTree key order
+	int CompareKey(const Byte *key, u_int32_t keyLength, const Byte *bound, u_int32_t boundLength)
+	{
+		int diff = memcmp(key, bound, keyLength < boundLength ? keyLength : boundLength);
+		if (diff != 0) return diff;
+		return keyLength < boundLength ? -1 : (keyLength > boundLength ? 1 : 0);
+	}
+}
+
+int CursorImpl::GetBulk(BulkRecordBuffer ^buffer, BulkRecordFilter ^filter,
+	CursorPosition position, GetOpFlags flags)
+{
+	if (buffer == nullptr) throw gcnew ArgumentNullException("buffer");
+	bool isBTree = false;
+	switch(_db->GetDatabaseType()) {
+		case DatabaseType::Queue:
+		case DatabaseType::Recno:
+			throw gcnew NotSupportedException("Bulk reads need stored keys; record number databases aren't supported");
+		case DatabaseType::BTree:
+			isBTree = true;
+			break;
+	}
+
+	// pin the filter once so each entry is tested without leaving native code
+	array<Byte> ^keyStart = filter != nullptr ? filter->KeyStart : nullptr;
+	array<Byte> ^keyEnd = filter != nullptr ? filter->KeyEnd : nullptr;
+	array<Byte> ^valuePattern = filter != nullptr ? filter->ValuePattern : nullptr;
+	int valueOffset = filter != nullptr ? filter->ValueOffset : 0;
+	if (valueOffset < 0) throw gcnew ArgumentOutOfRangeException("filter");
+	u_int32_t keyStartLength = keyStart != nullptr ? keyStart->Length : 0;
+	u_int32_t keyEndLength = keyEnd != nullptr ? keyEnd->Length : 0;
+	u_int32_t valuePatternLength = valuePattern != nullptr ? valuePattern->Length : 0;
+	pin_ptr<Byte> pinnedKeyStart = keyStartLength > 0 ? &keyStart[0] : nullptr;
+	pin_ptr<Byte> pinnedKeyEnd = keyEndLength > 0 ? &keyEnd[0] : nullptr;
+	pin_ptr<Byte> pinnedValuePattern = valuePatternLength > 0 ? &valuePattern[0] : nullptr;
+
+	if (position == CursorPosition::SetRange && (keyStart == nullptr || !isBTree))
+	{
+		// only BTrees can be positioned by key; the filter still applies
+		position = CursorPosition::Next;
+	}
+	u_int32_t allFlags = static_cast<u_int32_t>(position) |
+		static_cast<u_int32_t>(flags) | DB_MULTIPLE_KEY;
+	while (true)
+	{
+		buffer->Clear();
+		array<Byte> ^bytes = buffer->Buffer;
+		pin_ptr<Byte> pinned = &bytes[0];
+		Byte *start = pinned;
+		Dbt dbtKey;
+		if (position == CursorPosition::SetRange)
+		{
+			dbtKey.set_data(pinnedKeyStart);
+			dbtKey.set_size(keyStartLength);
+		}
+		Dbt dbtBuffer(start, bytes->Length);
+		dbtBuffer.set_ulen(bytes->Length);
+		dbtBuffer.set_flags(DB_DBT_USERMEM);
+		int ret = DeadlockLoop("GetBulk", &dbtKey, &dbtBuffer, allFlags, get_core);
+		switch(ret) {
+		case DbRetVal::NOTFOUND:
+			return Lengths::NotFound;
+		case DbRetVal::BUFFER_SMALL:
+			// the next entry alone is bigger than the buffer
+			buffer->Resize(dbtBuffer.get_size());
+			continue;
+		case DbRetVal::SUCCESS:
+			break;
+		default:
+			throw BdbExceptionFactory::Create(ret, String::Format(
+				L"BerkeleyDbWrapper:Cursor:GetBulk: Unexpected error with ret value {0}", ret));
+		}
+		void *p;
+		void *retKey, *retData;
+		u_int32_t retKeyLength, retDataLength;
+		DB_MULTIPLE_INIT(p, dbtBuffer.get_DBT());
+		while (true)
+		{
+			DB_MULTIPLE_KEY_NEXT(p, dbtBuffer.get_DBT(), retKey, retKeyLength, retData, retDataLength);
+			if (p == NULL) break;
+			const Byte *key = static_cast<const Byte *>(retKey);
+			const Byte *data = static_cast<const Byte *>(retData);
+			if (keyStart != nullptr && CompareKey(key, retKeyLength, pinnedKeyStart, keyStartLength) < 0)
+			{
+				continue;
+			}
+			if (keyEnd != nullptr && CompareKey(key, retKeyLength, pinnedKeyEnd, keyEndLength) >= 0)
+			{
+				if (isBTree)
+				{
+					// keys are ordered, nothing further can match
+					buffer->MarkExhausted();
+					break;
+				}
+				continue;
+			}
+			if (valuePattern != nullptr && (valueOffset + valuePatternLength > retDataLength ||
+				memcmp(data + valueOffset, pinnedValuePattern, valuePatternLength) != 0))
+			{
+				continue;
+			}
+			buffer->Add(static_cast<int>(key - start), retKeyLength,
+				static_cast<int>(data - start), retDataLength);
+		}
+		return buffer->Count;
+	}
+}
+
 Lengths CursorImpl::Put(DataBuffer key,
 	DataBuffer value, int offset, int length, CursorPosition position,
 	PutOpFlags flags)
@@ -144,6 +144,29 @@ namespace BerkeleyDbWrapper
 		virtual Buffers GetBuffers(DataBuffer key, int offset, int length,
 			CursorPosition position, GetOpFlags flags) override;
 		/// <summary>
+		/// 	<para>Reads as many entries as fit into a buffer in one call, using
+		///		<c>DB_MULTIPLE_KEY</c>, keeping those that pass a filter.</para>
+		/// </summary>
+		/// <param name="buffer">
+		/// 	<para>The <see cref="BulkRecordBuffer" /> whose entries are replaced.</para>
+		/// </param>
+		/// <param name="filter">
+		/// 	<para>The <see cref="BulkRecordFilter" /> tested against each entry before
+		///		it is added to <paramref name="buffer"/>, or null.</para>
+		/// </param>
+		/// <param name="position">
+		/// 	<para>The <see cref="CursorPosition"/> specifying the position at
+		///		which to start reading.</para>
+		/// </param>
+		/// <param name="flags">
+		/// 	<para>The <see cref="GetOpFlags"/> specifying the read options.</para>
+		/// </param>
+		/// <returns>
+		///		<para>The number of entries kept, or <see cref="Lengths::NotFound"/>.</para>
+		/// </returns>
+		virtual int GetBulk(BulkRecordBuffer ^buffer, BulkRecordFilter ^filter,
+			CursorPosition position, GetOpFlags flags) override;
+		/// <summary>
 		/// 	<para>Writes a cursor entry.</para>
 		/// </summary>
 		/// <param name="key">
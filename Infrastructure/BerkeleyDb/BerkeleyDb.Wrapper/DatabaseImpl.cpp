@@ -4,6 +4,7 @@
 #include "CursorImpl.h"
 #include "BdbExceptionFactory.h"
 #include "Alloc.h"
+#include "RmwOperators.h"
 
 using namespace std;
 using namespace System::Runtime::InteropServices;
@@ -24,11 +25,12 @@ using namespace BerkeleyDbWrapper;
 
 DatabaseImpl::DatabaseImpl(DatabaseConfig^ dbConfig): 
 	m_pDb(NULL), m_pEnv(NULL), m_errpfx(0), m_dbConfig(dbConfig), Id(dbConfig->Id),
-	m_isTxn(false), m_maxDeadlockRetries(1), m_pTrMode(dbConfig->TransactionMode),
-	disposed(false), m_isCDB(false)
+	m_isTxn(false), m_maxDeadlockRetries(1), m_retryPolicy(NULL), m_contention(NULL),
+	m_pTrMode(dbConfig->TransactionMode), disposed(false), m_isCDB(false)
 {
 	try
 	{
+		CreateRetryPolicy(dbConfig);
 		m_pDb = new Db(0, 0);
 		m_pDb->set_alloc(&malloc_wrapper, &realloc_wrapper, &free_wrapper);
 		this->Open(dbConfig);
@@ -41,11 +43,13 @@ DatabaseImpl::DatabaseImpl(DatabaseConfig^ dbConfig):
 
 DatabaseImpl::DatabaseImpl(EnvironmentImpl^ environment, DatabaseConfig^ dbConfig): 
 	environment(environment), m_pDb(NULL), m_pEnv(environment->Handle), m_errpfx(0), m_dbConfig(dbConfig), Id(dbConfig->Id), 
-	m_isTxn(false), m_maxDeadlockRetries(1), m_pTrMode(dbConfig->TransactionMode),
+	m_isTxn(false), m_maxDeadlockRetries(1), m_retryPolicy(NULL), m_contention(NULL),
+	m_pTrMode(dbConfig->TransactionMode),
 	disposed(false), m_isCDB((environment->GetOpenFlags() & EnvOpenFlags::InitCDB) == EnvOpenFlags::InitCDB)
 {
 	try
 	{
+		CreateRetryPolicy(dbConfig);
 		m_pDb = new Db(m_pEnv, 0);
 		EnvOpenFlags envOpenFlags = environment->GetOpenFlags();
 		if ((envOpenFlags & EnvOpenFlags::InitTxn)== EnvOpenFlags::InitTxn)
@@ -64,13 +68,32 @@ DatabaseImpl::DatabaseImpl(EnvironmentImpl^ environment, DatabaseConfig^ dbConfi
 
 DatabaseImpl::DatabaseImpl():
 	environment(nullptr), m_pDb(NULL), m_pEnv(NULL), m_errpfx(0), m_dbConfig(nullptr), Id(0), disposed(false),
-	m_pTrMode()
+	m_retryPolicy(NULL), m_contention(NULL), m_pTrMode()
 {
 }
 
+void DatabaseImpl::CreateRetryPolicy(DatabaseConfig ^dbConfig)
+{
+	DeadlockRetry ^retry = dbConfig->DeadlockRetry;
+	m_retryPolicy = retry != nullptr ?
+		new RetryPolicy(retry->BaseDelay, retry->MaxDelay, retry->Jitter, retry->RetryLockTimeout) :
+		new RetryPolicy(0, 0, false, 0);
+	m_contention = new ContentionCounters();
+}
+
 DatabaseImpl::!DatabaseImpl()
 {
 	disposed = true;
+	if (m_retryPolicy != NULL)
+	{
+		delete m_retryPolicy;
+		m_retryPolicy = NULL;
+	}
+	if (m_contention != NULL)
+	{
+		delete m_contention;
+		m_contention = NULL;
+	}
 	if (m_pDb != NULL)
 	{
 		try
@@ -1036,6 +1059,51 @@ DbRetVal DatabaseImpl::Get(Dbt *dbtKey, Dbt *dbtValue)
 	return (DbRetVal)ret; //can't get here, but compiler doesn't know that
 }
 
+DbTxn *DatabaseImpl::BeginTry(TransactionContext &context, int retry_count)
+{
+	DbTxn *txn = context.begin();
+	if (retry_count > 0 && txn != NULL && m_retryPolicy->RetryLockTimeout() > 0)
+	{
+		// a retry that meets the same contention should fail fast and back off again
+		txn->set_timeout(m_retryPolicy->RetryLockTimeout(), DB_SET_LOCK_TIMEOUT);
+	}
+	return txn;
+}
+
+// Counts a deadlock on try retry_count, already rolled back, and backs off before the next
+// try. Returns false when no tries are left.
+bool DatabaseImpl::DeadlockBackoff(int retry_count, LARGE_INTEGER &firstDeadlock)
+{
+	if (retry_count == 0)
+	{
+		QueryPerformanceCounter(&firstDeadlock);
+	}
+	m_contention->Deadlock();
+	if (retry_count + 1 >= m_maxDeadlockRetries) return false;
+	m_contention->Retry();
+	m_retryPolicy->Backoff(retry_count + 1);
+	return true;
+}
+
+void DatabaseImpl::EndTries(String ^methodName, int retry_count, const LARGE_INTEGER &firstDeadlock,
+	bool exhausted)
+{
+	const int intDeadlockValue = static_cast<int>(DbRetVal::LOCK_DEADLOCK); 
+	if (retry_count > 0)
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		m_contention->RetryTime(now.QuadPart - firstDeadlock.QuadPart);
+	}
+	if (exhausted) 
+	{ 
+		m_contention->Exhausted();
+		ConvStr msg(methodName + " exceeded retry limit. Giving up."); 
+		m_pEnv->errx(msg.Str()); 
+		throw BdbExceptionFactory::Create(intDeadlockValue, gcnew String(db_strerror(intDeadlockValue))); 
+	}
+}
+
 int DatabaseImpl::DeadlockLoop(String ^methodName, TransactionContext &context, Dbt *key,
 	Dbt *data, int options, BdbCall bdbCall)
 {
@@ -1043,13 +1111,14 @@ int DatabaseImpl::DeadlockLoop(String ^methodName, TransactionContext &context,
 	int retry_count = 0; 
 	bool deadlock_occurred = false; 
 	int ret = 0;
+	LARGE_INTEGER firstDeadlock;
 	do 
 	{ 
 		deadlock_occurred = false; 
 		ret = 0; 
 		try 
 		{ 
-			ret = bdbCall(m_pDb, context.begin(), key, data, options);
+			ret = bdbCall(m_pDb, BeginTry(context, retry_count), key, data, options);
 			deadlock_occurred = (ret == intDeadlockValue);
 		} 
 		catch(DbDeadlockException) 
@@ -1058,18 +1127,11 @@ int DatabaseImpl::DeadlockLoop(String ^methodName, TransactionContext &context,
 		} 
 		if (deadlock_occurred) 
 		{ 
-			Log(intDeadlockValue, "Deadlock"); 
 			context.rollback();
-			++retry_count; 
-			if (retry_count >= m_maxDeadlockRetries) break; 
+			if (!DeadlockBackoff(retry_count++, firstDeadlock)) break; 
 		} 
 	} while(deadlock_occurred); 
-	if (deadlock_occurred) 
-	{ 
-		ConvStr msg(methodName + " exceeded retry limit. Giving up."); 
-		m_pEnv->errx(msg.Str()); 
-		throw BdbExceptionFactory::Create(intDeadlockValue, gcnew String(db_strerror(intDeadlockValue))); 
-	}
+	EndTries(methodName, retry_count, firstDeadlock, deadlock_occurred);
 	return ret;
 }
 
@@ -1178,13 +1240,12 @@ int DatabaseImpl::Get(DataBuffer key, int offset, DataBuffer buffer,
 	return SwitchMemStd("Get", context, ret, size);
 }
 
-Stream^ DatabaseImpl::Get(DataBuffer key,
-	int offset, int length, GetOpFlags flags)
+int DatabaseImpl::GetMalloc(String ^methodName, DataBuffer key, int offset, int length,
+	GetOpFlags flags, DbtExtended &dbtBuffer)
 {
 	int ret = 0;
 	int size = -1;
 	DatabaseImpl ^db = this;
-	DbtExtended dbtBuffer;
 	dbtBuffer.set_flags(DB_DBT_MALLOC);
 	TransactionContext context(db);
 	{
@@ -1193,14 +1254,30 @@ Stream^ DatabaseImpl::Get(DataBuffer key,
 		if (offset > 0 || length > 0) {
 			dbtBuffer.set_for_partial(offset, length);
 		}
-		ret = TryMemStd("Get", context, &dbtKey, &dbtBuffer, &size, static_cast<int>(flags),
+		ret = TryMemStd(methodName, context, &dbtKey, &dbtBuffer, &size, static_cast<int>(flags),
 			&get_core);
 	}
-	size = SwitchMemStd("Get", context, ret, size);
+	return SwitchMemStd(methodName, context, ret, size);
+}
+
+Stream^ DatabaseImpl::Get(DataBuffer key,
+	int offset, int length, GetOpFlags flags)
+{
+	DbtExtended dbtBuffer;
+	int size = GetMalloc("Get", key, offset, length, flags, dbtBuffer);
 	if (size < 0) return nullptr;
 	return dbtBuffer.CreateStream();
 }
 
+UnmanagedMemoryView^ DatabaseImpl::GetView(DataBuffer key,
+	int offset, int length, GetOpFlags flags)
+{
+	DbtExtended dbtBuffer;
+	int size = GetMalloc("GetView", key, offset, length, flags, dbtBuffer);
+	if (size < 0) return nullptr;
+	return dbtBuffer.CreateView();
+}
+
 array<Byte>^ DatabaseImpl::GetBuffer(DataBuffer key,
 	int offset, int length, GetOpFlags flags)
 {
@@ -1298,6 +1375,229 @@ DbRetVal DatabaseImpl::Exists(DataBuffer key, ExistsOpFlags flags)
 	return static_cast<DbRetVal>(ret);
 }
 
+int DatabaseImpl::BatchItem(BatchOp op, TransactionContext &context, DataBuffer key,
+	DataBuffer buffer, int options, int *sizePtr)
+{
+	int ret = 0;
+	DbtHolder dbtKey;
+	DbtHolder dbtBuffer;
+	dbtKey.initialize_for_read(key);
+	try
+	{
+		switch(op)
+		{
+		case BatchOp::Get:
+			dbtBuffer.initialize_for_write(buffer);
+			ret = m_pDb->get(context.begin(), &dbtKey, &dbtBuffer, options);
+			*sizePtr = dbtBuffer.get_size();
+			break;
+		case BatchOp::Put:
+			dbtBuffer.initialize_for_read(buffer);
+			ret = m_pDb->put(context.begin(), &dbtKey, &dbtBuffer, options);
+			*sizePtr = dbtBuffer.get_size();
+			break;
+		case BatchOp::Delete:
+			ret = m_pDb->del(context.begin(), &dbtKey, options);
+			*sizePtr = 0;
+			break;
+		}
+	}
+	catch(DbDeadlockException)
+	{
+		ret = static_cast<int>(DbRetVal::LOCK_DEADLOCK);
+	}
+	catch(DbMemoryException &mex)
+	{
+		ret = static_cast<int>(DbRetVal::BUFFER_SMALL);
+		*sizePtr = mex.get_dbt()->get_size();
+	}
+	return ret;
+}
+
+void DatabaseImpl::RunBatch(String ^methodName, BatchOp op, array<DataBuffer>^ keys,
+	array<DataBuffer>^ buffers, array<int>^ results, int options)
+{
+	if (keys == nullptr) throw gcnew ArgumentNullException("keys");
+	if (results == nullptr) throw gcnew ArgumentNullException("results");
+	int count = keys->Length;
+	if (op != BatchOp::Delete && (buffers == nullptr || buffers->Length < count))
+		throw gcnew ArgumentException("A buffer is required for each key", "buffers");
+	if (results->Length < count)
+		throw gcnew ArgumentException("A result slot is required for each key", "results");
+
+	const int intDeadlockValue = static_cast<int>(DbRetVal::LOCK_DEADLOCK);
+	DatabaseImpl ^db = this;
+	int retry_count = 0;
+	LARGE_INTEGER firstDeadlock;
+	// start is the first item not yet made durable; items before it are committed
+	// and are never run again.
+	int start = 0;
+	while (start < count)
+	{
+		TransactionContext context(db);
+		bool transactional = BeginTry(context, retry_count) != NULL;
+		int index = start;
+		try
+		{
+			for (; index < count; ++index)
+			{
+				int size = -1;
+				int ret = BatchItem(op, context, keys[index], op == BatchOp::Delete ? DataBuffer::Empty :
+					buffers[index], options, &size);
+				if (ret == intDeadlockValue)
+				{
+					break;
+				}
+				bool expected;
+				switch(ret)
+				{
+				case DbRetVal::SUCCESS:
+					expected = true;
+					results[index] = op == BatchOp::Delete ? ret : size;
+					break;
+				case DbRetVal::BUFFER_SMALL:
+					expected = op == BatchOp::Get;
+					results[index] = size;
+					break;
+				case DbRetVal::NOTFOUND:
+				case DbRetVal::KEYEMPTY:
+					expected = op != BatchOp::Put;
+					results[index] = op == BatchOp::Delete ? ret : -1;
+					break;
+				default:
+					expected = false;
+					break;
+				}
+				if (!expected)
+				{
+					throw BdbExceptionFactory::Create(ret, String::Format(
+						L"BerkeleyDbWrapper:Database:{0}: Unexpected error with ret value {1} on batch item {2}",
+						methodName, ret, index));
+				}
+			}
+		}
+		catch (const exception &ex)
+		{
+			throw BdbExceptionFactory::Create(&ex, "BerkeleyDbWrapper:Database:" + methodName);
+		}
+		if (index == count)
+		{
+			context.commit();
+			EndTries(methodName, retry_count, firstDeadlock, false);
+			return;
+		}
+		// deadlocked on item index; a rollback undoes everything since start, but without a
+		// transaction the items before index are already applied and only index is retried.
+		context.rollback();
+		if (!transactional)
+		{
+			start = index;
+		}
+		if (!DeadlockBackoff(retry_count++, firstDeadlock))
+		{
+			EndTries(methodName, retry_count, firstDeadlock, true);
+		}
+	}
+}
+
+void DatabaseImpl::GetMany(array<DataBuffer>^ keys, array<DataBuffer>^ buffers, array<int>^ results,
+	GetOpFlags flags)
+{
+	RunBatch("GetMany", BatchOp::Get, keys, buffers, results, static_cast<int>(flags));
+}
+
+void DatabaseImpl::PutMany(array<DataBuffer>^ keys, array<DataBuffer>^ buffers, array<int>^ results,
+	PutOpFlags flags)
+{
+	RunBatch("PutMany", BatchOp::Put, keys, buffers, results, static_cast<int>(flags));
+}
+
+void DatabaseImpl::DeleteMany(array<DataBuffer>^ keys, array<DbRetVal>^ results, DeleteOpFlags flags)
+{
+	if (keys == nullptr) throw gcnew ArgumentNullException("keys");
+	if (results == nullptr) throw gcnew ArgumentNullException("results");
+	array<int>^ codes = gcnew array<int>(keys->Length);
+	RunBatch("DeleteMany", BatchOp::Delete, keys, nullptr, codes, static_cast<int>(flags));
+	for (int i = 0; i < codes->Length; ++i)
+	{
+		results[i] = static_cast<DbRetVal>(codes[i]);
+	}
+}
+
+int DatabaseImpl::IncrementCounter(DataBuffer key, DataBuffer initialData, int counterOffset, int incrementBy,
+	int minimum, int maximum)
+{
+	if (counterOffset < initialData.ByteLength)
+		throw gcnew ArgumentOutOfRangeException("counterOffset", "The counter can't overlap the initial data");
+	if (minimum > maximum)
+		throw gcnew ArgumentException("The minimum is greater than the maximum", "minimum");
+	int ret = 0;
+	RmwOperand operand(RmwIncrement);
+	DatabaseImpl ^db = this;
+	TransactionContext context(db);
+	{
+		DbtHolder dbtKey;
+		DbtHolder dbtInitial;
+		dbtKey.initialize_for_read(key);
+		dbtInitial.initialize_for_read(initialData);
+		operand.initialData = dbtInitial.get_data();
+		operand.initialSize = dbtInitial.get_size();
+		operand.offset = counterOffset;
+		operand.incrementBy = incrementBy;
+		operand.minimum = minimum;
+		operand.maximum = maximum;
+		ret = TryStd("IncrementCounter", context, &dbtKey, &operand, m_isCDB ? DB_WRITECURSOR : 0, &rmw_core);
+	}
+	SwitchStd("IncrementCounter", context, ret);
+	return operand.counter;
+}
+
+bool DatabaseImpl::CompareAndSet(DataBuffer key, DataBuffer buffer, int ticksOffset, __int64 %storedTicks)
+{
+	if (ticksOffset < 0 || ticksOffset > buffer.ByteLength - static_cast<int>(sizeof(__int64)))
+		throw gcnew ArgumentOutOfRangeException("ticksOffset", "The timestamp must lie within the buffer");
+	int ret = 0;
+	RmwOperand operand(RmwCompareAndSet);
+	DatabaseImpl ^db = this;
+	TransactionContext context(db);
+	{
+		DbtHolder dbtKey;
+		DbtHolder dbtBuffer;
+		dbtKey.initialize_for_read(key);
+		dbtBuffer.initialize_for_read(buffer);
+		operand.set_data(dbtBuffer.get_data());
+		operand.set_size(dbtBuffer.get_size());
+		operand.offset = ticksOffset;
+		ret = TryStd("CompareAndSet", context, &dbtKey, &operand, m_isCDB ? DB_WRITECURSOR : 0, &rmw_core);
+	}
+	SwitchStd("CompareAndSet", context, ret);
+	storedTicks = operand.storedTicks;
+	return operand.applied;
+}
+
+int DatabaseImpl::Append(DataBuffer key, DataBuffer initialData, DataBuffer buffer)
+{
+	int ret = 0;
+	RmwOperand operand(RmwAppend);
+	DatabaseImpl ^db = this;
+	TransactionContext context(db);
+	{
+		DbtHolder dbtKey;
+		DbtHolder dbtInitial;
+		DbtHolder dbtBuffer;
+		dbtKey.initialize_for_read(key);
+		dbtInitial.initialize_for_read(initialData);
+		dbtBuffer.initialize_for_read(buffer);
+		operand.initialData = dbtInitial.get_data();
+		operand.initialSize = dbtInitial.get_size();
+		operand.set_data(dbtBuffer.get_data());
+		operand.set_size(dbtBuffer.get_size());
+		ret = TryStd("Append", context, &dbtKey, &operand, m_isCDB ? DB_WRITECURSOR : 0, &rmw_core);
+	}
+	SwitchStd("Append", context, ret);
+	return static_cast<int>(operand.length);
+}
+
 int DatabaseImpl::GetLength(DataBuffer key, GetOpFlags flags)
 {
 	int ret = 0;
@@ -2042,6 +2342,18 @@ int DatabaseImpl::GetKeyCount(DbStatFlags statFlag)
 	}
 }
 
+ContentionStatistics^ DatabaseImpl::GetContentionStatistics()
+{
+	ContentionTotals totals;
+	if (m_contention == NULL)
+	{
+		return gcnew ContentionStatistics(0, 0, 0, TimeSpan::Zero);
+	}
+	m_contention->Read(&totals);
+	return gcnew ContentionStatistics(totals.deadlocks, totals.retries, totals.exhausted,
+		TimeSpan::FromSeconds(static_cast<double>(totals.retryTicks) / System::Diagnostics::Stopwatch::Frequency));
+}
+
 int DatabaseImpl::Compact(int fillPercentage, int maxPagesFreed, int implicitTxnTimeoutMsecs)
 {
 	int ret = 0;
@@ -2070,6 +2382,158 @@ int DatabaseImpl::Compact(int fillPercentage, int maxPagesFreed, int implicitTxn
 	}
 }
 
+bool DatabaseImpl::FindSliceEnd(array<Byte>^ startKey, int maxKeys, array<Byte>^ %endKey)
+{
+	int ret = 0;
+	Dbc *cur = NULL;
+	Dbt dbtKey;
+	dbtKey.set_flags(DB_DBT_REALLOC);
+	// only the keys are wanted, so read no data
+	Dbt dbtData;
+	dbtData.set_flags(DB_DBT_USERMEM | DB_DBT_PARTIAL);
+	dbtData.set_ulen(0);
+	dbtData.set_dlen(0);
+	endKey = nullptr;
+	try
+	{
+		try
+		{
+			u_int32_t flags = DB_FIRST;
+			if (startKey != nullptr && startKey->Length > 0)
+			{
+				void *start = malloc_wrapper(startKey->Length);
+				Marshal::Copy(startKey, 0, IntPtr(start), startKey->Length);
+				dbtKey.set_data(start);
+				dbtKey.set_size(startKey->Length);
+				flags = DB_SET_RANGE;
+			}
+			ret = m_pDb->cursor(NULL, &cur, 0);
+			if (ret != 0)
+			{
+				throw BdbExceptionFactory::Create(ret, "BerkeleyDbWrapper:Database:CompactSlice: Unexpected error on cursor open with ret value " + ret);
+			}
+			int count = 0;
+			do
+			{
+				ret = cur->get(&dbtKey, &dbtData, flags);
+				flags = DB_NEXT;
+			} while (ret == 0 && ++count < maxKeys);
+		}
+		catch (DbDeadlockException &de)
+		{
+			Log(de.get_errno(), "Slice end search deadlocked, slice deferred");
+			return false;
+		}
+		catch (const DbException &ex)
+		{
+			throw BdbExceptionFactory::Create(ret, &ex, gcnew String(ex.what()));
+		}
+		switch(ret)
+		{
+		case 0:
+			{
+				int endSize = static_cast<int>(dbtKey.get_size());
+				endKey = gcnew array<Byte>(endSize);
+				if (endSize > 0)
+					Marshal::Copy(IntPtr(dbtKey.get_data()), endKey, 0, endSize);
+			}
+			break;
+		case DB_NOTFOUND:
+			// the database ends within the slice
+			break;
+		default:
+			throw BdbExceptionFactory::Create(ret, "BerkeleyDbWrapper:Database:CompactSlice: Unexpected error on cursor get with ret value " + ret);
+		}
+	}
+	finally
+	{
+		if (cur != NULL)
+			cur->close();
+		if (dbtKey.get_data() != NULL)
+			free_wrapper(dbtKey.get_data());
+	}
+	return true;
+}
+
+void DatabaseImpl::CompactSlice(int fillPercentage, int maxPagesFreed, int maxKeys, int implicitTxnTimeoutMsecs,
+	CompactProgress^ progress)
+{
+	int ret = 0;
+	DB_COMPACT cmpt;
+	memset(&cmpt, 0, sizeof(cmpt));
+	cmpt.compact_fillpercent = fillPercentage > 0 ? fillPercentage : 0;
+	cmpt.compact_pages = maxPagesFreed > 0 ? maxPagesFreed : 0;
+	cmpt.compact_timeout = implicitTxnTimeoutMsecs > 0 ? implicitTxnTimeoutMsecs : 0;
+	Dbt dbtStart;
+	Dbt dbtEnd;
+	dbtEnd.set_flags(DB_DBT_MALLOC);
+	array<Byte>^ resumeKey = progress->ResumeKey;
+	pin_ptr<Byte> startPtr = nullptr;
+	if (resumeKey != nullptr && resumeKey->Length > 0)
+	{
+		startPtr = &resumeKey[0];
+		dbtStart.set_data(startPtr);
+		dbtStart.set_size(resumeKey->Length);
+	}
+	// bound the slice by key span as well as pages freed, so a slice over densely packed
+	// pages that frees little can't examine the rest of the database in one go
+	array<Byte>^ stopKey = nullptr;
+	if (maxKeys > 0 && !FindSliceEnd(resumeKey, maxKeys, stopKey))
+		return;
+	Dbt dbtStop;
+	pin_ptr<Byte> stopPtr = nullptr;
+	if (stopKey != nullptr && stopKey->Length > 0)
+	{
+		stopPtr = &stopKey[0];
+		dbtStop.set_data(stopPtr);
+		dbtStop.set_size(stopKey->Length);
+	}
+	array<Byte>^ endKey = nullptr;
+	try
+	{
+		try
+		{
+			ret = m_pDb->compact(NULL, startPtr != nullptr ? &dbtStart : NULL,
+				stopPtr != nullptr ? &dbtStop : NULL, &cmpt, DB_FREE_SPACE, &dbtEnd);
+		}
+		catch (const DbException &ex)
+		{
+			throw BdbExceptionFactory::Create(ret, &ex, gcnew String(ex.what()));
+		}
+		catch (const exception &ex)
+		{
+			throw BdbExceptionFactory::Create(ret, &ex, gcnew String(ex.what()));
+		}
+		// a slice that reached the page limit resumes where compact stopped, one that didn't
+		// resumes at its stop key, and one with no stop key ran off the end of the database
+		if (maxPagesFreed > 0 && static_cast<int>(cmpt.compact_pages_free) >= maxPagesFreed &&
+			dbtEnd.get_data() != NULL && dbtEnd.get_size() > 0)
+		{
+			int endSize = static_cast<int>(dbtEnd.get_size());
+			endKey = gcnew array<Byte>(endSize);
+			Marshal::Copy(IntPtr(dbtEnd.get_data()), endKey, 0, endSize);
+		}
+		else if (stopPtr != nullptr)
+		{
+			endKey = stopKey;
+		}
+	}
+	finally
+	{
+		if (dbtEnd.get_data() != NULL)
+			free_wrapper(dbtEnd.get_data());
+	}
+	switch(ret)
+	{
+	case DbRetVal::SUCCESS: case DbRetVal::PAGE_NOTFOUND:
+		progress->AddSlice(endKey, cmpt.compact_pages_free, cmpt.compact_pages_examine,
+			cmpt.compact_pages_truncated);
+		break;
+	default:
+		throw BdbExceptionFactory::Create(ret, "BerkeleyDbWrapper:Database:CompactSlice: Unexpected error with ret value " + ret);
+	}
+}
+
 int DatabaseImpl::Truncate()
 {
 	u_int32_t count = 0;
@@ -2528,6 +2992,113 @@ void DatabaseImpl::BackupFromMpf(String^ backupFile, array<Byte>^ copyBuffer)
 	}
 }
 
+namespace
+{
+	// Layout of a delta file, mirrored by BackupSet when it is applied on restore:
+	// header (magic, version, page size, since lsn), then per changed page its number followed
+	// by its contents, then a trailer of DeltaEndMarker and the page count of the database.
+	const char DeltaMagic[8] = { 'B', 'D', 'B', 'D', 'E', 'L', 'T', 'A' };
+	const unsigned int DeltaVersion = 1;
+	const unsigned int DeltaEndMarker = 0xFFFFFFFF;
+
+	inline bool ChangedSince(const DB_LSN *pageLsn, const DB_LSN &since)
+	{
+		// pages of unlogged databases carry a file number of 0 and can never be skipped
+		if (pageLsn->file == 0)
+			return true;
+		if (pageLsn->file != since.file)
+			return pageLsn->file > since.file;
+		return pageLsn->offset >= since.offset;
+	}
+}
+
+int DatabaseImpl::BackupDeltaFromMpf(String^ deltaFile, __int64 sinceLsn, array<Byte>^ copyBuffer)
+{
+	int ret = 0;
+	unsigned int pageSize = static_cast<unsigned int>(GetPageSize());
+	DB_LSN since;
+	since.file = static_cast<u_int32_t>(sinceLsn >> 32);
+	since.offset = static_cast<u_int32_t>(sinceLsn & 0xFFFFFFFF);
+	pin_ptr<void> buf = nullptr;
+	int copiedPages = 0;
+	DbMpoolFile *mpf;
+	void *bufRead;
+	ofstream backupStream;
+	if (copyBuffer != nullptr && copyBuffer->Length > 0)
+	{
+		// the copy buffer backs the stream so pages and their numbers are written in large blocks
+		buf = &copyBuffer[0];
+		backupStream.rdbuf()->pubsetbuf(reinterpret_cast<char *>(buf), copyBuffer->Length);
+	}
+	try
+	{
+		mpf = m_pDb->get_mpf();
+		do
+		{
+			pin_ptr<wchar_t> deltaFilePath = &(deltaFile->ToCharArray())[0];
+			backupStream.open(deltaFilePath, ofstream::binary | ios_base::out | ios_base::trunc);
+		} while(false);
+		backupStream.write(DeltaMagic, sizeof(DeltaMagic));
+		backupStream.write(reinterpret_cast<const char *>(&DeltaVersion), sizeof(DeltaVersion));
+		backupStream.write(reinterpret_cast<const char *>(&pageSize), sizeof(pageSize));
+		backupStream.write(reinterpret_cast<const char *>(&sinceLsn), sizeof(sinceLsn));
+		db_pgno_t pageNumber = 0;
+		do
+		{
+			try
+			{
+				bufRead = NULL;
+				ret = mpf->get(&pageNumber, NULL, 0, &bufRead);
+				switch(ret)
+				{
+				case DbRetVal::SUCCESS:
+					// every page starts with the lsn of the last logged change made to it
+					if (ChangedSince(static_cast<const DB_LSN *>(bufRead), since))
+					{
+						backupStream.write(reinterpret_cast<const char *>(&pageNumber), sizeof(pageNumber));
+						backupStream.write(reinterpret_cast<const char *>(bufRead), pageSize);
+						++copiedPages;
+					}
+					break;
+				case DbRetVal::PAGE_NOTFOUND:
+					break;
+				default:
+					throw BdbExceptionFactory::Create(ret,
+						"BerkeleyDbWrapper:Database:BackupDeltaFromMpf: Unexpected error in getting page " + pageNumber +
+						" with ret value " + ret);
+				}
+			}
+			finally
+			{
+				// unchanged pages were only needed for their lsn, so don't let the scan push out hot pages
+				if (bufRead != NULL)
+					mpf->put(bufRead, DB_PRIORITY_VERY_LOW, 0);
+			}
+			if (ret == static_cast<int>(DbRetVal::SUCCESS))
+				++pageNumber;
+		} while(ret == static_cast<int>(DbRetVal::SUCCESS));
+		backupStream.write(reinterpret_cast<const char *>(&DeltaEndMarker), sizeof(DeltaEndMarker));
+		backupStream.write(reinterpret_cast<const char *>(&pageNumber), sizeof(pageNumber));
+		backupStream.flush();
+		if (backupStream.fail())
+		{
+			throw BdbExceptionFactory::Create(0,
+				"BerkeleyDbWrapper:Database:BackupDeltaFromMpf: Failed writing delta file " + deltaFile);
+		}
+	}
+	catch(const exception &ex)
+	{
+		throw BdbExceptionFactory::Create(ret, &ex, String::Format("While backing up delta to {0}: {1}", deltaFile,
+			gcnew String(ex.what())));
+	}
+	finally
+	{
+		if (backupStream.is_open())
+			backupStream.close();
+	}
+	return copiedPages;
+}
+
 DbTxn * DatabaseImpl::BeginTrans()
 {
 	switch(m_pTrMode) {
@@ -2535,6 +3106,7 @@ DbTxn * DatabaseImpl::BeginTrans()
 			return NULL;
 			break;
 		case DatabaseTransactionMode::PerCall:
+		case DatabaseTransactionMode::GroupCommit:
 			if (m_isTxn) {
 				DbTxn *txn;
 				m_pEnv->txn_begin(NULL, &txn, 0);
@@ -2557,6 +3129,12 @@ void DatabaseImpl::CommitTrans(DbTxn *txn)
 		case DatabaseTransactionMode::PerCall:
 			txn->commit(0);
 			break;
+		case DatabaseTransactionMode::GroupCommit:
+			// the commit record only reaches the log buffer here; the group's shared
+			// flush makes it durable before Join returns
+			txn->commit(DB_TXN_NOSYNC);
+			environment->Committer->Join();
+			break;
 		default:
 			throw new exception("Unrecognized transaction mode");
 	}
@@ -2569,6 +3147,7 @@ void DatabaseImpl::RollbackTrans(DbTxn *txn)
 		case DatabaseTransactionMode::None:
 			break;
 		case DatabaseTransactionMode::PerCall:
+		case DatabaseTransactionMode::GroupCommit:
 			txn->abort();
 			break;
 		default:
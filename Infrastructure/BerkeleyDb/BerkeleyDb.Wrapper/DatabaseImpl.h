@@ -3,6 +3,7 @@
 #include "DbtHolder.h"
 #include "EnvironmentImpl.h"
 #include "ConvStr.h"
+#include "RetryPolicy.h"
 
 
 
@@ -32,6 +33,7 @@ namespace BerkeleyDbWrapper
 		int Id;
 
 		virtual CacheSize^ GetCacheSize() override;
+		virtual ContentionStatistics^ GetContentionStatistics() override;
 		virtual Cursor^ GetCursor() override;
 		virtual DatabaseConfig^ GetDatabaseConfig() override;
 		virtual DatabaseEntry^ Get(DatabaseEntry^ key, DatabaseEntry^ value) override;
@@ -48,8 +50,11 @@ namespace BerkeleyDbWrapper
 		virtual String^ GetErrorPrefix() override;
 		virtual array<unsigned char>^ Get(int key, array<unsigned char>^ buffer) override;
 		virtual array<unsigned char>^ GetBuffer(DataBuffer key, int offset, int length, GetOpFlags flags) override;
+		virtual UnmanagedMemoryView^ GetView(DataBuffer key, int offset, int length, GetOpFlags flags) override;
 		virtual bool Delete(DataBuffer key, DeleteOpFlags flags) override;
 		virtual int Compact(int fillPercentage, int maxPagesFreed, int implicitTxnTimeoutMsecs) override;
+		virtual void CompactSlice(int fillPercentage, int maxPagesFreed, int maxKeys, int implicitTxnTimeoutMsecs,
+			CompactProgress^ progress) override;
 		virtual int Get(DataBuffer key, int offset, DataBuffer buffer, GetOpFlags flags) override;
 		virtual int GetHashFillFactor() override;
 		virtual int GetKeyCount(DbStatFlags statFlag) override;
@@ -57,9 +62,18 @@ namespace BerkeleyDbWrapper
 		virtual int GetPageSize() override;
 		virtual int GetRecordLength() override;
 		virtual int Put(DataBuffer key, int offset, int count, DataBuffer buffer, PutOpFlags flags) override;
+		virtual void GetMany(array<DataBuffer>^ keys, array<DataBuffer>^ buffers, array<int>^ results, GetOpFlags flags) override;
+		virtual void PutMany(array<DataBuffer>^ keys, array<DataBuffer>^ buffers, array<int>^ results, PutOpFlags flags) override;
+		virtual void DeleteMany(array<DataBuffer>^ keys, array<DbRetVal>^ results, DeleteOpFlags flags) override;
+		virtual int IncrementCounter(DataBuffer key, DataBuffer initialData, int counterOffset, int incrementBy,
+			int minimum, int maximum) override;
+		virtual bool CompareAndSet(DataBuffer key, DataBuffer buffer, int ticksOffset,
+			[Out] __int64 %storedTicks) override;
+		virtual int Append(DataBuffer key, DataBuffer initialData, DataBuffer buffer) override;
 		virtual int Truncate() override;
 		virtual void BackupFromDisk(String^ backupFile, array<unsigned char>^ copyBuffer) override;
 		virtual void BackupFromMpf(String^ backupFile, array<unsigned char>^ copyBuffer) override;
+		virtual int BackupDeltaFromMpf(String^ deltaFile, __int64 sinceLsn, array<unsigned char>^ copyBuffer) override;
 		virtual void Delete(DatabaseEntry^ key) override;
 		virtual void Delete(String^ key) override;
 		virtual void PrintStats(DbStatFlags statFlags) override;
@@ -103,6 +117,7 @@ namespace BerkeleyDbWrapper
 		inline void RollbackTrans(DbTxn *txn);
 		static PostAccessUnmanagedMemoryCleanup^ MemoryCleanup;
 		Dbc *CreateCursorHandle();
+		ContentionCounters *Contention() { return m_contention; }
 
 	private:
 		EnvironmentImpl^ environment;
@@ -112,7 +127,10 @@ namespace BerkeleyDbWrapper
 		bool m_isTxn;
 		bool m_isCDB;
 		int m_maxDeadlockRetries;
+		RetryPolicy *m_retryPolicy;
+		ContentionCounters *m_contention;
 		DatabaseConfig^ m_dbConfig;
+		void CreateRetryPolicy(DatabaseConfig ^dbConfig);
 		void Open(DbTxn *txn, Db* pDb, String ^path, DatabaseType type, DbOpenFlags flags);
 		void Open(DatabaseConfig ^dbConfig);
 		//void Open(String ^path, DatabaseType type, DbOpenFlags flags);
@@ -130,6 +148,9 @@ namespace BerkeleyDbWrapper
 		bool disposed;
 		const DatabaseTransactionMode m_pTrMode;
 		typedef int (*BdbCall)(Db *, DbTxn *, Dbt *, Dbt *, int);
+		DbTxn *BeginTry(TransactionContext &context, int retry_count);
+		bool DeadlockBackoff(int retry_count, LARGE_INTEGER &firstDeadlock);
+		void EndTries(String ^methodName, int retry_count, const LARGE_INTEGER &firstDeadlock, bool exhausted);
 		int DeadlockLoop(String ^methodName, TransactionContext &context, Dbt *key, Dbt *data, int options,
 			BdbCall bdbCall);
 		int TryStd(String ^methodName, TransactionContext &context, Dbt *key, Dbt *data, int options,
@@ -138,6 +159,14 @@ namespace BerkeleyDbWrapper
 			int options, BdbCall bdbCall);
 		int SwitchMemStd(String ^methodName, TransactionContext &context, int ret, int size);
 		void SwitchStd(String ^methodName, TransactionContext &context, int ret);
+		int GetMalloc(String ^methodName, DataBuffer key, int offset, int length, GetOpFlags flags,
+			DbtExtended &dbtBuffer);
+		enum class BatchOp { Get, Put, Delete };
+		int BatchItem(BatchOp op, TransactionContext &context, DataBuffer key, DataBuffer buffer, int options,
+			int *sizePtr);
+		bool FindSliceEnd(array<Byte>^ startKey, int maxKeys, array<Byte>^ %endKey);
+		void RunBatch(String ^methodName, BatchOp op, array<DataBuffer>^ keys, array<DataBuffer>^ buffers,
+			array<int>^ results, int options);
 	};
 
 	class TransactionContext
@@ -157,9 +186,12 @@ namespace BerkeleyDbWrapper
 		{
 			if (begun)
 			{
-				m_db->CommitTrans(txn);
+				// the handle is gone once commit is called, even if it throws (as a group
+				// commit can while waiting on the flush), so never let it reach rollback
+				DbTxn *committing = txn;
 				txn = NULL;
 				begun = false;
+				m_db->CommitTrans(committing);
 			}
 		}
 		void rollback()
@@ -35,6 +35,10 @@ namespace BerkeleyDbWrapper
 			return gcnew SafeUnmanagedMemoryStream((Byte *)get_data(), get_size(),
 				MemoryUtil::AllocClean);
 		}
+		UnmanagedMemoryView ^CreateView() {
+			return gcnew UnmanagedMemoryView((Byte *)get_data(), get_size(),
+				MemoryUtil::AllocClean);
+		}
 		array<Byte> ^CreateBuffer() {
 			__int32 size = get_size();
 			if (size < 0) return nullptr;
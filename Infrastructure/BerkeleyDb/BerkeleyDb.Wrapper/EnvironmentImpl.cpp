@@ -3,6 +3,7 @@
 #include "DatabaseImpl.h"
 #include "BdbExceptionFactory.h"
 #include "Alloc.h"
+#include "SlabAllocator.h"
 
 #define HAVE_MEMCPY
 #include "db_int.h"
@@ -77,6 +78,8 @@ void EnvironmentImpl::SetUserCopy(ENV *env, bool doSet)
 EnvironmentImpl::EnvironmentImpl(EnvironmentConfig^ envConfig) : m_errpfx(0)//, bufferSize(1048), maxDbEntryReuse(5)
 {
 	int ret = 0;
+	GroupCommit ^groupCommit = envConfig->GroupCommit != nullptr ? envConfig->GroupCommit : gcnew GroupCommit();
+	m_groupCommitter = gcnew GroupCommitter(this, groupCommit->MaxWait, groupCommit->MaxOperations);
 	try
 	{		
 		m_log = gcnew MySpace::Logging::LogWrapper();
@@ -178,6 +181,8 @@ EnvironmentImpl::EnvironmentImpl(EnvironmentConfig^ envConfig) : m_errpfx(0)//,
 EnvironmentImpl::EnvironmentImpl(String^ dbHome, EnvOpenFlags flags) : m_errpfx(0)//, bufferSize(1048), maxDbEntryReuse(5)
 {
 	int ret = 0;
+	GroupCommit ^groupCommit = gcnew GroupCommit();
+	m_groupCommitter = gcnew GroupCommitter(this, groupCommit->MaxWait, groupCommit->MaxOperations);
 	try
 	{
 		m_pEnv = new DbEnv(0);
@@ -646,6 +651,36 @@ int EnvironmentImpl::GetLastCheckpointLogNumber()
 	}
 }
 
+__int64 EnvironmentImpl::GetLastCheckpointLsn()
+{
+	int ret = 0;
+	__int64 lsn = 0;
+	DB_TXN_STAT *stat = NULL;
+	try
+	{
+		ret = m_pEnv->txn_stat(&stat, 0);
+		if (ret == 0) {
+			lsn = (static_cast<__int64>(stat->st_last_ckp.file) << 32) | stat->st_last_ckp.offset;
+		}
+	}
+	catch (const exception &ex)
+	{
+		throw BdbExceptionFactory::Create(ret, &ex, gcnew String(ex.what()));
+	}
+	finally {
+		if (stat != NULL) {
+			free_wrapper(stat);
+		}
+	}
+	switch(ret)
+	{
+		case DbRetVal::SUCCESS:
+			return lsn;
+		default:
+			throw BdbExceptionFactory::Create(ret, "BerkeleyDbWrappwer:Environment:GetLastCheckpointLsn: Unexpected error with ret value " + ret);
+	}
+}
+
 int EnvironmentImpl::GetCurrentLogNumber()
 {
 	int ret = 0;
@@ -823,6 +858,21 @@ void EnvironmentImpl::SetTimeout (int microseconds, TimeoutFlags flag)
 	}
 }
 
+AllocatorStatistics^ EnvironmentImpl::GetAllocatorStatistics()
+{
+	SlabStats stats;
+	slab_get_stats(&stats);
+	array<SizeClassStatistics^>^ sizeClasses = gcnew array<SizeClassStatistics^>(SLAB_CLASS_COUNT);
+	for (int i = 0; i < SLAB_CLASS_COUNT; ++i)
+	{
+		const SlabClassStats &cls = stats.classes[i];
+		sizeClasses[i] = gcnew SizeClassStatistics(static_cast<int>(cls.blockSize), cls.hits, cls.misses,
+			cls.blocksInUse, cls.blocksReserved, cls.bytesLive);
+	}
+	return gcnew AllocatorStatistics(stats.bytesLive, stats.slabBytes, stats.largeAllocations, stats.largeBytes,
+		sizeClasses);
+}
+
 void EnvironmentImpl::GetLockStatistics()
 {
 	DB_LOCK_STAT *pLockStat = 0;
@@ -1,6 +1,7 @@
 #pragma once
 #include "Stdafx.h"
 #include "ConvStr.h"
+#include "GroupCommitter.h"
 
 namespace BerkeleyDbWrapper
 {
@@ -34,6 +35,8 @@ namespace BerkeleyDbWrapper
 		virtual EnvFlags GetFlags() override;
 		virtual String^ GetHomeDirectory() override;
 		virtual int GetLastCheckpointLogNumber() override;
+		virtual __int64 GetLastCheckpointLsn() override;
+		virtual AllocatorStatistics^ GetAllocatorStatistics() override;
 		virtual void GetLockStatistics() override;
 		virtual String^ GetLogFileNameFromNumber(int logNumber) override;
 		virtual int GetMaxLockers() override;
@@ -72,6 +75,10 @@ namespace BerkeleyDbWrapper
 		{
 			DbEnv *get() { return m_pEnv; }
 		}
+		property GroupCommitter^ Committer
+		{
+			GroupCommitter^ get() { return m_groupCommitter; }
+		}
 		void RaiseMessageEvent(String ^message);
 		void RaisePanicEvent(String ^errorPrefix, String ^message);
 		static void SetUserCopy(ENV *env, bool doSet);		
@@ -80,6 +87,7 @@ namespace BerkeleyDbWrapper
 		DbEnv *m_pEnv;
 		ConvStr *m_errpfx;
 		LogWrapper^ m_log;
+		GroupCommitter^ m_groupCommitter;
 		bool GetVerbose(u_int32_t which);
 		void SetFlags (BerkeleyDbWrapper::EnvFlags flags, int onoff);
 		void SetVerbose(u_int32_t which, int onoff);
@@ -0,0 +1,145 @@
+#include "stdafx.h"
+#include "GroupCommitter.h"
+#include "EnvironmentImpl.h"
+#include "BdbExceptionFactory.h"
+
+using namespace System;
+using namespace System::Diagnostics;
+using namespace System::Threading;
+using namespace BerkeleyDbWrapper;
+
+GroupCommitter::GroupCommitter(EnvironmentImpl ^environment, int maxWaitMilliseconds, int maxOperations) :
+	m_environment(environment), m_flush(gcnew Action(environment, &EnvironmentImpl::FlushLogsToDisk)),
+	m_lock(gcnew Object()),
+	m_maxWait(maxWaitMilliseconds > 0 ? maxWaitMilliseconds : 0),
+	m_maxOperations(maxOperations > 1 ? maxOperations : 1),
+	m_openGroup(gcnew FlushGroup())
+{
+}
+
+GroupCommitter::GroupCommitter(Action ^flush, int maxWaitMilliseconds, int maxOperations) :
+	m_environment(nullptr), m_flush(flush), m_lock(gcnew Object()),
+	m_maxWait(maxWaitMilliseconds > 0 ? maxWaitMilliseconds : 0),
+	m_maxOperations(maxOperations > 1 ? maxOperations : 1),
+	m_openGroup(gcnew FlushGroup())
+{
+}
+
+void GroupCommitter::Join()
+{
+	__int64 started = Stopwatch::GetTimestamp();
+	int groupSize = 0;
+	Monitor::Enter(m_lock);
+	try
+	{
+		FlushGroup ^group = m_openGroup;
+		int position = ++group->Count;
+		if (position == 1)
+		{
+			groupSize = Lead(group, started);
+		}
+		else
+		{
+			Follow(group, position);
+		}
+	}
+	finally
+	{
+		Monitor::Exit(m_lock);
+	}
+	Count(groupSize, started);
+}
+
+// Called with m_lock held; returns with it held.
+int GroupCommitter::Lead(FlushGroup ^group, __int64 started)
+{
+	__int64 deadline = started + m_maxWait * Stopwatch::Frequency / 1000;
+	while (group->Count < m_maxOperations)
+	{
+		__int64 remaining = (deadline - Stopwatch::GetTimestamp()) * 1000 / Stopwatch::Frequency;
+		if (remaining <= 0)
+		{
+			break;
+		}
+		Monitor::Wait(m_lock, static_cast<int>(remaining));
+	}
+	int groupSize = group->Count;
+	m_openGroup = gcnew FlushGroup();
+
+	// flush outside the lock so the next group can gather in the meantime
+	BdbException ^failure = nullptr;
+	Monitor::Exit(m_lock);
+	try
+	{
+		m_flush();
+	}
+	catch (BdbException ^ex)
+	{
+		failure = ex;
+	}
+	catch (Exception ^ex)
+	{
+		// the members must still be released, so every failure is recorded against the group
+		failure = BdbExceptionFactory::Create(0, "BerkeleyDbWrapper:GroupCommitter:Join: " + ex->Message);
+	}
+	finally
+	{
+		Monitor::Enter(m_lock);
+	}
+
+	// flushes of consecutive groups can overlap, so the result is only ever the group's own
+	group->Failure = failure;
+	group->Flushed = true;
+	Monitor::PulseAll(m_lock);
+	if (failure != nullptr)
+	{
+		throw failure;
+	}
+	return groupSize;
+}
+
+// Called with m_lock held; returns with it held.
+void GroupCommitter::Follow(FlushGroup ^group, int position)
+{
+	if (position >= m_maxOperations)
+	{
+		// the group is full, wake the leader
+		Monitor::PulseAll(m_lock);
+	}
+	while (!group->Flushed)
+	{
+		Monitor::Wait(m_lock);
+	}
+	if (group->Failure != nullptr)
+	{
+		throw BdbExceptionFactory::Create(group->Failure->Code,
+			"BerkeleyDbWrapper:GroupCommitter:Join: Group log flush failed - " + group->Failure->Message);
+	}
+}
+
+void GroupCommitter::Count(int groupSize, __int64 started)
+{
+	if (m_environment == nullptr)
+	{
+		return;
+	}
+	if (groupSize > 0)
+	{
+		if (m_environment->GroupCommitSize != nullptr)
+		{
+			m_environment->GroupCommitSize->IncrementBy(groupSize);
+		}
+		if (m_environment->GroupCommitSizeBase != nullptr)
+		{
+			m_environment->GroupCommitSizeBase->Increment();
+		}
+	}
+	if (m_environment->GroupCommitWaitTime != nullptr)
+	{
+		m_environment->GroupCommitWaitTime->IncrementBy(Stopwatch::GetTimestamp() - started);
+	}
+	if (m_environment->GroupCommitWaitTimeBase != nullptr)
+	{
+		m_environment->GroupCommitWaitTimeBase->Increment();
+	}
+}
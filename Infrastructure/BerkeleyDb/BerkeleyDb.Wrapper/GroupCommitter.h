@@ -0,0 +1,48 @@
+#pragma once
+#include "Stdafx.h"
+
+namespace BerkeleyDbWrapper
+{
+	using namespace System;
+
+	ref class EnvironmentImpl;
+
+	// Lets concurrent commits on one environment share a single log flush. Each
+	// transaction is committed with DB_TXN_NOSYNC and its thread then joins the open
+	// group. The first thread to join leads the group: it holds the window open until
+	// maxOperations have joined or maxWaitMilliseconds have passed, flushes the log
+	// once, and releases every member of the group.
+	ref class GroupCommitter sealed
+	{
+	public:
+		GroupCommitter(EnvironmentImpl ^environment, int maxWaitMilliseconds, int maxOperations);
+
+		// Flushes with flush in place of an environment, which leaves the group commit
+		// counters unset; for tests.
+		GroupCommitter(Action ^flush, int maxWaitMilliseconds, int maxOperations);
+
+		// Blocks until every commit made before the call is durable.
+		void Join();
+
+	private:
+		// One generation of commits sharing a flush. Members keep a reference to their
+		// own generation, so each sees the result of the flush that covered its commit.
+		ref class FlushGroup sealed
+		{
+		public:
+			int Count;
+			bool Flushed;
+			BdbException ^Failure;
+		};
+
+		EnvironmentImpl ^m_environment;
+		Action ^m_flush;
+		Object ^m_lock;
+		const int m_maxWait;
+		const int m_maxOperations;
+		FlushGroup ^m_openGroup;
+		int Lead(FlushGroup ^group, __int64 started);
+		void Follow(FlushGroup ^group, int position);
+		void Count(int groupSize, __int64 started);
+	};
+}
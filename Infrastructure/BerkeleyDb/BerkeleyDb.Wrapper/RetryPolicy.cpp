@@ -0,0 +1,124 @@
+#include "stdafx.h"
+#include "RetryPolicy.h"
+
+#pragma managed(push, off)
+
+namespace
+{
+	// Delays under this many microseconds are spun out with yields rather than slept, since
+	// Sleep can't wait less than a scheduler quantum.
+	const int MinSleepMicroseconds = 1000;
+
+	__int64 Frequency()
+	{
+		static __int64 frequency = 0;
+		if (frequency == 0)
+		{
+			LARGE_INTEGER value;
+			QueryPerformanceFrequency(&value);
+			frequency = value.QuadPart;
+		}
+		return frequency;
+	}
+
+	// splitmix64 finalizer over the thread id and clock; good enough to decorrelate
+	// threads without keeping generator state anywhere
+	unsigned __int64 Random()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		unsigned __int64 z = static_cast<unsigned __int64>(counter.QuadPart) ^
+			(static_cast<unsigned __int64>(GetCurrentThreadId()) << 32);
+		z += 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+}
+
+RetryPolicy::RetryPolicy(int baseDelayMicroseconds, int maxDelayMicroseconds, bool jitter,
+	int retryLockTimeoutMicroseconds) :
+	m_baseDelay(baseDelayMicroseconds > 0 ? baseDelayMicroseconds : 0),
+	m_maxDelay(maxDelayMicroseconds > baseDelayMicroseconds ? maxDelayMicroseconds : baseDelayMicroseconds),
+	m_jitter(jitter),
+	m_retryLockTimeout(retryLockTimeoutMicroseconds > 0 ? retryLockTimeoutMicroseconds : 0)
+{
+}
+
+void RetryPolicy::Backoff(int retry) const
+{
+	if (m_baseDelay == 0 || retry < 1)
+	{
+		return;
+	}
+	__int64 limit = m_baseDelay;
+	for (int n = 1; n < retry && limit < m_maxDelay; ++n)
+	{
+		limit <<= 1;
+	}
+	if (limit > m_maxDelay)
+	{
+		limit = m_maxDelay;
+	}
+	__int64 delay = m_jitter ? static_cast<__int64>(Random() % static_cast<unsigned __int64>(limit + 1)) : limit;
+	if (delay >= MinSleepMicroseconds)
+	{
+		Sleep(static_cast<DWORD>(delay / 1000));
+		return;
+	}
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	__int64 deadline = now.QuadPart + delay * Frequency() / 1000000;
+	do
+	{
+		SwitchToThread();
+		QueryPerformanceCounter(&now);
+	} while (now.QuadPart < deadline);
+}
+
+ContentionCounters::ContentionCounters()
+{
+	memset(m_stripes, 0, sizeof(m_stripes));
+}
+
+ContentionCounters::Stripe &ContentionCounters::Current()
+{
+	// thread ids are multiples of 4
+	return m_stripes[(GetCurrentThreadId() >> 2) % StripeCount];
+}
+
+void ContentionCounters::Deadlock()
+{
+	InterlockedIncrement64(&Current().deadlocks);
+}
+
+void ContentionCounters::Retry()
+{
+	InterlockedIncrement64(&Current().retries);
+}
+
+void ContentionCounters::Exhausted()
+{
+	InterlockedIncrement64(&Current().exhausted);
+}
+
+void ContentionCounters::RetryTime(__int64 ticks)
+{
+	InterlockedExchangeAdd64(&Current().retryTicks, ticks);
+}
+
+void ContentionCounters::Read(ContentionTotals *totals) const
+{
+	memset(totals, 0, sizeof(ContentionTotals));
+	for (int n = 0; n < StripeCount; ++n)
+	{
+		// interlocked reads so a 32 bit process never sees a torn count
+		Stripe &stripe = const_cast<Stripe &>(m_stripes[n]);
+		totals->deadlocks += InterlockedCompareExchange64(&stripe.deadlocks, 0, 0);
+		totals->retries += InterlockedCompareExchange64(&stripe.retries, 0, 0);
+		totals->exhausted += InterlockedCompareExchange64(&stripe.exhausted, 0, 0);
+		totals->retryTicks += InterlockedCompareExchange64(&stripe.retryTicks, 0, 0);
+	}
+}
+
+#pragma managed(pop)
@@ -0,0 +1,67 @@
+#pragma once
+
+// Deadlock retry support for DatabaseImpl and CursorImpl. Both are native and free of
+// allocation so the retry path adds no managed transitions or heap traffic to a contended
+// operation. Only DatabaseImpl backs off, after rolling back; a cursor retries inside its
+// caller's transaction, which keeps its locks.
+
+struct ContentionTotals
+{
+	__int64 deadlocks;		// operations chosen as deadlock victims
+	__int64 retries;		// retries made after deadlocks
+	__int64 exhausted;		// operations that gave up after their last retry
+	__int64 retryTicks;		// QueryPerformanceCounter ticks from first deadlock to completion
+};
+
+// Waits between retries: retry n waits up to baseDelay * 2^(n-1) microseconds, capped at
+// maxDelay, drawn at random below that limit when jitter is set so the victims of one
+// deadlock don't collide again on their retries.
+class RetryPolicy
+{
+public:
+	RetryPolicy(int baseDelayMicroseconds, int maxDelayMicroseconds, bool jitter,
+		int retryLockTimeoutMicroseconds);
+
+	void Backoff(int retry) const;
+
+	// The lock timeout to give a retried transaction, or 0 to keep the environment's.
+	unsigned int RetryLockTimeout() const { return m_retryLockTimeout; }
+
+private:
+	const int m_baseDelay;
+	const int m_maxDelay;
+	const bool m_jitter;
+	const unsigned int m_retryLockTimeout;
+};
+
+// Contention counters written by many threads and read rarely. Writers are spread over
+// cache line sized stripes chosen by thread, so concurrent threads rarely touch the same
+// line; a read sums the stripes.
+class ContentionCounters
+{
+public:
+	ContentionCounters();
+
+	void Deadlock();
+	void Retry();
+	void Exhausted();
+	void RetryTime(__int64 ticks);
+	void Read(ContentionTotals *totals) const;
+
+private:
+	static const int StripeCount = 32;
+	struct Stripe
+	{
+		volatile __int64 deadlocks;
+		volatile __int64 retries;
+		volatile __int64 exhausted;
+		volatile __int64 retryTicks;
+		char pad[64 - 4 * sizeof(__int64)];
+	};
+	Stripe m_stripes[StripeCount];
+	Stripe &Current();
+
+	// to prevent copying
+	ContentionCounters(const ContentionCounters &counters);
+	ContentionCounters& operator =(const ContentionCounters &counters);
+};
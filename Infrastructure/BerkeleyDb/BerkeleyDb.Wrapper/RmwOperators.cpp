@@ -0,0 +1,246 @@
+#include "stdafx.h"
+#include "RmwOperators.h"
+#include "Alloc.h"
+
+#pragma managed(push, off)
+
+namespace
+{
+	int Insert(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, Dbt *value, bool cdb)
+	{
+		if (cdb)
+		{
+			return cur->put(key, value, DB_KEYFIRST);
+		}
+		// the read of a missing record retains no lock, so another writer may have added it
+		// since; DB_KEYEXIST sends the caller back to read it again
+		return db->put(txn, key, value, DB_NOOVERWRITE);
+	}
+
+	// Writes a whole record made of the operand's initial data, zeros up to tailOffset and then
+	// the tail, over the cursor's record if found, else as a new one.
+	int Replace(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, const RmwOperand *operand, bool found, bool cdb,
+		const void *tail, u_int32_t tailSize, u_int32_t tailOffset)
+	{
+		u_int32_t size = tailOffset + tailSize;
+		char *record = static_cast<char *>(malloc_wrapper(size));
+		if (record == NULL)
+		{
+			return ENOMEM;
+		}
+		int ret;
+		try
+		{
+			memset(record, 0, size);
+			if (operand->initialSize > 0)
+			{
+				memcpy(record, operand->initialData, operand->initialSize);
+			}
+			memcpy(record + tailOffset, tail, tailSize);
+			Dbt value(record, size);
+			ret = found ? cur->put(NULL, &value, DB_CURRENT) : Insert(db, txn, cur, key, &value, cdb);
+		}
+		catch (...)
+		{
+			free_wrapper(record);
+			throw;
+		}
+		free_wrapper(record);
+		return ret;
+	}
+
+	int ReadResult(int ret, bool *found)
+	{
+		switch (ret)
+		{
+		case 0:
+			*found = true;
+			return 0;
+		case DB_NOTFOUND:
+		case DB_KEYEMPTY:
+			*found = false;
+			return 0;
+		default:
+			return ret;
+		}
+	}
+
+	// Whether the cursor's record is at least size bytes long.
+	int Holds(Dbc *cur, u_int32_t size, bool *holds)
+	{
+		if (size == 0)
+		{
+			*holds = true;
+			return 0;
+		}
+		char last;
+		Dbt probe(&last, sizeof(last));
+		probe.set_ulen(sizeof(last));
+		probe.set_doff(size - 1);
+		probe.set_dlen(sizeof(last));
+		probe.set_flags(DB_DBT_USERMEM | DB_DBT_PARTIAL);
+		Dbt key;
+		int ret = cur->get(&key, &probe, DB_CURRENT);
+		*holds = (ret == 0 && probe.get_size() == sizeof(last));
+		return ret;
+	}
+
+	int Increment(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, RmwOperand *operand, bool cdb)
+	{
+		// only the counter is read, and only the counter is written back
+		__int32 value = 0;
+		Dbt stored(&value, sizeof(value));
+		stored.set_ulen(sizeof(value));
+		stored.set_doff(operand->offset);
+		stored.set_dlen(sizeof(value));
+		stored.set_flags(DB_DBT_USERMEM | DB_DBT_PARTIAL);
+		bool found;
+		int ret = ReadResult(cur->get(key, &stored, DB_SET | DB_RMW), &found);
+		if (ret != 0) return ret;
+
+		u_int32_t present = found ? stored.get_size() : 0;
+		bool valid = found;
+		if (found && present < sizeof(value))
+		{
+			// the record ends before the counter; it is only extended if it holds the initial data
+			ret = Holds(cur, operand->initialSize, &valid);
+			if (ret != 0) return ret;
+		}
+		if (!valid)
+		{
+			value = 0;
+		}
+
+		__int64 sum = static_cast<__int64>(value) + operand->incrementBy;
+		if (sum < operand->minimum) sum = operand->minimum;
+		if (sum > operand->maximum) sum = operand->maximum;
+		operand->counter = static_cast<int>(sum);
+
+		if (valid)
+		{
+			// a partial put past the end of the record pads it with zeros
+			Dbt update(&operand->counter, sizeof(operand->counter));
+			update.set_doff(operand->offset);
+			update.set_dlen(present);
+			update.set_flags(DB_DBT_PARTIAL);
+			ret = cur->put(NULL, &update, DB_CURRENT);
+		}
+		else
+		{
+			ret = Replace(db, txn, cur, key, operand, found, cdb, &operand->counter, sizeof(operand->counter),
+				operand->offset);
+		}
+		operand->applied = (ret == 0);
+		return ret;
+	}
+
+	int CompareAndSet(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, RmwOperand *operand, bool cdb)
+	{
+		__int64 ticks;
+		memcpy(&ticks, static_cast<char *>(operand->get_data()) + operand->offset, sizeof(ticks));
+		__int64 storedTicks = 0;
+		Dbt stored(&storedTicks, sizeof(storedTicks));
+		stored.set_ulen(sizeof(storedTicks));
+		stored.set_doff(operand->offset);
+		stored.set_dlen(sizeof(storedTicks));
+		stored.set_flags(DB_DBT_USERMEM | DB_DBT_PARTIAL);
+		bool found;
+		int ret = ReadResult(cur->get(key, &stored, DB_SET | DB_RMW), &found);
+		if (ret != 0) return ret;
+
+		if (found && stored.get_size() == sizeof(storedTicks) && storedTicks >= ticks)
+		{
+			operand->applied = false;
+			operand->storedTicks = storedTicks;
+			return 0;
+		}
+		Dbt value(operand->get_data(), operand->get_size());
+		ret = found ? cur->put(NULL, &value, DB_CURRENT) : Insert(db, txn, cur, key, &value, cdb);
+		operand->applied = (ret == 0);
+		return ret;
+	}
+
+	int Append(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, RmwOperand *operand, bool cdb)
+	{
+		Dbt stored;
+		stored.set_flags(DB_DBT_MALLOC);
+		bool found;
+		int ret = ReadResult(cur->get(key, &stored, DB_SET | DB_RMW), &found);
+		if (stored.get_data() != NULL)
+		{
+			free_wrapper(stored.get_data());
+		}
+		if (ret != 0) return ret;
+
+		if (found)
+		{
+			u_int32_t size = stored.get_size();
+			Dbt tail(operand->get_data(), operand->get_size());
+			tail.set_doff(size);
+			tail.set_dlen(0);
+			tail.set_flags(DB_DBT_PARTIAL);
+			ret = cur->put(NULL, &tail, DB_CURRENT);
+			operand->length = size + operand->get_size();
+		}
+		else
+		{
+			ret = Replace(db, txn, cur, key, operand, false, cdb, operand->get_data(), operand->get_size(),
+				operand->initialSize);
+			operand->length = operand->initialSize + operand->get_size();
+		}
+		operand->applied = (ret == 0);
+		return ret;
+	}
+
+	int Apply(Db *db, DbTxn *txn, Dbc *cur, Dbt *key, RmwOperand *operand, bool cdb)
+	{
+		int ret;
+		do
+		{
+			switch (operand->kind)
+			{
+			case RmwIncrement:
+				ret = Increment(db, txn, cur, key, operand, cdb);
+				break;
+			case RmwCompareAndSet:
+				ret = CompareAndSet(db, txn, cur, key, operand, cdb);
+				break;
+			case RmwAppend:
+				ret = Append(db, txn, cur, key, operand, cdb);
+				break;
+			default:
+				return EINVAL;
+			}
+		} while (ret == DB_KEYEXIST);
+		return ret;
+	}
+}
+
+int rmw_core(Db *db, DbTxn *txn, Dbt *key, Dbt *data, int options)
+{
+	RmwOperand *operand = static_cast<RmwOperand *>(data);
+	operand->applied = false;
+	Dbc *cur = NULL;
+	int ret = db->cursor(txn, &cur, options);
+	if (ret != 0) return ret;
+	try
+	{
+		ret = Apply(db, txn, cur, key, operand, (options & DB_WRITECURSOR) != 0);
+	}
+	catch (...)
+	{
+		try
+		{
+			cur->close();
+		}
+		catch (...)
+		{
+		}
+		throw;
+	}
+	// the cursor has to be closed before the transaction ends either way
+	int closeRet = cur->close();
+	return ret != 0 ? ret : closeRet;
+}
+
+#pragma managed(pop)
@@ -0,0 +1,38 @@
+#pragma once
+
+// Read-modify-write operators run by DatabaseImpl in native code. Each reads the record through
+// a write cursor, which keeps the record's write lock until the change is written, and edits it
+// without calling back into managed code. The operands ride in the data Dbt so the operators fit
+// DatabaseImpl's BdbCall signature and share its deadlock retry.
+
+enum RmwKind
+{
+	RmwIncrement,
+	RmwCompareAndSet,
+	RmwAppend
+};
+
+// data and size are the value written by compare and set, or appended by append.
+struct RmwOperand : public Dbt
+{
+	RmwOperand(RmwKind kind) : Dbt(), kind(kind), initialData(NULL), initialSize(0), offset(0),
+		incrementBy(0), minimum(0), maximum(0), applied(false), counter(0), storedTicks(0), length(0)
+	{
+	}
+
+	RmwKind kind;
+	const void *initialData;	// what a missing record starts as
+	u_int32_t initialSize;
+	u_int32_t offset;			// of the counter, or of the timestamp compared
+	int incrementBy;
+	int minimum;
+	int maximum;
+
+	bool applied;				// whether the record was changed
+	int counter;				// counter value after an increment
+	__int64 storedTicks;		// stored timestamp that refused a compare and set
+	u_int32_t length;			// record length after an append
+};
+
+// BdbCall for the operators; data must be an RmwOperand and options the cursor flags.
+int rmw_core(Db *db, DbTxn *txn, Dbt *key, Dbt *data, int options);
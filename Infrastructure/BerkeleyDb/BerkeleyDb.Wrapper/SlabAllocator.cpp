@@ -0,0 +1,490 @@
+#include "stdafx.h"
+#include "SlabAllocator.h"
+
+// Berkeley Db calls these through function pointers from native code, so keep them native
+// to avoid a managed transition on every allocation.
+#pragma managed(push, off)
+
+namespace
+{
+	// Slabs come straight from VirtualAlloc, so each starts on an allocation granularity
+	// (64K) boundary and every 64K chunk of the address space belongs to at most one slab.
+	const size_t SlabBytes = 256 * 1024;
+	const int ChunkShift = 16;
+	const int LeafBits = 16;
+#ifdef _WIN64
+	const int AddressBits = 48;
+#else
+	const int AddressBits = 32;
+#endif
+	const size_t RootSize = static_cast<size_t>(1) << (AddressBits - ChunkShift - LeafBits);
+	const size_t LeafSize = static_cast<size_t>(1) << LeafBits;
+	const size_t BatchBytes = 16 * 1024;
+	const int MinBatch = 4;
+	const int MaxBatch = 64;
+	// empty slabs kept per class so a class hovering at a slab boundary doesn't thrash
+	const int RetainedEmptySlabs = 1;
+
+	// Precedes every small block handed out. The link is only used while the block is free.
+	struct BlockHeader
+	{
+		unsigned __int32 size;	// requested size
+		unsigned __int32 reserved;
+		union
+		{
+			BlockHeader *next;
+			unsigned __int64 align;
+		};
+	};
+
+	// Sits at the start of the slab's own memory.
+	struct Slab
+	{
+		Slab *prev;
+		Slab *next;
+		BlockHeader *free;
+		int freeCount;
+		int capacity;
+		int cls;
+	};
+
+	const size_t SlabHeaderBytes = (sizeof(Slab) + 15) & ~static_cast<size_t>(15);
+
+	struct ClassCounters
+	{
+		__int64 hits;
+		__int64 misses;
+		__int64 allocs;
+		__int64 frees;
+		__int64 bytesLive;
+	};
+
+	struct ThreadCache
+	{
+		BlockHeader *free[SLAB_CLASS_COUNT];
+		int count[SLAB_CLASS_COUNT];
+		ClassCounters counters[SLAB_CLASS_COUNT];
+		__int64 largeAllocs;
+		__int64 largeFrees;
+		__int64 largeBytes;
+		ThreadCache *prev;
+		ThreadCache *next;
+	};
+
+	struct Depot
+	{
+		CRITICAL_SECTION lock;
+		Slab *partial;		// slabs with at least one free block
+		int slabCount;
+		int emptySlabs;
+	};
+
+	const size_t ClassSizes[SLAB_CLASS_COUNT] =
+	{
+		16, 32, 48, 64, 80, 96, 112, 128,
+		160, 192, 224, 256, 320, 384, 448, 512,
+		640, 768, 896, 1024, 1536, 2048, 3072, 4096,
+		6144, 8192, 12288, SLAB_MAX_BLOCK
+	};
+
+	// class index by (size + 15) / 16 for sizes up to SLAB_MAX_BLOCK
+	unsigned char g_classBySize[SLAB_MAX_BLOCK / 16 + 1];
+	int g_batch[SLAB_CLASS_COUNT];
+	int g_capacity[SLAB_CLASS_COUNT];
+	Depot g_depots[SLAB_CLASS_COUNT];
+	volatile LONG g_initState = 0;
+	DWORD g_flsIndex = FLS_OUT_OF_INDEXES;
+
+	// Owning slab of every 64K chunk, as a two level radix map over the address space. A
+	// pointer is only ever treated as ours if it lands in a chunk mapped here; leaves are
+	// created under g_mapLock and never freed, so lookups need no lock.
+	Slab * volatile * volatile g_slabMap[RootSize];
+	CRITICAL_SECTION g_mapLock;
+
+	// live caches, plus the folded-in counters of caches whose threads have exited
+	CRITICAL_SECTION g_cacheListLock;
+	ThreadCache *g_caches = NULL;
+	ThreadCache g_retired;
+
+	void FlushCache(ThreadCache *cache);
+
+	void __stdcall ReleaseCache(void *data)
+	{
+		ThreadCache *cache = static_cast<ThreadCache *>(data);
+		if (cache == NULL) return;
+		FlushCache(cache);
+		EnterCriticalSection(&g_cacheListLock);
+		for (int i = 0; i < SLAB_CLASS_COUNT; ++i)
+		{
+			g_retired.counters[i].hits += cache->counters[i].hits;
+			g_retired.counters[i].misses += cache->counters[i].misses;
+			g_retired.counters[i].allocs += cache->counters[i].allocs;
+			g_retired.counters[i].frees += cache->counters[i].frees;
+			g_retired.counters[i].bytesLive += cache->counters[i].bytesLive;
+		}
+		g_retired.largeAllocs += cache->largeAllocs;
+		g_retired.largeFrees += cache->largeFrees;
+		g_retired.largeBytes += cache->largeBytes;
+		if (cache->prev != NULL) cache->prev->next = cache->next;
+		else g_caches = cache->next;
+		if (cache->next != NULL) cache->next->prev = cache->prev;
+		LeaveCriticalSection(&g_cacheListLock);
+		free(cache);
+	}
+
+	void Initialize()
+	{
+		if (g_initState == 2) return;
+		if (InterlockedCompareExchange(&g_initState, 1, 0) == 0)
+		{
+			int cls = 0;
+			for (size_t units = 0; units <= SLAB_MAX_BLOCK / 16; ++units)
+			{
+				while (ClassSizes[cls] < units * 16) ++cls;
+				g_classBySize[units] = static_cast<unsigned char>(cls);
+			}
+			for (int i = 0; i < SLAB_CLASS_COUNT; ++i)
+			{
+				int batch = static_cast<int>(BatchBytes / ClassSizes[i]);
+				g_batch[i] = batch < MinBatch ? MinBatch : (batch > MaxBatch ? MaxBatch : batch);
+				g_capacity[i] = static_cast<int>((SlabBytes - SlabHeaderBytes) / (sizeof(BlockHeader) + ClassSizes[i]));
+				InitializeCriticalSectionAndSpinCount(&g_depots[i].lock, 4000);
+			}
+			InitializeCriticalSectionAndSpinCount(&g_mapLock, 4000);
+			InitializeCriticalSectionAndSpinCount(&g_cacheListLock, 4000);
+			g_flsIndex = FlsAlloc(&ReleaseCache);
+			InterlockedExchange(&g_initState, 2);
+		}
+		else
+		{
+			while (g_initState != 2) Sleep(0);
+		}
+	}
+
+	ThreadCache *GetCache()
+	{
+		Initialize();
+		ThreadCache *cache = static_cast<ThreadCache *>(FlsGetValue(g_flsIndex));
+		if (cache == NULL)
+		{
+			cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+			if (cache == NULL) return NULL;
+			EnterCriticalSection(&g_cacheListLock);
+			cache->next = g_caches;
+			if (g_caches != NULL) g_caches->prev = cache;
+			g_caches = cache;
+			LeaveCriticalSection(&g_cacheListLock);
+			FlsSetValue(g_flsIndex, cache);
+		}
+		return cache;
+	}
+
+	// Returns the slab p was handed out from, or NULL if p isn't ours.
+	inline Slab *SlabOf(const void *p)
+	{
+		size_t key = reinterpret_cast<size_t>(p) >> ChunkShift;
+		size_t root = key >> LeafBits;
+		if (root >= RootSize) return NULL;
+		Slab * volatile *leaf = g_slabMap[root];
+		if (leaf == NULL) return NULL;
+		return leaf[key & (LeafSize - 1)];
+	}
+
+	// Points every chunk of the slab at owner, or at NULL to forget it.
+	bool MapSlab(Slab *slab, Slab *owner)
+	{
+		size_t first = reinterpret_cast<size_t>(slab) >> ChunkShift;
+		size_t last = (reinterpret_cast<size_t>(slab) + SlabBytes - 1) >> ChunkShift;
+		bool mapped = true;
+		EnterCriticalSection(&g_mapLock);
+		for (size_t key = first; key <= last; ++key)
+		{
+			Slab * volatile *leaf = g_slabMap[key >> LeafBits];
+			if (leaf == NULL)
+			{
+				if (owner == NULL) continue;
+				leaf = static_cast<Slab * volatile *>(VirtualAlloc(NULL, LeafSize * sizeof(Slab *),
+					MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+				if (leaf == NULL)
+				{
+					mapped = false;
+					break;
+				}
+				g_slabMap[key >> LeafBits] = leaf;
+			}
+			leaf[key & (LeafSize - 1)] = owner;
+		}
+		LeaveCriticalSection(&g_mapLock);
+		return mapped;
+	}
+
+	inline BlockHeader *HeaderOf(void *p)
+	{
+		return static_cast<BlockHeader *>(p) - 1;
+	}
+
+	void LinkSlab(Depot &depot, Slab *slab)
+	{
+		slab->prev = NULL;
+		slab->next = depot.partial;
+		if (depot.partial != NULL) depot.partial->prev = slab;
+		depot.partial = slab;
+	}
+
+	void UnlinkSlab(Depot &depot, Slab *slab)
+	{
+		if (slab->prev != NULL) slab->prev->next = slab->next;
+		else depot.partial = slab->next;
+		if (slab->next != NULL) slab->next->prev = slab->prev;
+	}
+
+	// Carves a new slab into blocks and adds it to the depot. Called with the depot locked.
+	bool Grow(int cls)
+	{
+		char *memory = static_cast<char *>(VirtualAlloc(NULL, SlabBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+		if (memory == NULL) return false;
+		Slab *slab = reinterpret_cast<Slab *>(memory);
+		if (!MapSlab(slab, slab))
+		{
+			MapSlab(slab, NULL);
+			VirtualFree(memory, 0, MEM_RELEASE);
+			return false;
+		}
+		size_t stride = sizeof(BlockHeader) + ClassSizes[cls];
+		slab->cls = cls;
+		slab->capacity = g_capacity[cls];
+		slab->freeCount = slab->capacity;
+		slab->free = NULL;
+		for (int i = slab->capacity - 1; i >= 0; --i)
+		{
+			BlockHeader *block = reinterpret_cast<BlockHeader *>(memory + SlabHeaderBytes + i * stride);
+			block->next = slab->free;
+			slab->free = block;
+		}
+		Depot &depot = g_depots[cls];
+		LinkSlab(depot, slab);
+		++depot.slabCount;
+		++depot.emptySlabs;
+		return true;
+	}
+
+	// Gives an empty slab back to the system. Called with the depot locked.
+	void ReleaseSlab(Depot &depot, Slab *slab)
+	{
+		UnlinkSlab(depot, slab);
+		--depot.slabCount;
+		MapSlab(slab, NULL);
+		VirtualFree(slab, 0, MEM_RELEASE);
+	}
+
+	// Returns a block to its slab. Called with the depot locked.
+	void PutBlock(Depot &depot, Slab *slab, BlockHeader *block)
+	{
+		block->next = slab->free;
+		slab->free = block;
+		if (slab->freeCount++ == 0) LinkSlab(depot, slab);
+		if (slab->freeCount == slab->capacity)
+		{
+			if (depot.emptySlabs >= RetainedEmptySlabs) ReleaseSlab(depot, slab);
+			else ++depot.emptySlabs;
+		}
+	}
+
+	bool Refill(ThreadCache *cache, int cls)
+	{
+		Depot &depot = g_depots[cls];
+		EnterCriticalSection(&depot.lock);
+		for (int i = 0; i < g_batch[cls]; ++i)
+		{
+			if (depot.partial == NULL && !Grow(cls)) break;
+			Slab *slab = depot.partial;
+			BlockHeader *block = slab->free;
+			slab->free = block->next;
+			if (slab->freeCount-- == slab->capacity) --depot.emptySlabs;
+			if (slab->freeCount == 0) UnlinkSlab(depot, slab);
+			block->next = cache->free[cls];
+			cache->free[cls] = block;
+			++cache->count[cls];
+		}
+		LeaveCriticalSection(&depot.lock);
+		return cache->free[cls] != NULL;
+	}
+
+	void Spill(ThreadCache *cache, int cls, int blocks)
+	{
+		Depot &depot = g_depots[cls];
+		EnterCriticalSection(&depot.lock);
+		for (int i = 0; i < blocks && cache->free[cls] != NULL; ++i)
+		{
+			BlockHeader *block = cache->free[cls];
+			cache->free[cls] = block->next;
+			--cache->count[cls];
+			PutBlock(depot, SlabOf(block), block);
+		}
+		LeaveCriticalSection(&depot.lock);
+	}
+
+	void FlushCache(ThreadCache *cache)
+	{
+		for (int cls = 0; cls < SLAB_CLASS_COUNT; ++cls)
+		{
+			if (cache->count[cls] > 0) Spill(cache, cls, cache->count[cls]);
+		}
+	}
+}
+
+void *slab_malloc(size_t size)
+{
+	if (size > SLAB_MAX_BLOCK)
+	{
+		ThreadCache *cache = GetCache();
+		void *p = malloc(size);
+		if (p == NULL) return NULL;
+		if (cache != NULL)
+		{
+			++cache->largeAllocs;
+			cache->largeBytes += _msize(p);
+		}
+		return p;
+	}
+
+	ThreadCache *cache = GetCache();
+	if (cache == NULL) return NULL;
+	int cls = g_classBySize[(size + 15) >> 4];
+	ClassCounters &counters = cache->counters[cls];
+	if (cache->free[cls] != NULL)
+	{
+		++counters.hits;
+	}
+	else
+	{
+		++counters.misses;
+		if (!Refill(cache, cls)) return NULL;
+	}
+	BlockHeader *block = cache->free[cls];
+	cache->free[cls] = block->next;
+	--cache->count[cls];
+	block->size = static_cast<unsigned __int32>(size);
+	++counters.allocs;
+	counters.bytesLive += size;
+	return block + 1;
+}
+
+void slab_free(void *p)
+{
+	if (p == NULL) return;
+	Slab *slab = SlabOf(p);
+	if (slab == NULL)
+	{
+		// a large block, or memory handed over by code that allocated it on the CRT heap
+		ThreadCache *cache = GetCache();
+		if (cache != NULL)
+		{
+			++cache->largeFrees;
+			cache->largeBytes -= _msize(p);
+		}
+		free(p);
+		return;
+	}
+
+	BlockHeader *block = HeaderOf(p);
+	int cls = slab->cls;
+	ThreadCache *cache = GetCache();
+	if (cache == NULL)
+	{
+		Depot &depot = g_depots[cls];
+		EnterCriticalSection(&depot.lock);
+		PutBlock(depot, slab, block);
+		LeaveCriticalSection(&depot.lock);
+		return;
+	}
+	ClassCounters &counters = cache->counters[cls];
+	++counters.frees;
+	counters.bytesLive -= block->size;
+	block->next = cache->free[cls];
+	cache->free[cls] = block;
+	if (++cache->count[cls] > g_batch[cls] * 2)
+	{
+		Spill(cache, cls, g_batch[cls]);
+	}
+}
+
+void *slab_realloc(void *p, size_t size)
+{
+	if (p == NULL) return slab_malloc(size);
+	if (size == 0)
+	{
+		slab_free(p);
+		return NULL;
+	}
+	Slab *slab = SlabOf(p);
+	if (slab == NULL)
+	{
+		// blocks from the CRT heap stay there whatever their new size
+		size_t oldSize = _msize(p);
+		void *grown = realloc(p, size);
+		if (grown == NULL) return NULL;
+		ThreadCache *cache = GetCache();
+		if (cache != NULL) cache->largeBytes += static_cast<__int64>(_msize(grown)) - static_cast<__int64>(oldSize);
+		return grown;
+	}
+
+	BlockHeader *block = HeaderOf(p);
+	int cls = slab->cls;
+	if (size <= ClassSizes[cls])
+	{
+		ThreadCache *cache = GetCache();
+		if (cache != NULL) cache->counters[cls].bytesLive += static_cast<__int64>(size) - block->size;
+		block->size = static_cast<unsigned __int32>(size);
+		return p;
+	}
+	void *moved = slab_malloc(size);
+	if (moved == NULL) return NULL;
+	memcpy(moved, p, block->size);
+	slab_free(p);
+	return moved;
+}
+
+void slab_get_stats(SlabStats *stats)
+{
+	Initialize();
+	memset(stats, 0, sizeof(SlabStats));
+	EnterCriticalSection(&g_cacheListLock);
+	ThreadCache totals = g_retired;
+	for (ThreadCache *cache = g_caches; cache != NULL; cache = cache->next)
+	{
+		for (int i = 0; i < SLAB_CLASS_COUNT; ++i)
+		{
+			totals.counters[i].hits += cache->counters[i].hits;
+			totals.counters[i].misses += cache->counters[i].misses;
+			totals.counters[i].allocs += cache->counters[i].allocs;
+			totals.counters[i].frees += cache->counters[i].frees;
+			totals.counters[i].bytesLive += cache->counters[i].bytesLive;
+		}
+		totals.largeAllocs += cache->largeAllocs;
+		totals.largeFrees += cache->largeFrees;
+		totals.largeBytes += cache->largeBytes;
+	}
+	LeaveCriticalSection(&g_cacheListLock);
+
+	for (int i = 0; i < SLAB_CLASS_COUNT; ++i)
+	{
+		SlabClassStats &cls = stats->classes[i];
+		cls.blockSize = ClassSizes[i];
+		cls.hits = totals.counters[i].hits;
+		cls.misses = totals.counters[i].misses;
+		cls.blocksInUse = totals.counters[i].allocs - totals.counters[i].frees;
+		cls.bytesLive = totals.counters[i].bytesLive;
+		EnterCriticalSection(&g_depots[i].lock);
+		__int64 slabs = g_depots[i].slabCount;
+		LeaveCriticalSection(&g_depots[i].lock);
+		cls.blocksReserved = slabs * g_capacity[i];
+		stats->bytesLive += cls.bytesLive;
+		stats->slabBytes += slabs * SlabBytes;
+	}
+	stats->largeAllocations = totals.largeAllocs - totals.largeFrees;
+	stats->largeBytes = totals.largeBytes;
+	stats->bytesLive += totals.largeBytes;
+}
+
+#pragma managed(pop)
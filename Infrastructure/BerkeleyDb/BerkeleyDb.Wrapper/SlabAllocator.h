@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+
+// Size-class slab allocator behind malloc_wrapper/realloc_wrapper/free_wrapper (see Alloc.h).
+// Blocks up to SLAB_MAX_BLOCK bytes are served from per-thread caches that refill from, and
+// spill to, a per-class depot of 256K slabs reserved with VirtualAlloc; larger blocks go
+// straight to the CRT heap. Which pointers are ours is decided by an address map over the
+// slabs, never by reading memory around the pointer, so anything else is passed to the CRT.
+// A slab whose blocks are all free goes back to the system once its class already holds an
+// empty one, so a steady read load stays off the heap without pinning a burst's peak.
+
+#define SLAB_CLASS_COUNT 28
+#define SLAB_MAX_BLOCK 16384
+
+struct SlabClassStats
+{
+	size_t blockSize;
+	__int64 hits;			// allocations served from a thread cache
+	__int64 misses;			// allocations that refilled the thread cache from the depot
+	__int64 blocksInUse;
+	__int64 blocksReserved;
+	__int64 bytesLive;		// requested bytes of the blocks in use
+};
+
+struct SlabStats
+{
+	__int64 bytesLive;		// requested bytes of all live allocations, small and large
+	__int64 slabBytes;		// bytes obtained from the heap for slabs
+	__int64 largeAllocations;
+	__int64 largeBytes;
+	SlabClassStats classes[SLAB_CLASS_COUNT];
+};
+
+void *slab_malloc(size_t size);
+void *slab_realloc(void *p, size_t size);
+void slab_free(void *p);
+void slab_get_stats(SlabStats *stats);
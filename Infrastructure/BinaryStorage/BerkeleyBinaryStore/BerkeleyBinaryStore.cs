@@ -38,7 +38,7 @@ namespace MySpace.BinaryStorage.Store
         {
             get
             {
-                return false;
+                return true;
             }
         }
 
@@ -85,14 +85,43 @@ namespace MySpace.BinaryStorage.Store
             return this.store.EntryExists((short) keySpace.Int32Value, key.PartitionId, key.Key);
         }
 
+        /// <summary>
+        /// Normal get as a stream over the entry in native memory
+        /// </summary>
+        /// <param name="keySpace">type id</param>
+        /// <param name="key">key</param>
+        /// <returns>stream that frees the entry's memory when closed</returns>
         public Stream Get(DataBuffer keySpace, StorageKey key)
         {
-            throw new NotSupportedException();
+            return GetStream(keySpace, key, GetOptions.Default);
         }
 
+        /// <summary>
+        /// Partial get as a stream over the entry in native memory
+        /// </summary>
+        /// <param name="keySpace">type id</param>
+        /// <param name="key">key</param>
+        /// <param name="offset">start offset</param>
+        /// <param name="length">read length</param>
+        /// <returns>stream that frees the entry's memory when closed</returns>
         public Stream Get(DataBuffer keySpace, StorageKey key, int offset, int length)
         {
-            throw new NotSupportedException();
+            if (offset < 0) throw new ArgumentOutOfRangeException("offset");
+            if (length < 1) throw new ArgumentOutOfRangeException("length");
+
+            return GetStream(keySpace, key, GetOptions.Partial(offset, length));
+        }
+
+        private Stream GetStream(DataBuffer keySpace, StorageKey key, GetOptions options)
+        {
+            // the stream holds its own reference to the view, so the entry stays
+            // readable after the view is disposed here
+            using (UnmanagedMemoryView view = this.store.GetEntryView((short)keySpace.Int32Value, key.PartitionId, key.Key, options))
+            {
+                IncrementGetPerfCounter(view == null ? 0 : view.Length);
+
+                return view == null ? null : view.CreateStream();
+            }
         }
 
         /// <summary>
@@ -0,0 +1,156 @@
+﻿using System;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.DataRelay.Client.Test
+{
+    /// <summary>
+    /// Tests which concurrent Gets <see cref="GetCoalescer"/> lets share one message, and what
+    /// each caller gets back.
+    /// </summary>
+    [TestClass]
+    public class GetCoalescerTests
+    {
+        private const int _waitMilliseconds = 5000;
+
+        private static RelayMessage CreateGet(short typeId, int id, byte[] extendedId)
+        {
+            return new RelayMessage(typeId, id, extendedId, MessageType.Get);
+        }
+
+        // Calls Send for message on another thread; the caller must already have joined its flight,
+        // so the thread waits rather than leads.
+        private static Thread StartWaiter(GetCoalescer coalescer, RelayMessage message, Action<RelayMessage> send,
+            RelayMessage[] reply)
+        {
+            var thread = new Thread(() => reply[0] = coalescer.Send(message, send));
+            thread.Start();
+            return thread;
+        }
+
+        private static void Join(Thread thread)
+        {
+            Assert.IsTrue(thread.Join(_waitMilliseconds), "The waiting Get never returned.");
+        }
+
+        [TestMethod]
+        public void LeaderSendsItsOwnMessage()
+        {
+            var coalescer = new GetCoalescer();
+            var message = CreateGet(1, 5, new byte[] { 5 });
+            var sends = 0;
+
+            var reply = coalescer.Send(message, m => ++sends);
+
+            Assert.AreSame(message, reply);
+            Assert.AreEqual(1, sends);
+        }
+
+        [TestMethod]
+        public void SameGetInFlightIsShared()
+        {
+            var coalescer = new GetCoalescer();
+            var leaderMessage = CreateGet(1, 5, new byte[] { 5 });
+            bool isLeader;
+            var flight = coalescer.Join(leaderMessage, out isLeader);
+            Assert.IsTrue(isLeader);
+
+            var sends = 0;
+            var reply = new RelayMessage[1];
+            var waiter = StartWaiter(coalescer, CreateGet(1, 5, new byte[] { 5 }), m => Interlocked.Increment(ref sends),
+                reply);
+            Assert.IsFalse(waiter.Join(50), "The waiting Get returned before its leader.");
+
+            coalescer.Complete(flight, true);
+            Join(waiter);
+
+            Assert.AreSame(leaderMessage, reply[0]);
+            Assert.AreEqual(0, sends);
+        }
+
+        [TestMethod]
+        public void FailedLeaderLetsWaitersSendTheirOwn()
+        {
+            var coalescer = new GetCoalescer();
+            bool isLeader;
+            var flight = coalescer.Join(CreateGet(1, 5, new byte[] { 5 }), out isLeader);
+
+            var waiterMessage = CreateGet(1, 5, new byte[] { 5 });
+            RelayMessage sent = null;
+            var reply = new RelayMessage[1];
+            var waiter = StartWaiter(coalescer, waiterMessage, m => sent = m, reply);
+
+            coalescer.Complete(flight, false);
+            Join(waiter);
+
+            Assert.AreSame(waiterMessage, sent);
+            Assert.AreSame(waiterMessage, reply[0]);
+        }
+
+        [TestMethod]
+        public void LeaderSendErrorEndsTheFlight()
+        {
+            var coalescer = new GetCoalescer();
+            var message = CreateGet(1, 5, new byte[] { 5 });
+
+            try
+            {
+                coalescer.Send(message, m => { throw new InvalidOperationException("Test send failure"); });
+                Assert.Fail("The send error was not thrown.");
+            }
+            catch (InvalidOperationException)
+            {
+            }
+
+            bool isLeader;
+            coalescer.Join(CreateGet(1, 5, new byte[] { 5 }), out isLeader);
+            Assert.IsTrue(isLeader);
+        }
+
+        [TestMethod]
+        public void CompletedGetIsNotShared()
+        {
+            var coalescer = new GetCoalescer();
+            var sends = 0;
+
+            coalescer.Send(CreateGet(1, 5, new byte[] { 5 }), m => ++sends);
+            var second = CreateGet(1, 5, new byte[] { 5 });
+            var reply = coalescer.Send(second, m => ++sends);
+
+            Assert.AreSame(second, reply);
+            Assert.AreEqual(2, sends);
+        }
+
+        [TestMethod]
+        public void OnlyIdenticalGetsJoin()
+        {
+            var coalescer = new GetCoalescer();
+            var freshness = new DateTime(2010, 1, 1);
+            var conditional = CreateGet(1, 5, new byte[] { 5 });
+            conditional.Freshness = freshness;
+            bool isLeader;
+
+            coalescer.Join(CreateGet(1, 5, new byte[] { 5 }), out isLeader);
+            Assert.IsTrue(isLeader);
+            coalescer.Join(conditional, out isLeader);
+            Assert.IsTrue(isLeader, "Freshness");
+            coalescer.Join(CreateGet(2, 5, new byte[] { 5 }), out isLeader);
+            Assert.IsTrue(isLeader, "Type id");
+            coalescer.Join(CreateGet(1, 6, new byte[] { 5 }), out isLeader);
+            Assert.IsTrue(isLeader, "Primary id");
+            coalescer.Join(CreateGet(1, 5, new byte[] { 6 }), out isLeader);
+            Assert.IsTrue(isLeader, "Extended id");
+            coalescer.Join(CreateGet(1, 5, new byte[] { 5, 0 }), out isLeader);
+            Assert.IsTrue(isLeader, "Extended id length");
+            coalescer.Join(CreateGet(1, 5, null), out isLeader);
+            Assert.IsTrue(isLeader, "No extended id");
+
+            var sameConditional = CreateGet(1, 5, new byte[] { 5 });
+            sameConditional.Freshness = freshness;
+            coalescer.Join(sameConditional, out isLeader);
+            Assert.IsFalse(isLeader, "Same freshness");
+            coalescer.Join(CreateGet(1, 5, null), out isLeader);
+            Assert.IsFalse(isLeader, "Both without extended ids");
+        }
+    }
+}
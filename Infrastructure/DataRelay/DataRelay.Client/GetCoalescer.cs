@@ -0,0 +1,185 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace MySpace.DataRelay.Client
+{
+    /// <summary>
+    /// Lets concurrent Gets for the same key share one message in flight.
+    /// </summary>
+    /// <remarks>
+    /// The first caller for a key leads: it sends its message and completes the flight. Callers
+    /// that arrive for the same key while it is out wait for it and read the leader's reply
+    /// instead of sending their own. Conditional Gets only share with Gets of the same freshness.
+    /// Readers must not change the shared message; reading its payload into their own objects
+    /// is safe from any number of threads.
+    /// </remarks>
+    internal class GetCoalescer
+    {
+        private readonly Dictionary<GetKey, Flight> _inFlight = new Dictionary<GetKey, Flight>();
+
+        /// <summary>
+        /// Sends <paramref name="message"/> with <paramref name="send"/> unless the same Get is already in flight.
+        /// </summary>
+        /// <returns>The message holding the reply; either <paramref name="message"/> or the leader's.</returns>
+        public RelayMessage Send(RelayMessage message, Action<RelayMessage> send)
+        {
+            bool isLeader;
+            Flight flight = Join(message, out isLeader);
+            if (isLeader)
+            {
+                bool succeeded = false;
+                try
+                {
+                    send(message);
+                    succeeded = true;
+                }
+                finally
+                {
+                    Complete(flight, succeeded);
+                }
+                return message;
+            }
+
+            RelayMessage reply = flight.Wait();
+            if (reply == null)
+            {
+                // the leader failed to send, so don't share in its failure
+                send(message);
+                return message;
+            }
+            return reply;
+        }
+
+        /// <summary>
+        /// Joins the flight for <paramref name="message"/>'s key, starting one if there is none.
+        /// </summary>
+        /// <param name="message">The Get message.</param>
+        /// <param name="isLeader"><see langword="true"/> if the caller must send <paramref name="message"/>
+        /// and then <see cref="Complete"/> the flight; otherwise the caller should <see cref="Flight.Wait"/>.</param>
+        public Flight Join(RelayMessage message, out bool isLeader)
+        {
+            var key = new GetKey(message);
+            Flight flight;
+            lock (_inFlight)
+            {
+                isLeader = !_inFlight.TryGetValue(key, out flight);
+                if (isLeader)
+                {
+                    flight = new Flight(key, message);
+                    _inFlight.Add(key, flight);
+                }
+            }
+            return flight;
+        }
+
+        /// <summary>
+        /// Completes a flight led by the caller, releasing its waiters.
+        /// </summary>
+        /// <param name="flight">The flight returned by <see cref="Join"/>.</param>
+        /// <param name="succeeded"><see langword="false"/> if the message could not be sent.</param>
+        public void Complete(Flight flight, bool succeeded)
+        {
+            lock (_inFlight)
+            {
+                _inFlight.Remove(flight.Key);
+            }
+            flight.Complete(succeeded);
+        }
+
+        /// <summary>
+        /// One Get in flight and the callers waiting on it.
+        /// </summary>
+        internal class Flight
+        {
+            private readonly RelayMessage _message;
+            private bool _isComplete;
+            private bool _succeeded;
+
+            public Flight(GetKey key, RelayMessage message)
+            {
+                Key = key;
+                _message = message;
+            }
+
+            public GetKey Key { get; private set; }
+
+            public void Complete(bool succeeded)
+            {
+                lock (this)
+                {
+                    _succeeded = succeeded;
+                    _isComplete = true;
+                    Monitor.PulseAll(this);
+                }
+            }
+
+            /// <summary>
+            /// Waits for the leader's reply.
+            /// </summary>
+            /// <returns>The leader's message, or <see langword="null"/> if it could not be sent.</returns>
+            public RelayMessage Wait()
+            {
+                lock (this)
+                {
+                    while (!_isComplete)
+                    {
+                        Monitor.Wait(this);
+                    }
+                    return _succeeded ? _message : null;
+                }
+            }
+        }
+
+        /// <summary>
+        /// What makes two Gets the same.
+        /// </summary>
+        internal struct GetKey : IEquatable<GetKey>
+        {
+            private readonly short _typeId;
+            private readonly int _primaryId;
+            private readonly byte[] _extendedId;
+            private readonly DateTime? _freshness;
+
+            public GetKey(RelayMessage message)
+            {
+                _typeId = message.TypeId;
+                _primaryId = message.Id;
+                _extendedId = message.ExtendedId;
+                _freshness = message.Freshness;
+            }
+
+            public bool Equals(GetKey other)
+            {
+                if (_typeId != other._typeId || _primaryId != other._primaryId || _freshness != other._freshness)
+                {
+                    return false;
+                }
+                if (_extendedId == null || other._extendedId == null)
+                {
+                    return _extendedId == other._extendedId;
+                }
+                if (_extendedId.Length != other._extendedId.Length)
+                {
+                    return false;
+                }
+                for (int i = 0; i < _extendedId.Length; i++)
+                {
+                    if (_extendedId[i] != other._extendedId[i]) return false;
+                }
+                return true;
+            }
+
+            public override bool Equals(object obj)
+            {
+                return obj is GetKey && Equals((GetKey)obj);
+            }
+
+            public override int GetHashCode()
+            {
+                // the primary id is normally derived from the extended id, so it stands in for it
+                return (_typeId << 16) ^ _primaryId;
+            }
+        }
+    }
+}
@@ -2,6 +2,7 @@ using System;
 using System.Collections.Generic;
 using System.Net;
 using System.Text;
+using System.Threading;
 using MySpace.Common;
 using MySpace.Common.Storage;
 using MySpace.DataRelay.Configuration;
@@ -77,6 +78,7 @@ namespace MySpace.DataRelay.Client
             if (_configuration != null && _configuration.TypeSettings != null)
             {
                 RelayMessage.SetCompressionImplementation(_configuration.TypeSettings.Compressor);
+                RelayMessage.SetCompressionDictionaries(_configuration.TypeSettings);
             }
 
 			_flexForwarder = new FlexForwarder();
@@ -229,12 +231,29 @@ namespace MySpace.DataRelay.Client
 		}
 
     	private Dictionary<short, bool> _useCacheLookup;
+		private Dictionary<short, bool> _coalesceGetsLookup;
+		private Dictionary<short, TimeSpan> _localCacheStaleLookup;
 
 		private bool UseCacheLookup(short typeId)
 		{
 			return _useCacheLookup != null && _useCacheLookup[typeId];
 		}
 
+		private bool CoalescesGets(short typeId)
+		{
+			bool coalesceGets;
+			var coalesceGetsLookup = _coalesceGetsLookup;
+			return coalesceGetsLookup != null && coalesceGetsLookup.TryGetValue(typeId, out coalesceGets) && coalesceGets;
+		}
+
+		private TimeSpan GetLocalCacheStaleGrace(short typeId)
+		{
+			TimeSpan staleGrace;
+			var localCacheStaleLookup = _localCacheStaleLookup;
+			return localCacheStaleLookup != null && localCacheStaleLookup.TryGetValue(typeId, out staleGrace) ?
+				staleGrace : TimeSpan.Zero;
+		}
+
 		private void ReloadConfig(object state, EventArgs args)
 		{
 			var config = state as RelayNodeConfig;
@@ -246,6 +265,7 @@ namespace MySpace.DataRelay.Client
 				if (config.TypeSettings != null)
 				{
 					RelayMessage.SetCompressionImplementation(config.TypeSettings.Compressor);
+					RelayMessage.SetCompressionDictionaries(config.TypeSettings);
 				}
 				_configuration = config;
 			}
@@ -262,15 +282,27 @@ namespace MySpace.DataRelay.Client
 			if (_configuration != null)
 			{
 				var useCacheLookup = new Dictionary<short, bool>();
+				var coalesceGetsLookup = new Dictionary<short, bool>();
+				var localCacheStaleLookup = new Dictionary<short, TimeSpan>();
 				foreach (var typeSetting in _configuration.TypeSettings.TypeSettingCollection)
 				{
 					useCacheLookup[typeSetting.TypeId] =
 						(typeSetting.LocalCacheTTLSeconds ?? -1) >= 0;
+					coalesceGetsLookup[typeSetting.TypeId] = typeSetting.CoalesceGets;
+					if ((typeSetting.LocalCacheStaleSeconds ?? 0) > 0)
+					{
+						localCacheStaleLookup[typeSetting.TypeId] =
+							TimeSpan.FromSeconds(typeSetting.LocalCacheStaleSeconds.Value);
+					}
 				}
 				_useCacheLookup = useCacheLookup;
+				_coalesceGetsLookup = coalesceGetsLookup;
+				_localCacheStaleLookup = localCacheStaleLookup;
 			} else
 			{
 				_useCacheLookup = null;				
+				_coalesceGetsLookup = null;
+				_localCacheStaleLookup = null;
 			}
 		}
 
@@ -849,6 +881,96 @@ namespace MySpace.DataRelay.Client
 			}			
 		}
 
+		private readonly GetCoalescer _getCoalescer = new GetCoalescer();
+
+		/// <summary>
+		/// Forwards a Get message, sharing the reply of an identical Get already in flight
+		/// if its type coalesces Gets.
+		/// </summary>
+		/// <param name="message">The Get message.</param>
+		/// <returns>The message holding the reply. It may be shared with other callers, so
+		/// it must only be read.</returns>
+		private RelayMessage ForwardGetMessage(RelayMessage message)
+		{
+			if (!CoalescesGets(message.TypeId))
+			{
+				ForwardMessage(message);
+				return message;
+			}
+			return _getCoalescer.Send(message, ForwardMessage);
+		}
+
+		/// <summary>
+		/// Forwards Get messages, replacing each one whose type coalesces Gets and that
+		/// matches a Get already in flight with the message holding that Get's reply.
+		/// </summary>
+		/// <param name="messages">The Get messages; may hold nulls.</param>
+		private void ForwardGetMessages(RelayMessage[] messages)
+		{
+			List<GetCoalescer.Flight> led = null;
+			GetCoalescer.Flight[] joined = null;
+			var toSend = messages;
+			for (int i = 0; i < messages.Length; i++)
+			{
+				var message = messages[i];
+				if (message == null || !CoalescesGets(message.TypeId)) continue;
+
+				bool isLeader;
+				var flight = _getCoalescer.Join(message, out isLeader);
+				if (isLeader)
+				{
+					if (led == null) led = new List<GetCoalescer.Flight>();
+					led.Add(flight);
+				}
+				else
+				{
+					if (joined == null)
+					{
+						joined = new GetCoalescer.Flight[messages.Length];
+						toSend = (RelayMessage[])messages.Clone();
+					}
+					joined[i] = flight;
+					toSend[i] = null;
+				}
+			}
+
+			bool succeeded = false;
+			try
+			{
+				ForwardMessages(toSend);
+				succeeded = true;
+			}
+			finally
+			{
+				if (led != null)
+				{
+					foreach (var flight in led)
+					{
+						_getCoalescer.Complete(flight, succeeded);
+					}
+				}
+			}
+
+			// only waited on once this batch's own flights are complete, so two batches can't wait on each other
+			if (joined != null)
+			{
+				for (int i = 0; i < joined.Length; i++)
+				{
+					if (joined[i] == null) continue;
+
+					var reply = joined[i].Wait();
+					if (reply != null)
+					{
+						messages[i] = reply;
+					}
+					else
+					{
+						ForwardMessage(messages[i]);
+					}
+				}
+			}
+		}
+
 		/// <summary>
 		/// Finds and loads the given <see cref="ICacheParameter"/> object from the transport.
 		/// </summary>
@@ -887,6 +1009,11 @@ namespace MySpace.DataRelay.Client
 								emptyObject.DataSource = DataSource.Cache;
 								return true;
 							}
+							if (ServeStaleFromLocalCache(typeId, emptyObject, entry))
+							{
+								// a background refresh, if any, updates the entry
+								return true;
+							}
 						}
 					}
 					RelayMessage message;
@@ -902,7 +1029,7 @@ namespace MySpace.DataRelay.Client
 						message = RelayMessage.GetGetMessageForObject(typeId,
 							emptyObject);						
 					}
-					ForwardMessage(message);
+					message = ForwardGetMessage(message);
 					if (useLocalCaching)
 					{
 						// checked after forwarder sends since that's when
@@ -1056,6 +1183,142 @@ namespace MySpace.DataRelay.Client
 			return LocalCache.RefreshExpires(typeId, LocalCache.GetKey(instance));
 		}
 
+		/// <summary>
+		/// Serves an expired local cache entry if its type's LocalCacheStaleSeconds allows,
+		/// so readers don't all wait on the server when a popular entry expires. The first
+		/// reader to take the entry's refresh lease sends the conditional Get in the background.
+		/// </summary>
+		/// <returns><see langword="true"/> if <paramref name="emptyObject"/> was filled
+		/// from the stale entry; otherwise <see langword="false"/>.</returns>
+		private bool ServeStaleFromLocalCache(short typeId, ICacheParameter emptyObject,
+			StorageEntry<ICacheParameter> entry)
+		{
+			var instanceType = emptyObject.GetType();
+			var updated = entry.Updated;
+			return ServeStaleFromLocalCache(typeId, emptyObject, entry, (key, message) =>
+				ApplyLocalCacheRefresh(typeId, key, instanceType, updated, message));
+		}
+
+		/// <summary>
+		/// Serves an expired local cache entry of a known type; see
+		/// <see cref="ServeStaleFromLocalCache(short, ICacheParameter, StorageEntry{ICacheParameter})"/>.
+		/// </summary>
+		private bool ServeStaleFromLocalCache<T>(short typeId, T emptyObject,
+			StorageEntry<T> entry) where T : ICacheParameter
+		{
+			var stale = entry.Instance;
+			var instanceType = emptyObject.GetType();
+			var updated = entry.Updated;
+			return ServeStaleFromLocalCache(typeId, emptyObject, entry, (key, message) =>
+				ApplyLocalCacheRefresh(stale, instanceType, updated, message));
+		}
+
+		private bool ServeStaleFromLocalCache<T>(short typeId, T emptyObject,
+			StorageEntry<T> entry, Action<StorageKey, RelayMessage> applyReply)
+			where T : ICacheParameter
+		{
+			var options = new LocalCacheOptions { StaleGracePeriod = GetLocalCacheStaleGrace(typeId) };
+			if (!LocalCache.IsServableStale(entry, options)) return false;
+
+			Copy(entry.Instance, emptyObject);
+			emptyObject.DataSource = DataSource.Cache;
+
+			var key = LocalCache.GetKey(emptyObject);
+			if (LocalCache.TryBeginRefresh(typeId, key, options))
+			{
+				byte[] extendedIdBytes;
+				DateTime? lastUpdatedDate;
+				RelayMessage.GetExtendedInfo(emptyObject, out extendedIdBytes, out lastUpdatedDate);
+				var message = new RelayMessage(typeId, emptyObject.PrimaryId, extendedIdBytes, MessageType.Get)
+				{
+					Freshness = entry.Updated
+				};
+				try
+				{
+					ThreadPool.QueueUserWorkItem(state => RefreshLocalCache(typeId, key, message, applyReply));
+				}
+				catch
+				{
+					LocalCache.EndRefresh(typeId, key);
+					throw;
+				}
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Sends the conditional Get for a stale local cache entry and updates the entry
+		/// from the reply, then releases the entry's refresh lease.
+		/// </summary>
+		private void RefreshLocalCache(short typeId, StorageKey key, RelayMessage message,
+			Action<StorageKey, RelayMessage> applyReply)
+		{
+			try
+			{
+				ForwardMessage(message);
+				AssertNoLegacySerialization(message);
+				if (message.ErrorOccurred)
+				{
+					// leave the entry stale; the next reader retries
+					return;
+				}
+				applyReply(key, message);
+			}
+			catch (Exception ex)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Error refreshing local cache entry {0} of type {1}: {2}", key, typeId, ex);
+			}
+			finally
+			{
+				LocalCache.EndRefresh(typeId, key);
+			}
+		}
+
+		private static void ApplyLocalCacheRefresh(short typeId, StorageKey key, Type instanceType,
+			DateTime updated, RelayMessage message)
+		{
+			if (!message.Freshness.HasValue || updated.CompareTo(message.Freshness.Value) < 0)
+			{
+				var instance = (ICacheParameter)Activator.CreateInstance(instanceType);
+				if (message.GetObject(instance))
+				{
+					SaveToLocalCache(typeId, instance, message);
+				}
+				else if (!message.Freshness.HasValue)
+				{
+					// was deleted on server
+					LocalCache.Delete(typeId, key);
+				}
+			}
+			else
+			{
+				LocalCache.RefreshExpires(typeId, key);
+			}
+		}
+
+		private static void ApplyLocalCacheRefresh<T>(T stale, Type instanceType,
+			DateTime updated, RelayMessage message) where T : ICacheParameter
+		{
+			if (!message.Freshness.HasValue || updated.CompareTo(message.Freshness.Value) < 0)
+			{
+				var instance = (T)Activator.CreateInstance(instanceType);
+				if (message.GetObject(instance))
+				{
+					SaveToLocalCache(instance, message);
+				}
+				else if (!message.Freshness.HasValue)
+				{
+					// was deleted on server
+					LocalCache.Delete(stale);
+				}
+			}
+			else
+			{
+				LocalCache.RefreshExpires(stale);
+			}
+		}
+
     	public void GetObjects(IList<ICacheParameter> emptyObjects)
 		{
             try
@@ -1090,6 +1353,9 @@ namespace MySpace.DataRelay.Client
 								{
 									Copy(entry.Instance, emptyObject);
 									emptyObject.DataSource = DataSource.Cache;
+								} else if (ServeStaleFromLocalCache(typeId, emptyObject, entry))
+								{
+									// a background refresh, if any, updates the entry
 								} else
 								{
 									RelayMessage.GetExtendedInfo(emptyObject, out extendedIdBytes, out lastUpdatedDate);
@@ -1119,7 +1385,7 @@ namespace MySpace.DataRelay.Client
                 }
                 if (gotOne)
                 {
-					ForwardMessages(messages);
+					ForwardGetMessages(messages);
                     IList<ICacheParameter> handledVersioned = null;
 					now = DateTime.Now;						
 					for (int i = 0; i < paramCount; i++)
@@ -1343,6 +1609,12 @@ namespace MySpace.DataRelay.Client
 								return new RelayResult<T>(RelayResultType.Success,
 									null, emptyObject);
 							}
+							if (ServeStaleFromLocalCache(typeId, emptyObject, entry))
+							{
+								// a background refresh, if any, updates the entry
+								return new RelayResult<T>(RelayResultType.Success,
+									null, emptyObject);
+							}
 						}
 					}
 					if (entry.IsFound)
@@ -1355,7 +1627,7 @@ namespace MySpace.DataRelay.Client
 						message = RelayMessage.GetGetMessageForObject(typeId,
 							emptyObject);
 					}
-					ForwardMessage(message);
+					message = ForwardGetMessage(message);
 					if (useLocalCaching)
 					{
 						// checked after forwarder sends since that's when
@@ -1582,6 +1854,10 @@ namespace MySpace.DataRelay.Client
 									Copy(entry.Instance, emptyObject);
 									emptyObject.DataSource = DataSource.Cache;
 								}
+								else if (ServeStaleFromLocalCache(typeId, emptyObject, entry))
+								{
+									// a background refresh, if any, updates the entry
+								}
 								else
 								{
 									RelayMessage.GetExtendedInfo(emptyObject, out extendedIdBytes, out lastUpdatedDate);
@@ -1610,7 +1886,7 @@ namespace MySpace.DataRelay.Client
 				}
 				if (gotOne)
 				{
-					ForwardMessages(messages);
+					ForwardGetMessages(messages);
 					IList<ICacheParameter> unhandledVersioned = null, handledVersioned = null;
 					now = DateTime.Now;
 					for (int i = 0; i < emptyObjects.Count; i++)
@@ -19,6 +19,7 @@ namespace MySpace.DataRelay.Client
             if (updatedConfig!=null && updatedConfig.TypeSettings != null)
             {
                 RelayMessage.SetCompressionImplementation(updatedConfig.TypeSettings.Compressor);
+                RelayMessage.SetCompressionDictionaries(updatedConfig.TypeSettings);
                 _configuration = updatedConfig;
             }
         }
@@ -0,0 +1,159 @@
+﻿using System;
+using System.Collections.Generic;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.DataRelay.Common.Schemas;
+
+namespace MySpace.DataRelay.Common.Test.Schemas
+{
+	[TestClass]
+	public class ConsistentHashRingTests
+	{
+		private const int virtualNodes = 100;
+		private const int idCount = 100000;
+
+		private static ConsistentHashRing CreateRing(params string[] keys)
+		{
+			return new ConsistentHashRing(keys, virtualNodes);
+		}
+
+		private static bool InAnyMove(IList<HashRangeMove> moves, int objectId, int from, int to)
+		{
+			foreach (var move in moves)
+			{
+				if (move.Contains(objectId))
+				{
+					return move.FromCluster == from && move.ToCluster == to;
+				}
+			}
+			return false;
+		}
+
+		[TestMethod]
+		public void IdsAreSpreadOverClusters()
+		{
+			var ring = CreateRing("a", "b", "c", "d");
+			var counts = new int[ring.ClusterCount];
+
+			for (var id = 0; id < idCount; ++id)
+			{
+				counts[ring.GetClusterIndex(id)]++;
+			}
+
+			foreach (var count in counts)
+			{
+				Assert.IsTrue(count > idCount / 4 * 0.7 && count < idCount / 4 * 1.3, "Cluster has " + count + " ids");
+			}
+		}
+
+		[TestMethod]
+		public void RebuiltRingMapsIdsTheSame()
+		{
+			var first = CreateRing("a", "b", "c");
+			var second = CreateRing("a", "b", "c");
+
+			for (var id = -1000; id < 1000; ++id)
+			{
+				Assert.AreEqual(first.GetClusterIndex(id), second.GetClusterIndex(id));
+			}
+			Assert.AreEqual(0, ConsistentHashRing.GetMoves(first, second).Count);
+		}
+
+		[TestMethod]
+		public void AddingClusterOnlyMovesIdsToIt()
+		{
+			var before = CreateRing("a", "b", "c");
+			var after = CreateRing("a", "b", "c", "d");
+			var moves = ConsistentHashRing.GetMoves(before, after);
+			var moved = 0;
+
+			for (var id = 0; id < idCount; ++id)
+			{
+				var from = before.GetClusterIndex(id);
+				var to = after.GetClusterIndex(id);
+				if (from != to)
+				{
+					++moved;
+					Assert.AreEqual(3, to, "Id " + id + " moved between existing clusters");
+					Assert.IsTrue(InAnyMove(moves, id, from, to), "Id " + id + " moved outside the moves");
+				}
+				else
+				{
+					Assert.IsFalse(InAnyMove(moves, id, from, to), "Id " + id + " is in a move but kept its cluster");
+				}
+			}
+			// about a quarter of the ids go to the new cluster
+			Assert.IsTrue(moved > idCount / 4 * 0.7 && moved < idCount / 4 * 1.3, moved + " ids moved");
+		}
+
+		[TestMethod]
+		public void RemovingClusterOnlyMovesItsIds()
+		{
+			var before = CreateRing("a", "b", "c", "d");
+			var after = CreateRing("a", "b", "c");
+			var moves = ConsistentHashRing.GetMoves(before, after);
+
+			for (var id = 0; id < idCount; ++id)
+			{
+				var from = before.GetClusterIndex(id);
+				var to = after.GetClusterIndex(id);
+				Assert.AreEqual(from == 3, from != to, "Id " + id);
+			}
+			foreach (var move in moves)
+			{
+				Assert.AreEqual(3, move.FromCluster);
+			}
+		}
+
+		[TestMethod]
+		public void MovesAreOrderedDisjointAndMerged()
+		{
+			var moves = ConsistentHashRing.GetMoves(CreateRing("a", "b", "c"), CreateRing("a", "b", "c", "d", "e"));
+			double fraction = 0;
+
+			Assert.IsTrue(moves.Count > 0);
+			for (var i = 0; i < moves.Count; ++i)
+			{
+				Assert.IsTrue(moves[i].Start <= moves[i].End, moves[i].ToString());
+				Assert.AreNotEqual(moves[i].FromCluster, moves[i].ToCluster);
+				if (i > 0)
+				{
+					var previous = moves[i - 1];
+					Assert.IsTrue(previous.End < moves[i].Start, previous + " overlaps " + moves[i]);
+					Assert.IsFalse(previous.End + 1 == moves[i].Start && previous.FromCluster == moves[i].FromCluster &&
+						previous.ToCluster == moves[i].ToCluster, previous + " was not merged with " + moves[i]);
+				}
+				fraction += moves[i].Fraction;
+			}
+			// two new clusters out of five take about two fifths of the ring
+			Assert.IsTrue(fraction > 0.3 && fraction < 0.5, "Moved fraction " + fraction);
+		}
+
+		[TestMethod]
+		public void RenamedClusterKeyMovesOnlyItsRanges()
+		{
+			var before = CreateRing("a", "b", "c");
+			var after = CreateRing("a", "b", "c2");
+
+			foreach (var move in ConsistentHashRing.GetMoves(before, after))
+			{
+				Assert.IsTrue(move.FromCluster == 2 || move.ToCluster == 2, move.ToString());
+			}
+		}
+
+		[TestMethod]
+		public void EmptyRingMapsToFirstCluster()
+		{
+			var ring = new ConsistentHashRing(new string[0], virtualNodes);
+
+			Assert.AreEqual(0, ring.GetClusterIndex(42));
+			Assert.AreEqual(0, ConsistentHashRing.GetMoves(ring, CreateRing("a")).Count);
+		}
+
+		[TestMethod]
+		[ExpectedException(typeof(ArgumentOutOfRangeException))]
+		public void VirtualNodesMustBePositive()
+		{
+			new ConsistentHashRing(new[] { "a" }, 0);
+		}
+	}
+}
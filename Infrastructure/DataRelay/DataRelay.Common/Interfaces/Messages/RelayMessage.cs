@@ -9,6 +9,7 @@ using System.Text;
 using MySpace.Common;
 using MySpace.Common.IO;
 using MySpace.DataRelay.Common.Interfaces.Query;
+using MySpace.DataRelay.Common.Schemas;
 
 namespace MySpace.DataRelay
 {
@@ -634,7 +635,7 @@ namespace MySpace.DataRelay
 
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
 
-			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Save);
+			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Save);
 		}
 
 		public static RelayMessage GetSaveMessageForObject<T>(short typeId, bool useCompression, int ttlSeconds, T obj) where T : ICacheParameter
@@ -642,7 +643,7 @@ namespace MySpace.DataRelay
 			byte[] extendedKeyBytes = null;
 			DateTime? lastUpdatedDate = null;
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
-			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Save);
+			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Save);
 
 		}
 
@@ -654,7 +655,7 @@ namespace MySpace.DataRelay
 			DateTime? lastUpdatedDate = null;
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
 
-			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Save);
+			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Save);
 		}
 
 
@@ -665,7 +666,7 @@ namespace MySpace.DataRelay
 			byte[] extendedKeyBytes = null;
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
 
-			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Update);
+			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Update);
 		}
 
 		public static RelayMessage GetUpdateMessageForObject<T>(short typeId, bool useCompression, int ttlSeconds, T obj) where T : ICacheParameter
@@ -675,27 +676,27 @@ namespace MySpace.DataRelay
 			byte[] extendedKeyBytes = null;
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
 
-			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Update);
+			return new RelayMessage(typeId, obj.PrimaryId, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Update);
 		}
 
 		public static RelayMessage GetSaveMessageForObject<T>(short typeId, int id, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Save);
+			return new RelayMessage(typeId, id, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Save);
 		}
 
 		public static RelayMessage GetSaveMessageForObject<T>(short typeId, int id, byte[] extendedKeyBytes, DateTime? lastUpdatedDate, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Save);
+			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Save);
 		}
 
 		public static RelayMessage GetSaveMessageForObject<T>(short typeId, int id, int ttlSeconds, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Save);
+			return new RelayMessage(typeId, id, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Save);
 		}
 
 		public static RelayMessage GetSaveMessageForObject<T>(short typeId, int id, byte[] extendedKeyBytes, DateTime? lastUpdatedDate, int ttlSeconds, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Save);
+			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Save);
 		}
 
 		public static RelayMessage GetGetMessageForObject<T>(short typeId, T obj) where T : ICacheParameter
@@ -741,32 +742,32 @@ namespace MySpace.DataRelay
 			DateTime? lastUpdatedDate;
 			GetExtendedInfo(obj, out extendedKeyBytes, out lastUpdatedDate);
 
-			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Delete);
+			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Delete);
 		}
 
 		public static RelayMessage GetDeleteMessageForObject<T>(short typeId, int id, int ttlSeconds, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Delete);
+			return new RelayMessage(typeId, id, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Delete);
 		}
 
 		public static RelayMessage GetUpdateMessageForObject<T>(short typeId, int id, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Update);
+			return new RelayMessage(typeId, id, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Update);
 		}
 
 		public static RelayMessage GetUpdateMessageForObject<T>(short typeId, int id, int ttlSeconds, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Update);
+			return new RelayMessage(typeId, id, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Update);
 		}
 
 		public static RelayMessage GetUpdateMessageForObject<T>(short typeId, int id, byte[] extendedKeyBytes, DateTime? lastUpdatedDate, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, MessageType.Update);
+			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, MessageType.Update);
 		}
 
 		public static RelayMessage GetUpdateMessageForObject<T>(short typeId, int id, byte[] extendedKeyBytes, DateTime? lastUpdatedDate, int ttlSeconds, T obj, bool useCompression)
 		{
-			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation), useCompression, ttlSeconds, MessageType.Update);
+			return new RelayMessage(typeId, id, extendedKeyBytes, lastUpdatedDate, SerializePayload(typeId, obj, useCompression), useCompression, ttlSeconds, MessageType.Update);
 		}
 
 		#endregion
@@ -1040,6 +1041,45 @@ namespace MySpace.DataRelay
 			return RelayCompressionImplementation;
 		}
 
+		/// <summary>
+		/// Sets the shared compression dictionaries configured for each type. Compressed payloads
+		/// of a type with a dictionary are compressed against its newest version.
+		/// </summary>
+		/// <param name="typeSettings">The type settings.</param>
+		public static void SetCompressionDictionaries(TypeSettings typeSettings)
+		{
+			List<CompressionDictionary> dictionaries = new List<CompressionDictionary>();
+			if (typeSettings != null && typeSettings.TypeSettingCollection != null)
+			{
+				foreach (TypeSetting typeSetting in typeSettings.TypeSettingCollection)
+				{
+					if (typeSetting.CompressionDictionaries == null) continue;
+					foreach (CompressionDictionarySetting setting in typeSetting.CompressionDictionaries)
+					{
+						if (setting == null || setting.Content == null) continue;
+						dictionaries.Add(new CompressionDictionary(typeSetting.TypeId, setting.Version, setting.Content));
+					}
+				}
+			}
+			DictionaryCodec.SetDictionaries(dictionaries);
+		}
+
+		/// <summary>
+		/// Serializes a payload, compressing it against its type's shared dictionary if it has one.
+		/// </summary>
+		private static byte[] SerializePayload<T>(short typeId, T obj, bool useCompression)
+		{
+			if (useCompression)
+			{
+				DictionaryCodec codec = DictionaryCodec.GetCodec(typeId);
+				if (codec != null)
+				{
+					return Compressor.GetInstance().Compress(codec, new ArraySegment<byte>(Serializer.Serialize<T>(obj, false)));
+				}
+			}
+			return Serializer.Serialize<T>(obj, useCompression, RelayCompressionImplementation);
+		}
+
 		#endregion
 
 		#region ToString
@@ -7,6 +7,7 @@ using System.Text;
 using System.Net;
 using MySpace.DataRelay.Formatters;
 using MySpace.DataRelay.Common.Interfaces.Query;
+using MySpace.DataRelay.Common.Schemas;
 
 namespace MySpace.DataRelay
 {
@@ -246,6 +247,41 @@ namespace MySpace.DataRelay
 
 		#endregion
 
+		#region Compression Dictionaries
+
+		/// <summary>
+		/// Trains a shared compression dictionary for a type from a sample of its stored payloads.
+		/// </summary>
+		/// <param name="typeId">The type id; payloads of other types are skipped.</param>
+		/// <param name="version">The version to give the dictionary; it must be newer than any
+		/// already configured for the type.</param>
+		/// <param name="payloads">The sample payloads; a few thousand typical ones are enough.</param>
+		/// <param name="maxLength">The most bytes of dictionary, up to <see cref="CompressionDictionary.MaxLength"/>.</param>
+		/// <returns>The setting to add to the type's <see cref="TypeSetting.CompressionDictionaries"/>.</returns>
+		public static CompressionDictionarySetting TrainCompressionDictionary(short typeId, ushort version,
+			IEnumerable<RelayPayload> payloads, int maxLength)
+		{
+			if (payloads == null) throw new ArgumentNullException("payloads");
+			return new CompressionDictionarySetting
+			{
+				Version = version,
+				Content = CompressionDictionaryTrainer.Train(GetUncompressedPayloads(typeId, payloads), maxLength)
+			};
+		}
+
+		private static IEnumerable<byte[]> GetUncompressedPayloads(short typeId, IEnumerable<RelayPayload> payloads)
+		{
+			foreach (RelayPayload payload in payloads)
+			{
+				if (payload == null || payload.TypeId != typeId || payload.ByteArray == null) continue;
+				yield return payload.Compressed
+					? Compressor.GetInstance().Decompress(payload.ByteArray, RelayMessage.RelayCompressionImplementation)
+					: payload.ByteArray;
+			}
+		}
+
+		#endregion
+
         private void SetLastUpdatedDate<T>(T instance)
         {
             IExtendedRawCacheParameter iercp = instance as IExtendedRawCacheParameter;
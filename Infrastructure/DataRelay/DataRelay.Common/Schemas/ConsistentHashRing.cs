@@ -0,0 +1,239 @@
+using System;
+using System.Collections.Generic;
+using System.Text;
+
+namespace MySpace.DataRelay.Common.Schemas
+{
+	/// <summary>
+	/// Maps object ids to clusters with a consistent hash ring. Each cluster is placed on the
+	/// ring at a number of virtual node points derived from its key, and an id belongs to the
+	/// cluster owning the first point at or after the id's hash. Adding a cluster only takes
+	/// over the ranges in front of its own points, so most ids keep their cluster.
+	/// </summary>
+	public sealed class ConsistentHashRing
+	{
+		private readonly uint[] _points;
+		private readonly int[] _clusters;
+		private readonly int _clusterCount;
+
+		/// <summary>
+		/// Builds a ring for clusters identified by <paramref name="clusterKeys"/>, indexed in the same order.
+		/// </summary>
+		/// <param name="clusterKeys">A stable key per cluster; a cluster keeps its points as long as its key is unchanged.</param>
+		/// <param name="virtualNodes">The number of points per cluster. More points spread ids more evenly.</param>
+		public ConsistentHashRing(IList<string> clusterKeys, int virtualNodes)
+		{
+			if (clusterKeys == null) throw new ArgumentNullException("clusterKeys");
+			if (virtualNodes < 1) throw new ArgumentOutOfRangeException("virtualNodes", "virtualNodes must be at least 1.");
+
+			_clusterCount = clusterKeys.Count;
+			// the point goes in the high bits and the cluster in the low, so sorting orders by
+			// point and a point claimed by two clusters goes to the lower index
+			ulong[] entries = new ulong[_clusterCount * virtualNodes];
+			int entry = 0;
+			for (int cluster = 0; cluster < _clusterCount; cluster++)
+			{
+				for (int i = 0; i < virtualNodes; i++)
+				{
+					entries[entry++] = ((ulong)HashPoint(clusterKeys[cluster], i) << 32) | (uint)cluster;
+				}
+			}
+			Array.Sort(entries);
+
+			List<uint> points = new List<uint>(entries.Length);
+			List<int> clusters = new List<int>(entries.Length);
+			for (int i = 0; i < entries.Length; i++)
+			{
+				uint point = (uint)(entries[i] >> 32);
+				if (points.Count > 0 && points[points.Count - 1] == point) continue;
+				points.Add(point);
+				clusters.Add((int)(entries[i] & uint.MaxValue));
+			}
+			_points = points.ToArray();
+			_clusters = clusters.ToArray();
+		}
+
+		/// <summary>
+		/// Gets the number of clusters on the ring.
+		/// </summary>
+		public int ClusterCount
+		{
+			get { return _clusterCount; }
+		}
+
+		/// <summary>
+		/// Gets the index of the cluster that owns <paramref name="objectId"/>.
+		/// </summary>
+		public int GetClusterIndex(int objectId)
+		{
+			if (_points.Length == 0) return 0;
+			return GetOwner(HashId(objectId));
+		}
+
+		/// <summary>
+		/// Gets the position of <paramref name="objectId"/> on the ring.
+		/// </summary>
+		public static uint HashId(int objectId)
+		{
+			// ids are usually sequential, so they are mixed to spread them around the ring
+			return Mix((uint)objectId);
+		}
+
+		private int GetOwner(uint hash)
+		{
+			int index = Array.BinarySearch(_points, hash);
+			if (index < 0)
+			{
+				index = ~index;
+				if (index == _points.Length) index = 0;
+			}
+			return _clusters[index];
+		}
+
+		/// <summary>
+		/// Compares two rings and returns the ranges of the ring whose ids change cluster
+		/// between them, with adjacent ranges moving between the same clusters merged.
+		/// </summary>
+		/// <param name="before">The ring the ids are mapped with now.</param>
+		/// <param name="after">The ring the ids will be mapped with.</param>
+		/// <returns>The moved ranges in ring order; empty when nothing moves.</returns>
+		public static IList<HashRangeMove> GetMoves(ConsistentHashRing before, ConsistentHashRing after)
+		{
+			if (before == null) throw new ArgumentNullException("before");
+			if (after == null) throw new ArgumentNullException("after");
+
+			List<HashRangeMove> moves = new List<HashRangeMove>();
+			if (before._points.Length == 0 || after._points.Length == 0) return moves;
+
+			// every point of either ring ends a range that one owner holds in each ring
+			uint[] bounds = new uint[before._points.Length + after._points.Length];
+			before._points.CopyTo(bounds, 0);
+			after._points.CopyTo(bounds, before._points.Length);
+			Array.Sort(bounds);
+
+			uint start = 0;
+			for (int i = 0; i < bounds.Length; i++)
+			{
+				if (i > 0 && bounds[i] == bounds[i - 1]) continue;
+				AddMove(moves, before, after, start, bounds[i]);
+				start = bounds[i] + 1;
+			}
+			uint last = bounds[bounds.Length - 1];
+			if (last != uint.MaxValue)
+			{
+				// past the last point ids wrap around to the first
+				AddMove(moves, before, after, last + 1, uint.MaxValue);
+			}
+			return moves;
+		}
+
+		private static void AddMove(List<HashRangeMove> moves, ConsistentHashRing before, ConsistentHashRing after, uint start, uint end)
+		{
+			int from = before.GetOwner(end);
+			int to = after.GetOwner(end);
+			if (from == to) return;
+
+			if (moves.Count > 0)
+			{
+				HashRangeMove previous = moves[moves.Count - 1];
+				if (previous.End + 1 == start && previous.FromCluster == from && previous.ToCluster == to)
+				{
+					moves[moves.Count - 1] = new HashRangeMove(previous.Start, end, from, to);
+					return;
+				}
+			}
+			moves.Add(new HashRangeMove(start, end, from, to));
+		}
+
+		private static uint HashPoint(string key, int virtualNode)
+		{
+			// FNV-1a rather than string.GetHashCode, which may differ between runtimes
+			byte[] bytes = Encoding.UTF8.GetBytes(key + "#" + virtualNode);
+			uint hash = 2166136261;
+			for (int i = 0; i < bytes.Length; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619;
+			}
+			return Mix(hash);
+		}
+
+		private static uint Mix(uint hash)
+		{
+			// the murmur3 finalizer
+			hash ^= hash >> 16;
+			hash *= 0x85ebca6b;
+			hash ^= hash >> 13;
+			hash *= 0xc2b2ae35;
+			hash ^= hash >> 16;
+			return hash;
+		}
+	}
+
+	/// <summary>
+	/// A range of a <see cref="ConsistentHashRing"/> whose ids move from one cluster to another.
+	/// </summary>
+	public struct HashRangeMove
+	{
+		private readonly uint _start;
+		private readonly uint _end;
+		private readonly int _fromCluster;
+		private readonly int _toCluster;
+
+		/// <summary>
+		/// Initializes a new instance of the <see cref="HashRangeMove"/> structure.
+		/// </summary>
+		public HashRangeMove(uint start, uint end, int fromCluster, int toCluster)
+		{
+			_start = start;
+			_end = end;
+			_fromCluster = fromCluster;
+			_toCluster = toCluster;
+		}
+
+		/// <summary>
+		/// Gets the first ring position of the range.
+		/// </summary>
+		public uint Start { get { return _start; } }
+
+		/// <summary>
+		/// Gets the last ring position of the range, inclusive.
+		/// </summary>
+		public uint End { get { return _end; } }
+
+		/// <summary>
+		/// Gets the index of the cluster the ids belonged to.
+		/// </summary>
+		public int FromCluster { get { return _fromCluster; } }
+
+		/// <summary>
+		/// Gets the index of the cluster the ids move to.
+		/// </summary>
+		public int ToCluster { get { return _toCluster; } }
+
+		/// <summary>
+		/// Gets the share of all ids that fall in the range.
+		/// </summary>
+		public double Fraction
+		{
+			get { return ((double)_end - _start + 1) / 4294967296.0; }
+		}
+
+		/// <summary>
+		/// Gets whether <paramref name="objectId"/> falls in the range.
+		/// </summary>
+		public bool Contains(int objectId)
+		{
+			uint hash = ConsistentHashRing.HashId(objectId);
+			return hash >= _start && hash <= _end;
+		}
+
+		/// <summary>
+		/// Returns the range and the clusters it moves between.
+		/// </summary>
+		public override string ToString()
+		{
+			return string.Format("[{0}, {1}] cluster {2} -> {3}", _start, _end, _fromCluster, _toCluster);
+		}
+	}
+}
@@ -5,6 +5,7 @@ using System.Net.Sockets;
 using System.Net;
 using System.Xml.Serialization;
 using System.Collections.ObjectModel;
+using System.Globalization;
 using MySpace.Logging;
 using MySpace.Configuration;
 
@@ -371,8 +372,27 @@ namespace MySpace.DataRelay.Common.Schemas
 		public int RetryCount;
 		[XmlAttribute("NodeReselectMinutes")]
 		public int NodeReselectMinutes;
+		/// <summary>
+		/// Whether the forwarder picks a node for every request, preferring the less loaded of two
+		/// random nodes by response time, outstanding requests and recent errors, instead of sticking
+		/// with one randomly chosen node until it fails or <see cref="NodeReselectMinutes"/> pass.
+		/// </summary>
+		[XmlAttribute("AdaptiveNodeSelection")]
+		public bool AdaptiveNodeSelection;
 		[XmlAttribute("UseIdRanges")]
 		public bool UseIdRanges;
+		/// <summary>
+		/// Whether ids are mapped to clusters with a <see cref="ConsistentHashRing"/> instead of
+		/// by modulus, so that adding a cluster only moves the ids it takes over. Ignored when
+		/// <see cref="UseIdRanges"/> is set.
+		/// </summary>
+		[XmlAttribute("UseConsistentHashing")]
+		public bool UseConsistentHashing;
+		/// <summary>
+		/// The number of points each cluster gets on the ring when <see cref="UseConsistentHashing"/> is set.
+		/// </summary>
+		[XmlAttribute("VirtualNodesPerCluster")]
+		public int VirtualNodesPerCluster = 160;
 
 		[XmlAttribute("StartupRepopulateDuration")]
 		public int StartupRepopulateDuration;
@@ -406,6 +426,30 @@ namespace MySpace.DataRelay.Common.Schemas
 		[XmlAttribute("LegacySerialization")]
 		public bool LegacySerialization = true;
 
+		private ConsistentHashRing _hashRing;
+		/// <summary>
+		/// Gets the ring ids are mapped with when <see cref="UseConsistentHashing"/> is set. Clusters
+		/// are placed by their <see cref="RelayNodeClusterDefinition.RingKey"/>, or else by their position.
+		/// </summary>
+		[XmlIgnore]
+		public ConsistentHashRing HashRing
+		{
+			get
+			{
+				if (_hashRing == null)
+				{
+					RelayNodeClusterDefinition[] clusters = RelayNodeClusters ?? new RelayNodeClusterDefinition[0];
+					string[] keys = new string[clusters.Length];
+					for (int i = 0; i < clusters.Length; i++)
+					{
+						keys[i] = string.IsNullOrEmpty(clusters[i].RingKey) ? i.ToString(CultureInfo.InvariantCulture) : clusters[i].RingKey;
+					}
+					_hashRing = new ConsistentHashRing(keys, Math.Max(1, VirtualNodesPerCluster));
+				}
+				return _hashRing;
+			}
+		}
+
 		[XmlArray("RelayNodeClusters")]
 		[XmlArrayItem("RelayNodeCluster")]
 		public RelayNodeClusterDefinition[] DefaultRelayNodeClusters { get; set; }
@@ -557,6 +601,10 @@ namespace MySpace.DataRelay.Common.Schemas
 			{
 				return GetRangedIndex(objectId);
 			}
+			else if (UseConsistentHashing)
+			{
+				return HashRing.GetClusterIndex(objectId);
+			}
 			else
 			{
 				return GetModdedIndex(objectId);
@@ -599,6 +647,13 @@ namespace MySpace.DataRelay.Common.Schemas
 		[XmlAttribute("StartupRepopulateDuration")]
 		public int StartupRepopulateDuration;
 
+		/// <summary>
+		/// The key that places the cluster on its group's <see cref="ConsistentHashRing"/>. When
+		/// empty the cluster's position is used, so new clusters should be added at the end.
+		/// </summary>
+		[XmlAttribute("RingKey")]
+		public string RingKey;
+
 		public bool ContainsNode(IPAddress address, int listenPort)
 		{
 			foreach (RelayNodeDefinition node in RelayNodes)
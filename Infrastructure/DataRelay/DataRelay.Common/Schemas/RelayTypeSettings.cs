@@ -173,6 +173,8 @@ namespace MySpace.DataRelay.Common.Schemas
 		public bool Compress;
 		[XmlElement("LocalCacheTTLSeconds")]
 		public int? LocalCacheTTLSeconds;
+		[XmlElement("LocalCacheStaleSeconds")]
+		public int? LocalCacheStaleSeconds;
 		[XmlElement("GroupName")]
 		public string GroupName;
 		[XmlElement("RelatedIndexTypeId")]
@@ -189,6 +191,18 @@ namespace MySpace.DataRelay.Common.Schemas
 		public bool SyncInMessages;
 		[XmlElement("ThrowOnSyncFailure")]
 		public bool ThrowOnSyncFailure;
+		[XmlElement("HedgeSetting")]
+		public HedgeSetting HedgeSetting;
+		[XmlElement("CoalesceGets")]
+		public bool CoalesceGets;
+		/// <summary>
+		/// Shared dictionaries this type's compressed payloads are compressed against. The
+		/// newest version is used to compress; older versions are kept so stored payloads
+		/// compressed against them can still be read.
+		/// </summary>
+		[XmlArray("CompressionDictionaries")]
+		[XmlArrayItem("CompressionDictionary")]
+		public CompressionDictionarySetting[] CompressionDictionaries;
 
 		[XmlAttribute("GatherStatistics")]
 		public bool GatherStatistics = true;//default to true
@@ -314,6 +328,57 @@ namespace MySpace.DataRelay.Common.Schemas
 		}
 	}
 
+	/// <summary>
+	/// A version of a type's shared compression dictionary, as trained by
+	/// <see cref="MySpace.DataRelay.RelayPayload.TrainCompressionDictionary"/>.
+	/// </summary>
+	public class CompressionDictionarySetting
+	{
+		[XmlAttribute("Version")]
+		public ushort Version;
+		/// <summary>
+		/// The dictionary bytes, base64 encoded.
+		/// </summary>
+		[XmlElement("Content")]
+		public byte[] Content;
+
+		public override string ToString()
+		{
+			return string.Format("Compression dictionary version {0}, {1} bytes", Version,
+				Content == null ? 0 : Content.Length);
+		}
+	}
+
+	/// <summary>
+	/// Controls hedging of Get messages for a type. A Get that has not been answered within
+	/// the <see cref="Percentile"/> of the type's recent Get latency is sent again to another
+	/// node in the same cluster, and whichever node answers first is used.
+	/// </summary>
+	public class HedgeSetting
+	{
+		[XmlElement("Enabled")]
+		public bool Enabled;
+		/// <summary>
+		/// The latency percentile, from 50 to 99.9, after which a second Get is sent.
+		/// </summary>
+		[XmlElement("Percentile")]
+		public double Percentile = 95;
+		/// <summary>
+		/// The least time to wait for the first node, however fast the type's Gets are.
+		/// </summary>
+		[XmlElement("MinimumDelayMilliseconds")]
+		public int MinimumDelayMilliseconds = 2;
+
+		public override string ToString()
+		{
+			if (Enabled)
+			{
+				return string.Format("Hedge Gets after p{0} (at least {1} ms)", Percentile, MinimumDelayMilliseconds);
+			}
+			return "No Get Hedging";
+		}
+	}
+
     /// <summary>
     /// Controls if a type is stored in Flex Cache, Data Relay, or both.
     /// </summary>
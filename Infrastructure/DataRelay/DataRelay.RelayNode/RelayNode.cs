@@ -487,6 +487,8 @@ namespace MySpace.DataRelay
 
 				_typeSettings = _configuration.TypeSettings != null ? 
 					_configuration.TypeSettings.TypeSettingCollection : null;
+				// components decompress stored payloads, which may use a type's dictionary
+				RelayMessage.SetCompressionDictionaries(_configuration.TypeSettings);
 
 			}
 			else
@@ -545,6 +547,7 @@ namespace MySpace.DataRelay
 				_typeIdBelongsHere = GenerateTypeIdBelongsHere(_myGroup, newConfiguration.TypeSettings);
 				_typeSettings = newConfiguration.TypeSettings != null ?
 					newConfiguration.TypeSettings.TypeSettingCollection : null;
+				RelayMessage.SetCompressionDictionaries(newConfiguration.TypeSettings);
 
 				_redirectionConfigured = newConfiguration.RedirectMessages;
 				log.InfoFormat("Redirection enabled: {0}", RedirectionEnabled());
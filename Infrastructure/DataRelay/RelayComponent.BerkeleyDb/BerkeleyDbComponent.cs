@@ -1,5 +1,6 @@
 using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Threading;
 using BerkeleyDbWrapper;
 using MySpace.BerkeleyDb.Configuration;
@@ -194,70 +195,26 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 			return bytes;
 		}
 
-		// Record for counter doens't exist in BDB. Creates new record, size is length of iPayloadStorage + 4 bytes for each counter 
-		static unsafe private byte[] CreateCounterBytes(byte[] payloadHeader, int iVersion, byte byteCounterOffset,
-			int iPayloadStorageLength, int iIncrementBy, int iStrategyLimit)
+		// Start of a counter record: the payload header and the version byte. The 32 bit counters
+		// follow, and are added natively by BerkeleyDbStorage.IncrementCounter.
+		static private byte[] CreateCounterHeader(byte[] payloadHeader, int iVersion, int iPayloadStorageLength)
 		{
-			if (byteCounterOffset < 0 || iVersion == 0)
-				return null;
-
-			int iSize = iPayloadStorageLength + 1 + (byteCounterOffset + 1) * sizeof(int); // + 1 byte for version
-			byte[] bytes = new byte[iSize];
-
-			// Set the payload info
+			byte[] bytes = new byte[iPayloadStorageLength + 1]; // + 1 byte for version
 			if (payloadHeader != null)
 			{
-				fixed (byte* pBytes = &bytes[0], pPh = &payloadHeader[0])
-				{
-					*((PayloadStorage*) pBytes) = *(PayloadStorage*) pPh;
-				}
+				Buffer.BlockCopy(payloadHeader, 0, bytes, 0, iPayloadStorageLength);
 			}
-			// Set the Version
 			bytes[iPayloadStorageLength] = (byte)iVersion;
-
-			fixed (byte* pBytes = &bytes[iSize - 4])
-			{
-				int* pBytesInt = (int*)pBytes;
-				*pBytesInt += iIncrementBy;
-
-				if (iStrategyLimit > 0 && *pBytesInt > iStrategyLimit)
-					*pBytesInt = iStrategyLimit;
-			}
-
 			return bytes;
 		}
 
-		// Record exists in BDB. Resize updated record.
-		// Update value of counter defined by byteCounterOffset 
-		static unsafe byte[] ModifyByteArray(byte[] bufferByteArr, int length, int iPayloadStorageLength, int iIncrementBy,
-			byte byteCounterOffset, int iStrategyLimit)
-		{
-			// Length is DBEntry Length, what is 4 bytes for each counter + 1 byte for version
-			//Length of record = Length - headerSize - versionbyte (in bytes)
-			int iCounterOffset = byteCounterOffset;
-			int iNumOfCountersInBDB = (length - iPayloadStorageLength - 1) / 4; // 4 is sizeof(int)
-			int iBytesToAllocate;
-
-			if (iCounterOffset >= iNumOfCountersInBDB)
-				iBytesToAllocate = length + (iCounterOffset - iNumOfCountersInBDB + 1) * 4; // resize
-			else
-				iBytesToAllocate = length;
-
-			Array.Resize(ref bufferByteArr, iBytesToAllocate);
-		
-			fixed (byte* pCounter = &bufferByteArr[iPayloadStorageLength + 1 + iCounterOffset * 4]) // 1
-			{
-				int* pCounterInt = (int*)pCounter;
-				*pCounterInt += iIncrementBy;
-
-				if (*pCounterInt < 0)
-					*pCounterInt = 0;
+		// Offset of PayloadStorage.LastUpdatedTicks in a stored record
+		private static readonly int LastUpdatedTicksOffset = GetLastUpdatedTicksOffset();
 
-				if (iStrategyLimit > 0 && *pCounterInt > iStrategyLimit)
-					*pCounterInt = iStrategyLimit;
-			}
-
-			return bufferByteArr;
+		static unsafe private int GetLastUpdatedTicksOffset()
+		{
+			PayloadStorage payloadStorage;
+			return (int)((byte*)&payloadStorage.LastUpdatedTicks - (byte*)&payloadStorage);
 		}
 
 		private static BerkeleyDbConfig GetConfig(RelayNodeConfig config)
@@ -506,7 +463,63 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 							  LockStatRegionWait =
 								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
 																		 BerkeleyDbCounters.PerformanceCounterIndexes.
-																			 LockStatRegionWait)
+																			 LockStatRegionWait),
+							  GroupCommitSize =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 GroupCommitSize),
+							  GroupCommitSizeBase =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 GroupCommitSizeBase),
+							  GroupCommitWaitTime =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 GroupCommitWaitTime),
+							  GroupCommitWaitTimeBase =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 GroupCommitWaitTimeBase),
+							  MaintenanceJobs =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceJobs),
+							  MaintenanceDeferrals =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceDeferrals),
+							  MaintenanceJobTime =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceJobTime),
+							  MaintenanceJobTimeBase =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceJobTimeBase),
+							  MaintenanceCompactPagesFreed =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceCompactPagesFreed),
+							  MaintenanceForegroundLatency =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 MaintenanceForegroundLatency),
+							  ContentionDeadlocks =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 ContentionDeadlocks),
+							  ContentionRetries =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 ContentionRetries),
+							  ContentionRetryTime =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 ContentionRetryTime),
+							  ContentionRetriesExhausted =
+								  BerkeleyDbCounters.Instance.GetCounter(GetInstanceName(),
+																		 BerkeleyDbCounters.PerformanceCounterIndexes.
+																			 ContentionRetriesExhausted)
 						  };
 
 
@@ -842,6 +855,7 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 			short typeId = message.TypeId;
 			int objectId = message.Id;
 			byte[] key = message.ExtendedId;
+			long started = Stopwatch.GetTimestamp();
 
 			if (Log.IsDebugEnabled)
 			{
@@ -874,73 +888,83 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 								{
 
 									bool bRaceCondition = false;
-									success = storage.SaveObject(typeId, objectId, key,
-										(int)startPosition, length, delegate(DatabaseEntry dbEntry)
-										{
-											if (dbEntry.Length > 0)
+									// a newer record, or a new one, is settled natively under the record lock
+									byteArray = SerializePayload(message.Payload);
+									bool saved;
+									long storedTicks;
+									success = storage.CompareAndSetObject(typeId, objectId, key, byteArray, LastUpdatedTicksOffset,
+										out saved, out storedTicks);
+									if (success && !saved)
+									{
+										// the stored record is as new or newer, so it decides what is kept
+										success = storage.SaveObject(typeId, objectId, key,
+											(int)startPosition, length, delegate(DatabaseEntry dbEntry)
 											{
-												// found a record. check the lastupdateticks 
-												long clientValue = message.Payload.LastUpdatedTicks;
-												PayloadStorage storedValue;
-												fixed (byte* pBytes = &dbEntry.Buffer[0])
+												if (dbEntry.Length > 0)
 												{
-													storedValue = *(PayloadStorage*)pBytes;
+													// found a record. check the lastupdateticks 
+													long clientValue = message.Payload.LastUpdatedTicks;
+													PayloadStorage storedValue;
+													fixed (byte* pBytes = &dbEntry.Buffer[0])
+													{
+														storedValue = *(PayloadStorage*)pBytes;
+													}
+
+													if (clientValue > storedValue.LastUpdatedTicks)
+													{
+														// this is a good set.  
+														// does not matter if record was deactivated...
+														byteArray = SerializePayload(message.Payload);
+														dbEntry.Buffer = byteArray;
+														dbEntry.StartPosition = 0;
+														dbEntry.Length = byteArray.Length;
+													}
+													else if (clientValue < storedValue.LastUpdatedTicks)
+													{
+														// not a good thing.  this update is older than whats stored
+														// deactivate this record!
+														message.Payload.LastUpdatedTicks = storedValue.LastUpdatedTicks;
+														byteArray = SerializePayload(message.Payload, true); // true for deactivation!
+														dbEntry.Buffer = byteArray;
+														dbEntry.StartPosition = 0;
+														dbEntry.Length = byteArray.Length;
+														BerkeleyDbCounters.Instance.IncrementCounter(GetInstanceName(), BerkeleyDbCounters.PerformanceCounterIndexes.RaceDeletes);
+														bRaceCondition = true;
+													}
+													else if (storedValue.Deactivated == false && clientValue == storedValue.LastUpdatedTicks)
+													{
+														// client and stored lastUpdateTime are equal.  Store existing record
+														// with dateTime.Now.Ticks
+														message.Payload.LastUpdatedTicks = DateTime.Now.Ticks;
+														byteArray = SerializePayload(message.Payload); // keep it that way it was with 
+														dbEntry.Buffer = byteArray;
+														dbEntry.StartPosition = 0;
+														dbEntry.Length = byteArray.Length;
+													}
+													else if (storedValue.Deactivated && clientValue == storedValue.LastUpdatedTicks)
+													{
+														// client and stored lastUpdateTime are equal and
+														// the record has already been deactivated. 'do-nothing'!
+														// this will keep the existing stored timestamp.
+														message.Payload.LastUpdatedTicks = storedValue.LastUpdatedTicks;
+														byteArray = SerializePayload(message.Payload, true); // keep it that way it was with 
+														dbEntry.Buffer = byteArray;
+														dbEntry.StartPosition = 0;
+														dbEntry.Length = byteArray.Length;
+														BerkeleyDbCounters.Instance.IncrementCounter(GetInstanceName(), BerkeleyDbCounters.PerformanceCounterIndexes.RaceDeletes);
+														bRaceCondition = true;
+													}
 												}
-
-												if (clientValue > storedValue.LastUpdatedTicks)
+												else
 												{
-													// this is a good set.  
-													// does not matter if record was deactivated...
+													// did not find an existing record
 													byteArray = SerializePayload(message.Payload);
 													dbEntry.Buffer = byteArray;
 													dbEntry.StartPosition = 0;
 													dbEntry.Length = byteArray.Length;
 												}
-												else if (clientValue < storedValue.LastUpdatedTicks)
-												{
-													// not a good thing.  this update is older than whats stored
-													// deactivate this record!
-													message.Payload.LastUpdatedTicks = storedValue.LastUpdatedTicks;
-													byteArray = SerializePayload(message.Payload, true); // true for deactivation!
-													dbEntry.Buffer = byteArray;
-													dbEntry.StartPosition = 0;
-													dbEntry.Length = byteArray.Length;
-													BerkeleyDbCounters.Instance.IncrementCounter(GetInstanceName(), BerkeleyDbCounters.PerformanceCounterIndexes.RaceDeletes);
-													bRaceCondition = true;
-												}
-												else if (storedValue.Deactivated == false && clientValue == storedValue.LastUpdatedTicks)
-												{
-													// client and stored lastUpdateTime are equal.  Store existing record
-													// with dateTime.Now.Ticks
-													message.Payload.LastUpdatedTicks = DateTime.Now.Ticks;
-													byteArray = SerializePayload(message.Payload); // keep it that way it was with 
-													dbEntry.Buffer = byteArray;
-													dbEntry.StartPosition = 0;
-													dbEntry.Length = byteArray.Length;
-												}
-												else if (storedValue.Deactivated && clientValue == storedValue.LastUpdatedTicks)
-												{
-													// client and stored lastUpdateTime are equal and
-													// the record has already been deactivated. 'do-nothing'!
-													// this will keep the existing stored timestamp.
-													message.Payload.LastUpdatedTicks = storedValue.LastUpdatedTicks;
-													byteArray = SerializePayload(message.Payload, true); // keep it that way it was with 
-													dbEntry.Buffer = byteArray;
-													dbEntry.StartPosition = 0;
-													dbEntry.Length = byteArray.Length;
-													BerkeleyDbCounters.Instance.IncrementCounter(GetInstanceName(), BerkeleyDbCounters.PerformanceCounterIndexes.RaceDeletes);
-													bRaceCondition = true;
-												}
-											}
-											else
-											{
-												// did not find an existing record
-												byteArray = SerializePayload(message.Payload);
-												dbEntry.Buffer = byteArray;
-												dbEntry.StartPosition = 0;
-												dbEntry.Length = byteArray.Length;
-											}
-										});
+											});
+									}
 									MarkOutcome(message, success);
 									BerkeleyDbCounters.Instance.CountSave(GetInstanceName(), (success && !bRaceCondition), byteArray.Length);
 								}
@@ -964,30 +988,15 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 								int iVersion = message.Payload.ByteArray[0]; // Assumes standard serialization
 								int iIncrementBy = updateMessage.IncrementBy;
 								int iStrategyLimit = updateMessage.StrategyLimit;
-								// we want to pull the PayloadStorage out of the stored record for comparison.
-								const long startPosition = 0;
 								int iPayloadStorageLength = sizeof(PayloadStorage);
-								int length = 0;
-								// length calculated for existing record in GetLengthForDBRecord
-								success = storage.SaveObject(typeId, objectId, key, (int)startPosition, length,
-										delegate(DatabaseEntry dbEntry)
-										{
-											byte[] btBuffer = GetDBRecord(typeId, objectId, key);
-
-											if (btBuffer != null && btBuffer.Length > sizeof(PayloadStorage))
-												byteArray = ModifyByteArray(btBuffer, btBuffer.Length, iPayloadStorageLength,
-													iIncrementBy, byteCounterOffset, iStrategyLimit);
-											else // no record in BDB
-												byteArray = CreateCounterBytes(SerializePayloadHeader(message.Payload), iVersion, byteCounterOffset,
-													iPayloadStorageLength, iIncrementBy, iStrategyLimit);
-
-											dbEntry.Buffer = byteArray;
-											dbEntry.StartPosition = 0;
-											dbEntry.Length = byteArray.Length;
-										});
+								// header, version byte, then 4 bytes for each counter
+								int iCounterPosition = iPayloadStorageLength + 1 + byteCounterOffset * sizeof(int);
+								success = storage.IncrementCounter(typeId, objectId, key,
+									CreateCounterHeader(SerializePayloadHeader(message.Payload), iVersion, iPayloadStorageLength),
+									iCounterPosition, iIncrementBy, 0, iStrategyLimit > 0 ? iStrategyLimit : int.MaxValue);
 
 								MarkOutcome(message, success);
-								BerkeleyDbCounters.Instance.CountSave(GetInstanceName(), success, byteArray.Length);
+								BerkeleyDbCounters.Instance.CountSave(GetInstanceName(), success, iCounterPosition + sizeof(int));
 							}
 							break;
 						case MessageType.Delete:
@@ -1039,6 +1048,14 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 				message.ResultDetails = exc.ToString();
 				throw;
 			}
+			finally
+			{
+				// lets background maintenance back off while requests are slow
+				if (storage != null)
+				{
+					storage.ReportRequestLatency(Stopwatch.GetTimestamp() - started);
+				}
+			}
 		}
 
 		private static void MarkOutcome(RelayMessage message, bool success)
@@ -1049,21 +1066,6 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 				message.ResultOutcome = RelayOutcome.Error; //should this be fail?
 		}
 
-		private byte[] GetDBRecord(short typeId, int objectId, byte[] key)
-		{
-			byte[] byteDbEntry = null;
-
-			storage.GetDbObject(typeId, objectId, key,
-								dbEntry =>
-									{
-										if (dbEntry == null) throw new ArgumentNullException("dbEntry");
-										byteDbEntry = dbEntry.Buffer;
-										Array.Resize(ref byteDbEntry, dbEntry.Length);
-									});
-
-			return byteDbEntry;
-		}
-
 		private int GetPayloadForMessage(RelayMessage message, short typeId, int objectId, byte[] key)
 		{
 			int len = 0;
@@ -1075,6 +1077,12 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 					payload = DeserializePayload(typeId, objectId, dbEntry.Buffer, dbEntry.StartPosition, len);
 				});
 
+			SetPayloadForMessage(message, payload);
+			return len;
+		}
+
+		private static void SetPayloadForMessage(RelayMessage message, RelayPayload payload)
+		{
 			if (payload != null)
 			{
 				if (Log.IsDebugEnabled)
@@ -1100,7 +1108,6 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 			{
 				message.Freshness = null;
 			}
-			return len;
 		}
 
 		private static UpdateMsg GetUpdateMsg(byte[] byteUpdate)
@@ -1117,9 +1124,155 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
 
 		public void HandleMessages(IList<RelayMessage> messages)
 		{
-			for (int i = 0; i < messages.Count; i++)
+			ThrottleThreads throttleThreads = bdbConfig.ThrottleThreads;
+			if (storage == null || (throttleThreads != null && throttleThreads.Enabled))
+			{
+				for (int i = 0; i < messages.Count; i++)
+				{
+					HandleMessage(messages[i]);
+				}
+				return;
+			}
+
+			// consecutive gets, saves and deletes are handed to the storage as one batch so
+			// that each federated database is hit with one transaction instead of one per message.
+			int start = 0;
+			while (start < messages.Count)
+			{
+				BatchKind kind = GetBatchKind(messages[start]);
+				int end = start + 1;
+				if (kind != BatchKind.None)
+				{
+					while (end < messages.Count && GetBatchKind(messages[end]) == kind)
+					{
+						end++;
+					}
+				}
+				if (end - start == 1)
+				{
+					HandleMessage(messages[start]);
+				}
+				else
+				{
+					PostMessages(kind, messages, start, end - start);
+				}
+				start = end;
+			}
+		}
+		#endregion
+
+		#region Batching
+		private enum BatchKind
+		{
+			None,
+			Get,
+			Save,
+			Delete
+		}
+
+		private BatchKind GetBatchKind(RelayMessage message)
+		{
+			switch (message.MessageType)
+			{
+				case MessageType.Get:
+					return BatchKind.Get;
+				case MessageType.Save:
+				case MessageType.SaveWithConfirm:
+					bool bHasKey;
+					if (message.Payload == null ||
+						(RaceConditionLookup.TryGetValue(message.TypeId, out bHasKey) && bHasKey))
+					{
+						return BatchKind.None;
+					}
+					return BatchKind.Save;
+				case MessageType.Delete:
+				case MessageType.DeleteWithConfirm:
+					return BatchKind.Delete;
+				default:
+					return BatchKind.None;
+			}
+		}
+
+		private void PostMessages(BatchKind kind, IList<RelayMessage> messages, int offset, int count)
+		{
+			var typeIds = new short[count];
+			var objectIds = new int[count];
+			var keys = new byte[count][];
+			for (int i = 0; i < count; i++)
+			{
+				RelayMessage message = messages[offset + i];
+				typeIds[i] = message.TypeId;
+				objectIds[i] = message.Id;
+				keys[i] = message.ExtendedId;
+			}
+			long started = Stopwatch.GetTimestamp();
+
+			if (Log.IsDebugEnabled)
+			{
+				Log.DebugFormat("PostMessages() Posts {0} {1} messages to BerkeleyDb", count, kind);
+			}
+			try
+			{
+				bool[] results;
+				switch (kind)
+				{
+					case BatchKind.Get:
+						var payloads = new RelayPayload[count];
+						var lengths = new int[count];
+						storage.GetDbObjects(typeIds, objectIds, keys,
+							delegate(int index, DatabaseEntry dbEntry)
+							{
+								lengths[index] = dbEntry.Length;
+								payloads[index] = DeserializePayload(typeIds[index], objectIds[index],
+									dbEntry.Buffer, dbEntry.StartPosition, dbEntry.Length);
+							});
+						for (int i = 0; i < count; i++)
+						{
+							RelayMessage message = messages[offset + i];
+							SetPayloadForMessage(message, payloads[i]);
+							BerkeleyDbCounters.Instance.CountGet(GetInstanceName(), (message.Payload != null), lengths[i]);
+							MarkOutcome(message, true);
+						}
+						break;
+					case BatchKind.Save:
+						var byteArrays = new byte[count][];
+						for (int i = 0; i < count; i++)
+						{
+							byteArrays[i] = SerializePayload(messages[offset + i].Payload);
+						}
+						results = storage.SaveObjects(typeIds, objectIds, keys, byteArrays);
+						for (int i = 0; i < count; i++)
+						{
+							MarkOutcome(messages[offset + i], results[i]);
+							BerkeleyDbCounters.Instance.CountSave(GetInstanceName(), results[i], byteArrays[i].Length);
+						}
+						break;
+					case BatchKind.Delete:
+						results = storage.DeleteObjects(typeIds, objectIds, keys);
+						for (int i = 0; i < count; i++)
+						{
+							MarkOutcome(messages[offset + i], results[i]);
+							BerkeleyDbCounters.Instance.IncrementCounter(GetInstanceName(), BerkeleyDbCounters.PerformanceCounterIndexes.Delete);
+						}
+						break;
+					default:
+						throw new ApplicationException("Message type cannot be batched: " + kind);
+				}
+			}
+			catch (Exception exc)
+			{
+				for (int i = 0; i < count; i++)
+				{
+					RelayMessage message = messages[offset + i];
+					MarkOutcome(message, false);
+					message.ResultDetails = exc.ToString();
+				}
+				throw;
+			}
+			finally
 			{
-				HandleMessage(messages[i]);
+				// every message in the batch waited for the whole batch
+				storage.ReportRequestLatency(Stopwatch.GetTimestamp() - started);
 			}
 		}
 		#endregion
@@ -98,6 +98,26 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
             LockStatLockRegionSize = 57,                        //The size of the lock region, in bytes. 
             LockStatRegionWait = 58,                            //The number of times that a thread of control was forced to wait before obtaining the lock region mutex. 
             LockStatRegionNoWait = 59,                          //The number of times that a thread of control was able to obtain the lock region mutex without waiting. 
+
+            // group commit counters
+            GroupCommitSize = 60,
+            GroupCommitSizeBase = 61,
+            GroupCommitWaitTime = 62,
+            GroupCommitWaitTimeBase = 63,
+
+            // maintenance scheduler counters
+            MaintenanceJobs = 64,
+            MaintenanceDeferrals = 65,
+            MaintenanceJobTime = 66,
+            MaintenanceJobTimeBase = 67,
+            MaintenanceCompactPagesFreed = 68,
+            MaintenanceForegroundLatency = 69,
+
+            // deadlock contention counters
+            ContentionDeadlocks = 70,
+            ContentionRetries = 71,
+            ContentionRetryTime = 72,
+            ContentionRetriesExhausted = 73,
         }
 
 		public static readonly string[] PerformanceCounterNames = { 			
@@ -166,7 +186,27 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
             "LockStat-Lock hash bucket max length", 
             "LockStat-Size of the lock region bytes",
             "LockStat-Lock region mutex - wait count", 
-            "LockStat-Lock region mutex - not waintng count" 
+            "LockStat-Lock region mutex - not waintng count",
+
+            // group commit counters
+            "Avg Group Commit Size",
+            "Avg Group Commit Size Base",
+            "Avg Group Commit Wait Time",
+            "Avg Group Commit Wait Time Base",
+
+            // maintenance scheduler counters
+            "Maintenance Jobs/Sec",
+            "Maintenance Deferrals/Sec",
+            "Avg Maintenance Job Time",
+            "Avg Maintenance Job Time Base",
+            "Maintenance Compact Pages Freed",
+            "Maintenance Foreground Latency",
+
+            // deadlock contention counters
+            "Deadlocks",
+            "Deadlock Retries",
+            "Deadlock Retry Time",
+            "Deadlock Retries Exhausted"
 		};
 
 		public static readonly string[] PerformanceCounterHelp = { 
@@ -235,7 +275,27 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
             "Maximum length of a lock hash bucket",
             "The size of the lock region, in bytes",
             "The number of times that a thread of control was forced to wait before obtaining the lock region mutex",
-            "The number of times that a thread of control was able to obtain the lock region mutex without waiting"
+            "The number of times that a thread of control was able to obtain the lock region mutex without waiting",
+
+            // group commit counters
+            "Average number of commits made durable by one group commit log flush",
+            "Base for Avg Group Commit Size",
+            "Average time a group commit writer waits for its group's log flush",
+            "Base for Avg Group Commit Wait Time",
+
+            // maintenance scheduler counters
+            "Background maintenance jobs (checkpoint, trickle, compaction slice, deadlock detection) run per second",
+            "Due maintenance jobs held back per second by foreground latency or an exhausted budget",
+            "Average time taken by one maintenance job",
+            "Base for Avg Maintenance Job Time",
+            "Total pages freed by compaction slices",
+            "Average foreground request latency in microseconds, as seen by the maintenance scheduler",
+
+            // deadlock contention counters
+            "Total operations chosen as deadlock victims",
+            "Total retries made after deadlocks",
+            "Total milliseconds spent retrying deadlocked operations",
+            "Total operations that gave up after their last deadlock retry"
 		};
 
 		public static readonly PerformanceCounterType[] PerformanceCounterTypes = { 			
@@ -304,7 +364,27 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
             PerformanceCounterType.NumberOfItems32,
             PerformanceCounterType.NumberOfItems32,
             PerformanceCounterType.NumberOfItems32,
-            PerformanceCounterType.NumberOfItems32
+            PerformanceCounterType.NumberOfItems32,
+
+            // group commit counters
+            PerformanceCounterType.AverageCount64,
+            PerformanceCounterType.AverageBase,
+            PerformanceCounterType.AverageTimer32,
+            PerformanceCounterType.AverageBase,
+
+            // maintenance scheduler counters
+            PerformanceCounterType.RateOfCountsPerSecond32,
+            PerformanceCounterType.RateOfCountsPerSecond32,
+            PerformanceCounterType.AverageTimer32,
+            PerformanceCounterType.AverageBase,
+            PerformanceCounterType.NumberOfItems64,
+            PerformanceCounterType.NumberOfItems32,
+
+            // deadlock contention counters
+            PerformanceCounterType.NumberOfItems64,
+            PerformanceCounterType.NumberOfItems64,
+            PerformanceCounterType.NumberOfItems64,
+            PerformanceCounterType.NumberOfItems64
 		};
 
 		#endregion
@@ -527,6 +607,23 @@ namespace MySpace.DataRelay.RelayComponent.BerkeleyDb
             perfCounter[(int)PerformanceCounterIndexes.LockStatLockRegionSize].RawValue = 0;
             perfCounter[(int)PerformanceCounterIndexes.LockStatRegionWait].RawValue = 0;
             perfCounter[(int)PerformanceCounterIndexes.LockStatRegionNoWait].RawValue = 0;
+
+            perfCounter[(int)PerformanceCounterIndexes.GroupCommitSize].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.GroupCommitSizeBase].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.GroupCommitWaitTime].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.GroupCommitWaitTimeBase].RawValue = 0;
+
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceJobs].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceDeferrals].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceJobTime].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceJobTimeBase].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceCompactPagesFreed].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.MaintenanceForegroundLatency].RawValue = 0;
+
+            perfCounter[(int)PerformanceCounterIndexes.ContentionDeadlocks].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.ContentionRetries].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.ContentionRetryTime].RawValue = 0;
+            perfCounter[(int)PerformanceCounterIndexes.ContentionRetriesExhausted].RawValue = 0;
         }
 
 		public void Shutdown()
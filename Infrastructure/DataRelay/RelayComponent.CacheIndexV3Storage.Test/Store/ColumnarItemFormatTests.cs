@@ -0,0 +1,191 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common.IO;
+using MySpace.DataRelay.Common.Interfaces.Query.IndexCacheV3;
+using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Context;
+using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store;
+
+namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Test.Store
+{
+    /// <summary>
+    /// Round trips item lists through <see cref="ColumnarItemWriter"/> and <see cref="ColumnarItemReader"/>.
+    /// </summary>
+    [TestClass]
+    public class ColumnarItemFormatTests
+    {
+        private static InDeserializationContext CreateContext()
+        {
+            return new InDeserializationContext(0, "TestIndex", new byte[] { 1 }, 1, null, false, null, false, false,
+                null, null, null, null, null, null, false, null, DomainSpecificProcessingType.None, null, null, null);
+        }
+
+        private static byte[] Value(string tagName, int item)
+        {
+            return Encoding.UTF8.GetBytes(tagName + item);
+        }
+
+        // Every item has tag "a"; even items have "b"; every third item has "c" with an empty value.
+        private static InternalItemList CreateItems(int count)
+        {
+            var items = new InternalItemList();
+            for (var i = 0; i < count; ++i)
+            {
+                var item = new InternalItem { ItemId = BitConverter.GetBytes(i) };
+                item.UpdateTag(TagHashCollection.GetTagHashCode("a"), Value("a", i));
+                if (i % 2 == 0)
+                {
+                    item.UpdateTag(TagHashCollection.GetTagHashCode("b"), Value("b", i));
+                }
+                if (i % 3 == 0)
+                {
+                    item.UpdateTag(TagHashCollection.GetTagHashCode("c"), new byte[0]);
+                }
+                items.Add(item);
+            }
+            return items;
+        }
+
+        private static ColumnarItemReader RoundTrip(InternalItemList items, InDeserializationContext context)
+        {
+            var stream = new MemoryStream();
+            ColumnarItemWriter.Serialize(new CompactBinaryWriter(new BinaryWriter(stream)), items, context);
+            stream.Position = 0;
+            return new ColumnarItemReader(new CompactBinaryReader(stream), context);
+        }
+
+        private static void AssertItemsRead(int count)
+        {
+            var context = CreateContext();
+            var reader = RoundTrip(CreateItems(count), context);
+
+            for (var i = 0; i < count; ++i)
+            {
+                reader.MoveNext();
+                byte[] value;
+
+                CollectionAssert.AreEqual(BitConverter.GetBytes(i), reader.ItemId, "Item " + i);
+                Assert.IsTrue(reader.TryGetTagValue("a", out value));
+                CollectionAssert.AreEqual(Value("a", i), value);
+                Assert.AreEqual(i % 2 == 0, reader.TryGetTagValue("b", out value), "Item " + i);
+                if (i % 2 == 0)
+                {
+                    CollectionAssert.AreEqual(Value("b", i), value);
+                }
+                // an empty value is present but has no bytes
+                Assert.AreEqual(i % 3 == 0, reader.TryGetTagValue("c", out value), "Item " + i);
+                Assert.IsNull(value);
+                Assert.IsFalse(reader.TryGetTagValue("missing", out value));
+            }
+        }
+
+        [TestMethod]
+        public void SingleBlockRoundTrips()
+        {
+            AssertItemsRead(10);
+        }
+
+        [TestMethod]
+        public void FullBlockRoundTrips()
+        {
+            AssertItemsRead(ColumnarItemWriter.BlockSize);
+        }
+
+        [TestMethod]
+        public void ManyBlocksRoundTrip()
+        {
+            AssertItemsRead(ColumnarItemWriter.BlockSize * 2 + 7);
+        }
+
+        [TestMethod]
+        public void ToInternalItemKeepsPresentTags()
+        {
+            var items = CreateItems(ColumnarItemWriter.BlockSize + 1);
+            var reader = RoundTrip(items, CreateContext());
+
+            for (var i = 0; i < items.Count; ++i)
+            {
+                reader.MoveNext();
+
+                var item = reader.ToInternalItem();
+
+                CollectionAssert.AreEqual(items[i].ItemId, item.ItemId);
+                Assert.AreEqual(items[i].TagList.Count, item.TagList.Count, "Item " + i);
+                var tags = new Dictionary<int, byte[]>();
+                foreach (var tag in item.TagList)
+                {
+                    tags.Add(tag.Key, tag.Value);
+                }
+                foreach (var tag in items[i].TagList)
+                {
+                    byte[] value;
+                    Assert.IsTrue(tags.TryGetValue(tag.Key, out value), "Item " + i + " lost tag " + tag.Key);
+                    if (tag.Value.Length == 0)
+                    {
+                        Assert.IsNull(value);
+                    }
+                    else
+                    {
+                        CollectionAssert.AreEqual(tag.Value, value);
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ItemsWithoutTagsRoundTrip()
+        {
+            var items = new InternalItemList();
+            items.Add(new InternalItem { ItemId = new byte[] { 1, 2, 3 } });
+            items.Add(new InternalItem { ItemId = new byte[] { 4 } });
+            var reader = RoundTrip(items, CreateContext());
+            byte[] value;
+
+            reader.MoveNext();
+            CollectionAssert.AreEqual(new byte[] { 1, 2, 3 }, reader.ItemId);
+            Assert.IsFalse(reader.TryGetTagValue("a", out value));
+            Assert.IsNull(reader.ToInternalItem().TagList);
+            reader.MoveNext();
+            CollectionAssert.AreEqual(new byte[] { 4 }, reader.ItemId);
+        }
+
+        [TestMethod]
+        public void BlocksHaveTheirOwnColumns()
+        {
+            // the tags of the second block are all different from the first's
+            var items = new InternalItemList();
+            for (var i = 0; i < ColumnarItemWriter.BlockSize + 1; ++i)
+            {
+                var item = new InternalItem { ItemId = BitConverter.GetBytes(i) };
+                var tagName = i < ColumnarItemWriter.BlockSize ? "first" : "second";
+                item.UpdateTag(TagHashCollection.GetTagHashCode(tagName), Value(tagName, i));
+                items.Add(item);
+            }
+            var reader = RoundTrip(items, CreateContext());
+            byte[] value;
+
+            for (var i = 0; i < ColumnarItemWriter.BlockSize; ++i)
+            {
+                reader.MoveNext();
+            }
+            Assert.IsTrue(reader.TryGetTagValue("first", out value));
+            reader.MoveNext();
+
+            Assert.IsFalse(reader.TryGetTagValue("first", out value));
+            Assert.IsTrue(reader.TryGetTagValue("second", out value));
+            CollectionAssert.AreEqual(Value("second", ColumnarItemWriter.BlockSize), value);
+        }
+
+        [TestMethod]
+        [ExpectedException(typeof(Exception))]
+        public void EmptyItemIdIsRejected()
+        {
+            var items = new InternalItemList();
+            items.Add(new InternalItem { ItemId = new byte[0] });
+
+            RoundTrip(items, CreateContext());
+        }
+    }
+}
@@ -92,6 +92,10 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Config
         [XmlElement("IsMetadataPropertyCollection")]
         public bool IsMetadataPropertyCollection;
 
+        // Indexes are written in the columnar format once every server of the type can read it
+        [XmlElement("ColumnarSerialization")]
+        public bool ColumnarSerialization;
+
         [XmlElement("QueryOverrideSettings")]
         public QueryOverrideSettings QueryOverrideSettings;
 
@@ -334,6 +334,8 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Context
 
             LegacySerializationUtil.Instance.InitializeLegacySerializtionTypes(nodeConfig.TypeSettings, storageConfiguration.CacheIndexV3StorageConfig.SupportLegacySerialization);
 
+            ColumnarSerializationUtil.Instance.InitializeColumnarSerializationTypes(storageConfiguration.CacheIndexV3StorageConfig.IndexTypeMappingCollection);
+
 
             #region init performance counters
 
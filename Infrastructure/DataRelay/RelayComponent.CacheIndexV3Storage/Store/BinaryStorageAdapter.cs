@@ -1,4 +1,5 @@
 ﻿using System;
+using System.IO;
 using System.Runtime.InteropServices;
 using MySpace.ResourcePool;
 using MySpace.Storage;
@@ -57,6 +58,42 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
             return resultBytes;
         }
 
+        /// <summary>
+        /// Reads a whole entry as a stream positioned after its header, or null if the entry
+        /// is missing or has no value. Stores that stream data lend the entry's native memory
+        /// to the stream instead of copying it into arrays; the caller must dispose it.
+        /// </summary>
+        public static Stream GetStream(IBinaryStorage store, short typeId, int primaryId, byte[] extendedId)
+        {
+            var key = new StorageKey(extendedId, primaryId);
+            Stream entry;
+
+            if (store.StreamsData)
+            {
+                entry = store.Get(typeId, key);
+            }
+            else
+            {
+                byte[] dbEntry = store.GetBuffer(typeId, key);
+                entry = dbEntry == null ? null : new MemoryStream(dbEntry, false);
+            }
+
+            if (entry == null)
+            {
+                return null;
+            }
+
+            if (entry.Length <= BdbHeaderSize)
+            {
+                entry.Dispose();
+                return null;
+            }
+
+            entry.Seek(BdbHeaderSize, SeekOrigin.Begin);
+
+            return entry;
+        }
+
         public static bool Delete(IBinaryStorage store, short typeId, int primaryId, byte[] extendedId)
         {
             return store.Delete(typeId, new StorageKey(extendedId, primaryId));
@@ -297,10 +297,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
             // Note: If InDeserializationContext.DeserializeHeaderOnly property is set then InDeserializationContext.UnserializedCacheIndexInternal shall hold all CacheIndexInternal 
             // payload except metadata and virtual count. This code path will only be used if just header info like 
             // virtual count needs to be updated keeping rest of the index untouched
-            if (InDeserializationContext.DeserializeHeaderOnly &&
-                outDeserializationContext != null &&
-                outDeserializationContext.UnserializedCacheIndexInternal != null &&
-                outDeserializationContext.UnserializedCacheIndexInternal.Length != 0)
+            if (IsHeaderOnlyUpdate)
             {
                 //Count
                 writer.Write(outDeserializationContext.TotalCount);
@@ -315,6 +312,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                 {
                     writer.Write(0);
                 }
+                else if (CurrentVersion >= COLUMNAR_VERSION)
+                {
+                    writer.Write(InternalItemList.Count);
+                    ColumnarItemWriter.Serialize(writer, InternalItemList, InDeserializationContext);
+                }
                 else
                 {
                     writer.Write(InternalItemList.Count);
@@ -381,6 +383,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         public void Deserialize(IPrimitiveReader reader, int version)
         {
             ushort len;
+            deserializedVersion = version;
 
             //Metadata or MetadataPropertyCollection
             if (InDeserializationContext.IsMetadataPropertyCollection)
@@ -452,8 +455,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
 
                 #region Populate InternalItemList
 
-                InternalItem internalItem;
+                IItem item;
                 bool enterConditionPassed = false;
+                ColumnarItemReader columnarItemReader = version >= COLUMNAR_VERSION ?
+                    new ColumnarItemReader(reader, InDeserializationContext) :
+                    null;
 
                 InternalItemList = new InternalItemList();
                 GroupByResult = new GroupByResult(new BaseComparer(InDeserializationContext.PrimarySortInfo.IsTag, InDeserializationContext.PrimarySortInfo.FieldName, InDeserializationContext.PrimarySortInfo.SortOrderList));
@@ -470,18 +476,27 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
 
                     #region Deserialize ItemId
 
-                    len = reader.ReadUInt16();
-                    if (len > 0)
+                    if (columnarItemReader != null)
                     {
-                        internalItem = new InternalItem
-                                           {
-                                               ItemId = reader.ReadBytes(len)
-                                           };
+                        // the reader stands in for the item until it is kept
+                        columnarItemReader.MoveNext();
+                        item = columnarItemReader;
                     }
                     else
                     {
-                        throw new Exception("Invalid ItemId - is null or length is zero for IndexId : " +
-                                            IndexCacheUtils.GetReadableByteArray(InDeserializationContext.IndexId));
+                        len = reader.ReadUInt16();
+                        if (len > 0)
+                        {
+                            item = new InternalItem
+                                       {
+                                           ItemId = reader.ReadBytes(len)
+                                       };
+                        }
+                        else
+                        {
+                            throw new Exception("Invalid ItemId - is null or length is zero for IndexId : " +
+                                                IndexCacheUtils.GetReadableByteArray(InDeserializationContext.IndexId));
+                        }
                     }
 
                     #endregion
@@ -499,21 +514,24 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region enter condition processing
 
-                                if (FilterPassed(internalItem, InDeserializationContext.EnterCondition))
+                                if (FilterPassed(item, InDeserializationContext.EnterCondition))
                                 {
-                                    if (InDeserializationContext.ExitCondition != null && !FilterPassed(internalItem, InDeserializationContext.ExitCondition))
+                                    if (InDeserializationContext.ExitCondition != null && !FilterPassed(item, InDeserializationContext.ExitCondition))
                                     {
                                         // no need to search beyond this point
                                         break;
                                     }
 
                                     enterConditionPassed = true;
-                                    DeserializeTags(internalItem, InDeserializationContext, OutDeserializationContext, reader);
-                                    ApplyFilterAndAddItem(internalItem);
+                                    DeserializeTags(item, InDeserializationContext, OutDeserializationContext, reader);
+                                    ApplyFilterAndAddItem(item);
                                 }
                                 else
                                 {
-                                    SkipDeserializeInternalItem(reader);
+                                    if (columnarItemReader == null)
+                                    {
+                                        SkipDeserializeInternalItem(reader);
+                                    }
                                     // no filter processing required
                                 }
 
@@ -523,11 +541,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region exit condition processing
 
-                                if (FilterPassed(internalItem, InDeserializationContext.ExitCondition))
+                                if (FilterPassed(item, InDeserializationContext.ExitCondition))
                                 {
                                     // since item passed exit filter, we keep it.
-                                    DeserializeTags(internalItem, InDeserializationContext, OutDeserializationContext, reader);
-                                    ApplyFilterAndAddItem(internalItem);
+                                    DeserializeTags(item, InDeserializationContext, OutDeserializationContext, reader);
+                                    ApplyFilterAndAddItem(item);
                                 }
                                 else
                                 {
@@ -541,8 +559,8 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region enter condition processing when no exit condition exists
 
-                                DeserializeTags(internalItem, InDeserializationContext, OutDeserializationContext, reader);
-                                ApplyFilterAndAddItem(internalItem);
+                                DeserializeTags(item, InDeserializationContext, OutDeserializationContext, reader);
+                                ApplyFilterAndAddItem(item);
 
                                 #endregion
                             }
@@ -556,8 +574,8 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             #region Deserialize InternalItem and fetch PrimarySortTag value
 
                             byte[] tagValue;
-                            DeserializeTags(internalItem, InDeserializationContext, OutDeserializationContext, reader);
-                            if (!internalItem.TryGetTagValue(InDeserializationContext.PrimarySortInfo.FieldName, out tagValue))
+                            DeserializeTags(item, InDeserializationContext, OutDeserializationContext, reader);
+                            if (!item.TryGetTagValue(InDeserializationContext.PrimarySortInfo.FieldName, out tagValue))
                             {
                                 throw new Exception("PrimarySortTag Not found:  " + InDeserializationContext.PrimarySortInfo.FieldName);
                             }
@@ -568,16 +586,16 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region enter condition processing
 
-                                if (FilterPassed(internalItem, InDeserializationContext.EnterCondition))
+                                if (FilterPassed(item, InDeserializationContext.EnterCondition))
                                 {
-                                    if (InDeserializationContext.ExitCondition != null && !FilterPassed(internalItem, InDeserializationContext.ExitCondition))
+                                    if (InDeserializationContext.ExitCondition != null && !FilterPassed(item, InDeserializationContext.ExitCondition))
                                     {
                                         // no need to search beyond this point
                                         break;
                                     }
 
                                     enterConditionPassed = true;
-                                    ApplyFilterAndAddItem(internalItem);
+                                    ApplyFilterAndAddItem(item);
                                 }                               
 
                                 #endregion
@@ -586,10 +604,10 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region exit condition processing
 
-                                if (FilterPassed(internalItem, InDeserializationContext.ExitCondition))
+                                if (FilterPassed(item, InDeserializationContext.ExitCondition))
                                 {                                
                                     // since item passed exit filter, we keep it.
-                                    ApplyFilterAndAddItem(internalItem);
+                                    ApplyFilterAndAddItem(item);
                                 }
                                 else
                                 {
@@ -604,7 +622,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                             {
                                 #region enter condition processing when no exit condition exists
 
-                                ApplyFilterAndAddItem(internalItem);
+                                ApplyFilterAndAddItem(item);
 
                                 #endregion
                             }
@@ -618,8 +636,8 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                     {
                         #region No Enter/Exit Condition
 
-                        DeserializeTags(internalItem, InDeserializationContext, OutDeserializationContext, reader);
-                        ApplyFilterAndAddItem(internalItem);
+                        DeserializeTags(item, InDeserializationContext, OutDeserializationContext, reader);
+                        ApplyFilterAndAddItem(item);
 
                         #endregion
                     }
@@ -637,8 +655,8 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         /// <summary>
         /// Applies the filter and adds the item.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
-        private void ApplyFilterAndAddItem(InternalItem internalItem)
+        /// <param name="item">The item.</param>
+        private void ApplyFilterAndAddItem(IItem item)
         {
             if (InDeserializationContext.CapCondition != null &&
                 InDeserializationContext.CapCondition.FilterCaps != null &&
@@ -647,46 +665,46 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                 #region CapCondition Exists
 
                 byte[] tagValue;
-                if (internalItem.TryGetTagValue(InDeserializationContext.CapCondition.FieldName, out tagValue))
+                if (item.TryGetTagValue(InDeserializationContext.CapCondition.FieldName, out tagValue))
                 {
                     FilterCap filterCap;
                     if (InDeserializationContext.CapCondition.FilterCaps.TryGetValue(tagValue, out filterCap))
                     {
                         #region  Filter Cap found for tagValue
 
-                        if (filterCap.Cap > 0 && FilterPassed(internalItem, GetCappedOrParentFilter(filterCap)))
+                        if (filterCap.Cap > 0 && FilterPassed(item, GetCappedOrParentFilter(filterCap)))
                         {
                             filterCap.Cap--;
-                            ProcessAdditionalConstraintsAndAddItem(internalItem);
+                            ProcessAdditionalConstraintsAndAddItem(item);
                         }
 
                         #endregion
                     }
-                    else if (!InDeserializationContext.CapCondition.IgnoreNonCappedItems && FilterPassed(internalItem, InDeserializationContext.Filter))
+                    else if (!InDeserializationContext.CapCondition.IgnoreNonCappedItems && FilterPassed(item, InDeserializationContext.Filter))
                     {
                         #region Filter Cap not found for tagValue
 
-                        ProcessAdditionalConstraintsAndAddItem(internalItem);
+                        ProcessAdditionalConstraintsAndAddItem(item);
 
                         #endregion
                     }
                 }
-                else if (!InDeserializationContext.CapCondition.IgnoreNonCappedItems && FilterPassed(internalItem, InDeserializationContext.Filter))
+                else if (!InDeserializationContext.CapCondition.IgnoreNonCappedItems && FilterPassed(item, InDeserializationContext.Filter))
                 {
                     #region Apply parent filter
 
-                    ProcessAdditionalConstraintsAndAddItem(internalItem);
+                    ProcessAdditionalConstraintsAndAddItem(item);
 
                     #endregion
                 }
 
                 #endregion
             }
-            else if (FilterPassed(internalItem, InDeserializationContext.Filter))
+            else if (FilterPassed(item, InDeserializationContext.Filter))
             {
                 #region CapCondition Doesn't  Exist
 
-                ProcessAdditionalConstraintsAndAddItem(internalItem);
+                ProcessAdditionalConstraintsAndAddItem(item);
 
                 #endregion
             }
@@ -695,9 +713,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         /// <summary>
         /// Processes the additional constraints and add item.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
-        private void ProcessAdditionalConstraintsAndAddItem(InternalItem internalItem)
+        /// <param name="item">The item.</param>
+        private void ProcessAdditionalConstraintsAndAddItem(IItem item)
         {
+            InternalItem internalItem = ToInternalItem(item);
+
             // Domain specific processing
             if (InDeserializationContext.DomainSpecificProcessingType != DomainSpecificProcessingType.None)
             {
@@ -719,6 +739,17 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
             }
         }
 
+        /// <summary>
+        /// Gets the item as an <see cref="InternalItem"/>, building one if it is still in columnar form.
+        /// </summary>
+        /// <param name="item">The item.</param>
+        /// <returns>InternalItem</returns>
+        private static InternalItem ToInternalItem(IItem item)
+        {
+            ColumnarItemReader columnarItemReader = item as ColumnarItemReader;
+            return columnarItemReader != null ? columnarItemReader.ToInternalItem() : (InternalItem)item;
+        }
+
         /// <summary>
         /// Applies the grouping.
         /// </summary>
@@ -820,36 +851,41 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         /// <summary>
         /// Deserializes the internal item.
         /// </summary>
-        /// <param name="internalItem">The internal item</param>
+        /// <param name="item">The item</param>
         /// <param name="inDeserializationContext">The in deserialization context.</param>
         /// <param name="outDeserializationContext">The out deserialization context.</param>
         /// <param name="reader">The reader.</param>
-        private static void DeserializeTags(InternalItem internalItem,
+        private static void DeserializeTags(IItem item,
             InDeserializationContext inDeserializationContext,
             OutDeserializationContext outDeserializationContext,
             IPrimitiveReader reader)
         {
-            byte kvpListCount = reader.ReadByte();
-
-            if (kvpListCount > 0)
+            // a columnar item's tags are already in its block and are read as they are asked for
+            InternalItem internalItem = item as InternalItem;
+            if (internalItem != null)
             {
-                internalItem.TagList = new List<KeyValuePair<int, byte[]>>(kvpListCount);
-                for (byte j = 0; j < kvpListCount; j++)
+                byte kvpListCount = reader.ReadByte();
+
+                if (kvpListCount > 0)
                 {
-                    int tagHashCode = reader.ReadInt32();
-                    ushort tagValueLen = reader.ReadUInt16();
-                    byte[] tagValue = null;
-                    if (tagValueLen > 0)
+                    internalItem.TagList = new List<KeyValuePair<int, byte[]>>(kvpListCount);
+                    for (byte j = 0; j < kvpListCount; j++)
                     {
-                        tagValue = reader.ReadBytes(tagValueLen);
-                        if (inDeserializationContext.StringHashCodeDictionary != null &&
-                            inDeserializationContext.StringHashCodeDictionary.Count > 0 &&
-                            inDeserializationContext.StringHashCodeDictionary.ContainsKey(tagHashCode))
+                        int tagHashCode = reader.ReadInt32();
+                        ushort tagValueLen = reader.ReadUInt16();
+                        byte[] tagValue = null;
+                        if (tagValueLen > 0)
                         {
-                            tagValue = inDeserializationContext.StringHashCollection.GetStringByteArray(inDeserializationContext.TypeId, tagValue);
+                            tagValue = reader.ReadBytes(tagValueLen);
+                            if (inDeserializationContext.StringHashCodeDictionary != null &&
+                                inDeserializationContext.StringHashCodeDictionary.Count > 0 &&
+                                inDeserializationContext.StringHashCodeDictionary.ContainsKey(tagHashCode))
+                            {
+                                tagValue = inDeserializationContext.StringHashCollection.GetStringByteArray(inDeserializationContext.TypeId, tagValue);
+                            }
                         }
+                        internalItem.TagList.Add(new KeyValuePair<int, byte[]>(tagHashCode, tagValue));
                     }
-                    internalItem.TagList.Add(new KeyValuePair<int, byte[]>(tagHashCode, tagValue));
                 }
             }
 
@@ -859,11 +895,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                 byte[] distinctValue;
                 if (String.Equals(inDeserializationContext.GetDistinctValuesFieldName, "ItemId", StringComparison.OrdinalIgnoreCase))
                 {
-                    distinctValue = internalItem.ItemId;
+                    distinctValue = item.ItemId;
                 }
                 else
                 {
-                    internalItem.TryGetTagValue(inDeserializationContext.GetDistinctValuesFieldName, out distinctValue);
+                    item.TryGetTagValue(inDeserializationContext.GetDistinctValuesFieldName, out distinctValue);
                 }
 
                 if (distinctValue != null)
@@ -905,15 +941,15 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         /// <summary>
         /// Processes the filters.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
+        /// <param name="item">The item.</param>
         /// <param name="filter">The filter.</param>
         /// <returns>if true Filter passed successfully; otherwise, false</returns>
-        private bool FilterPassed(InternalItem internalItem, Filter filter)
+        private bool FilterPassed(IItem item, Filter filter)
         {
             bool retVal = true;
             if (filter != null)
             {
-                if (!FilterUtil.ProcessFilter(internalItem,
+                if (!FilterUtil.ProcessFilter(item,
                     filter,
                     InDeserializationContext.InclusiveFilter,
                     InDeserializationContext.TagHashCollection,
@@ -922,14 +958,16 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
                     retVal = false;
                     if (InDeserializationContext.CollectFilteredItems)
                     {
-                        outDeserializationContext.FilteredInternalItemList.Add(internalItem);
+                        outDeserializationContext.FilteredInternalItemList.Add(ToInternalItem(item));
                     }
                 }
             }
             return retVal;
         }
 
-        private const int CURRENT_VERSION = 2;
+        private const int ROW_VERSION = 2;
+        private const int COLUMNAR_VERSION = 3;
+        private int deserializedVersion;
         /// <summary>
         /// Gets the current serialization data version of your object.  The <see cref="Serialize"/> method
         /// will write to the stream the correct format for this version.
@@ -939,7 +977,30 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
         {
             get
             {
-                return CURRENT_VERSION;
+                // a header only update writes the items back as they were read
+                if (IsHeaderOnlyUpdate)
+                {
+                    return deserializedVersion >= COLUMNAR_VERSION ? COLUMNAR_VERSION : ROW_VERSION;
+                }
+                return !LegacySerializationUtil.Instance.IsSupported(InDeserializationContext.TypeId) &&
+                       ColumnarSerializationUtil.Instance.IsEnabled(InDeserializationContext.TypeId) ?
+                    COLUMNAR_VERSION :
+                    ROW_VERSION;
+            }
+        }
+
+        /// <summary>
+        /// Gets a value indicating whether only the header was deserialized and the rest is kept unread.
+        /// </summary>
+        /// <value><c>true</c> if only the header is to be updated; otherwise, <c>false</c>.</value>
+        private bool IsHeaderOnlyUpdate
+        {
+            get
+            {
+                return InDeserializationContext.DeserializeHeaderOnly &&
+                       outDeserializationContext != null &&
+                       outDeserializationContext.UnserializedCacheIndexInternal != null &&
+                       outDeserializationContext.UnserializedCacheIndexInternal.Length != 0;
             }
         }
 
@@ -0,0 +1,244 @@
+﻿using System;
+using System.Collections.Generic;
+using MySpace.Common.IO;
+using MySpace.DataRelay.Common.Interfaces.Query.IndexCacheV3;
+using MySpace.DataRelay.Interfaces.Query.IndexCacheV3;
+using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Context;
+
+namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
+{
+    /// <summary>
+    /// Steps through items written by <see cref="ColumnarItemWriter"/>, one block at a time.
+    /// </summary>
+    /// <remarks>
+    /// The reader is itself the current item, so filters, caps and the primary sort can be checked
+    /// against it without building an <see cref="InternalItem"/>. Only the ItemId and tag values
+    /// asked for are copied out of the block, and <see cref="ToInternalItem"/> is called just for
+    /// the items that are kept.
+    /// </remarks>
+    internal class ColumnarItemReader : IItem
+    {
+        #region Data members
+
+        private readonly IPrimitiveReader reader;
+        private readonly InDeserializationContext inDeserializationContext;
+        private readonly Dictionary<string, int> tagHashCodes = new Dictionary<string, int>();
+
+        private byte[] block;
+        private int blockItemCount;
+        private int row;
+
+        // per column: tag hash code, and start of its presence bitmap and of its value offsets
+        private int[] columnTagHashCodes;
+        private int[] columnBitmapStarts;
+        private int[] columnOffsetsStarts;
+
+        // values copied for the current row
+        private byte[] itemId;
+        private byte[][] tagValues;
+        private bool[] tagValuesRead;
+
+        #endregion
+
+        #region Ctors
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="ColumnarItemReader"/> class.
+        /// </summary>
+        /// <param name="reader">The reader positioned at the first block.</param>
+        /// <param name="inDeserializationContext">The in deserialization context.</param>
+        internal ColumnarItemReader(IPrimitiveReader reader, InDeserializationContext inDeserializationContext)
+        {
+            this.reader = reader;
+            this.inDeserializationContext = inDeserializationContext;
+        }
+
+        #endregion
+
+        #region Methods
+
+        /// <summary>
+        /// Moves to the next item, reading the next block once the current one is used up.
+        /// </summary>
+        internal void MoveNext()
+        {
+            row++;
+            if (block == null || row >= blockItemCount)
+            {
+                ReadBlock();
+            }
+            else
+            {
+                Array.Clear(tagValuesRead, 0, tagValuesRead.Length);
+            }
+            itemId = null;
+
+            if (ReadInt32(block, (row + 1) * sizeof(int)) <= ReadInt32(block, row * sizeof(int)))
+            {
+                throw new Exception("Invalid ItemId - is null or length is zero for IndexId : " +
+                                    IndexCacheUtils.GetReadableByteArray(inDeserializationContext.IndexId));
+            }
+        }
+
+        /// <summary>
+        /// Reads the next block and its column directory.
+        /// </summary>
+        private void ReadBlock()
+        {
+            blockItemCount = reader.ReadUInt16();
+            block = reader.ReadBytes(reader.ReadInt32());
+            row = 0;
+
+            int bitmapLength = (blockItemCount + 7) / 8;
+            int offsetsLength = (blockItemCount + 1) * sizeof(int);
+            int position = ReadInt32(block, blockItemCount * sizeof(int));
+            int columnCount = block[position] | (block[position + 1] << 8);
+            position += sizeof(ushort);
+
+            columnTagHashCodes = new int[columnCount];
+            columnBitmapStarts = new int[columnCount];
+            columnOffsetsStarts = new int[columnCount];
+            for (int c = 0; c < columnCount; c++)
+            {
+                columnTagHashCodes[c] = ReadInt32(block, position);
+                columnBitmapStarts[c] = position + sizeof(int);
+                columnOffsetsStarts[c] = columnBitmapStarts[c] + bitmapLength;
+                position = ReadInt32(block, columnOffsetsStarts[c] + blockItemCount * sizeof(int));
+            }
+
+            tagValues = new byte[columnCount][];
+            tagValuesRead = new bool[columnCount];
+        }
+
+        /// <summary>
+        /// Builds an <see cref="InternalItem"/> for the current item.
+        /// </summary>
+        /// <returns>InternalItem</returns>
+        internal InternalItem ToInternalItem()
+        {
+            InternalItem internalItem = new InternalItem { ItemId = ItemId };
+            for (int c = 0; c < columnTagHashCodes.Length; c++)
+            {
+                if (IsPresent(c))
+                {
+                    if (internalItem.TagList == null)
+                    {
+                        internalItem.TagList = new List<KeyValuePair<int, byte[]>>(columnTagHashCodes.Length);
+                    }
+                    internalItem.TagList.Add(new KeyValuePair<int, byte[]>(columnTagHashCodes[c], GetTagValue(c)));
+                }
+            }
+            return internalItem;
+        }
+
+        /// <summary>
+        /// Determines whether the current item has a value for the column.
+        /// </summary>
+        private bool IsPresent(int column)
+        {
+            return (block[columnBitmapStarts[column] + (row >> 3)] & (1 << (row & 7))) != 0;
+        }
+
+        /// <summary>
+        /// Gets the current item's value for the column, copying it out of the block on first use.
+        /// </summary>
+        private byte[] GetTagValue(int column)
+        {
+            if (!tagValuesRead[column])
+            {
+                byte[] tagValue = CopyRange(columnOffsetsStarts[column]);
+                if (tagValue != null &&
+                    inDeserializationContext.StringHashCodeDictionary != null &&
+                    inDeserializationContext.StringHashCodeDictionary.Count > 0 &&
+                    inDeserializationContext.StringHashCodeDictionary.ContainsKey(columnTagHashCodes[column]))
+                {
+                    tagValue = inDeserializationContext.StringHashCollection.GetStringByteArray(inDeserializationContext.TypeId, tagValue);
+                }
+                tagValues[column] = tagValue;
+                tagValuesRead[column] = true;
+            }
+            return tagValues[column];
+        }
+
+        /// <summary>
+        /// Copies the current item's bytes out of the block given the start of their offsets.
+        /// </summary>
+        /// <returns>The bytes, or null if there are none.</returns>
+        private byte[] CopyRange(int offsetsStart)
+        {
+            int start = ReadInt32(block, offsetsStart + row * sizeof(int));
+            int length = ReadInt32(block, offsetsStart + (row + 1) * sizeof(int)) - start;
+            if (length == 0)
+            {
+                return null;
+            }
+            byte[] bytes = new byte[length];
+            Buffer.BlockCopy(block, start, bytes, 0, length);
+            return bytes;
+        }
+
+        /// <summary>
+        /// Reads a little-endian int from the block.
+        /// </summary>
+        private static int ReadInt32(byte[] block, int offset)
+        {
+            return block[offset] | (block[offset + 1] << 8) | (block[offset + 2] << 16) | (block[offset + 3] << 24);
+        }
+
+        #endregion
+
+        #region IItem Members
+
+        /// <summary>
+        /// Tries the get tag value.
+        /// </summary>
+        /// <param name="tagName">Name of the tag.</param>
+        /// <param name="tagValue">The tag value.</param>
+        /// <returns></returns>
+        public bool TryGetTagValue(string tagName, out byte[] tagValue)
+        {
+            tagValue = null;
+            if (tagName != null && columnTagHashCodes.Length > 0)
+            {
+                int tagHashCode;
+                if (!tagHashCodes.TryGetValue(tagName, out tagHashCode))
+                {
+                    tagHashCode = TagHashCollection.GetTagHashCode(tagName);
+                    tagHashCodes.Add(tagName, tagHashCode);
+                }
+
+                for (int c = 0; c < columnTagHashCodes.Length; c++)
+                {
+                    if (columnTagHashCodes[c] == tagHashCode)
+                    {
+                        if (!IsPresent(c))
+                        {
+                            return false;
+                        }
+                        tagValue = GetTagValue(c);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /// <summary>
+        /// Gets the item id.
+        /// </summary>
+        /// <value>The item id.</value>
+        public byte[] ItemId
+        {
+            get
+            {
+                if (itemId == null)
+                {
+                    itemId = CopyRange(0);
+                }
+                return itemId;
+            }
+        }
+
+        #endregion
+    }
+}
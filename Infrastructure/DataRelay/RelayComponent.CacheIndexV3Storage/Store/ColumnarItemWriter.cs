@@ -0,0 +1,199 @@
+﻿using System;
+using System.Collections.Generic;
+using MySpace.Common.IO;
+using MySpace.DataRelay.Common.Interfaces.Query.IndexCacheV3;
+using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Context;
+
+namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store
+{
+    /// <summary>
+    /// Writes an <see cref="InternalItemList"/> in the columnar format read by <see cref="ColumnarItemReader"/>.
+    /// </summary>
+    /// <remarks>
+    /// Items are written in blocks of up to <see cref="BlockSize"/> items so a partial get still only reads
+    /// the front of the index. Each block is written as (ushort)ItemCount, (int)ByteLength and then ByteLength bytes:
+    /// <list type="bullet">
+    /// <item>ItemId offsets, ItemCount + 1 ints, followed by the ItemId bytes.</item>
+    /// <item>(ushort)ColumnCount, then per tag: (int)TagHashCode, a presence bitmap of one bit per item,
+    /// value offsets, ItemCount + 1 ints, followed by the value bytes.</item>
+    /// </list>
+    /// Offsets are from the start of the block, so any item's ItemId or tag value is found without reading the others.
+    /// </remarks>
+    internal static class ColumnarItemWriter
+    {
+        /// <summary>
+        /// The most items written to one block.
+        /// </summary>
+        internal const int BlockSize = 256;
+
+        /// <summary>
+        /// Serializes the internal item list.
+        /// </summary>
+        /// <param name="writer">The writer.</param>
+        /// <param name="internalItemList">The internal item list.</param>
+        /// <param name="inDeserializationContext">The in deserialization context.</param>
+        internal static void Serialize(IPrimitiveWriter writer,
+            InternalItemList internalItemList,
+            InDeserializationContext inDeserializationContext)
+        {
+            for (int start = 0; start < internalItemList.Count; start += BlockSize)
+            {
+                WriteBlock(writer, internalItemList, start, Math.Min(BlockSize, internalItemList.Count - start), inDeserializationContext);
+            }
+        }
+
+        /// <summary>
+        /// Writes one block of items.
+        /// </summary>
+        private static void WriteBlock(IPrimitiveWriter writer,
+            InternalItemList internalItemList,
+            int start,
+            int count,
+            InDeserializationContext inDeserializationContext)
+        {
+            #region Gather columns
+
+            List<int> tagHashCodes = new List<int>();
+            int itemIdBytes = 0;
+            InternalItem internalItem;
+            for (int i = 0; i < count; i++)
+            {
+                internalItem = internalItemList[start + i];
+                if (internalItem.ItemId == null || internalItem.ItemId.Length == 0)
+                {
+                    throw new Exception("Invalid ItemId - is null or length is zero for IndexId : " +
+                                        IndexCacheUtils.GetReadableByteArray(inDeserializationContext.IndexId));
+                }
+                itemIdBytes += internalItem.ItemId.Length;
+
+                if (internalItem.TagList != null)
+                {
+                    foreach (KeyValuePair<int /*TagHashCode*/, byte[] /*TagValue*/> kvp in internalItem.TagList)
+                    {
+                        if (!tagHashCodes.Contains(kvp.Key))
+                        {
+                            tagHashCodes.Add(kvp.Key);
+                        }
+                    }
+                }
+            }
+
+            int offsetsLength = (count + 1) * sizeof(int);
+            int bitmapLength = (count + 7) / 8;
+            int blockLength = offsetsLength + itemIdBytes + sizeof(ushort);
+
+            byte[][][] columnValues = new byte[tagHashCodes.Count][][];
+            bool[][] columnPresence = new bool[tagHashCodes.Count][];
+            for (int c = 0; c < tagHashCodes.Count; c++)
+            {
+                bool isStringHashed = inDeserializationContext.StringHashCodeDictionary != null &&
+                                      inDeserializationContext.StringHashCodeDictionary.Count > 0 &&
+                                      inDeserializationContext.StringHashCodeDictionary.ContainsKey(tagHashCodes[c]);
+                columnValues[c] = new byte[count][];
+                columnPresence[c] = new bool[count];
+                blockLength += sizeof(int) + bitmapLength + offsetsLength;
+
+                for (int i = 0; i < count; i++)
+                {
+                    byte[] tagValue;
+                    if (TryGetTagValue(internalItemList[start + i], tagHashCodes[c], out tagValue))
+                    {
+                        columnPresence[c][i] = true;
+                        if (tagValue != null && tagValue.Length > 0)
+                        {
+                            if (isStringHashed)
+                            {
+                                inDeserializationContext.StringHashCollection.AddStringArray(inDeserializationContext.TypeId, tagValue);
+                                tagValue = StringHashCollection.GetHashCodeByteArray(tagValue);
+                            }
+                            columnValues[c][i] = tagValue;
+                            blockLength += tagValue.Length;
+                        }
+                    }
+                }
+            }
+
+            #endregion
+
+            #region Fill block
+
+            byte[] block = new byte[blockLength];
+            int position = offsetsLength;
+            for (int i = 0; i < count; i++)
+            {
+                internalItem = internalItemList[start + i];
+                WriteInt32(block, i * sizeof(int), position);
+                Buffer.BlockCopy(internalItem.ItemId, 0, block, position, internalItem.ItemId.Length);
+                position += internalItem.ItemId.Length;
+            }
+            WriteInt32(block, count * sizeof(int), position);
+
+            block[position++] = (byte)tagHashCodes.Count;
+            block[position++] = (byte)(tagHashCodes.Count >> 8);
+
+            for (int c = 0; c < tagHashCodes.Count; c++)
+            {
+                WriteInt32(block, position, tagHashCodes[c]);
+                position += sizeof(int);
+
+                int bitmapStart = position;
+                position += bitmapLength;
+                int offsetsStart = position;
+                position += offsetsLength;
+
+                for (int i = 0; i < count; i++)
+                {
+                    if (columnPresence[c][i])
+                    {
+                        block[bitmapStart + (i >> 3)] |= (byte)(1 << (i & 7));
+                    }
+                    WriteInt32(block, offsetsStart + i * sizeof(int), position);
+                    byte[] tagValue = columnValues[c][i];
+                    if (tagValue != null)
+                    {
+                        Buffer.BlockCopy(tagValue, 0, block, position, tagValue.Length);
+                        position += tagValue.Length;
+                    }
+                }
+                WriteInt32(block, offsetsStart + count * sizeof(int), position);
+            }
+
+            #endregion
+
+            writer.Write((ushort)count);
+            writer.Write(blockLength);
+            writer.Write(block);
+        }
+
+        /// <summary>
+        /// Tries to get the tag value by hash code.
+        /// </summary>
+        private static bool TryGetTagValue(InternalItem internalItem, int tagHashCode, out byte[] tagValue)
+        {
+            tagValue = null;
+            if (internalItem.TagList != null)
+            {
+                for (int i = 0; i < internalItem.TagList.Count; i++)
+                {
+                    if (internalItem.TagList[i].Key == tagHashCode)
+                    {
+                        tagValue = internalItem.TagList[i].Value;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /// <summary>
+        /// Writes a little-endian int into the block.
+        /// </summary>
+        private static void WriteInt32(byte[] block, int offset, int value)
+        {
+            block[offset] = (byte)value;
+            block[offset + 1] = (byte)(value >> 8);
+            block[offset + 2] = (byte)(value >> 16);
+            block[offset + 3] = (byte)(value >> 24);
+        }
+    }
+}
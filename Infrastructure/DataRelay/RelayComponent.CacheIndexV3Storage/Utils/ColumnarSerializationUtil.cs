@@ -0,0 +1,61 @@
+﻿using System.Collections.Generic;
+using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Config;
+
+namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
+{
+    internal class ColumnarSerializationUtil
+    {
+        private static List<short> columnarSerializationTypes = new List<short>();
+
+        /// <summary>
+        /// Initializes a new instance of the <see cref="ColumnarSerializationUtil"/> class.
+        /// </summary>
+        private ColumnarSerializationUtil(){}
+
+        private static readonly ColumnarSerializationUtil instance = new ColumnarSerializationUtil();
+
+        /// <summary>
+        /// Gets the instance.
+        /// </summary>
+        /// <value>The instance.</value>
+        internal static ColumnarSerializationUtil Instance
+        {
+            get
+            {
+                return instance;
+            }
+        }
+
+        /// <summary>
+        /// Initializes the types whose indexes are written in the columnar format.
+        /// </summary>
+        /// <param name="indexTypeMappingCollection">The index type mapping collection.</param>
+        internal void InitializeColumnarSerializationTypes(IndexTypeMappingCollection indexTypeMappingCollection)
+        {
+            List<short> typeIds = new List<short>();
+            if (indexTypeMappingCollection != null)
+            {
+                foreach (IndexTypeMapping indexTypeMapping in indexTypeMappingCollection)
+                {
+                    if (indexTypeMapping.ColumnarSerialization)
+                    {
+                        typeIds.Add(indexTypeMapping.TypeId);
+                    }
+                }
+            }
+            columnarSerializationTypes = typeIds;
+        }
+
+        /// <summary>
+        /// Determines whether indexes of the specified type id are written in the columnar format.
+        /// </summary>
+        /// <param name="typeId">The type id.</param>
+        /// <returns>
+        /// 	<c>true</c> if the specified type id is written columnar; otherwise, <c>false</c>.
+        /// </returns>
+        internal bool IsEnabled(short typeId)
+        {
+            return columnarSerializationTypes.Contains(typeId);
+        }
+    }
+}
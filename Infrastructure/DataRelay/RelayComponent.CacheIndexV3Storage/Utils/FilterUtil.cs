@@ -1,7 +1,7 @@
 ﻿using System.Collections.Generic;
 using MySpace.DataRelay.Common.Interfaces.Query.IndexCacheV3;
+using MySpace.DataRelay.Interfaces.Query.IndexCacheV3;
 using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Context;
-using MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Store;
 
 namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
 {
@@ -10,19 +10,19 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
         /// <summary>
         /// Processes the filter.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
+        /// <param name="item">The item.</param>
         /// <param name="filter">The filter.</param>
         /// <param name="inclusiveFilter">if set to <c>true</c> includes the items that pass the filter; otherwise , <c>false</c>.</param>
         /// <param name="tagHashCollection">The TagHashCollection.</param>
         /// <param name="metadataPropertyCollection">The MetadataPropertyCollection.</param>
         /// <returns><c>true</c> if item passes the filter; otherwise, <c>false</c></returns>
-        internal static bool ProcessFilter(InternalItem internalItem, 
+        internal static bool ProcessFilter(IItem item, 
             Filter filter, 
             bool inclusiveFilter, 
             TagHashCollection tagHashCollection, 
             MetadataPropertyCollection metadataPropertyCollection)
         {
-            bool retVal = DoProcessFilter(internalItem, filter, tagHashCollection, metadataPropertyCollection);
+            bool retVal = DoProcessFilter(item, filter, tagHashCollection, metadataPropertyCollection);
 
             if (inclusiveFilter)
             {
@@ -35,12 +35,12 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
         /// Processes the aggregate filter.
         /// </summary>
         /// <typeparam name="T"></typeparam>
-        /// <param name="internalItem">The internal item.</param>
+        /// <param name="item">The item.</param>
         /// <param name="filter">The filter.</param>
         /// <param name="tagHashCollection">The TagHashCollection.</param>
         /// <param name="metadataPropertyCollection">The MetadataPropertyCollection.</param>
         /// <returns><c>true</c> if item passes the filter; otherwise, <c>false</c></returns>
-        private static bool ProcessAggregateFilter<T>(InternalItem internalItem, 
+        private static bool ProcessAggregateFilter<T>(IItem item, 
             T filter, 
             TagHashCollection tagHashCollection, 
             MetadataPropertyCollection metadataPropertyCollection)
@@ -55,7 +55,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
                 if (filter[i] is Condition)
                 {
                     // evaluate now
-                    retVal = DoProcessFilter(internalItem, filter[i], tagHashCollection, metadataPropertyCollection);
+                    retVal = DoProcessFilter(item, filter[i], tagHashCollection, metadataPropertyCollection);
                     if (retVal == filter.ShortCircuitHint)
                         break;
                 }
@@ -71,7 +71,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
             {
                 foreach (Filter f in later)
                 {
-                    retVal = DoProcessFilter(internalItem, f, tagHashCollection, metadataPropertyCollection);
+                    retVal = DoProcessFilter(item, f, tagHashCollection, metadataPropertyCollection);
                     if (retVal == filter.ShortCircuitHint)
                         break;
                 }
@@ -82,12 +82,12 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
         /// <summary>
         /// Does the process filter.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
+        /// <param name="item">The item.</param>
         /// <param name="filter">The filter.</param>
         /// <param name="tagHashCollection">The TagHashCollection.</param>
         /// <param name="metadataPropertyCollection">The MetadataPropertyCollection.</param>
         /// <returns><c>true</c> if item passes the filter; otherwise, <c>false</c></returns>
-        private static bool DoProcessFilter(InternalItem internalItem, 
+        private static bool DoProcessFilter(IItem item, 
             Filter filter, 
             TagHashCollection tagHashCollection, 
             MetadataPropertyCollection metadataPropertyCollection)
@@ -97,15 +97,15 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
             switch (filter.FilterType)
             {
                 case FilterType.Condition:
-                    retVal = ProcessCondition(internalItem, filter as Condition, metadataPropertyCollection);
+                    retVal = ProcessCondition(item, filter as Condition, metadataPropertyCollection);
                     break;
 
                 case FilterType.And:
-                    retVal = ProcessAggregateFilter(internalItem, filter as AndFilter, tagHashCollection, metadataPropertyCollection);
+                    retVal = ProcessAggregateFilter(item, filter as AndFilter, tagHashCollection, metadataPropertyCollection);
                     break;
 
                 case FilterType.Or:
-                    retVal = ProcessAggregateFilter(internalItem, filter as OrFilter, tagHashCollection, metadataPropertyCollection);
+                    retVal = ProcessAggregateFilter(item, filter as OrFilter, tagHashCollection, metadataPropertyCollection);
                     break;
             }
 
@@ -115,11 +115,11 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
         /// <summary>
         /// Processes the condition.
         /// </summary>
-        /// <param name="internalItem">The internal item.</param>
+        /// <param name="item">The item.</param>
         /// <param name="condition">The condition.</param>
         /// <param name="metadataPropertyCollection">The MetadataPropertyCollection.</param>
         /// <returns><c>true</c> if item passes the condition; otherwise, <c>false</c></returns>
-        private static bool ProcessCondition(InternalItem internalItem, 
+        private static bool ProcessCondition(IItem item, 
             Condition condition, 
             MetadataPropertyCollection metadataPropertyCollection)
         {
@@ -128,10 +128,10 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
             if (condition.IsTag)
             {
                 byte[] tagValue;
-                internalItem.TryGetTagValue(condition.FieldName, out tagValue);
+                item.TryGetTagValue(condition.FieldName, out tagValue);
                 return condition.Process(tagValue);
             }
-            return condition.Process(internalItem.ItemId);
+            return condition.Process(item.ItemId);
         }
     }
 }
\ No newline at end of file
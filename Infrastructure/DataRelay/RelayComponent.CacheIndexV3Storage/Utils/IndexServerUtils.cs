@@ -78,6 +78,7 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
             //storeContext.IndexStorageComponent.HandleMessage(getMsg);
 
             Stream myStream;
+            Stream entryStream = null;
 
             ResourcePoolItem<MemoryStream> pooledStreamItem = null;
             MemoryStream pooledStream;
@@ -93,15 +94,16 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
 
                 if (isFullGet)
                 {
-                    byte[] cacheBytes = BinaryStorageAdapter.Get(
+                    // read straight from the entry, past its header, without copying it into arrays
+                    entryStream = BinaryStorageAdapter.GetStream(
                         storeContext.IndexStorageComponent,
                         typeId,
                         primaryId,
                         extendedId);
 
-                    if (cacheBytes != null)
+                    if (entryStream != null)
                     {
-                        myStream = new MemoryStream(cacheBytes);
+                        myStream = entryStream;
                     }
                     else
                     {
@@ -232,6 +234,12 @@ namespace MySpace.DataRelay.RelayComponent.CacheIndexV3Storage.Utils
                 {
                     storeContext.MemoryPool.ReleaseItem(pooledStreamItem);
                 }
+
+                // release the entry's memory
+                if (entryStream != null)
+                {
+                    entryStream.Dispose();
+                }
             }
 
             return cacheIndexInternal;
@@ -0,0 +1,225 @@
+﻿using System;
+using System.IO;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding.Test
+{
+	/// <summary>
+	/// Tests the memory mapped log file that error queue messages spill to.
+	/// </summary>
+	[TestClass]
+	public class ErrorQueueSegmentTests
+	{
+		// the segment header, then each record's length and CRC ahead of its bytes
+		private const int _headerLength = 16;
+		private const int _recordHeaderLength = 8;
+		private const int _recordLength = 100;
+
+		private string _path;
+
+		[TestInitialize]
+		public void Initialize()
+		{
+			_path = Path.Combine(Path.GetTempPath(), "ErrorQueueSegmentTests" + Guid.NewGuid().ToString("N"));
+		}
+
+		[TestCleanup]
+		public void Cleanup()
+		{
+			File.Delete(_path);
+		}
+
+		private static long RecordPosition(int index)
+		{
+			return _headerLength + index * (_recordHeaderLength + _recordLength);
+		}
+
+		private static void Append(ErrorQueueSegment segment, int count)
+		{
+			var record = new byte[_recordLength];
+			for (var i = 0; i < count; ++i)
+			{
+				record[0] = (byte)i;
+				Assert.IsTrue(segment.TryAppend(record, _recordLength));
+			}
+		}
+
+		// Reads the rest of the segment, checking records start from record first.
+		private static int ReadAll(ErrorQueueSegment segment, int first)
+		{
+			byte[] buffer = null;
+			int length;
+			var read = 0;
+			while (segment.TryRead(ref buffer, out length))
+			{
+				Assert.AreEqual(_recordLength, length);
+				Assert.AreEqual((byte)(first + read), buffer[0]);
+				++read;
+			}
+			return read;
+		}
+
+		private ErrorQueueSegment CreateWithRecords(int count)
+		{
+			var segment = ErrorQueueSegment.Create(_path, 7, 4096);
+			Append(segment, count);
+			return segment;
+		}
+
+		[TestMethod]
+		public void AppendedRecordsAreReadInOrder()
+		{
+			using (var segment = CreateWithRecords(5))
+			{
+				Assert.AreEqual(5, ReadAll(segment, 0));
+				Assert.AreEqual(segment.WritePosition, segment.ReadPosition);
+			}
+		}
+
+		[TestMethod]
+		public void ReopenRecoversUnreadRecords()
+		{
+			long readPosition;
+			using (var segment = CreateWithRecords(5))
+			{
+				byte[] buffer = null;
+				int length;
+				Assert.IsTrue(segment.TryRead(ref buffer, out length));
+				Assert.IsTrue(segment.TryRead(ref buffer, out length));
+				readPosition = segment.ReadPosition;
+				segment.Flush();
+			}
+
+			int unread;
+			using (var segment = ErrorQueueSegment.Open(_path, readPosition, out unread))
+			{
+				Assert.AreEqual(7, segment.Sequence);
+				Assert.AreEqual(3, unread);
+				Assert.AreEqual(RecordPosition(5), segment.WritePosition);
+				Assert.AreEqual(3, ReadAll(segment, 2));
+			}
+		}
+
+		[TestMethod]
+		public void ReopenFromStartReadsEverything()
+		{
+			using (var segment = CreateWithRecords(5))
+			{
+				segment.Flush();
+			}
+
+			int unread;
+			using (var segment = ErrorQueueSegment.Open(_path, 0, out unread))
+			{
+				Assert.AreEqual(5, unread);
+				Assert.AreEqual(5, ReadAll(segment, 0));
+			}
+		}
+
+		[TestMethod]
+		public void CorruptRecordEndsTheLog()
+		{
+			using (var segment = CreateWithRecords(5))
+			{
+				segment.Flush();
+			}
+			// a torn write leaves the third record's bytes not matching its CRC
+			using (var stream = new FileStream(_path, FileMode.Open, FileAccess.ReadWrite))
+			{
+				stream.Position = RecordPosition(2) + _recordHeaderLength + 10;
+				stream.WriteByte(0xFF);
+			}
+
+			int unread;
+			using (var segment = ErrorQueueSegment.Open(_path, 0, out unread))
+			{
+				Assert.AreEqual(2, unread);
+				Assert.AreEqual(RecordPosition(2), segment.WritePosition);
+
+				Assert.AreEqual(2, ReadAll(segment, 0));
+
+				// appending carries on from the end of the good records
+				Append(segment, 1);
+				Assert.AreEqual(1, ReadAll(segment, 0));
+			}
+		}
+
+		[TestMethod]
+		public void ReadPositionOffRecordBoundaryReplaysEverything()
+		{
+			using (var segment = CreateWithRecords(5))
+			{
+				segment.Flush();
+			}
+
+			int unread;
+			using (var segment = ErrorQueueSegment.Open(_path, RecordPosition(2) + 1, out unread))
+			{
+				Assert.AreEqual(5, unread);
+				Assert.AreEqual(_headerLength, segment.ReadPosition);
+				Assert.AreEqual(5, ReadAll(segment, 0));
+			}
+		}
+
+		[TestMethod]
+		public void ReusedFileStartsEmpty()
+		{
+			using (var segment = CreateWithRecords(5))
+			{
+				segment.Flush();
+			}
+			using (var segment = ErrorQueueSegment.Create(_path, 8, 4096))
+			{
+				segment.Flush();
+			}
+
+			int unread;
+			using (var segment = ErrorQueueSegment.Open(_path, 0, out unread))
+			{
+				Assert.AreEqual(8, segment.Sequence);
+				Assert.AreEqual(0, unread);
+				Assert.AreEqual(_headerLength, segment.WritePosition);
+			}
+		}
+
+		[TestMethod]
+		public void RecordsSurviveUnmapAndMap()
+		{
+			using (var segment = CreateWithRecords(3))
+			{
+				segment.Unmap();
+				Assert.IsFalse(segment.IsMapped);
+
+				segment.Map();
+
+				Assert.IsTrue(segment.IsMapped);
+				Assert.AreEqual(3, ReadAll(segment, 0));
+				Append(segment, 1);
+				Assert.AreEqual(1, ReadAll(segment, 0));
+			}
+		}
+
+		[TestMethod]
+		public void FullSegmentRefusesRecord()
+		{
+			var record = new byte[_recordLength];
+			using (var segment = ErrorQueueSegment.Create(_path, 1, ErrorQueueSegment.GetCapacityFor(_recordLength)))
+			{
+				Assert.IsTrue(segment.TryAppend(record, _recordLength));
+				Assert.IsFalse(segment.TryAppend(record, 1));
+				Assert.AreEqual(1, ReadAll(segment, 0));
+			}
+		}
+
+		[TestMethod]
+		public void FileThatIsNotASegmentIsNotOpened()
+		{
+			var bytes = new byte[4096];
+			new Random(1).NextBytes(bytes);
+			File.WriteAllBytes(_path, bytes);
+
+			int unread;
+			Assert.IsNull(ErrorQueueSegment.Open(_path, 0, out unread));
+		}
+	}
+}
@@ -0,0 +1,87 @@
+﻿using System.Diagnostics;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding.Test
+{
+	/// <summary>
+	/// Tests the latency histogram that hedged Gets read their delay from.
+	/// </summary>
+	[TestClass]
+	public class GetLatencyTrackerTests
+	{
+		private const int _samplesPerUpdate = 1024;
+
+		private static void Record(GetLatencyTracker tracker, int count, int milliseconds, double percentile)
+		{
+			long ticks = milliseconds * Stopwatch.Frequency / 1000;
+			for (var i = 0; i < count; ++i)
+			{
+				tracker.Record(ticks, percentile);
+			}
+		}
+
+		// Asserts the delay is the latency given, to within the histogram's bucket width.
+		private static void AssertDelay(int milliseconds, GetLatencyTracker tracker)
+		{
+			Assert.IsTrue(tracker.DelayMilliseconds >= milliseconds && tracker.DelayMilliseconds <= milliseconds * 1.1 + 1,
+				string.Format("Expected a delay of about {0} ms, got {1} ms.", milliseconds, tracker.DelayMilliseconds));
+		}
+
+		[TestMethod]
+		public void DelayIsUnknownUntilEnoughGets()
+		{
+			var tracker = new GetLatencyTracker();
+
+			Record(tracker, _samplesPerUpdate - 1, 10, 95);
+			Assert.AreEqual(-1, tracker.DelayMilliseconds);
+
+			Record(tracker, 1, 10, 95);
+			AssertDelay(10, tracker);
+		}
+
+		[TestMethod]
+		public void DelayIsTheLatencyAtThePercentile()
+		{
+			var tracker = new GetLatencyTracker();
+			Record(tracker, _samplesPerUpdate * 9 / 10, 5, 80);
+			Record(tracker, _samplesPerUpdate - _samplesPerUpdate * 9 / 10, 200, 80);
+			AssertDelay(5, tracker);
+
+			tracker = new GetLatencyTracker();
+			Record(tracker, _samplesPerUpdate * 9 / 10, 5, 95);
+			Record(tracker, _samplesPerUpdate - _samplesPerUpdate * 9 / 10, 200, 95);
+			AssertDelay(200, tracker);
+		}
+
+		[TestMethod]
+		public void PercentileIsKeptWithinHalfAndNearlyAll()
+		{
+			var tracker = new GetLatencyTracker();
+			Record(tracker, _samplesPerUpdate / 2 + 1, 5, 10);
+			Record(tracker, _samplesPerUpdate / 2 - 1, 200, 10);
+			// a 10th percentile is read as the median, which is still fast
+			AssertDelay(5, tracker);
+
+			tracker = new GetLatencyTracker();
+			Record(tracker, _samplesPerUpdate - 1, 5, 100);
+			Record(tracker, 1, 200, 100);
+			// a 100th percentile is read as the 99.9th, which leaves out the one slow Get
+			AssertDelay(5, tracker);
+		}
+
+		[TestMethod]
+		public void OldLatenciesFadeOut()
+		{
+			var tracker = new GetLatencyTracker();
+			Record(tracker, _samplesPerUpdate, 200, 90);
+			AssertDelay(200, tracker);
+
+			Record(tracker, _samplesPerUpdate, 5, 90);
+			// halved once, the slow Gets are still a third of the histogram
+			AssertDelay(200, tracker);
+
+			Record(tracker, _samplesPerUpdate * 2, 5, 90);
+			AssertDelay(5, tracker);
+		}
+	}
+}
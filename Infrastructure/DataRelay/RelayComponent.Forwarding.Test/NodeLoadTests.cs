@@ -0,0 +1,112 @@
+﻿using System;
+using System.Diagnostics;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding.Test
+{
+	/// <summary>
+	/// Tests the load score adaptive node selection compares nodes by.
+	/// </summary>
+	[TestClass]
+	public class NodeLoadTests
+	{
+		private const double _idleScore = 0.1;
+		private const double _tolerance = 20; //milliseconds a busy test machine may add to a sample
+
+		// Records a request that took the given milliseconds.
+		private static void Answer(NodeLoad load, double milliseconds)
+		{
+			load.Begin();
+			load.End(Stopwatch.GetTimestamp() - (long)(milliseconds * Stopwatch.Frequency / 1000));
+		}
+
+		[TestMethod]
+		public void NewNodeScoresAsIdle()
+		{
+			var load = new NodeLoad();
+
+			Assert.AreEqual(0, load.Outstanding);
+			Assert.AreEqual(0.0, load.AverageMilliseconds);
+			Assert.AreEqual(_idleScore, load.Score, 0.0001);
+		}
+
+		[TestMethod]
+		public void OutstandingRequestsRaiseTheScore()
+		{
+			var load = new NodeLoad();
+
+			load.Begin();
+			var start = load.Begin();
+
+			Assert.AreEqual(2, load.Outstanding);
+			Assert.AreEqual(_idleScore * 3, load.Score, 0.0001);
+
+			load.End(start);
+			Assert.AreEqual(1, load.Outstanding);
+		}
+
+		[TestMethod]
+		public void FirstAnswerSetsTheAverage()
+		{
+			var load = new NodeLoad();
+
+			Answer(load, 100);
+
+			Assert.AreEqual(100, load.AverageMilliseconds, _tolerance);
+			Assert.AreEqual(0, load.Outstanding);
+		}
+
+		[TestMethod]
+		public void LaterAnswersMoveTheAverageByAFifth()
+		{
+			var load = new NodeLoad();
+
+			Answer(load, 100);
+			Answer(load, 600);
+
+			Assert.AreEqual(200, load.AverageMilliseconds, _tolerance);
+		}
+
+		[TestMethod]
+		public void SlowerNodeScoresHigher()
+		{
+			var fast = new NodeLoad();
+			var slow = new NodeLoad();
+
+			Answer(fast, 5);
+			Answer(slow, 200);
+
+			Assert.IsTrue(fast.Score < slow.Score);
+		}
+
+		[TestMethod]
+		public void BusyFastNodeCanScoreHigherThanIdleSlowerOne()
+		{
+			var busy = new NodeLoad();
+			var idle = new NodeLoad();
+			Answer(busy, 50);
+			Answer(idle, 100);
+
+			for (var i = 0; i < 4; ++i)
+			{
+				busy.Begin();
+			}
+
+			Assert.IsTrue(idle.Score < busy.Score, "Outstanding requests must count against a node.");
+		}
+
+		[TestMethod]
+		public void ErrorPenalizesTheNode()
+		{
+			var failing = new NodeLoad();
+			var healthy = new NodeLoad();
+			Answer(failing, 5);
+			Answer(healthy, 200);
+
+			failing.RecordError();
+
+			Assert.IsTrue(failing.Score > 500, "A fresh error must cost close to a second.");
+			Assert.IsTrue(healthy.Score < failing.Score);
+		}
+	}
+}
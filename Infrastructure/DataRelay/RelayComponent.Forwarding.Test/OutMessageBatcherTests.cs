@@ -0,0 +1,236 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding.Test
+{
+	/// <summary>
+	/// Tests when <see cref="OutMessageBatcher"/> sends waiting messages, and how it completes them.
+	/// </summary>
+	[TestClass]
+	public class OutMessageBatcherTests
+	{
+		private const int _waitMilliseconds = 5000;
+
+		/// <summary>
+		/// Records the batches begun and lets a test return them one at a time.
+		/// </summary>
+		private class FakeTransport
+		{
+			private readonly object _syncRoot = new object();
+			private readonly List<List<RelayMessage>> _batches = new List<List<RelayMessage>>();
+			private readonly Queue<AsyncCallback> _inFlight = new Queue<AsyncCallback>();
+
+			public Exception BeginError { get; set; }
+
+			public IAsyncResult BeginSend(List<RelayMessage> messages, AsyncCallback callback, object state)
+			{
+				if (BeginError != null) throw BeginError;
+				lock (_syncRoot)
+				{
+					_batches.Add(messages);
+					_inFlight.Enqueue(callback);
+					Monitor.PulseAll(_syncRoot);
+				}
+				return null;
+			}
+
+			public void EndSend(IAsyncResult asyncResult)
+			{
+			}
+
+			public int BatchCount
+			{
+				get { lock (_syncRoot) return _batches.Count; }
+			}
+
+			public List<RelayMessage> GetBatch(int index)
+			{
+				lock (_syncRoot) return _batches[index];
+			}
+
+			public bool WaitForBatches(int count)
+			{
+				lock (_syncRoot)
+				{
+					var deadline = DateTime.UtcNow.AddMilliseconds(_waitMilliseconds);
+					while (_batches.Count < count)
+					{
+						var remaining = deadline - DateTime.UtcNow;
+						if (remaining <= TimeSpan.Zero) return false;
+						Monitor.Wait(_syncRoot, remaining);
+					}
+					return true;
+				}
+			}
+
+			// Returns the oldest batch still in flight.
+			public void ReturnOne()
+			{
+				AsyncCallback callback;
+				lock (_syncRoot) callback = _inFlight.Dequeue();
+				callback(new ReturnedSend());
+			}
+		}
+
+		private class ReturnedSend : IAsyncResult
+		{
+			public object AsyncState { get { return null; } }
+			public WaitHandle AsyncWaitHandle { get { return null; } }
+			public bool CompletedSynchronously { get { return false; } }
+			public bool IsCompleted { get { return true; } }
+		}
+
+		private static ForwardingConfig CreateConfig(int sends, int length, int bytes, int delay)
+		{
+			return new ForwardingConfig
+			{
+				OutMessageBatching = true,
+				OutMessageBatchSends = sends,
+				OutMessageBatchLength = length,
+				OutMessageBatchBytes = bytes,
+				OutMessageBatchDelay = delay
+			};
+		}
+
+		private static OutMessageBatcher CreateBatcher(FakeTransport transport, ForwardingConfig config)
+		{
+			return new OutMessageBatcher(transport.BeginSend, transport.EndSend, config);
+		}
+
+		private static RelayMessage CreateMessage(int id)
+		{
+			return new RelayMessage(1, id, MessageType.Get);
+		}
+
+		[TestMethod]
+		public void SendsAtOnceBelowTheSendLimit()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(2, 64, 65536, 60000));
+
+			var first = CreateMessage(1);
+			var second = CreateMessage(2);
+			batcher.Enqueue(first, null, null);
+			batcher.Enqueue(second, null, null);
+
+			Assert.AreEqual(2, transport.BatchCount);
+			Assert.AreSame(first, transport.GetBatch(0)[0]);
+			Assert.AreSame(second, transport.GetBatch(1)[0]);
+		}
+
+		[TestMethod]
+		public void WaitingMessagesGoOutTogetherWhenASendReturns()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(1, 64, 65536, 60000));
+
+			var first = batcher.Enqueue(CreateMessage(1), null, null);
+			for (var id = 2; id <= 4; ++id)
+			{
+				batcher.Enqueue(CreateMessage(id), null, null);
+			}
+			Assert.AreEqual(1, transport.BatchCount);
+			Assert.IsFalse(first.IsCompleted);
+
+			transport.ReturnOne();
+
+			Assert.IsTrue(first.IsCompleted);
+			Assert.AreEqual(2, transport.BatchCount);
+			var batch = transport.GetBatch(1);
+			Assert.AreEqual(3, batch.Count);
+			for (var i = 0; i < batch.Count; ++i)
+			{
+				Assert.AreEqual(i + 2, batch[i].Id);
+			}
+		}
+
+		[TestMethod]
+		public void SendsWhenTheBatchIsFull()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(1, 3, 65536, 60000));
+
+			batcher.Enqueue(CreateMessage(1), null, null);
+			batcher.Enqueue(CreateMessage(2), null, null);
+			batcher.Enqueue(CreateMessage(3), null, null);
+			Assert.AreEqual(1, transport.BatchCount);
+
+			batcher.Enqueue(CreateMessage(4), null, null);
+			Assert.AreEqual(2, transport.BatchCount);
+			Assert.AreEqual(3, transport.GetBatch(1).Count);
+		}
+
+		[TestMethod]
+		public void SendsWhenTheBatchReachesItsBytes()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(1, 64, 1000, 60000));
+
+			batcher.Enqueue(CreateMessage(1), null, null);
+			var large = new RelayMessage(1, 2, new byte[600], MessageType.Get);
+			batcher.Enqueue(large, null, null);
+			Assert.AreEqual(1, transport.BatchCount);
+
+			batcher.Enqueue(new RelayMessage(1, 3, new byte[600], MessageType.Get), null, null);
+			Assert.AreEqual(2, transport.BatchCount);
+			Assert.AreEqual(2, transport.GetBatch(1).Count);
+			Assert.AreSame(large, transport.GetBatch(1)[0]);
+		}
+
+		[TestMethod]
+		public void SendsWhenTheOldestHasWaitedTheDelay()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(1, 64, 65536, 20));
+
+			batcher.Enqueue(CreateMessage(1), null, null);
+			var waiting = CreateMessage(2);
+			batcher.Enqueue(waiting, null, null);
+			Assert.AreEqual(1, transport.BatchCount);
+
+			Assert.IsTrue(transport.WaitForBatches(2), "The waiting message was never sent.");
+			Assert.AreSame(waiting, transport.GetBatch(1)[0]);
+		}
+
+		[TestMethod]
+		public void CompletesEachMessageWithItsCallbackAndState()
+		{
+			var transport = new FakeTransport();
+			var batcher = CreateBatcher(transport, CreateConfig(1, 64, 65536, 60000));
+			var completed = new List<object>();
+			AsyncCallback callback = asyncResult =>
+			{
+				Assert.IsTrue(OutMessageBatcher.IsBatched(asyncResult));
+				Assert.IsTrue(asyncResult.IsCompleted);
+				Assert.IsTrue(asyncResult.AsyncWaitHandle.WaitOne(0));
+				completed.Add(asyncResult.AsyncState);
+			};
+
+			batcher.Enqueue(CreateMessage(1), callback, "first");
+			batcher.Enqueue(CreateMessage(2), callback, "second");
+			batcher.Enqueue(CreateMessage(3), callback, "third");
+
+			transport.ReturnOne();
+			CollectionAssert.AreEqual(new object[] { "first" }, completed);
+			transport.ReturnOne();
+			CollectionAssert.AreEqual(new object[] { "first", "second", "third" }, completed);
+		}
+
+		[TestMethod]
+		public void FailedSendSetsAnErrorOnEveryMessage()
+		{
+			var transport = new FakeTransport { BeginError = new InvalidOperationException("Test send failure") };
+			var batcher = CreateBatcher(transport, CreateConfig(1, 64, 65536, 60000));
+			var message = CreateMessage(1);
+			var called = false;
+
+			var asyncResult = batcher.Enqueue(message, ar => called = true, null);
+
+			Assert.IsTrue(called);
+			Assert.IsTrue(asyncResult.IsCompleted);
+			Assert.AreEqual(RelayErrorType.Unknown, message.ErrorType);
+		}
+	}
+}
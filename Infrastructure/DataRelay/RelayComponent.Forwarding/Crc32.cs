@@ -0,0 +1,43 @@
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// The IEEE 802.3 CRC-32, as used by zip and Ethernet.
+	/// </summary>
+	internal static class Crc32
+	{
+		private static readonly uint[] _table = CreateTable();
+
+		private static uint[] CreateTable()
+		{
+			var table = new uint[256];
+			for (uint i = 0; i < table.Length; i++)
+			{
+				uint crc = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+				}
+				table[i] = crc;
+			}
+			return table;
+		}
+
+		/// <summary>
+		/// Computes the CRC of <paramref name="seed"/>'s four bytes followed by <paramref name="count"/>
+		/// bytes of <paramref name="buffer"/> from <paramref name="offset"/>.
+		/// </summary>
+		public static uint Compute(int seed, byte[] buffer, int offset, int count)
+		{
+			uint crc = 0xFFFFFFFF;
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				crc = _table[(crc ^ (uint)(seed >> shift)) & 0xFF] ^ (crc >> 8);
+			}
+			for (int i = offset, end = offset + count; i < end; i++)
+			{
+				crc = _table[(crc ^ buffer[i]) & 0xFF] ^ (crc >> 8);
+			}
+			return ~crc;
+		}
+	}
+}
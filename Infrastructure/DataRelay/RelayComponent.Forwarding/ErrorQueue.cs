@@ -64,9 +64,19 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				_itemsPerDequeue = config.ItemsPerDequeue;
 				_maxCount = config.MaxCount;
 
-				_persistence = ErrorQueuePersistence.Initialize(config.PersistenceFolder, _nodeName, _itemsPerDequeue,
-				                                                config.PersistenceFileSize, config.MaxPersistedMB,
-				                                                DequeueAllMessages, ProbeMessages);
+				var persistence = _persistence;
+				if (persistence != null && persistence.IsFor(config.PersistenceFolder))
+				{
+					persistence.Reload(_itemsPerDequeue, config.PersistenceFileSize, config.MaxPersistedMB);
+				}
+				else
+				{
+					// the log's files are mapped, so close them before another instance may open them
+					if (persistence != null) persistence.Dispose();
+					_persistence = ErrorQueuePersistence.Initialize(config.PersistenceFolder, _nodeName, _itemsPerDequeue,
+					                                                config.PersistenceFileSize, config.MaxPersistedMB,
+					                                                DequeueAllMessages, ProbeMessages);
+				}
 
 				if (config.Enabled)
 					_enabled = true;
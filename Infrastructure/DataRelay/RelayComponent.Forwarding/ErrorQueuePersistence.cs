@@ -10,21 +10,32 @@ using MySpace.Logging;
 namespace MySpace.DataRelay.RelayComponent.Forwarding
 {
 	/// <summary>
-	/// Implement persistent error queues.  When persistent error queues are 
+	/// Implement persistent error queues.  When persistent error queues are
 	/// enabled, the errored messages, in the form of <see cref="SerializedRelayMessage"/>
 	/// objects, are spilled to disk as they are added to the error queue.  Messages
 	/// are read from disk as they are dequeued.  The in-memory queues are kept
 	/// as empty as possible.
 	/// </summary>
-	internal class ErrorQueuePersistence
+	/// <remarks>
+	/// <para>Each node's messages are kept in an append-only log of memory-mapped
+	/// <see cref="ErrorQueueSegment"/> files.  Messages are appended to the last segment
+	/// and read back from the first, a dequeue's worth at a time, so replaying a large queue
+	/// never holds more than one batch of messages in memory.  Only those two segments are
+	/// kept mapped; the ones between are mapped again as reading reaches them, so a long
+	/// backlog doesn't use up address space.</para>
+	/// <para>How far reading has got is kept in a cursor file, so after a crash replay resumes
+	/// where it left off rather than from the start of the first segment.  Segments that have
+	/// been read are kept, up to a few, to be reused for new segments rather than deleted.</para>
+	/// </remarks>
+	internal class ErrorQueuePersistence : IDisposable
 	{
 		/// <summary>
 		/// Initializes persistent error queues.
 		/// </summary>
 		/// <param name="rootFolder">The root folder for persistent error queue storage.</param>
 		/// <param name="nodeName">Name of the node.  Used as a sub-folder name, for this node, under rootFolder.</param>
-		/// <param name="itemsPerFile">The number of messages per file.</param>
-		/// <param name="maxFileSize">The maximum file size in bytes.</param>
+		/// <param name="itemsPerDequeue">The most messages returned by one <see cref="Dequeue"/>.</param>
+		/// <param name="maxFileSize">The size in bytes of each segment file.</param>
 		/// <param name="globalMaxMb">The maximum aggregate files sizes in MB.  Zero is unlimited.</param>
 		/// <param name="getMessages">A delegate that will be called to retrieve messages from the <see cref="ErrorQueue"/>.</param>
 		/// <param name="probeMessages">A delegate that will be called to determine if the <see cref="ErrorQueue"/> has any
@@ -34,7 +45,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		public static ErrorQueuePersistence Initialize(
 			string rootFolder,
 			string nodeName,
-			int itemsPerFile,
+			int itemsPerDequeue,
 			int maxFileSize,
 			int globalMaxMb,
 			Func<SerializedRelayMessage[]> getMessages,
@@ -42,13 +53,13 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			if (string.IsNullOrEmpty(rootFolder))
 				return null;
-			
+
 			if (nodeName == null)
 				throw new ArgumentNullException("nodeName");
 			if (nodeName == string.Empty)
 				throw new ArgumentException("Node name may not be empty.", "nodeName");
-			if (itemsPerFile <= 0)
-				throw new ArgumentException("Items per file must be greater than zero.", "itemsPerFile");
+			if (itemsPerDequeue <= 0)
+				throw new ArgumentException("Items per dequeue must be greater than zero.", "itemsPerDequeue");
 			if (maxFileSize <= 0)
 				throw new ArgumentException("Max file size must be greater than zero.", "maxFileSize");
 			if (globalMaxMb < 0)
@@ -62,12 +73,12 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			{
 				var spillFolder = Path.Combine(rootFolder, nodeName);
 
-				var peristence = new ErrorQueuePersistence(spillFolder, nodeName, itemsPerFile, maxFileSize, getMessages, probeMessages);
+				var peristence = new ErrorQueuePersistence(spillFolder, nodeName, itemsPerDequeue, maxFileSize, getMessages, probeMessages);
 
 				GlobalMaxBytes = globalMaxMb > 0 ? globalMaxMb * 1024L * 1024L : long.MaxValue;
 
-				_log.DebugFormat("Persistent Error Queue Enabled for {0}:  itemsPerFile={1}, maxFileSize={2}, maxTotalBytes={3}",
-					nodeName, itemsPerFile, maxFileSize, GlobalMaxBytes);
+				_log.DebugFormat("Persistent Error Queue Enabled for {0}:  itemsPerDequeue={1}, maxFileSize={2}, maxTotalBytes={3}",
+					nodeName, itemsPerDequeue, maxFileSize, GlobalMaxBytes);
 
 				return peristence;
 			}
@@ -89,7 +100,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		/// units into consideration.)
 		/// </summary>
 		/// <value>The aggregate byte count of all error queue files.</value>
-		public static long GlobalFileBytes { get { return _globalFileSize; } }
+		public static long GlobalFileBytes { get { return Interlocked.Read(ref _globalFileSize); } }
 
 		private static int GetFileSequence(string path)
 		{
@@ -99,39 +110,10 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			return -1;
 		}
 
-		private static FileHeader GetFileHeader(string path)
-		{
-			using (var file = File.OpenRead(path))
-			{
-				return GetFileHeader(file);
-			}
-		}
-
-		private static FileHeader GetFileHeader(Stream stream)
-		{
-			stream.Position = 0;
-			var header = Serializer.Deserialize<FileHeader>(stream);
-			header.Length = stream.Length;
-			stream.Position = header.Position;
-
-			return header;
-		}
-
-		private static void WriteFileHeader(Stream stream, FileHeader header)
-		{
-			stream.Position = 0;
-			Serializer.Serialize(stream, header);
-
-			if (stream.Position > header.Position)
-				throw new FormatException("The Position value in the FileHeader is not past the end of the header.");
-
-			stream.Position = header.Position;
-		}
-
 		private ErrorQueuePersistence(
 			string spillFolder,
 			string nodeName,
-			int itemsPerFile,
+			int itemsPerDequeue,
 			int maxFileSize,
 			Func<SerializedRelayMessage[]> getMessages,
 			Func<bool> probeMessages)
@@ -139,7 +121,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 			_spillFolder = spillFolder;
 			_nodeName = nodeName;
-			_itemsPerFile = itemsPerFile;
+			_itemsPerDequeue = itemsPerDequeue;
 			_maxFileSize = maxFileSize;
 			_getMessages = getMessages;
 			_probeMessages = probeMessages;
@@ -160,46 +142,95 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				if (Directory.Exists(_spillFolder))
 				{
 					_spillInProgress = true;
-					ThreadPool.UnsafeQueueUserWorkItem(CountMessages, null);
+					ThreadPool.UnsafeQueueUserWorkItem(LoadSegments, null);
 				}
 			}
 		}
 
-		private void CountMessages(object obj)
+		/// <summary>
+		/// Gets whether this persists to <paramref name="rootFolder"/>.
+		/// </summary>
+		public bool IsFor(string rootFolder)
+		{
+			return !string.IsNullOrEmpty(rootFolder) &&
+				string.Equals(Path.Combine(rootFolder, _nodeName), _spillFolder, StringComparison.OrdinalIgnoreCase);
+		}
+
+		/// <summary>
+		/// Applies changed settings without reopening the log.
+		/// </summary>
+		public void Reload(int itemsPerDequeue, int maxFileSize, int globalMaxMb)
+		{
+			if (itemsPerDequeue > 0) _itemsPerDequeue = itemsPerDequeue;
+			if (maxFileSize > 0) _maxFileSize = maxFileSize;
+			GlobalMaxBytes = globalMaxMb > 0 ? globalMaxMb * 1024L * 1024L : long.MaxValue;
+		}
+
+		private void LoadSegments(object obj)
 		{
 			try
 			{
-				ResetGlobalFileSizeForNode(_nodeName);
+				// reusable segments aren't worth keeping across a restart
+				foreach (var path in Directory.GetFiles(_spillFolder, string.Format(_freeFilenameFormat, "*")))
+				{
+					File.Delete(path);
+				}
+
+				int cursorSequence;
+				long cursorPosition;
+				OpenCursor(out cursorSequence, out cursorPosition);
+				lock (_segmentsLock)
+				{
+					// new segments must sort after the cursor, or they'd be taken as read on the next load
+					_segmentSequence = Math.Max(_segmentSequence, cursorSequence - 1);
+				}
 
-				var pattern = string.Format(_spillFilenameFormat, "*");
-				var seqList = from fp in Directory.GetFiles(_spillFolder, pattern)
-					            select new {Path = fp, Seq = GetFileSequence(fp)};
-				var fileList = seqList.OrderBy(f => f.Seq).ToArray();
+				var segmentFiles = (from fp in Directory.GetFiles(_spillFolder, string.Format(_segmentFilenameFormat, "*"))
+				                    select new {Path = fp, Seq = GetFileSequence(fp)})
+					.OrderBy(f => f.Seq).ToArray();
 
-				foreach (var file in fileList)
+				foreach (var file in segmentFiles)
 				{
 					if (file.Seq < 0)
 					{
-						_log.WarnFormat("Encountered spill file with malformed name: {0}", file.Path);
+						_log.WarnFormat("Encountered error queue segment with malformed name: {0}", file.Path);
+						continue;
 					}
-					else
+					if (file.Seq < cursorSequence)
 					{
-						var header = GetFileHeader(file.Path);
-						IncrementGlobalFileSize(_nodeName, header.Length);
-						Interlocked.Add(ref _messageCount, header.MessageCount);
-						NodeManager.Instance.Counters.IncrementErrorQueueBy(header.MessageCount);
+						// read before the last shutdown, but not yet removed
+						File.Delete(file.Path);
+						continue;
+					}
 
-						lock (_spillFiles)
-						{
-							_spillFiles.Enqueue(file.Path);
-							_spillFileSequence = file.Seq;
-						}
+					int unread;
+					var segment = ErrorQueueSegment.Open(file.Path, file.Seq == cursorSequence ? cursorPosition : 0, out unread);
+					if (segment == null)
+					{
+						_log.WarnFormat("Encountered error queue segment with bad header: {0}", file.Path);
+						RenameToError(file.Path);
+						continue;
+					}
+
+					AddBytes(segment.Capacity);
+					Interlocked.Add(ref _messageCount, unread);
+					NodeManager.Instance.Counters.IncrementErrorQueueBy(unread);
+
+					lock (_segmentsLock)
+					{
+						var previous = _writeSegment;
+						_segments.Add(segment);
+						_writeSegment = segment;
+						_segmentSequence = Math.Max(_segmentSequence, file.Seq);
+						UnmapIfIdle(previous);
 					}
 				}
+
+				MigrateSpillFiles();
 			}
 			catch (Exception e)
 			{
-				_log.Error("Exception counting messages for " + _nodeName, e);
+				_log.Error("Exception loading error queue segments for " + _nodeName, e);
 			}
 			finally
 			{
@@ -211,6 +242,42 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 		}
 
+		/// <summary>
+		/// Appends the messages of spill files written before segments were used, oldest first.
+		/// </summary>
+		private void MigrateSpillFiles()
+		{
+			var spillFiles = (from fp in Directory.GetFiles(_spillFolder, string.Format(_spillFilenameFormat, "*"))
+			                  select new {Path = fp, Seq = GetFileSequence(fp)})
+				.Where(f => f.Seq >= 0).OrderBy(f => f.Seq).ToArray();
+
+			foreach (var file in spillFiles)
+			{
+				try
+				{
+					int count = 0;
+					using (var stream = File.OpenRead(file.Path))
+					{
+						var header = Serializer.Deserialize<SpillFileHeader>(stream);
+						stream.Position = header.Position;
+						for (int i = 0; i < header.MessageCount; ++i)
+						{
+							Append(Serializer.Deserialize<SerializedRelayMessage>(stream));
+							++count;
+						}
+					}
+					FlushWriteSegment();
+					NodeManager.Instance.Counters.IncrementErrorQueueBy(count);
+					File.Delete(file.Path);
+				}
+				catch (Exception e)
+				{
+					_log.Error("Exception migrating spill file " + file.Path, e);
+					RenameToError(file.Path);
+				}
+			}
+		}
+
 		/// <summary>
 		/// Creates the spill folder for this persistent error queue.
 		/// </summary>
@@ -219,7 +286,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			try
 			{
-				lock (_spillFiles)
+				lock (_segmentsLock)
 				{
 					if (Directory.Exists(_spillFolder))
 						return true;
@@ -249,7 +316,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			lock (_spillLock)
 			{
-				if (!_spillInProgress)
+				if (!_spillInProgress && !_disposed)
 				{
 					ThreadPool.UnsafeQueueUserWorkItem(RunSpill, null);
 					_spillInProgress = true;
@@ -259,11 +326,6 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		private void RunSpill(object obj)
 		{
-			Stream spillFile = null;
-			FileHeader header = null;
-			long bytesWritten = 0;
-			long initialLength = 0;
-
 			try
 			{
 				while (true)
@@ -273,80 +335,24 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 					foreach (var message in messages)
 					{
-						if (spillFile == null) lock (_spillFiles)
-						{
-							if (_currentSpillFilePath == null)
-							{
-								_currentSpillFilePath = Path.Combine(_spillFolder,
-								                                 string.Format(_spillFilenameFormat, (++_spillFileSequence).ToString("d8")));
-								header = new FileHeader();
-								spillFile = File.Open(_currentSpillFilePath, FileMode.CreateNew, FileAccess.ReadWrite);
-								WriteFileHeader(spillFile, header);
-								_spillFiles.Enqueue(_currentSpillFilePath);
-								initialLength = 0;
-							}
-							else
-							{
-								spillFile = File.Open(_currentSpillFilePath, FileMode.Open, FileAccess.ReadWrite);
-								header = GetFileHeader(spillFile);
-								spillFile.Position = spillFile.Length;
-								initialLength = spillFile.Length;
-							}
-						}
-
-						Serializer.Serialize(spillFile, message);
-						++header.MessageCount;
-						Interlocked.Increment(ref _messageCount);
-
-						if (header.MessageCount >= _itemsPerFile || spillFile.Position >= _maxFileSize) lock (_spillFiles)
-						{
-							bytesWritten += spillFile.Length - initialLength;
-							_currentSpillFilePath = null;
-							WriteFileHeader(spillFile, header);
-							spillFile.Close();
-							spillFile = null;
-						}
+						Append(message);
 					}
+					FlushWriteSegment();
 				}
 
-				if (spillFile != null)
+				while (GlobalFileBytes > GlobalMaxBytes && DiscardOneSegment())
 				{
-					bytesWritten += spillFile.Length - initialLength;
-					WriteFileHeader(spillFile, header);
-					spillFile.Close();
-					spillFile = null;
 				}
-
-				if (IncrementGlobalFileSize(_nodeName, bytesWritten))
-					DiscardOneFile();
 			}
 			catch (Exception e)
 			{
 				_log.Error(e);
-
-				if (spillFile != null) lock (_spillFiles)
-				{
-					var path = _currentSpillFilePath;
-					_currentSpillFilePath = null;
-					spillFile.Dispose();
-
-					if (path != null) try
-					{
-						var newName = path.Replace(_spillFileExtension, ".error");
-						File.Delete(newName);
-						File.Move(path, newName);
-					}
-					catch (Exception e2)
-					{
-						_log.Error("Exception renaming " + path, e2);
-					}
-				}
 			}
 			finally
 			{
 				lock (_spillLock)
 				{
-					if (_probeMessages())
+					if (_probeMessages() && !_disposed)
 					{
 						// New messages appeared between the time we detected the empty
 						// queue above and now.
@@ -361,46 +367,188 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 		}
 
-		private void DiscardOneFile()
+		/// <summary>
+		/// Appends <paramref name="message"/> to the log.  Only called by the one thread spilling.
+		/// </summary>
+		private void Append(SerializedRelayMessage message)
 		{
-			string path;
+			_writeBuffer.SetLength(0);
+			Serializer.Serialize(_writeBuffer, message);
+			var bytes = _writeBuffer.GetBuffer();
+			var length = (int)_writeBuffer.Length;
 
-			lock (_spillFiles)
+			var segment = _writeSegment;
+			if (segment == null || !segment.TryAppend(bytes, length))
 			{
-				if (_spillFiles.Count == 0) return;
-				path = _spillFiles.Peek();
-				if (path == _currentSpillFilePath) return;
-				_spillFiles.Dequeue();
+				if (segment != null) segment.Flush();
+				segment = AddSegment(length);
+				if (!segment.TryAppend(bytes, length))
+					throw new InvalidOperationException("A new error queue segment could not hold a message of " + length + " bytes.");
 			}
 
-			try
+			Interlocked.Increment(ref _messageCount);
+		}
+
+		private void FlushWriteSegment()
+		{
+			var segment = _writeSegment;
+			if (segment != null) segment.Flush();
+		}
+
+		private ErrorQueueSegment AddSegment(int recordLength)
+		{
+			long capacity = Math.Max(_maxFileSize, ErrorQueueSegment.GetCapacityFor(recordLength));
+			int sequence;
+			string reusePath = null;
+			lock (_segmentsLock)
 			{
-				using (var file = File.Open(path, FileMode.Open, FileAccess.Read))
+				sequence = ++_segmentSequence;
+				if (capacity == _maxFileSize && _freeSegments.Count > 0)
 				{
-					var header = GetFileHeader(file);
+					reusePath = _freeSegments.Dequeue();
+				}
+			}
 
-					_log.WarnFormat("Discarding Error Queue file containing {0} messages because maximum disk space exceeded: {1}",
-									header.MessageCount, path);
+			var path = Path.Combine(_spillFolder, string.Format(_segmentFilenameFormat, sequence.ToString("d8")));
+			long existingBytes = 0;
+			if (reusePath != null)
+			{
+				try
+				{
+					existingBytes = new FileInfo(reusePath).Length;
+					File.Move(reusePath, path);
+				}
+				catch (Exception e)
+				{
+					_log.Error("Exception reusing error queue segment " + reusePath, e);
+					DeleteFile(reusePath, existingBytes);
+					existingBytes = 0;
+				}
+			}
 
-					Interlocked.Add(ref _messageCount, -header.MessageCount);
-					NodeManager.Instance.Counters.IncrementErrorQueueBy(-header.MessageCount);
-					IncrementDiscardCount(header.MessageCount);
-					IncrementGlobalFileSize(_nodeName, -file.Length);
+			var segment = ErrorQueueSegment.Create(path, sequence, capacity);
+			AddBytes(segment.Capacity - existingBytes);
 
-					for (int i = 0; i < header.MessageCount; ++i)
-					{
-						var message = Serializer.Deserialize<SerializedRelayMessage>(file);
-						Forwarder.RaiseMessageDropped(message);
-					}
-				}
+			lock (_segmentsLock)
+			{
+				var previous = _writeSegment;
+				_segments.Add(segment);
+				_writeSegment = segment;
+				UnmapIfIdle(previous);
+			}
+			return segment;
+		}
+
+		/// <summary>
+		/// Unmaps <paramref name="segment"/> if it is neither read nor written.  Called holding _segmentsLock,
+		/// which is also held while the reader maps the first segment, so a segment is never unmapped once
+		/// reading reaches it.
+		/// </summary>
+		private void UnmapIfIdle(ErrorQueueSegment segment)
+		{
+			if (segment == null || segment == _writeSegment || (_segments.Count > 0 && segment == _segments[0]))
+				return;
+			try
+			{
+				segment.Unmap();
 			}
 			catch (Exception e)
 			{
-				_log.Error(e);
+				_log.Error("Exception unmapping error queue segment " + segment.Path, e);
 			}
-			finally
+		}
+
+		/// <summary>
+		/// Removes <paramref name="segment"/>, the first, once nothing more will be read from it.
+		/// </summary>
+		private void RetireSegment(ErrorQueueSegment segment, bool reuse)
+		{
+			lock (_segmentsLock)
 			{
-				File.Delete(path);
+				_segments.Remove(segment);
+				reuse &= segment.Capacity == _maxFileSize && _freeSegments.Count < _maxFreeSegments;
+			}
+			segment.Dispose();
+
+			if (reuse)
+			{
+				var freePath = Path.Combine(_spillFolder, string.Format(_freeFilenameFormat, segment.Sequence.ToString("d8")));
+				try
+				{
+					File.Move(segment.Path, freePath);
+					lock (_segmentsLock)
+					{
+						_freeSegments.Enqueue(freePath);
+					}
+					return;
+				}
+				catch (Exception e)
+				{
+					_log.Error("Exception keeping error queue segment " + segment.Path, e);
+				}
+			}
+			DeleteFile(segment.Path, segment.Capacity);
+		}
+
+		private bool DiscardOneSegment()
+		{
+			lock (_readLock)
+			{
+				// free segments go first; they hold no messages
+				string freePath = null;
+				ErrorQueueSegment segment = null;
+				lock (_segmentsLock)
+				{
+					if (_freeSegments.Count > 0) freePath = _freeSegments.Dequeue();
+					else if (_segments.Count > 1)
+					{
+						segment = _segments[0];
+						segment.Map();
+					}
+				}
+				if (freePath != null)
+				{
+					// the file was sized by the segment bound when it was retired, which may since have changed
+					long freeBytes = 0;
+					try
+					{
+						freeBytes = new FileInfo(freePath).Length;
+					}
+					catch (Exception e)
+					{
+						_log.Error("Exception reading length of " + freePath, e);
+					}
+					DeleteFile(freePath, freeBytes);
+					return true;
+				}
+				if (segment == null) return false;
+
+				int count = 0;
+				int length;
+				while (segment.TryRead(ref _readBuffer, out length))
+				{
+					++count;
+					try
+					{
+						Forwarder.RaiseMessageDropped(Serializer.Deserialize<SerializedRelayMessage>(
+							new MemoryStream(_readBuffer, 0, length, false)));
+					}
+					catch (Exception e)
+					{
+						_log.Error(e);
+					}
+				}
+
+				_log.WarnFormat("Discarding Error Queue segment containing {0} messages because maximum disk space exceeded: {1}",
+								count, segment.Path);
+
+				Interlocked.Add(ref _messageCount, -count);
+				NodeManager.Instance.Counters.IncrementErrorQueueBy(-count);
+				IncrementDiscardCount(count);
+
+				RetireSegment(segment, false);
+				SaveCursor();
+				return true;
 			}
 		}
 
@@ -422,69 +570,61 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		/// Dequeues persisted messages into the supplied <see cref="SerializedMessageList"/>.
 		/// </summary>
 		/// <remarks>
-		/// Each message file holds, at most, the number of messages specfied by the ItemsPerDequeue
-		/// QueueConfig" parameter.  One file is deserialized per <see cref="Dequeue"/> call, so the
-		/// number of messages returned will not exceed ItemsPerDequeue.
+		/// Messages are read in the order they were spilled, at most the number specified by the
+		/// ItemsPerDequeue QueueConfig parameter per call.  Only the messages returned are read into
+		/// memory.
 		/// </remarks>
 		/// <param name="messages">A <see cref="SerializedMessageList"/> into which the messages are stored.</param>
 		public void Dequeue(SerializedMessageList messages)
 		{
-			string path;
-
-			lock (_spillFiles)
+			lock (_readLock)
 			{
-				// This should never happen.
-				if (_spillFiles.Count == 0) return;
-
-				path = _spillFiles.Peek();
-				if (path == _currentSpillFilePath) lock (_spillLock)
+				int count = 0;
+				int skipped = 0;
+				int itemsPerDequeue = _itemsPerDequeue;
+				while (count < itemsPerDequeue)
 				{
-					// We'll deadlock if we try to wait for the spill to complete, so bail-out.
-					if (_spillInProgress) return;
-
-					_currentSpillFilePath = null;
-				}
-
-				_spillFiles.Dequeue();
-			}
-
-			try
-			{
-				using (var file = File.Open(path, FileMode.Open, FileAccess.Read))
-				{
-					var header = GetFileHeader(file);
-					IncrementGlobalFileSize(_nodeName, -file.Length);
+					ErrorQueueSegment segment;
+					bool isSealed;
+					lock (_segmentsLock)
+					{
+						if (_segments.Count == 0) break;
+						segment = _segments[0];
+						segment.Map();
+						// only the last segment is still appended to
+						isSealed = _segments.Count > 1;
+					}
 
-					for (int i = 0; i < header.MessageCount; ++i)
+					int length;
+					if (segment.TryRead(ref _readBuffer, out length))
 					{
-						var message = Serializer.Deserialize<SerializedRelayMessage>(file);
-						messages.Add(message);
+						try
+						{
+							messages.Add(Serializer.Deserialize<SerializedRelayMessage>(new MemoryStream(_readBuffer, 0, length, false)));
+							++count;
+						}
+						catch (Exception e)
+						{
+							_log.Error("Exception deserializing error queue message from " + segment.Path, e);
+							++skipped;
+						}
+						continue;
 					}
 
-					Interlocked.Add(ref _messageCount, -header.MessageCount);
+					if (!isSealed) break;
+					RetireSegment(segment, true);
 				}
 
-				File.Delete(path);
-			}
-			catch (Exception e)
-			{
-				_log.Error("Exception deserializing " + path, e);
-				
-				if (File.Exists(path))
+				if (count + skipped > 0)
 				{
-					try
+					Interlocked.Add(ref _messageCount, -(count + skipped));
+					if (skipped > 0)
 					{
-						string newName = path.Replace(_spillFileExtension, ".error");
-						File.Delete(newName);
-						File.Move(path, newName);
-					}
-					catch (IOException ioex)
-					{
-						_log.Error("Exception renaming " + path, ioex);
+						NodeManager.Instance.Counters.IncrementErrorQueueBy(-skipped);
+						IncrementDiscardCount(skipped);
 					}
+					SaveCursor();
 				}
-				
-				throw;
 			}
 		}
 
@@ -492,41 +632,106 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		/// Gets count of files for this node.
 		/// </summary>
 		/// <value>The file count.</value>
-		public int FileCount { get { lock (_spillFiles) return _spillFiles.Count; } }
+		public int FileCount { get { lock (_segmentsLock) return _segments.Count + _freeSegments.Count; } }
+
+		#region Cursor
+
+		private void OpenCursor(out int sequence, out long position)
+		{
+			sequence = 0;
+			position = 0;
+			var path = Path.Combine(_spillFolder, _cursorFilename);
+			_cursorFile = new FileStream(path, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.ReadWrite | FileShare.Delete);
+			if (_cursorFile.Length < _cursorBuffer.Length) return;
+
+			_cursorFile.Position = 0;
+			if (_cursorFile.Read(_cursorBuffer, 0, _cursorBuffer.Length) != _cursorBuffer.Length) return;
+			if (Crc32.Compute(0, _cursorBuffer, 0, 12) != BitConverter.ToUInt32(_cursorBuffer, 12))
+			{
+				_log.WarnFormat("Error queue cursor for {0} is damaged; replaying every segment", _nodeName);
+				return;
+			}
+			sequence = BitConverter.ToInt32(_cursorBuffer, 0);
+			position = BitConverter.ToInt64(_cursorBuffer, 4);
+		}
 
-		private static bool IncrementGlobalFileSize(string node, long increment)
+		/// <summary>
+		/// Records how far reading has got.  Called holding _readLock.
+		/// </summary>
+		private void SaveCursor()
 		{
-			lock (_fileSizeByNode)
+			int sequence = 0;
+			long position = 0;
+			lock (_segmentsLock)
 			{
-				long curSize;
-				if (_fileSizeByNode.TryGetValue(node, out curSize))
+				if (_segments.Count > 0)
 				{
-					_fileSizeByNode[node] = curSize + increment;
+					sequence = _segments[0].Sequence;
+					position = _segments[0].ReadPosition;
 				}
 				else
 				{
-					_fileSizeByNode.Add(node, increment);
+					// everything so far has been read
+					sequence = _segmentSequence + 1;
 				}
 			}
 
-			var byteCount = Interlocked.Add(ref _globalFileSize, increment);
-			NodeManager.Instance.Counters.SetPersistentErrorQueueBytes(byteCount);
-			return byteCount > GlobalMaxBytes;
+			try
+			{
+				if (_cursorFile == null)
+				{
+					_cursorFile = new FileStream(Path.Combine(_spillFolder, _cursorFilename), FileMode.OpenOrCreate,
+						FileAccess.ReadWrite, FileShare.ReadWrite | FileShare.Delete);
+				}
+				Buffer.BlockCopy(BitConverter.GetBytes(sequence), 0, _cursorBuffer, 0, 4);
+				Buffer.BlockCopy(BitConverter.GetBytes(position), 0, _cursorBuffer, 4, 8);
+				Buffer.BlockCopy(BitConverter.GetBytes(Crc32.Compute(0, _cursorBuffer, 0, 12)), 0, _cursorBuffer, 12, 4);
+				_cursorFile.Position = 0;
+				_cursorFile.Write(_cursorBuffer, 0, _cursorBuffer.Length);
+				_cursorFile.Flush();
+			}
+			catch (Exception e)
+			{
+				_log.Error("Exception saving error queue cursor for " + _nodeName, e);
+			}
+		}
+
+		#endregion
+
+		private void DeleteFile(string path, long bytes)
+		{
+			try
+			{
+				File.Delete(path);
+				AddBytes(-bytes);
+			}
+			catch (Exception e)
+			{
+				_log.Error("Exception deleting " + path, e);
+			}
 		}
 
-		private static void ResetGlobalFileSizeForNode(string node)
+		private static void RenameToError(string path)
 		{
-			lock (_fileSizeByNode)
+			try
 			{
-				long nodeSize;
-				if (_fileSizeByNode.TryGetValue(node, out nodeSize))
-				{
-					_fileSizeByNode.Remove(node);
-					NodeManager.Instance.Counters.SetPersistentErrorQueueBytes(Interlocked.Add(ref _globalFileSize, -nodeSize));
-				}
+				var newName = Path.ChangeExtension(path, ".error");
+				File.Delete(newName);
+				File.Move(path, newName);
+			}
+			catch (Exception e)
+			{
+				_log.Error("Exception renaming " + path, e);
 			}
 		}
 
+		private void AddBytes(long increment)
+		{
+			Interlocked.Add(ref _fileBytes, increment);
+			var byteCount = Interlocked.Add(ref _globalFileSize, increment);
+			NodeManager.Instance.Counters.SetPersistentErrorQueueBytes(byteCount);
+		}
+
 		private void IncrementDiscardCount(int count)
 		{
 			Interlocked.Add(ref _discardCount, count);
@@ -535,41 +740,88 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		public int DiscardCount { get { return _discardCount; } }
 
+		/// <summary>
+		/// Closes the log's files.  Messages in them are kept for the next instance.
+		/// </summary>
+		public void Dispose()
+		{
+			lock (_spillLock)
+			{
+				_disposed = true;
+			}
+			WaitForSpill();
+
+			lock (_readLock)
+			{
+				lock (_segmentsLock)
+				{
+					foreach (var segment in _segments)
+					{
+						segment.Flush();
+						segment.Dispose();
+					}
+					_segments.Clear();
+					_writeSegment = null;
+				}
+				if (_cursorFile != null)
+				{
+					_cursorFile.Dispose();
+					_cursorFile = null;
+				}
+			}
+
+			// the files are still there, but this instance no longer answers for them
+			AddBytes(-Interlocked.Exchange(ref _fileBytes, 0));
+		}
+
+		/// <summary>
+		/// The header of a spill file written before segments were used.
+		/// </summary>
 		[SerializableClass]
-		private class FileHeader
+		private class SpillFileHeader
 		{
 			[SerializableProperty(1)]
 			public int MessageCount;
 			[SerializableProperty(1)]
 			public long Position = 64;
-
-			public long Length;
 		}
 
 		private static readonly LogWrapper _log = new LogWrapper();
 
 		private readonly object _spillLock = new object();
 		private bool _spillInProgress;
+		private bool _disposed;
 
 		private readonly string _spillFolder;
 		private readonly string _nodeName;
-		private readonly int _itemsPerFile;
-		private readonly int _maxFileSize;
+		private int _itemsPerDequeue;
+		private int _maxFileSize;
 		private readonly Func<SerializedRelayMessage[]> _getMessages;
 		private readonly Func<bool> _probeMessages;
 
-		private const string _spillFileExtension = ".spill";
-		private const string _spillFilenameFormat = "{0}" + _spillFileExtension;
-	
-		private readonly Queue<string> _spillFiles = new Queue<string>();
-		private int _spillFileSequence;
-		private string _currentSpillFilePath;
-		
+		private const string _spillFilenameFormat = "{0}.spill";
+		private const string _segmentFilenameFormat = "{0}.segment";
+		private const string _freeFilenameFormat = "{0}.free";
+		private const string _cursorFilename = "cursor";
+		private const int _maxFreeSegments = 2;
+
+		private readonly object _segmentsLock = new object();
+		private readonly List<ErrorQueueSegment> _segments = new List<ErrorQueueSegment>();
+		private readonly Queue<string> _freeSegments = new Queue<string>();
+		private ErrorQueueSegment _writeSegment;
+		private int _segmentSequence;
+
+		private readonly object _readLock = new object();
+		private byte[] _readBuffer;
+		private readonly MemoryStream _writeBuffer = new MemoryStream();
+		private readonly byte[] _cursorBuffer = new byte[16];
+		private FileStream _cursorFile;
+
 		private int _messageCount;
 		private int _discardCount;
+		private long _fileBytes;
 
 		private static long _globalFileSize;
-		private static readonly Dictionary<string, long> _fileSizeByNode = new Dictionary<string, long>();
 		private static long _globalMaxBytes = long.MaxValue;
 	}
 }
@@ -0,0 +1,251 @@
+using System;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Threading;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// One memory-mapped file of a node's persistent error queue log.
+	/// </summary>
+	/// <remarks>
+	/// <para>The file is a fixed size, so it is allocated once and may be reused for a later segment.
+	/// After a header, records are appended one after another, each framed by its length and a CRC of
+	/// the segment's sequence number and its bytes. Reading stops at the first record that does not
+	/// check out, so a write torn by a crash, or a record left from the file's previous use, ends the log.</para>
+	/// <para>One thread appends while another reads; a record is visible to the reader only once
+	/// <see cref="WritePosition"/> has moved past it.</para>
+	/// <para>A segment between the one being read and the one being written is unmapped, keeping
+	/// only its positions, and mapped again with <see cref="Map"/> when the reader reaches it.</para>
+	/// </remarks>
+	internal sealed class ErrorQueueSegment : IDisposable
+	{
+		private const int _headerLength = 16;
+		private const int _recordHeaderLength = 8;
+		private const int _magic = 0x4C515245; // "ERQL"
+		private const int _version = 1;
+
+		private FileStream _stream;
+		private MemoryMappedFile _file;
+		private MemoryMappedViewAccessor _view;
+		private long _writePosition;
+		private long _readPosition;
+
+		private ErrorQueueSegment(string path, long capacity)
+		{
+			Path = path;
+			Capacity = capacity;
+			Map();
+		}
+
+		/// <summary>
+		/// Gets the smallest capacity of a segment that can hold a record of <paramref name="length"/> bytes.
+		/// </summary>
+		public static long GetCapacityFor(int length)
+		{
+			return _headerLength + _recordHeaderLength + length + sizeof(int);
+		}
+
+		/// <summary>
+		/// Creates an empty segment at <paramref name="path"/>, reusing the file there if any.
+		/// </summary>
+		public static ErrorQueueSegment Create(string path, int sequence, long capacity)
+		{
+			var segment = new ErrorQueueSegment(path, capacity);
+			segment.Sequence = sequence;
+			segment._view.Write(0, _magic);
+			segment._view.Write(4, _version);
+			segment._view.Write(8, sequence);
+			segment._view.Write(_headerLength, 0);
+			segment._writePosition = _headerLength;
+			segment._readPosition = _headerLength;
+			return segment;
+		}
+
+		/// <summary>
+		/// Opens the segment at <paramref name="path"/> and finds the end of its log.
+		/// </summary>
+		/// <param name="path">The segment file.</param>
+		/// <param name="readPosition">Where reading left off, or zero to read from the start.</param>
+		/// <param name="unread">The number of records past <paramref name="readPosition"/>.</param>
+		/// <returns>The segment, or <see langword="null"/> if the file is not a segment.</returns>
+		public static ErrorQueueSegment Open(string path, long readPosition, out int unread)
+		{
+			unread = 0;
+			long length = new FileInfo(path).Length;
+			if (length < GetCapacityFor(0)) return null;
+
+			var segment = new ErrorQueueSegment(path, length);
+			if (segment._view.ReadInt32(0) != _magic || segment._view.ReadInt32(4) != _version)
+			{
+				segment.Dispose();
+				return null;
+			}
+			segment.Sequence = segment._view.ReadInt32(8);
+
+			bool foundReadPosition = readPosition <= _headerLength;
+			long position = _headerLength;
+			int recordLength;
+			byte[] buffer = null;
+			while ((recordLength = segment.ReadRecord(position, ref buffer)) >= 0)
+			{
+				if (position == readPosition) foundReadPosition = true;
+				if (position >= readPosition) unread++;
+				position += _recordHeaderLength + recordLength;
+			}
+			if (position == readPosition) foundReadPosition = true;
+
+			segment._writePosition = position;
+			if (foundReadPosition)
+			{
+				segment._readPosition = Math.Max(readPosition, _headerLength);
+			}
+			else
+			{
+				// not on a record boundary, so the cursor is from some other log; replay it all
+				segment._readPosition = _headerLength;
+				unread = 0;
+				for (long p = _headerLength; (recordLength = segment.ReadRecord(p, ref buffer)) >= 0; p += _recordHeaderLength + recordLength)
+				{
+					unread++;
+				}
+			}
+			return segment;
+		}
+
+		public string Path { get; private set; }
+
+		public int Sequence { get; private set; }
+
+		public long Capacity { get; private set; }
+
+		public long WritePosition
+		{
+			get { return Interlocked.Read(ref _writePosition); }
+		}
+
+		public long ReadPosition
+		{
+			get { return _readPosition; }
+		}
+
+		/// <summary>
+		/// Gets whether the file is open and mapped.
+		/// </summary>
+		public bool IsMapped
+		{
+			get { return _view != null; }
+		}
+
+		/// <summary>
+		/// Opens and maps the file, if it isn't already.
+		/// </summary>
+		public void Map()
+		{
+			if (_view != null) return;
+			try
+			{
+				// shared so that an instance left behind by a config reload or AppDomain restart can't lock us out
+				_stream = new FileStream(Path, FileMode.OpenOrCreate, FileAccess.ReadWrite, FileShare.ReadWrite | FileShare.Delete);
+				if (_stream.Length != Capacity)
+				{
+					_stream.SetLength(Capacity);
+				}
+				_file = MemoryMappedFile.CreateFromFile(_stream, null, Capacity, MemoryMappedFileAccess.ReadWrite, null,
+					HandleInheritability.None, true);
+				_view = _file.CreateViewAccessor(0, Capacity);
+			}
+			catch
+			{
+				Release();
+				throw;
+			}
+		}
+
+		/// <summary>
+		/// Writes the file through and closes it, keeping the read and write positions.
+		/// </summary>
+		public void Unmap()
+		{
+			Flush();
+			Release();
+		}
+
+		/// <summary>
+		/// Appends a record of <paramref name="length"/> bytes from <paramref name="buffer"/>.
+		/// </summary>
+		/// <returns><see langword="false"/> if the segment has no room for it.</returns>
+		public bool TryAppend(byte[] buffer, int length)
+		{
+			long position = _writePosition;
+			long end = position + _recordHeaderLength + length;
+			if (end + sizeof(int) > Capacity) return false;
+
+			_view.WriteArray(position + _recordHeaderLength, buffer, 0, length);
+			_view.Write(end, 0); // ends the log here until the next record
+			_view.Write(position + 4, Crc32.Compute(Sequence, buffer, 0, length));
+			_view.Write(position, length);
+			Interlocked.Exchange(ref _writePosition, end);
+			return true;
+		}
+
+		/// <summary>
+		/// Reads the next unread record into <paramref name="buffer"/>, growing it if need be.
+		/// </summary>
+		/// <returns><see langword="false"/> if there is no complete record to read.</returns>
+		public bool TryRead(ref byte[] buffer, out int length)
+		{
+			length = 0;
+			if (_readPosition >= WritePosition) return false;
+
+			length = ReadRecord(_readPosition, ref buffer);
+			if (length < 0)
+			{
+				// can't be read past, so the rest is lost
+				_readPosition = WritePosition;
+				length = 0;
+				return false;
+			}
+			_readPosition += _recordHeaderLength + length;
+			return true;
+		}
+
+		private int ReadRecord(long position, ref byte[] buffer)
+		{
+			if (position + _recordHeaderLength > Capacity) return -1;
+			int length = _view.ReadInt32(position);
+			if (length <= 0 || position + _recordHeaderLength + length > Capacity) return -1;
+
+			uint crc = _view.ReadUInt32(position + 4);
+			if (buffer == null || buffer.Length < length)
+			{
+				buffer = new byte[Math.Max(length, buffer == null ? 4096 : buffer.Length * 2)];
+			}
+			_view.ReadArray(position + _recordHeaderLength, buffer, 0, length);
+			return Crc32.Compute(Sequence, buffer, 0, length) == crc ? length : -1;
+		}
+
+		/// <summary>
+		/// Writes appended records through to the file.
+		/// </summary>
+		public void Flush()
+		{
+			if (_view != null) _view.Flush();
+		}
+
+		private void Release()
+		{
+			if (_view != null) _view.Dispose();
+			if (_file != null) _file.Dispose();
+			if (_stream != null) _stream.Dispose();
+			_view = null;
+			_file = null;
+			_stream = null;
+		}
+
+		public void Dispose()
+		{
+			Release();
+		}
+	}
+}
@@ -335,7 +335,20 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			Node node;
 			if (message.IsTwoWayMessage)
 			{
-				if (PrepareMessage(message).Pop(out node)) node.HandleOutMessage(message);
+				if (PrepareMessage(message).Pop(out node))
+				{
+					HedgeSetting hedgeSetting = HedgedGet.GetHedgeSetting(message);
+					if (hedgeSetting == null)
+					{
+						node.HandleOutMessage(message);
+					}
+					else
+					{
+						AutoResetEvent waitHandle = OutMessageWaitHandle;
+						HedgedGet.Begin(message, node, hedgeSetting, ar => waitHandle.Set(), null);
+						waitHandle.WaitOne();
+					}
+				}
 				else message.SetError(RelayErrorType.NoNodesAvailable);
 
 				RetryHandleMessageOnError(message, node);
@@ -768,6 +781,12 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			Node node;
 			if (nodes.Pop(out node))
 			{
+				HedgeSetting hedgeSetting = HedgedGet.GetHedgeSetting(message);
+				if (hedgeSetting != null)
+				{
+					return HedgedGet.Begin(message, node, hedgeSetting, callback, state);
+				}
+
 				var result = new AsynchronousResult<Node>((ar, n, m) =>
 					{
 						try
@@ -843,6 +862,21 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			if (asyncResult is SynchronousAsyncResult) return;
 
+			var hedgedGet = asyncResult as HedgedGet;
+			if (hedgedGet != null)
+			{
+				try
+				{
+					RetryHandleMessageOnError(hedgedGet.Message, hedgedGet.Node);
+				}
+				catch (Exception ex)
+				{
+					log.Error(ex);
+				}
+				Thread.MemoryBarrier();
+				return;
+			}
+
 			((AsynchronousResult)asyncResult).Complete();
 			Thread.MemoryBarrier();
 		}
@@ -54,6 +54,32 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		/// </summary>
 		[XmlElement("RepostMessageLists")]
 		public bool RepostMessageLists;
+		/// <summary>
+		/// Whether out messages sent to a node by separate callers are coalesced into message lists once the node is busy.
+		/// </summary>
+		[XmlElement("OutMessageBatching")]
+		public bool OutMessageBatching;
+		/// <summary>
+		/// The most out messages coalesced into one list.
+		/// </summary>
+		[XmlElement("OutMessageBatchLength")]
+		public int OutMessageBatchLength = 64;
+		/// <summary>
+		/// The approximate number of bytes of out messages at which a list is sent without waiting further.
+		/// </summary>
+		[XmlElement("OutMessageBatchBytes")]
+		public int OutMessageBatchBytes = 65536;
+		/// <summary>
+		/// The most milliseconds an out message waits for others to be coalesced with.
+		/// </summary>
+		[XmlElement("OutMessageBatchDelay")]
+		public int OutMessageBatchDelay = 5;
+		/// <summary>
+		/// The most out message sends to a node outstanding before messages start waiting to be coalesced.
+		/// The number actually used adapts to the node's round trip time.
+		/// </summary>
+		[XmlElement("OutMessageBatchSends")]
+		public int OutMessageBatchSends = 8;
 		
 		/// <summary>
 		/// If true, the forwarder will write the message.tostring and destination nodes of all handled RelayMessages to the default Trace.
@@ -12,6 +12,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		public static readonly string PerformanceCategoryName = "MySpace Relay Forwarding";
 		private bool nov09CountersExist = false;
 		private bool nov10CountersExist = false;
+		private bool hedgeCountersExist = false;
 
 		protected PerformanceCounter[] PerformanceCounters;
 		protected enum PerformanceCounterIndexes
@@ -50,7 +51,10 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			Increment = 30,
 
 			PersistentErrorQueueBytes = 31,			// Begin counters added 11/5/10
-			ErrorQueueMessagesDiscarded = 32
+			ErrorQueueMessagesDiscarded = 32,
+
+			HedgedGets = 33,
+			HedgedGetsWon = 34
 		}
 
 
@@ -88,7 +92,9 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			@"Msg/Sec - Confirmed Increment",
 			@"Msg/Sec - Increment",
 			@"Persistent Error Queue Bytes",
-			@"Error Queue Messages Discarded"
+			@"Error Queue Messages Discarded",
+			@"Msg/Sec - Hedged Get",
+			@"Msg/Sec - Hedged Get Won"
 		};
 
 		public static readonly string[] PerformanceCounterHelp = { 
@@ -124,7 +130,9 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			"Confirmed Increment Messages Per Second",
 			"Increment Messages Per Second",
 			"Persistent Error Queue On-Disk Size",
-			"Count of Error Queue messages discarded due to queue-length or disk-size limits"
+			"Count of Error Queue messages discarded due to queue-length or disk-size limits",
+			"Second copies of slow Get messages sent to another node in the cluster per second",
+			"Hedged Get messages per second answered first by the second copy"
 		};
 
 		public static readonly PerformanceCounterType[] PerformanceCounterTypes = { 			
@@ -160,7 +168,9 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			PerformanceCounterType.RateOfCountsPerSecond32, 
 			PerformanceCounterType.RateOfCountsPerSecond32,
 			PerformanceCounterType.NumberOfItems64,
-			PerformanceCounterType.NumberOfItems32
+			PerformanceCounterType.NumberOfItems32,
+			PerformanceCounterType.RateOfCountsPerSecond32,
+			PerformanceCounterType.RateOfCountsPerSecond32
 		};
 		#endregion
 
@@ -242,7 +252,10 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 						}
 					}
 
-					if (!nov09CountersExist || !nov10CountersExist)
+					hedgeCountersExist = PerformanceCounterCategory.CounterExists(
+						PerformanceCounterNames[(int)PerformanceCounterIndexes.HedgedGets], PerformanceCategoryName);
+
+					if (!nov09CountersExist || !nov10CountersExist || !hedgeCountersExist)
 					{
 						_log.Warn("Current performance counters are not installed, please reinstall DataRelay counters.");
 					}
@@ -616,6 +629,22 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 		}
 
+		internal void IncrementHedgedGets()
+		{
+			if (hedgeCountersExist)
+			{
+				PerformanceCounters[(int)PerformanceCounterIndexes.HedgedGets].Increment();
+			}
+		}
+
+		internal void IncrementHedgedGetsWon()
+		{
+			if (hedgeCountersExist)
+			{
+				PerformanceCounters[(int)PerformanceCounterIndexes.HedgedGetsWon].Increment();
+			}
+		}
+
 		internal void Shutdown()
 		{
 			if (_countersInitialized)
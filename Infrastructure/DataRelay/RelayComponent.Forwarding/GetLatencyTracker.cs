@@ -0,0 +1,116 @@
+using System;
+using System.Diagnostics;
+using System.Threading;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// A decaying histogram of Get latencies for one type, from which the hedge delay is read.
+	/// </summary>
+	/// <remarks>
+	/// Latencies are counted in microseconds into buckets eight to an octave, so a percentile
+	/// is found to within about 9% from a fixed, small array. Every <see cref="_samplesPerUpdate"/>
+	/// samples the percentile is read out and every bucket is halved, so the delay follows the
+	/// type's recent latency rather than its whole history.
+	/// </remarks>
+	internal class GetLatencyTracker
+	{
+		private const int _subBucketBits = 3;
+		private const int _subBuckets = 1 << _subBucketBits;
+		private const int _bucketCount = 32 * _subBuckets;
+		private const int _samplesPerUpdate = 1024;
+		private static readonly double _ticksPerMicrosecond = Stopwatch.Frequency / 1000000.0;
+
+		private readonly int[] _buckets = new int[_bucketCount];
+		private readonly object _updateLock = new object();
+		private int _samples;
+		private volatile int _delayMilliseconds = -1;
+
+		/// <summary>
+		/// Gets the latency at the percentile last read, in milliseconds, or -1 until enough
+		/// Gets have been seen to tell.
+		/// </summary>
+		public int DelayMilliseconds
+		{
+			get { return _delayMilliseconds; }
+		}
+
+		/// <summary>
+		/// Counts a Get that took <paramref name="elapsedTicks"/> <see cref="Stopwatch"/> ticks.
+		/// </summary>
+		public void Record(long elapsedTicks, double percentile)
+		{
+			long micros = (long)(elapsedTicks / _ticksPerMicrosecond);
+			Interlocked.Increment(ref _buckets[GetBucket(micros)]);
+			if (Interlocked.Increment(ref _samples) % _samplesPerUpdate == 0)
+			{
+				Update(percentile);
+			}
+		}
+
+		private void Update(double percentile)
+		{
+			// a thread already updating will do; samples counted meanwhile only shift the result slightly
+			if (!Monitor.TryEnter(_updateLock)) return;
+			try
+			{
+				long total = 0;
+				for (int i = 0; i < _bucketCount; i++)
+				{
+					total += _buckets[i];
+				}
+				if (total == 0) return;
+
+				long rank = (long)Math.Ceiling(total * Math.Min(Math.Max(percentile, 50.0), 99.9) / 100.0);
+				long seen = 0;
+				int bucket = _bucketCount - 1;
+				for (int i = 0; i < _bucketCount; i++)
+				{
+					seen += _buckets[i];
+					if (seen >= rank)
+					{
+						bucket = i;
+						break;
+					}
+				}
+				_delayMilliseconds = (int)Math.Ceiling(GetBucketLimit(bucket) / 1000.0);
+
+				for (int i = 0; i < _bucketCount; i++)
+				{
+					int count;
+					do
+					{
+						count = _buckets[i];
+					} while (Interlocked.CompareExchange(ref _buckets[i], count >> 1, count) != count);
+				}
+			}
+			finally
+			{
+				Monitor.Exit(_updateLock);
+			}
+		}
+
+		private static int GetBucket(long micros)
+		{
+			if (micros < _subBuckets) return (int)Math.Max(micros, 0);
+			int octave = 0;
+			for (long v = micros >> _subBucketBits; v != 0; v >>= 1)
+			{
+				octave++;
+			}
+			int bucket = (octave << _subBucketBits) + (int)((micros >> (octave - 1)) & (_subBuckets - 1));
+			return Math.Min(bucket, _bucketCount - 1);
+		}
+
+		/// <summary>
+		/// Gets the least latency, in microseconds, above every latency counted in <paramref name="bucket"/>.
+		/// </summary>
+		private static long GetBucketLimit(int bucket)
+		{
+			int octave = bucket >> _subBucketBits;
+			long sub = bucket & (_subBuckets - 1);
+			if (octave == 0) return sub + 1;
+			return (_subBuckets + sub + 1) << (octave - 1);
+		}
+	}
+}
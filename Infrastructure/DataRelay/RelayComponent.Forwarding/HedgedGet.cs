@@ -0,0 +1,273 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using MySpace.DataRelay.Common.Schemas;
+using MySpace.Logging;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// A Get sent to one node and, if that node has not answered within the type's hedge delay,
+	/// sent again to another node in the same cluster. The first good reply is copied into the
+	/// caller's message and the other is ended and dropped.
+	/// </summary>
+	/// <remarks>
+	/// Each node is sent its own copy of the message, so a reply arriving after the Get has
+	/// completed cannot overwrite the result the caller already has. The hedge delay is the
+	/// configured percentile of the type's recent Get latency, so about that share of Gets are
+	/// sent twice. Hedging only helps nodes on an <see cref="IAsyncRelayTransport"/>; a
+	/// synchronous transport has answered before the delay can start.
+	/// </remarks>
+	internal class HedgedGet : IAsyncResult
+	{
+		private const int _hedgePending = 0;
+		private const int _hedgeSent = 1;
+		private const int _hedgeCancelled = 2;
+
+		private static readonly LogWrapper _log = new LogWrapper();
+		private static readonly object _trackersLock = new object();
+		private static Dictionary<short, GetLatencyTracker> _trackers = new Dictionary<short, GetLatencyTracker>();
+
+		private readonly RelayMessage _message;
+		private readonly Node _node;
+		private readonly HedgeSetting _setting;
+		private readonly GetLatencyTracker _tracker;
+		private readonly AsyncCallback _callback;
+		private readonly object _asyncState;
+		private readonly object _waitLock = new object();
+		private Timer _timer;
+		private ManualResetEvent _waitHandle;
+		private int _outstanding = 1;
+		private int _hedgeState;
+		private int _completed;
+		private volatile bool _isCompleted;
+
+		/// <summary>
+		/// Gets the hedge setting for <paramref name="message"/> if it is a Get of a type whose
+		/// Gets are hedged; otherwise, <see langword="null"/>.
+		/// </summary>
+		internal static HedgeSetting GetHedgeSetting(RelayMessage message)
+		{
+			if (message.MessageType != MessageType.Get) return null;
+
+			TypeSetting typeSetting = NodeManager.Instance.Config.TypeSettings.TypeSettingCollection[message.TypeId];
+			if (typeSetting == null || typeSetting.HedgeSetting == null || !typeSetting.HedgeSetting.Enabled) return null;
+
+			return typeSetting.HedgeSetting;
+		}
+
+		/// <summary>
+		/// Sends <paramref name="message"/> to <paramref name="node"/>, hedging it per <paramref name="setting"/>.
+		/// </summary>
+		internal static HedgedGet Begin(RelayMessage message, Node node, HedgeSetting setting, AsyncCallback callback, object asyncState)
+		{
+			var hedgedGet = new HedgedGet(message, node, setting, callback, asyncState);
+			hedgedGet.Start();
+			return hedgedGet;
+		}
+
+		private HedgedGet(RelayMessage message, Node node, HedgeSetting setting, AsyncCallback callback, object asyncState)
+		{
+			_message = message;
+			_node = node;
+			_setting = setting;
+			_tracker = GetTracker(message.TypeId);
+			_callback = callback;
+			_asyncState = asyncState;
+		}
+
+		/// <summary>
+		/// Gets the caller's message, which holds the winning reply once complete.
+		/// </summary>
+		internal RelayMessage Message
+		{
+			get { return _message; }
+		}
+
+		/// <summary>
+		/// Gets the node the Get was first sent to.
+		/// </summary>
+		internal Node Node
+		{
+			get { return _node; }
+		}
+
+		private static GetLatencyTracker GetTracker(short typeId)
+		{
+			GetLatencyTracker tracker;
+			if (_trackers.TryGetValue(typeId, out tracker)) return tracker;
+
+			lock (_trackersLock)
+			{
+				if (_trackers.TryGetValue(typeId, out tracker)) return tracker;
+
+				// readers never lock, so the map is replaced rather than changed
+				var trackers = new Dictionary<short, GetLatencyTracker>(_trackers);
+				tracker = new GetLatencyTracker();
+				trackers.Add(typeId, tracker);
+				_trackers = trackers;
+				return tracker;
+			}
+		}
+
+		private void Start()
+		{
+			int delay = _tracker.DelayMilliseconds;
+			if (delay < 0)
+			{
+				// too few Gets seen yet to know what slow is
+				_hedgeState = _hedgeCancelled;
+			}
+
+			Send(_node, CreateCopy(_message));
+
+			if (delay < 0 || _isCompleted) return;
+
+			_timer = new Timer(OnHedgeDue, null, Math.Max(delay, _setting.MinimumDelayMilliseconds), Timeout.Infinite);
+			if (_isCompleted)
+			{
+				DisposeTimer();
+			}
+		}
+
+		private void OnHedgeDue(object state)
+		{
+			try
+			{
+				Node hedgeNode = _node.GetRetryNodeFromCluster(new[] { _node });
+				if (hedgeNode == null) return;
+
+				// counted before the hedge is committed to, so the first reply can't see itself as the last
+				Interlocked.Increment(ref _outstanding);
+				if (Interlocked.CompareExchange(ref _hedgeState, _hedgeSent, _hedgePending) != _hedgePending)
+				{
+					Interlocked.Decrement(ref _outstanding);
+					return;
+				}
+
+				NodeManager.Instance.Counters.IncrementHedgedGets();
+				Send(hedgeNode, CreateCopy(_message));
+			}
+			catch (Exception ex)
+			{
+				if (_log.IsErrorEnabled)
+					_log.ErrorFormat("Error sending hedged Get for type {0}: {1}", _message.TypeId, ex);
+			}
+		}
+
+		private void Send(Node node, RelayMessage copy)
+		{
+			long start = Stopwatch.GetTimestamp();
+			node.BeginHandleOutMessage(copy, asyncResult => OnReply(node, copy, start, asyncResult), null);
+		}
+
+		private void OnReply(Node node, RelayMessage reply, long start, IAsyncResult asyncResult)
+		{
+			try
+			{
+				node.EndHandleOutMessage(asyncResult);
+			}
+			catch (Exception ex)
+			{
+				if (_log.IsErrorEnabled)
+					_log.ErrorFormat("Error ending hedged Get for type {0}: {1}", reply.TypeId, ex);
+				reply.SetError(RelayErrorType.Unknown);
+			}
+
+			bool good = !reply.ErrorOccurred;
+			if (good)
+			{
+				_tracker.Record(Stopwatch.GetTimestamp() - start, _setting.Percentile);
+			}
+
+			// an error completes the Get only if no other reply can still come
+			int remaining = Interlocked.Decrement(ref _outstanding);
+			if (good
+				|| Interlocked.CompareExchange(ref _hedgeState, _hedgeCancelled, _hedgePending) == _hedgePending
+				|| remaining == 0)
+			{
+				Complete(reply, node != _node);
+			}
+		}
+
+		private void Complete(RelayMessage reply, bool hedgeWon)
+		{
+			if (Interlocked.Exchange(ref _completed, 1) != 0) return;
+
+			Interlocked.CompareExchange(ref _hedgeState, _hedgeCancelled, _hedgePending);
+			DisposeTimer();
+			if (hedgeWon)
+			{
+				NodeManager.Instance.Counters.IncrementHedgedGetsWon();
+			}
+
+			_message.Payload = reply.Payload;
+			_message.ResultOutcome = reply.ResultOutcome;
+			_message.ResultDetails = reply.ResultDetails;
+			_message.Freshness = reply.Freshness;
+			_message.SetError(reply.ErrorType);
+
+			lock (_waitLock)
+			{
+				_isCompleted = true;
+				if (_waitHandle != null) _waitHandle.Set();
+			}
+			if (_callback != null) _callback(this);
+		}
+
+		private void DisposeTimer()
+		{
+			Timer timer = Interlocked.Exchange(ref _timer, null);
+			if (timer != null) timer.Dispose();
+		}
+
+		private static RelayMessage CreateCopy(RelayMessage message)
+		{
+			var copy = new RelayMessage(message, message.MessageType)
+			{
+				RelayTTL = message.RelayTTL,
+				SourceZone = message.SourceZone,
+				IsInterClusterMsg = message.IsInterClusterMsg,
+				HydrationPolicy = message.HydrationPolicy,
+				KeyType = message.KeyType
+			};
+			copy.AddressHistory.AddRange(message.AddressHistory);
+			return copy;
+		}
+
+		#region IAsyncResult Members
+
+		object IAsyncResult.AsyncState
+		{
+			get { return _asyncState; }
+		}
+
+		WaitHandle IAsyncResult.AsyncWaitHandle
+		{
+			get
+			{
+				lock (_waitLock)
+				{
+					if (_waitHandle == null)
+					{
+						_waitHandle = new ManualResetEvent(_isCompleted);
+					}
+					return _waitHandle;
+				}
+			}
+		}
+
+		bool IAsyncResult.CompletedSynchronously
+		{
+			get { return false; }
+		}
+
+		bool IAsyncResult.IsCompleted
+		{
+			get { return _isCompleted; }
+		}
+
+		#endregion
+	}
+}
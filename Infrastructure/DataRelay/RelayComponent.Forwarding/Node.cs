@@ -35,6 +35,9 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		private Port<MessagesWithLock> _outMessagesPort = new Port<MessagesWithLock>();
 		
 		private readonly BatchedQueue<SerializedRelayMessage> _batch;
+		private OutMessageBatcher _outBatcher;
+
+		internal readonly NodeLoad Load = new NodeLoad(); //for adaptive node selection
 
 		internal string GetMessageQueueName()
 		{
@@ -84,6 +87,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			                                                   	}));
 
 			_batch = new BatchedQueue<SerializedRelayMessage>(_messageBurstLength, _messageBurstTimeoutSpan, ProcessBatch);
+			ReloadOutBatcher(forwardingConfig);
 		}
 
 		internal void BulkAsyncEndHandleOutMessages(IAsyncResult asyncResult)
@@ -110,6 +114,23 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 		}
 
+		private void ReloadOutBatcher(ForwardingConfig forwardingConfig)
+		{
+			//only an async transport can have more than one send outstanding to batch behind
+			if (forwardingConfig == null || !forwardingConfig.OutMessageBatching || !(_transport is IAsyncRelayTransport))
+			{
+				_outBatcher = null; //batches already sending still complete
+			}
+			else if (_outBatcher == null)
+			{
+				_outBatcher = new OutMessageBatcher(BeginSendOutBatch, EndSendOutBatch, forwardingConfig);
+			}
+			else
+			{
+				_outBatcher.ReloadConfig(forwardingConfig);
+			}
+		}
+
 		internal static ushort DetermineZone(RelayNodeDefinition nodeDefinition)
 		{
 			if (nodeDefinition == null)
@@ -164,6 +185,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			
 			_batch.BatchTimeout = _messageBurstTimeoutSpan;
 			_batch.BatchSize = _messageBurstLength;
+			ReloadOutBatcher(forwardingConfig);
 
 			if (MessageErrorQueue == null)
 			{
@@ -292,6 +314,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 				bool messageHandled = true;
 
+				long loadStart = Load.Begin();
 				try
 				{
 					if (GatherStats || TypeSpecificStatisticsManager.Instance.GatherStats(message.TypeId))
@@ -366,6 +389,10 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 					message.SetError(ex);
 					NodeGroup.LogNodeException(message, this, ex);
 				}
+				finally
+				{
+					Load.End(loadStart);
+				}
 				return messageHandled;
 			}
 			finally
@@ -402,6 +429,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 
 			var watch = GatherStats ? Stopwatch.StartNew() : null;
+			long loadStart = Load.Begin();
 			try
 			{
 				NodeManager.Instance.Counters.CountMessage(message);
@@ -409,6 +437,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				message.ResultOutcome = RelayOutcome.Queued; // close enough
 				result.InnerResult = asyncTransport.BeginSendMessage(message, useSyncForInMessages, asyncResult =>
 				{
+					Load.End(loadStart);
 					if (watch != null)
 					{
 						watch.Stop();
@@ -428,6 +457,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 			catch (Exception ex)
 			{
+				Load.End(loadStart);
 				//this is only called for get messages, which aren't error queued
 				InstrumentException(ex);
 				message.SetError(ex);
@@ -500,6 +530,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 
 			var watch = GatherStats ? Stopwatch.StartNew() : null;
+			long loadStart = Load.Begin();
 			try
 			{
 				var result = new AsynchronousOutListResult(messages);
@@ -510,6 +541,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				
 				result.InnerResult = asyncTransport.BeginSendMessageList(messages, asyncResult =>
 				{
+					Load.End(loadStart);
 					if (watch != null)
 					{
 						_bulkOutMessageInfo.CaculateStatisics(messages.Count, watch.ElapsedMilliseconds);
@@ -527,6 +559,8 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			}
 			catch (Exception ex)
 			{
+				Load.End(loadStart);
+				Load.RecordError();
 				//this is only called for get messages, which aren't error queued
 				for (int i = 0; i < messages.Count; ++i)
 				{
@@ -625,14 +659,46 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		internal IAsyncResult BeginHandleOutMessage(RelayMessage message, AsyncCallback callback, object asyncState)
 		{
+			var outBatcher = _outBatcher;
+			if (outBatcher != null)
+			{
+				return outBatcher.Enqueue(message, callback, asyncState);
+			}
 			return BeginDoHandleMessage(message, false, false, callback, asyncState);
 		}
 
 		internal void EndHandleOutMessage(IAsyncResult asyncResult)
 		{
+			if (OutMessageBatcher.IsBatched(asyncResult)) return;
 			EndDoHandleMessage(asyncResult);
 		}
 
+		private IAsyncResult BeginSendOutBatch(List<RelayMessage> messages, AsyncCallback callback, object asyncState)
+		{
+			//a lone message goes the way it would have without batching
+			if (messages.Count == 1)
+			{
+				return BeginDoHandleMessage(messages[0], false, false, callback, asyncState);
+			}
+			for (int i = 0; i < messages.Count; i++)
+			{
+				NodeManager.Instance.Counters.CountMessage(messages[i]);
+			}
+			return BeginDoHandleOutMessages(messages, callback, asyncState);
+		}
+
+		private void EndSendOutBatch(IAsyncResult asyncResult)
+		{
+			if (asyncResult is AsynchronousOutListResult)
+			{
+				EndDoHandleOutMessages(asyncResult);
+			}
+			else
+			{
+				EndDoHandleMessage(asyncResult);
+			}
+		}
+
 		internal IAsyncResult BeginHandleOutMessages(List<RelayMessage> messages, AsyncCallback callback, object asyncState)
 		{
 			return BeginDoHandleOutMessages(messages, callback, asyncState);
@@ -787,6 +853,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				}
 				return false;
 			}
+			long loadStart = Load.Begin();
 			try
 			{
 				if (GatherStats || TypeSpecificStatisticsManager.Instance.GatherStats(messages[0].TypeId))
@@ -817,6 +884,10 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 				NodeGroup.LogNodeOutMessageException(messages, this, ex);
 				return false;
 			}
+			finally
+			{
+				Load.End(loadStart);
+			}
 		}
 
 		/// <summary>
@@ -1038,6 +1109,7 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		private void InstrumentException(Exception exc)
 		{
+			Load.RecordError();
 			if (exc is SocketException)
 			{
 				SocketError error = ((SocketException)exc).SocketErrorCode;
@@ -1129,6 +1201,13 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			_transport.GetConnectionStats(out openConnections, out activeConnections);
 			NodeGroup.AddPropertyLine(sb, "Active/Open Connections", activeConnections + " / " + openConnections);
 			NodeGroup.AddPropertyLine(sb, "Gathering Stats", GatherStats.ToString());
+			NodeGroup.AddPropertyLine(sb, "Avg Response Time (ms)", Load.AverageMilliseconds, 3);
+			NodeGroup.AddPropertyLine(sb, "Outstanding Requests", Load.Outstanding, 0);
+			var outBatcher = _outBatcher;
+			if (outBatcher != null)
+			{
+				outBatcher.GetHtmlStatus(sb);
+			}
 
 			if (_serverUnreachableErrors > 0)
 			{
@@ -1199,8 +1278,11 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
                 NodeCluster
                 .SelectNodesInZoneForMessage()
                 .Except(alreadyTried)
-                .Where(node => node.Activated && !node.DangerZone)
-                .OrderBy(r => random.Next());
+                .Where(node => node.Activated && !node.DangerZone);
+
+            candidateNodes = NodeGroup.GroupDefinition.AdaptiveNodeSelection
+                ? candidateNodes.OrderBy(node => node.Load.Score)
+                : candidateNodes.OrderBy(r => random.Next());
 
             return candidateNodes.FirstOrDefault();
         }
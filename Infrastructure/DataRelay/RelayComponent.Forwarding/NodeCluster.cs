@@ -335,6 +335,12 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			{
 				return null;
 			}
+			if (_nodeGroup.GroupDefinition.AdaptiveNodeSelection)
+			{
+				Node adaptiveNode = SelectAdaptiveNodeByZone(_nodesByZone, _localZone);
+				ChosenNode = adaptiveNode; //just for status
+				return adaptiveNode;
+			}
 			Node chosenNode = ChosenNode;
 			//could potentially be nulled here, after selection made, 
 			//in that case it wouldn't be re-chosen. that's ok, it will be next time
@@ -361,6 +367,11 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			Node chosenNode = null;
 
+			if (_nodeGroup.GroupDefinition.AdaptiveNodeSelection && zone < _nodesByZone.Length)
+			{
+				return SelectAdaptiveNode(_nodesByZone[zone]);
+			}
+
 			if (!ChosenZoneNodes.ContainsKey(zone) || ChosenZoneNodes[zone] == null || ChosenZoneNodes[zone].DangerZone)
 			{
 				lock (_chooseZoneNodeLock)
@@ -447,6 +458,83 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		}
 
 
+		[ThreadStatic]
+		private static Random _adaptiveRandomizer;
+
+		/// <summary>
+		/// Picks two random activated, non-Danger-zone nodes from <paramref name="candidates"/>
+		/// and returns the one with the lower <see cref="NodeLoad.Score"/>. Comparing just two keeps
+		/// every request from piling onto the same node between score updates.
+		/// </summary>
+		private static Node SelectAdaptiveNode(IList<Node> candidates)
+		{
+			if (candidates == null || candidates.Count == 0) return null;
+
+			Random randomizer = _adaptiveRandomizer;
+			if (randomizer == null)
+			{
+				randomizer = _adaptiveRandomizer = new Random(Guid.NewGuid().GetHashCode());
+			}
+
+			Node first = null, second = null;
+			int available = 0;
+			int start = randomizer.Next(candidates.Count);
+			for (int i = 0; i < candidates.Count; i++)
+			{
+				Node candidate = candidates[(start + i) % candidates.Count];
+				if (candidate.DangerZone || !candidate.Activated) continue;
+				available++;
+				// reservoir sampling picks two uniformly without building a list of safe nodes
+				if (first == null)
+				{
+					first = candidate;
+				}
+				else if (second == null)
+				{
+					second = candidate;
+				}
+				else if (randomizer.Next(available) < 2)
+				{
+					if (randomizer.Next(2) == 0) first = candidate;
+					else second = candidate;
+				}
+			}
+			if (second == null) return first;
+			return second.Load.Score < first.Load.Score ? second : first;
+		}
+
+		/// <summary>
+		/// Adaptive counterpart of <see cref="SelectANodeByZone"/>; tries startZone first and
+		/// then the other zones in random order.
+		/// </summary>
+		private static Node SelectAdaptiveNodeByZone(List<Node>[] nodesByZone, ushort startZone)
+		{
+			Node candidate = null;
+			if (startZone < nodesByZone.Length)
+			{
+				candidate = SelectAdaptiveNode(nodesByZone[startZone]);
+			}
+			if (candidate == null)
+			{
+				List<int> zonesToTry = new List<int>(nodesByZone.Length);
+				for (int i = 0; i < nodesByZone.Length; i++)
+				{
+					if (i != startZone && nodesByZone[i] != null && nodesByZone[i].Count > 0)
+					{
+						zonesToTry.Add(i);
+					}
+				}
+				Random randomizer = _adaptiveRandomizer ?? new Random(Guid.NewGuid().GetHashCode());
+				while (zonesToTry.Count > 0 && candidate == null)
+				{
+					int zoneIndex = randomizer.Next(zonesToTry.Count);
+					candidate = SelectAdaptiveNode(nodesByZone[zonesToTry[zoneIndex]]);
+					zonesToTry.RemoveAt(zoneIndex);
+				}
+			}
+			return candidate;
+		}
+
 		private LinkedListStack<Node> SelectNodes(RelayMessage message)
 		{
 			LinkedListStack<Node> nodes;
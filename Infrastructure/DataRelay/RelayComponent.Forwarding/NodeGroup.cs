@@ -11,21 +11,62 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 {
 	internal class NodeGroup
 	{
-		internal RelayNodeGroupDefinition GroupDefinition;
+		/// <summary>
+		/// The group definition, which carries the hash ring, published together with the clusters
+		/// it maps ids to, so a reader never pairs one mapping's cluster indexes with another's clusters.
+		/// </summary>
+		private sealed class ClusterMapping
+		{
+			internal readonly RelayNodeGroupDefinition Definition;
+			internal readonly List<NodeCluster> Clusters;
+			internal readonly NodeCluster MyCluster;
+			internal readonly bool ByHash;
+
+			internal ClusterMapping(RelayNodeGroupDefinition definition, List<NodeCluster> clusters, NodeCluster myCluster)
+			{
+				Definition = definition;
+				Clusters = clusters;
+				MyCluster = myCluster;
+				ByHash = definition.UseConsistentHashing && !definition.UseIdRanges;
+			}
+		}
+
+		internal RelayNodeGroupDefinition GroupDefinition; //for settings; ids are routed with the definition in the mapping
 	    internal RelayRetryPolicy RelayRetryPolicy;
 		
-		internal NodeCluster MyCluster; //the cluster where this is running, if any
-		internal List<NodeCluster> Clusters = new List<NodeCluster>(); //all of the clusters, including "MyCluster"
 		internal static int MaximumQueuedItems = 750000;
 		internal bool Activated;
 
 		private static readonly LogWrapper _log = new LogWrapper();
 
 		private ForwardingConfig _forwardingConfig;
-		private bool _clusterByRange;
+		private volatile ClusterMapping _mapping;
 		private readonly System.Threading.Timer _nodeReselectTimer;
 		private readonly System.Threading.TimerCallback _nodeReselectTimerCallback;
 
+		/// <summary>
+		/// All of the clusters, including <see cref="MyCluster"/>. The list is replaced, never
+		/// changed, when the mapping reloads.
+		/// </summary>
+		internal List<NodeCluster> Clusters
+		{
+			get
+			{
+				return _mapping.Clusters;
+			}
+		}
+
+		/// <summary>
+		/// The cluster where this is running, if any.
+		/// </summary>
+		internal NodeCluster MyCluster
+		{
+			get
+			{
+				return _mapping.MyCluster;
+			}
+		}
+
 		internal string GroupName
 		{
 			get
@@ -38,20 +79,22 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{   
 			GroupDefinition = groupDefinition;
 			Activated = groupDefinition.Activated;
-			_clusterByRange = groupDefinition.UseIdRanges;
 			_forwardingConfig = forwardingConfig;
 			
 			RelayNodeClusterDefinition myClusterDefinition = NodeManager.Instance.GetMyNodeClusterDefinition();
 
+			NodeCluster myCluster = null;
+			List<NodeCluster> clusters = new List<NodeCluster>();
 			foreach (RelayNodeClusterDefinition clusterDefintion in groupDefinition.RelayNodeClusters)
 			{
 				NodeCluster nodeCluster = new NodeCluster(clusterDefintion, nodeConfig, this, forwardingConfig);
 				if (clusterDefintion == myClusterDefinition)
 				{
-					MyCluster = nodeCluster;
+					myCluster = nodeCluster;
 				}
-				Clusters.Add(nodeCluster);
+				clusters.Add(nodeCluster);
 			}
+			_mapping = new ClusterMapping(groupDefinition, clusters, myCluster);
 
 			_nodeReselectTimerCallback = new System.Threading.TimerCallback(NodeReselectTimer_Elapsed);
 			if (_nodeReselectTimer == null)
@@ -72,30 +115,33 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		{
 			RelayNodeClusterDefinition myClusterDefinition = newConfig.GetMyCluster();
 			Activated = groupDefinition.Activated;
+			ClusterMapping mapping = _mapping;
+			LogMappingMoves(mapping.Definition, groupDefinition);
+			//the clusters read the new settings while they rebuild; routing keeps the old mapping until it's replaced below
 			GroupDefinition = groupDefinition;
-			_clusterByRange = groupDefinition.UseIdRanges;
 			_forwardingConfig = newForwardingConfig;
 			
-			if (groupDefinition.RelayNodeClusters.Length == Clusters.Count)
+			if (groupDefinition.RelayNodeClusters.Length == mapping.Clusters.Count)
 			{
 				//same number of clusters, just let the clusters rebuild themselves. the clusters will entirely rebuild, so shuffinling around servers should be okay
 				if (_log.IsDebugEnabled)
 					_log.DebugFormat("Rebuilding existing clusters in group {0}.", groupDefinition.Name);
+				NodeCluster myCluster = null;
 				for (int i = 0; i < groupDefinition.RelayNodeClusters.Length; i++)
 				{
-					Clusters[i].ReloadMapping(groupDefinition.RelayNodeClusters[i], newConfig, newForwardingConfig);
+					mapping.Clusters[i].ReloadMapping(groupDefinition.RelayNodeClusters[i], newConfig, newForwardingConfig);
 					if (groupDefinition.RelayNodeClusters[i] == myClusterDefinition)
 					{
-						MyCluster = Clusters[i];
+						myCluster = mapping.Clusters[i];
 					}
 				}
-				if (myClusterDefinition == null && MyCluster != null)
+				if (myCluster == null && mapping.MyCluster != null)
 				{
+					//this group no longer contains "me". If it DID contain "me", it would've been set above.
 					if (_log.IsInfoEnabled)
 						_log.InfoFormat("Group {0} no longer contains this server. Removing.", GroupName);
-					//this group no longer contains "me". If it DID contain "me", it would've been set above.
-					MyCluster = null;
 				}
+				_mapping = new ClusterMapping(groupDefinition, mapping.Clusters, myCluster);
 			}
 			else
 			{
@@ -113,12 +159,72 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 					}
 					newClusters.Add(nodeCluster);
 				}
-				Clusters = newClusters;
-				MyCluster = myCluster;
+				_mapping = new ClusterMapping(groupDefinition, newClusters, myCluster);
 			}
 			_nodeReselectTimer.Change(NodeReselectIntervalMilliseconds, NodeReselectIntervalMilliseconds);
 		}
 
+		/// <summary>
+		/// Gets the ranges of ids that change cluster going from <paramref name="before"/> to
+		/// <paramref name="after"/>, when both map ids with a consistent hash ring.
+		/// </summary>
+		/// <returns>The moved ranges, or <see langword="null"/> if either group does not use consistent hashing.</returns>
+		internal static IList<HashRangeMove> GetMappingMoves(RelayNodeGroupDefinition before, RelayNodeGroupDefinition after)
+		{
+			if (before == null || after == null
+				|| before.UseIdRanges || after.UseIdRanges
+				|| !before.UseConsistentHashing || !after.UseConsistentHashing)
+			{
+				return null;
+			}
+			return ConsistentHashRing.GetMoves(before.HashRing, after.HashRing);
+		}
+
+		private static void LogMappingMoves(RelayNodeGroupDefinition before, RelayNodeGroupDefinition after)
+		{
+			if (!_log.IsInfoEnabled) return;
+
+			IList<HashRangeMove> moves = GetMappingMoves(before, after);
+			if (moves == null)
+			{
+				if (before != null && before.RelayNodeClusters != null && after.RelayNodeClusters != null
+					&& before.RelayNodeClusters.Length != after.RelayNodeClusters.Length
+					&& !after.UseIdRanges)
+				{
+					_log.InfoFormat("Group {0} went from {1} to {2} clusters without consistent hashing on both sides; most ids change cluster.",
+						after.Name, before.RelayNodeClusters.Length, after.RelayNodeClusters.Length);
+				}
+				return;
+			}
+			if (moves.Count == 0) return;
+
+			// sum the moves per cluster pair so the log stays short with many virtual nodes
+			Dictionary<long, double> fractions = new Dictionary<long, double>();
+			double total = 0;
+			foreach (HashRangeMove move in moves)
+			{
+				long pair = ((long)move.FromCluster << 32) | (uint)move.ToCluster;
+				double fraction;
+				fractions.TryGetValue(pair, out fraction);
+				fractions[pair] = fraction + move.Fraction;
+				total += move.Fraction;
+			}
+			StringBuilder summary = new StringBuilder();
+			foreach (KeyValuePair<long, double> pair in fractions)
+			{
+				summary.AppendFormat(" cluster {0} -> {1}: {2:P2};", pair.Key >> 32, (int)pair.Key, pair.Value);
+			}
+			_log.InfoFormat("Group {0} mapping reload moves {1:P2} of ids in {2} ranges:{3}",
+				after.Name, total, moves.Count, summary);
+			if (_log.IsDebugEnabled)
+			{
+				foreach (HashRangeMove move in moves)
+				{
+					_log.DebugFormat("Group {0} moves ring range {1}", after.Name, move);
+				}
+			}
+		}
+
 		private void NodeReselectTimer_Elapsed(object state)
 		{
 			ReselectNodes();
@@ -142,33 +248,35 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		private void ReselectNodes()
 		{
-			for (int i = 0; i < Clusters.Count; i++)
+			foreach (NodeCluster cluster in Clusters)
 			{
-				Clusters[i].ReselectNode();
+				cluster.ReselectNode();
 			}        
 		}
 
 		internal NodeCluster GetClusterForId(int objectId, bool interClusterMessage)
 		{
-			if (MyCluster != null && !interClusterMessage)
+			ClusterMapping mapping = _mapping;
+			if (mapping.MyCluster != null && !interClusterMessage)
 			{
-				return MyCluster;
+				return mapping.MyCluster;
 			}
 			
-			int clusterIndex = GroupDefinition.GetClusterIndexFor(objectId);
+			int clusterIndex = mapping.Definition.GetClusterIndexFor(objectId);
 			
 			
 			if (clusterIndex >= 0)
 			{
-				return Clusters[clusterIndex];
+				return mapping.Clusters[clusterIndex];
 			}
 			return null;
 		}
 
-		private int GetModdedIndex(int objectId)
+		private static int GetModdedIndex(ClusterMapping mapping, int objectId)
 		{
+			if (mapping.ByHash) return mapping.Definition.HashRing.GetClusterIndex(objectId);
 			if (objectId == Int32.MinValue) return 0; //cause Math.Abs(Int32.MinValue) throws
-			return Math.Abs(objectId) % Clusters.Count;
+			return Math.Abs(objectId) % mapping.Clusters.Count;
 		}
 
 		/// <summary>
@@ -178,12 +286,13 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 		/// <returns></returns>
 		public List<int>[] GetModdedIndexLists(int[] objectIdList)
 		{
-			List<int>[] lists = new List<int>[Clusters.Count];			
+			ClusterMapping mapping = _mapping;
+			List<int>[] lists = new List<int>[mapping.Clusters.Count];			
 
 			for (int i = 0; i < objectIdList.Length; i++)
 			{
 				int itemId = objectIdList[i];
-				int clusterIndex = GetModdedIndex(itemId);
+				int clusterIndex = GetModdedIndex(mapping, itemId);
 
 				if (lists[clusterIndex] == null)
 				{
@@ -197,13 +306,14 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		public List<RelayMessage>[] GetModdedMessageLists(RelayMessage[] messages)
 		{
-			List<RelayMessage>[] lists = new List<RelayMessage>[Clusters.Count];
+			ClusterMapping mapping = _mapping;
+			List<RelayMessage>[] lists = new List<RelayMessage>[mapping.Clusters.Count];
 
 			for (int i = 0; i < messages.Length; i++)
 			{
 				int itemId = messages[i].Id;
 				
-				int clusterIndex = GetModdedIndex(itemId);
+				int clusterIndex = GetModdedIndex(mapping, itemId);
 				
 				if (lists[clusterIndex] == null)
 				{
@@ -324,17 +434,18 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 			//messages that, from out of system, go to each cluster
 			if(message.IsClusterBroadcastMessage)
 			{
-				if (MyCluster == null) //out of system, each cluster
+				ClusterMapping mapping = _mapping;
+				if (mapping.MyCluster == null) //out of system, each cluster
 				{
 					nodes = new LinkedListStack<Node>();
-					for (int clusterIndex = 0; clusterIndex < Clusters.Count; clusterIndex++)
+					for (int clusterIndex = 0; clusterIndex < mapping.Clusters.Count; clusterIndex++)
 					{
-						nodes.Push(Clusters[clusterIndex].GetNodesForMessage(message));							
+						nodes.Push(mapping.Clusters[clusterIndex].GetNodesForMessage(message));							
 					}
 				}
 				else //in system, my cluster
 				{
-					nodes = MyCluster.GetNodesForMessage(message);
+					nodes = mapping.MyCluster.GetNodesForMessage(message);
 				}
 			}
 			else
@@ -461,33 +572,33 @@ namespace MySpace.DataRelay.RelayComponent.Forwarding
 
 		internal void ProcessQueues()
 		{
-			for (int i = 0; i < Clusters.Count; i++)
+			foreach (NodeCluster cluster in Clusters)
 			{
-				Clusters[i].ProcessQueues();
+				cluster.ProcessQueues();
 			}
 		}
 
 		internal void PopulateQueues(Dictionary<string, ErrorQueue> errorQueues, bool incrementCounter)
 		{
-			for (int i = 0; i < Clusters.Count; i++)
+			foreach (NodeCluster cluster in Clusters)
 			{
-				Clusters[i].PopulateQueues(errorQueues,incrementCounter);
+				cluster.PopulateQueues(errorQueues,incrementCounter);
 			}
 		}
 
 		internal void AggregateCounterTick()
 		{
-			for (int i = 0; i < Clusters.Count; i++)
+			foreach (NodeCluster cluster in Clusters)
 			{
-				Clusters[i].AggregateCounterTicker();
+				cluster.AggregateCounterTicker();
 			}
 		}
 
 		internal void SetNewDispatchers(Dispatcher newInDispatcher, Dispatcher newOutDispatcher)
 		{
-			for (int i = 0; i < Clusters.Count; i++)
+			foreach (NodeCluster cluster in Clusters)
 			{
-				Clusters[i].SetNewDispatchers(newInDispatcher, newOutDispatcher);
+				cluster.SetNewDispatchers(newInDispatcher, newOutDispatcher);
 			}
 		}
 
@@ -0,0 +1,98 @@
+﻿using System;
+using System.Diagnostics;
+using System.Threading;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// Tracks how loaded a <see cref="Node"/> looks from here: an exponentially weighted
+	/// average of its response times, the requests outstanding to it, and a penalty for
+	/// recent errors. Used by adaptive node selection to steer requests away from a slow
+	/// or failing node as soon as it starts misbehaving.
+	/// </summary>
+	internal class NodeLoad
+	{
+		private const double _weight = 0.2; //of each new sample in the average
+		private const double _errorPenaltyMilliseconds = 1000;
+		private static readonly long _errorPenaltyTicks = Stopwatch.Frequency * 5; //how long an error counts against the node
+		private static readonly double _ticksPerMillisecond = Stopwatch.Frequency / 1000.0;
+
+		private long _averageBits; //the average in milliseconds, as double bits so it can be swapped atomically
+		private int _outstanding;
+		private long _lastErrorTicks;
+
+		/// <summary>
+		/// Gets the average response time in milliseconds.
+		/// </summary>
+		internal double AverageMilliseconds
+		{
+			get { return BitConverter.Int64BitsToDouble(Interlocked.Read(ref _averageBits)); }
+		}
+
+		/// <summary>
+		/// Gets the number of requests sent to the node and not yet answered.
+		/// </summary>
+		internal int Outstanding
+		{
+			get { return Thread.VolatileRead(ref _outstanding); }
+		}
+
+		/// <summary>
+		/// Gets the expected cost of sending the node one more request; lower is better.
+		/// </summary>
+		internal double Score
+		{
+			get
+			{
+				double latency = AverageMilliseconds;
+				long lastError = Interlocked.Read(ref _lastErrorTicks);
+				if (lastError != 0)
+				{
+					long sinceError = Stopwatch.GetTimestamp() - lastError;
+					if (sinceError < _errorPenaltyTicks)
+					{
+						// fades out over the penalty period
+						latency += _errorPenaltyMilliseconds * (_errorPenaltyTicks - sinceError) / _errorPenaltyTicks;
+					}
+				}
+				// a bit more than zero so that outstanding requests still count against idle nodes
+				return (latency + 0.1) * (Outstanding + 1);
+			}
+		}
+
+		/// <summary>
+		/// Records a request being sent to the node.
+		/// </summary>
+		/// <returns>The timestamp to pass to <see cref="End"/>.</returns>
+		internal long Begin()
+		{
+			Interlocked.Increment(ref _outstanding);
+			return Stopwatch.GetTimestamp();
+		}
+
+		/// <summary>
+		/// Records the answer to a request begun at <paramref name="startTicks"/>.
+		/// </summary>
+		internal void End(long startTicks)
+		{
+			Interlocked.Decrement(ref _outstanding);
+			double sample = (Stopwatch.GetTimestamp() - startTicks) / _ticksPerMillisecond;
+			long current, updated;
+			do
+			{
+				current = Interlocked.Read(ref _averageBits);
+				double average = BitConverter.Int64BitsToDouble(current);
+				average = average == 0 ? sample : average + _weight * (sample - average);
+				updated = BitConverter.DoubleToInt64Bits(average);
+			} while (Interlocked.CompareExchange(ref _averageBits, updated, current) != current);
+		}
+
+		/// <summary>
+		/// Records an error from the node.
+		/// </summary>
+		internal void RecordError()
+		{
+			Interlocked.Exchange(ref _lastErrorTicks, Stopwatch.GetTimestamp());
+		}
+	}
+}
@@ -0,0 +1,358 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Text;
+using System.Threading;
+using MySpace.Logging;
+
+namespace MySpace.DataRelay.RelayComponent.Forwarding
+{
+	/// <summary>
+	/// Coalesces out messages sent to one <see cref="Node"/> by many callers into message list sends.
+	/// </summary>
+	/// <remarks>
+	/// <para>A message is sent at once while fewer than the current send limit are outstanding, so
+	/// a lightly loaded node sees no added delay. Past the limit, messages wait and go out together
+	/// when a send returns, when the batch reaches its count or byte bound, or when the oldest has
+	/// waited the delay budget, whichever is first.</para>
+	/// <para>The send limit follows the node's round trip time: while the average stays near the
+	/// lowest seen, and messages are waiting, the limit rises; once it doubles, the node is queueing
+	/// and the limit falls, so fewer, larger lists are sent.</para>
+	/// </remarks>
+	internal class OutMessageBatcher
+	{
+		private const double _rttWeight = 0.2;
+		private const int _batchesPerMinimum = 1000; // before the lowest round trip is forgotten
+		private const int _histogramBuckets = 12;
+		private const int _messageOverhead = 64; // rough serialized size of a message's fixed fields
+		private static readonly double _ticksPerMillisecond = Stopwatch.Frequency / 1000.0;
+		private static readonly LogWrapper _log = new LogWrapper();
+
+		private readonly Func<List<RelayMessage>, AsyncCallback, object, IAsyncResult> _beginSend;
+		private readonly Action<IAsyncResult> _endSend;
+		private readonly object _syncRoot = new object();
+		private readonly Timer _timer;
+
+		private int _maxLength;
+		private int _maxBytes;
+		private int _delayMilliseconds;
+		private int _maxSends;
+
+		private List<BatchedOutMessage> _pending = new List<BatchedOutMessage>();
+		private int _pendingBytes;
+		private bool _timerArmed;
+		private int _sending;
+		private int _sendLimit;
+		private double _rttAverage;
+		private double _rttMinimum;
+		private int _batchesSinceMinimum;
+
+		private readonly long[] _batchLengths = new long[_histogramBuckets]; // by powers of 2 messages
+		private readonly long[] _addedDelays = new long[_histogramBuckets]; // by powers of 2 from 1/16 ms
+
+		/// <summary>
+		/// Initializes a new instance of the <see cref="OutMessageBatcher"/> class.
+		/// </summary>
+		/// <param name="beginSend">Begins sending a batch of one or more messages.</param>
+		/// <param name="endSend">Ends a send begun by <paramref name="beginSend"/>.</param>
+		/// <param name="config">The forwarding configuration holding the batch bounds.</param>
+		internal OutMessageBatcher(Func<List<RelayMessage>, AsyncCallback, object, IAsyncResult> beginSend,
+			Action<IAsyncResult> endSend, ForwardingConfig config)
+		{
+			if (beginSend == null) throw new ArgumentNullException("beginSend");
+			if (endSend == null) throw new ArgumentNullException("endSend");
+			_beginSend = beginSend;
+			_endSend = endSend;
+			_timer = new Timer(obj => OnDelayElapsed(), null, Timeout.Infinite, Timeout.Infinite);
+			ReloadConfig(config);
+			_sendLimit = _maxSends;
+		}
+
+		/// <summary>
+		/// Applies changed batch bounds from <paramref name="config"/>.
+		/// </summary>
+		internal void ReloadConfig(ForwardingConfig config)
+		{
+			lock (_syncRoot)
+			{
+				_maxLength = Math.Max(1, config.OutMessageBatchLength);
+				_maxBytes = Math.Max(1, config.OutMessageBatchBytes);
+				_delayMilliseconds = Math.Max(1, config.OutMessageBatchDelay);
+				_maxSends = Math.Max(1, config.OutMessageBatchSends);
+				if (_sendLimit > _maxSends) _sendLimit = _maxSends;
+			}
+		}
+
+		/// <summary>
+		/// Queues <paramref name="message"/> to be sent with the next batch.
+		/// </summary>
+		/// <returns>An <see cref="IAsyncResult"/> completed when the message's batch returns.</returns>
+		internal IAsyncResult Enqueue(RelayMessage message, AsyncCallback callback, object asyncState)
+		{
+			var entry = new BatchedOutMessage(message, callback, asyncState);
+			List<BatchedOutMessage> batch = null;
+			lock (_syncRoot)
+			{
+				_pending.Add(entry);
+				_pendingBytes += EstimateSize(message);
+				if (_sending < _sendLimit || _pending.Count >= _maxLength || _pendingBytes >= _maxBytes)
+				{
+					batch = TakeBatch();
+				}
+				else if (!_timerArmed)
+				{
+					_timerArmed = true;
+					_timer.Change(_delayMilliseconds, Timeout.Infinite);
+				}
+			}
+			if (batch != null) Send(batch);
+			return entry;
+		}
+
+		/// <summary>
+		/// Gets whether <paramref name="asyncResult"/> was returned by <see cref="Enqueue"/>. Its
+		/// message already holds any error by the time the callback is called.
+		/// </summary>
+		internal static bool IsBatched(IAsyncResult asyncResult)
+		{
+			return asyncResult is BatchedOutMessage;
+		}
+
+		private static int EstimateSize(RelayMessage message)
+		{
+			int size = _messageOverhead;
+			if (message.ExtendedId != null) size += message.ExtendedId.Length;
+			if (message.QueryData != null) size += message.QueryData.Length;
+			return size;
+		}
+
+		// must hold _syncRoot
+		private List<BatchedOutMessage> TakeBatch()
+		{
+			List<BatchedOutMessage> batch = _pending;
+			_pending = new List<BatchedOutMessage>();
+			_pendingBytes = 0;
+			if (_timerArmed)
+			{
+				_timerArmed = false;
+				_timer.Change(Timeout.Infinite, Timeout.Infinite);
+			}
+			_sending++;
+
+			long now = Stopwatch.GetTimestamp();
+			_batchLengths[GetBucket(batch.Count)]++;
+			for (int i = 0; i < batch.Count; i++)
+			{
+				_addedDelays[GetBucket((int)((now - batch[i].EnqueuedTicks) * 16 / _ticksPerMillisecond) + 1)]++;
+			}
+			return batch;
+		}
+
+		private void OnDelayElapsed()
+		{
+			List<BatchedOutMessage> batch = null;
+			lock (_syncRoot)
+			{
+				if (!_timerArmed) return;
+				_timerArmed = false;
+				// the oldest message has waited its budget; send even past the limit
+				if (_pending.Count > 0) batch = TakeBatch();
+			}
+			if (batch != null) Send(batch);
+		}
+
+		private void Send(List<BatchedOutMessage> batch)
+		{
+			var messages = new List<RelayMessage>(batch.Count);
+			for (int i = 0; i < batch.Count; i++)
+			{
+				messages.Add(batch[i].Message);
+			}
+
+			long start = Stopwatch.GetTimestamp();
+			try
+			{
+				_beginSend(messages, asyncResult => OnSent(batch, start, asyncResult), null);
+			}
+			catch (Exception ex)
+			{
+				_log.Error(ex);
+				for (int i = 0; i < messages.Count; i++)
+				{
+					messages[i].SetError(RelayErrorType.Unknown);
+				}
+				OnSent(batch, start, null);
+			}
+		}
+
+		private void OnSent(List<BatchedOutMessage> batch, long start, IAsyncResult asyncResult)
+		{
+			if (asyncResult != null)
+			{
+				try
+				{
+					_endSend(asyncResult);
+				}
+				catch (Exception ex)
+				{
+					_log.Error(ex);
+				}
+			}
+
+			List<BatchedOutMessage> next = null;
+			lock (_syncRoot)
+			{
+				_sending--;
+				Adapt((Stopwatch.GetTimestamp() - start) / _ticksPerMillisecond);
+				if (_pending.Count > 0 && _sending < _sendLimit) next = TakeBatch();
+			}
+
+			if (next != null)
+			{
+				if (asyncResult == null || asyncResult.CompletedSynchronously)
+				{
+					// don't grow this stack a batch at a time while sends fail fast
+					ThreadPool.QueueUserWorkItem(obj => Send(next));
+				}
+				else
+				{
+					Send(next);
+				}
+			}
+
+			for (int i = 0; i < batch.Count; i++)
+			{
+				batch[i].Complete();
+			}
+		}
+
+		// must hold _syncRoot
+		private void Adapt(double rtt)
+		{
+			_rttAverage = _rttAverage == 0 ? rtt : _rttAverage + _rttWeight * (rtt - _rttAverage);
+			if (_rttMinimum == 0 || rtt < _rttMinimum || ++_batchesSinceMinimum >= _batchesPerMinimum)
+			{
+				_rttMinimum = Math.Min(rtt, _rttAverage);
+				_batchesSinceMinimum = 0;
+			}
+
+			if (_rttAverage > 2 * _rttMinimum)
+			{
+				if (_sendLimit > 1) _sendLimit--;
+			}
+			else if (_pending.Count > 0 && _sendLimit < _maxSends)
+			{
+				_sendLimit++;
+			}
+		}
+
+		private static int GetBucket(int value)
+		{
+			int bucket = 0;
+			while (value > 1 && bucket < _histogramBuckets - 1)
+			{
+				value = (value + 1) >> 1;
+				bucket++;
+			}
+			return bucket;
+		}
+
+		internal void GetHtmlStatus(StringBuilder sb)
+		{
+			lock (_syncRoot)
+			{
+				NodeGroup.AddPropertyLine(sb, "Out Batch Send Limit", _sendLimit + " / " + _maxSends);
+				NodeGroup.AddPropertyLine(sb, "Out Batch Round Trip (ms)", _rttAverage, 3);
+				NodeGroup.AddPropertyLine(sb, "Out Batch Lengths", DescribeHistogram(_batchLengths, 1, ""));
+				NodeGroup.AddPropertyLine(sb, "Out Batch Added Delay", DescribeHistogram(_addedDelays, 1.0 / 16, " ms"));
+			}
+		}
+
+		private static string DescribeHistogram(long[] buckets, double unit, string suffix)
+		{
+			var sb = new StringBuilder();
+			for (int i = 0; i < buckets.Length; i++)
+			{
+				if (buckets[i] == 0) continue;
+				if (sb.Length > 0) sb.Append(", ");
+				sb.AppendFormat("&lt;={0}{1}: {2}", (1 << i) * unit, suffix, buckets[i]);
+			}
+			return sb.Length == 0 ? "None" : sb.ToString();
+		}
+
+		private class BatchedOutMessage : IAsyncResult
+		{
+			private readonly AsyncCallback _callback;
+			private readonly object _asyncState;
+			private readonly object _waitLock = new object();
+			private ManualResetEvent _waitHandle;
+			private volatile bool _isCompleted;
+
+			public BatchedOutMessage(RelayMessage message, AsyncCallback callback, object asyncState)
+			{
+				Message = message;
+				_callback = callback;
+				_asyncState = asyncState;
+				EnqueuedTicks = Stopwatch.GetTimestamp();
+			}
+
+			public RelayMessage Message { get; private set; }
+
+			public long EnqueuedTicks { get; private set; }
+
+			public void Complete()
+			{
+				lock (_waitLock)
+				{
+					_isCompleted = true;
+					if (_waitHandle != null) _waitHandle.Set();
+				}
+				if (_callback != null)
+				{
+					try
+					{
+						_callback(this);
+					}
+					catch (Exception ex)
+					{
+						_log.Error(ex);
+					}
+				}
+			}
+
+			#region IAsyncResult Members
+
+			object IAsyncResult.AsyncState
+			{
+				get { return _asyncState; }
+			}
+
+			WaitHandle IAsyncResult.AsyncWaitHandle
+			{
+				get
+				{
+					lock (_waitLock)
+					{
+						if (_waitHandle == null)
+						{
+							_waitHandle = new ManualResetEvent(_isCompleted);
+						}
+						return _waitHandle;
+					}
+				}
+			}
+
+			bool IAsyncResult.CompletedSynchronously
+			{
+				get { return false; }
+			}
+
+			bool IAsyncResult.IsCompleted
+			{
+				get { return _isCompleted; }
+			}
+
+			#endregion
+		}
+	}
+}
@@ -0,0 +1,190 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+
+namespace MySpace.SocketTransport.AsyncClient.Test
+{
+	/// <summary>
+	/// A socket server on the loopback interface that speaks the client wire format. It either
+	/// echoes every round trip at once, or hands each one to the test to answer when and in
+	/// whatever order it likes.
+	/// </summary>
+	internal sealed class LoopbackServer : IDisposable
+	{
+		private const int _takeTimeout = 5000;
+
+		private readonly TcpListener _listener;
+		private readonly bool _echo;
+		private readonly List<TcpClient> _connections = new List<TcpClient>();
+		private readonly BlockingCollection<Request> _requests = new BlockingCollection<Request>();
+		private int _connectionsAccepted;
+
+		public LoopbackServer(bool echo)
+		{
+			_echo = echo;
+			_listener = new TcpListener(IPAddress.Loopback, 0);
+			_listener.Start();
+			new Thread(Accept) { IsBackground = true }.Start();
+		}
+
+		public IPEndPoint EndPoint
+		{
+			get { return (IPEndPoint)_listener.LocalEndpoint; }
+		}
+
+		/// <summary>
+		/// How many connections clients have opened since the server started.
+		/// </summary>
+		public int ConnectionsAccepted
+		{
+			get { return Thread.VolatileRead(ref _connectionsAccepted); }
+		}
+
+		/// <summary>
+		/// Waits for the next round trip that has not been echoed.
+		/// </summary>
+		public Request Take()
+		{
+			Request request;
+			if (!_requests.TryTake(out request, _takeTimeout))
+			{
+				throw new TimeoutException("No request arrived.");
+			}
+			return request;
+		}
+
+		/// <summary>
+		/// Drops every open connection.
+		/// </summary>
+		public void CloseConnections()
+		{
+			lock (_connections)
+			{
+				foreach (var connection in _connections)
+				{
+					connection.Close();
+				}
+				_connections.Clear();
+			}
+		}
+
+		public void Dispose()
+		{
+			_listener.Stop();
+			CloseConnections();
+		}
+
+		private void Accept()
+		{
+			while (true)
+			{
+				TcpClient connection;
+				try
+				{
+					connection = _listener.AcceptTcpClient();
+				}
+				catch (SocketException)
+				{
+					return;
+				}
+				catch (ObjectDisposedException)
+				{
+					return;
+				}
+				Interlocked.Increment(ref _connectionsAccepted);
+				lock (_connections)
+				{
+					_connections.Add(connection);
+				}
+				new Thread(() => Read(connection)) { IsBackground = true }.Start();
+			}
+		}
+
+		private void Read(TcpClient connection)
+		{
+			var header = new byte[ClientMessage.HeaderSize];
+			var terminator = new byte[ClientMessage.TerminatorSize];
+			try
+			{
+				var stream = connection.GetStream();
+				while (ReadFully(stream, header))
+				{
+					// starter, total length, command id, message id, round trip flag; host order
+					var length = BitConverter.ToInt32(header, 2);
+					var messageId = BitConverter.ToInt16(header, 8);
+					var isRoundTrip = header[10] != 0;
+					var data = new byte[length - ClientMessage.EnvelopeSize];
+					if (!ReadFully(stream, data) || !ReadFully(stream, terminator)) return;
+					if (!isRoundTrip) continue;
+
+					var request = new Request(stream, messageId, data);
+					if (_echo) request.Reply(data);
+					else _requests.Add(request);
+				}
+			}
+			catch (IOException)
+			{
+			}
+			catch (ObjectDisposedException)
+			{
+			}
+		}
+
+		private static bool ReadFully(Stream stream, byte[] buffer)
+		{
+			var read = 0;
+			while (read < buffer.Length)
+			{
+				var count = stream.Read(buffer, read, buffer.Length - read);
+				if (count == 0) return false;
+				read += count;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// A round trip the server has received.
+		/// </summary>
+		public sealed class Request
+		{
+			private static readonly byte[] _busyReply = { 241, 216, 254, 255 };
+
+			private readonly Stream _stream;
+
+			public Request(Stream stream, short messageId, byte[] data)
+			{
+				_stream = stream;
+				MessageId = messageId;
+				Data = data;
+			}
+
+			public short MessageId { get; private set; }
+
+			public byte[] Data { get; private set; }
+
+			public void Reply(byte[] data)
+			{
+				var reply = new byte[ServerMessage.HeaderSize + data.Length];
+				BitConverter.GetBytes(reply.Length).CopyTo(reply, 0);
+				BitConverter.GetBytes(MessageId).CopyTo(reply, sizeof(int));
+				data.CopyTo(reply, ServerMessage.HeaderSize);
+				lock (_stream)
+				{
+					_stream.Write(reply, 0, reply.Length);
+				}
+			}
+
+			public void ReplyBusy(int retryAfterMilliseconds)
+			{
+				var data = new byte[_busyReply.Length + sizeof(int)];
+				_busyReply.CopyTo(data, 0);
+				BitConverter.GetBytes(retryAfterMilliseconds).CopyTo(data, _busyReply.Length);
+				Reply(data);
+			}
+		}
+	}
+}
@@ -0,0 +1,268 @@
+﻿using System;
+using System.IO;
+using System.Net.Sockets;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.Common;
+
+namespace MySpace.SocketTransport.AsyncClient.Test
+{
+	[TestClass]
+	public class MultiplexedSocketChannelTests
+	{
+		private const short _commandId = 7;
+		private const int _timeout = 5000;
+
+		private LoopbackServer _server;
+
+		[TestCleanup]
+		public void TestCleanup()
+		{
+			if (_server != null) _server.Dispose();
+		}
+
+		private MultiplexedSocketChannel CreateChannel(int maxPendingRequests)
+		{
+			return new MultiplexedSocketChannel(_server.EndPoint, 1000, maxPendingRequests, false);
+		}
+
+		private static Func<short, IPoolItem<MemoryStream>> Message(int value)
+		{
+			return messageId =>
+			{
+				var data = AsyncSocketClient.MemoryPool.Borrow();
+				ClientMessage.WriteMessage(data.Item, false, _commandId, messageId, true, value,
+					(v, stream) => stream.Write(BitConverter.GetBytes(v), 0, sizeof(int)));
+				data.Item.Seek(0, SeekOrigin.Begin);
+				return data;
+			};
+		}
+
+		// Sends a round trip and returns a handle that is set once its result arrives.
+		private static ManualResetEvent Send(MultiplexedSocketChannel channel, int value, int timeout,
+			Action<RoundTripAsyncEventArgs> onResult)
+		{
+			var done = new ManualResetEvent(false);
+			channel.SendRoundTripAsync(timeout, Message(value), e =>
+			{
+				onResult(e);
+				done.Set();
+			});
+			return done;
+		}
+
+		// Reads the echoed value, or -1 for a failed or empty reply; results arrive on pool
+		// threads, so the test asserts on what was read rather than here.
+		private static int ReadValue(RoundTripAsyncEventArgs e)
+		{
+			if (e.Error != null || e.Response == null) return -1;
+			var buffer = new byte[sizeof(int)];
+			if (e.Response.Read(buffer, 0, buffer.Length) != buffer.Length) return -1;
+			return BitConverter.ToInt32(buffer, 0);
+		}
+
+		private static void Wait(WaitHandle handle)
+		{
+			Assert.IsTrue(handle.WaitOne(_timeout), "The request did not complete.");
+		}
+
+		[TestMethod]
+		public void RepliesAreMatchedToRequestsInAnyOrder()
+		{
+			_server = new LoopbackServer(false);
+			using (var channel = CreateChannel(16))
+			{
+				var results = new int[3];
+				var done = new ManualResetEvent[results.Length];
+				for (var i = 0; i < results.Length; ++i)
+				{
+					var index = i;
+					done[i] = Send(channel, 100 + i, _timeout, e => results[index] = ReadValue(e));
+				}
+
+				var requests = new LoopbackServer.Request[results.Length];
+				for (var i = 0; i < requests.Length; ++i)
+				{
+					requests[i] = _server.Take();
+				}
+				Assert.AreEqual(requests.Length, channel.PendingCount);
+				for (var i = requests.Length - 1; i >= 0; --i)
+				{
+					requests[i].Reply(requests[i].Data);
+				}
+
+				foreach (var handle in done) Wait(handle);
+				CollectionAssert.AreEqual(new[] { 100, 101, 102 }, results);
+				Assert.AreEqual(0, channel.PendingCount);
+				Assert.AreEqual(1, _server.ConnectionsAccepted);
+			}
+		}
+
+		[TestMethod]
+		public void RequestsInFlightShareOneConnection()
+		{
+			_server = new LoopbackServer(true);
+			const int count = 500;
+			var failures = 0;
+			var wrongReplies = 0;
+			using (var remaining = new CountdownEvent(count))
+			using (var channel = CreateChannel(1024))
+			{
+				for (var i = 0; i < count; ++i)
+				{
+					var value = i;
+					channel.SendRoundTripAsync(_timeout, Message(value), e =>
+					{
+						if (e.Error != null) Interlocked.Increment(ref failures);
+						else if (ReadValue(e) != value) Interlocked.Increment(ref wrongReplies);
+						remaining.Signal();
+					});
+				}
+
+				Assert.IsTrue(remaining.Wait(_timeout), "Not every request completed.");
+			}
+			Assert.AreEqual(0, failures);
+			Assert.AreEqual(0, wrongReplies);
+			Assert.AreEqual(1, _server.ConnectionsAccepted);
+		}
+
+		[TestMethod]
+		public void TimedOutRequestKeepsItsIdUntilTheLateReply()
+		{
+			_server = new LoopbackServer(false);
+			using (var channel = CreateChannel(16))
+			{
+				Exception error = null;
+				Wait(Send(channel, 1, 100, e => error = e.Error));
+				var late = _server.Take();
+
+				Assert.IsInstanceOfType(error, typeof(SocketException));
+				Assert.AreEqual(SocketError.TimedOut, ((SocketException)error).SocketErrorCode);
+				Assert.AreEqual(0, channel.PendingCount);
+				Assert.IsFalse(channel.HasError, "One timeout must not fail the channel.");
+
+				var value = 0;
+				var done = Send(channel, 2, _timeout, e => value = ReadValue(e));
+				var next = _server.Take();
+				Assert.AreNotEqual(late.MessageId, next.MessageId);
+
+				// the late reply is dropped rather than handed to the newer request
+				late.Reply(late.Data);
+				next.Reply(next.Data);
+				Wait(done);
+				Assert.AreEqual(2, value);
+			}
+		}
+
+		[TestMethod]
+		public void BusyReplyFailsOnlyItsRequest()
+		{
+			_server = new LoopbackServer(false);
+			using (var channel = CreateChannel(16))
+			{
+				Exception busyError = null;
+				var value = 0;
+				var busyDone = Send(channel, 1, _timeout, e => busyError = e.Error);
+				var done = Send(channel, 2, _timeout, e => value = ReadValue(e));
+
+				var first = _server.Take();
+				var second = _server.Take();
+				first.ReplyBusy(250);
+				second.Reply(second.Data);
+
+				Wait(busyDone);
+				Wait(done);
+				Assert.IsInstanceOfType(busyError, typeof(ServerBusyException));
+				Assert.AreEqual(TimeSpan.FromMilliseconds(250), ((ServerBusyException)busyError).RetryAfter);
+				Assert.AreEqual(2, value);
+				Assert.IsFalse(channel.HasError);
+			}
+		}
+
+		[TestMethod]
+		public void LostConnectionFailsEveryPendingRequest()
+		{
+			_server = new LoopbackServer(false);
+			using (var channel = CreateChannel(16))
+			{
+				var errors = new Exception[3];
+				var done = new ManualResetEvent[errors.Length];
+				for (var i = 0; i < errors.Length; ++i)
+				{
+					var index = i;
+					done[i] = Send(channel, i, _timeout, e => errors[index] = e.Error);
+				}
+				for (var i = 0; i < errors.Length; ++i)
+				{
+					_server.Take();
+				}
+
+				_server.CloseConnections();
+
+				foreach (var handle in done) Wait(handle);
+				foreach (var error in errors)
+				{
+					Assert.IsNotNull(error);
+				}
+				Assert.IsTrue(channel.HasError);
+				Assert.AreEqual(0, channel.PendingCount);
+				try
+				{
+					channel.SendRoundTripAsync(_timeout, Message(0), e => { });
+					Assert.Fail("A failed channel must refuse new requests.");
+				}
+				catch (InvalidOperationException)
+				{
+				}
+			}
+		}
+
+		[TestMethod]
+		public void FullPendingTableRefusesRequests()
+		{
+			_server = new LoopbackServer(false);
+			using (var channel = CreateChannel(2))
+			{
+				Send(channel, 1, _timeout, e => { });
+				Send(channel, 2, _timeout, e => { });
+				try
+				{
+					Send(channel, 3, _timeout, e => { });
+					Assert.Fail("A third request must not fit in two slots.");
+				}
+				catch (InvalidOperationException)
+				{
+				}
+				Assert.AreEqual(2, channel.PendingCount);
+			}
+		}
+
+		[TestMethod]
+		public void MultiplexedClientSpreadsRequestsOverItsConnections()
+		{
+			_server = new LoopbackServer(true);
+			const int count = 200;
+			var failures = 0;
+			var config = new SocketPoolConfig { Multiplexed = true, MultiplexedConnections = 2 };
+			using (var remaining = new CountdownEvent(count))
+			using (var client = new AsyncSocketClient(_server.EndPoint, config))
+			{
+				for (var i = 0; i < count; ++i)
+				{
+					var value = i;
+					client.SendRoundTripAsync(_commandId, value,
+						(v, stream) => stream.Write(BitConverter.GetBytes(v), 0, sizeof(int)),
+						e =>
+						{
+							if (ReadValue(e) != value) Interlocked.Increment(ref failures);
+							remaining.Signal();
+						});
+				}
+
+				Assert.IsTrue(remaining.Wait(_timeout), "Not every request completed.");
+			}
+			Assert.AreEqual(0, failures);
+			Assert.AreEqual(2, _server.ConnectionsAccepted);
+		}
+	}
+}
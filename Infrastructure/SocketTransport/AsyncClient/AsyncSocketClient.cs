@@ -1,6 +1,7 @@
 ﻿using System;
 using System.IO;
 using System.Net;
+using System.Threading;
 using MySpace.Common;
 
 namespace MySpace.SocketTransport
@@ -35,6 +36,7 @@ namespace MySpace.SocketTransport
 		internal static Pool<MemoryStream> MemoryPool { get { return _memoryPool; } }
 
 		private readonly SocketPool _socketPool;
+		private readonly MultiplexedChannels _multiplexedChannels;
 
 		/// <summary>
 		/// 	<para>Initializes a new instance of the <see cref="AsyncSocketClient"/> class.</para>
@@ -49,6 +51,10 @@ namespace MySpace.SocketTransport
 			if (endPoint == null) throw new ArgumentNullException("endPoint");
 
 			_socketPool = new SocketPool(endPoint, config ?? new SocketPoolConfig());
+			if (_socketPool.Config.Multiplexed)
+			{
+				_multiplexedChannels = new MultiplexedChannels(endPoint, _socketPool.Config);
+			}
 		}
 
 		/// <summary>
@@ -108,6 +114,12 @@ namespace MySpace.SocketTransport
 					dataSerializer);
 				sendData.Item.Seek(0, SeekOrigin.Begin);
 
+				if (_multiplexedChannels != null)
+				{
+					_multiplexedChannels.Next().SendOneWayAsync(sendData, resultAction);
+					return;
+				}
+
 				socket = _socketPool.Pool.Borrow();
 
 				socket.Item.SendOneWayAsync(
@@ -162,6 +174,36 @@ namespace MySpace.SocketTransport
 			if (dataSerializer == null) throw new ArgumentNullException("dataSerializer");
 			if (resultAction == null) throw new ArgumentNullException("resultAction");
 
+			if (_multiplexedChannels != null)
+			{
+				_multiplexedChannels.Next().SendRoundTripAsync(
+					_socketPool.Config.ReceiveTimeout,
+					messageId =>
+					{
+						var multiplexedData = _memoryPool.Borrow();
+						try
+						{
+							ClientMessage.WriteMessage<T>(
+								multiplexedData.Item,
+								_socketPool.Config.NetworkOrdered,
+								commandId,
+								messageId, // the reply is matched to this request by the id the server echoes
+								true,
+								data,
+								dataSerializer);
+							multiplexedData.Item.Seek(0, SeekOrigin.Begin);
+							return multiplexedData;
+						}
+						catch
+						{
+							multiplexedData.Dispose();
+							throw;
+						}
+					},
+					resultAction);
+				return;
+			}
+
 			var sendData = _memoryPool.Borrow();
 			IPoolItem<SocketChannel> socket = null;
 			try
@@ -210,7 +252,7 @@ namespace MySpace.SocketTransport
 				_remoteEndPoint = remoteEndPoint;
 				_config = config;
 				_pool = new Pool<SocketChannel>(
-					() => new SocketChannel(_remoteEndPoint, _config.ConnectTimeout),
+					() => new SocketChannel(_remoteEndPoint, _config.ConnectTimeout, _config.NetworkOrdered),
 					(socket, phase) => !socket.HasError,
 					_config);
 			}
@@ -222,6 +264,52 @@ namespace MySpace.SocketTransport
 			public Pool<SocketChannel> Pool { get { return _pool; } }
 		}
 
+		private class MultiplexedChannels
+		{
+			private readonly IPEndPoint _remoteEndPoint;
+			private readonly SocketPoolConfig _config;
+			private readonly MultiplexedSocketChannel[] _channels;
+			private int _next;
+
+			public MultiplexedChannels(IPEndPoint remoteEndPoint, SocketPoolConfig config)
+			{
+				_remoteEndPoint = remoteEndPoint;
+				_config = config;
+				_channels = new MultiplexedSocketChannel[Math.Max(1, config.MultiplexedConnections)];
+			}
+
+			/// <summary>
+			///	<para>Gets the next channel in turn, replacing it first if it has failed.</para>
+			/// </summary>
+			public MultiplexedSocketChannel Next()
+			{
+				int index = (Interlocked.Increment(ref _next) & int.MaxValue) % _channels.Length;
+				var channel = _channels[index];
+				if (channel != null && !channel.HasError) return channel;
+
+				var replacement = new MultiplexedSocketChannel(_remoteEndPoint, _config.ConnectTimeout, _config.MaxPendingRequests,
+					_config.NetworkOrdered);
+				var current = Interlocked.CompareExchange(ref _channels[index], replacement, channel);
+				if (current != channel)
+				{
+					// another caller replaced it first
+					replacement.Dispose();
+					return current;
+				}
+				if (channel != null) channel.Dispose();
+				return replacement;
+			}
+
+			public void Clear()
+			{
+				for (int i = 0; i < _channels.Length; ++i)
+				{
+					var channel = Interlocked.Exchange(ref _channels[i], null);
+					if (channel != null) channel.Dispose();
+				}
+			}
+		}
+
 		#region IDisposable Members
 
 		/// <summary>
@@ -230,6 +318,7 @@ namespace MySpace.SocketTransport
 		public void Dispose()
 		{
 			_socketPool.Pool.Clear();
+			if (_multiplexedChannels != null) _multiplexedChannels.Clear();
 		}
 
 		#endregion
@@ -22,6 +22,9 @@ namespace MySpace.SocketTransport
 			ConnectTimeout = 1000;
 			ReceiveTimeout = 2000;
 			NetworkOrdered = false;
+			Multiplexed = false;
+			MultiplexedConnections = 1;
+			MaxPendingRequests = 1024;
 		}
 
 		/// <summary>
@@ -44,5 +47,27 @@ namespace MySpace.SocketTransport
 		/// </value>
 		[XmlElement("NetworkOrdered")]
 		public bool NetworkOrdered { get; set; }
+
+		/// <summary>
+		/// 	<para>Gets or sets a value indicating whether requests share connections, each carrying
+		/// 	many requests at once, instead of borrowing a connection from the pool per request.</para>
+		/// </summary>
+		/// <value>
+		/// 	<para><see langword="true"/> if requests are multiplexed over shared connections; otherwise, <see langword="false"/>.</para>
+		/// </value>
+		[XmlElement("Multiplexed")]
+		public bool Multiplexed { get; set; }
+
+		/// <summary>
+		/// How many connections multiplexed requests are spread across.
+		/// </summary>
+		[XmlElement("MultiplexedConnections")]
+		public int MultiplexedConnections { get; set; }
+
+		/// <summary>
+		/// How many round trips may await replies on one multiplexed connection; rounded up to a power of two, at most 16384.
+		/// </summary>
+		[XmlElement("MaxPendingRequests")]
+		public int MaxPendingRequests { get; set; }
 	}
 }
@@ -0,0 +1,728 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+using MySpace.Common;
+using MySpace.Logging;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// 	<para>Encapsulates a socket connection to a specified end point that carries many
+	/// 	requests at once. Each round trip is sent with its own message id, which the server
+	/// 	echoes in the reply header, so replies are matched to their requests in whatever
+	/// 	order they arrive.</para>
+	/// </summary>
+	internal class MultiplexedSocketChannel : IDisposable
+	{
+		private enum State
+		{
+			Uninitialized,
+			Connecting,
+			Connected,
+			Disposed
+		}
+
+		private const int _receiveBufferSize = 8 << 10;
+		private const int _maxSendBatch = 64;
+		// message ids are positive shorts; 0 changes the reply header size and short.MinValue is the ack id
+		private const int _maxMessageId = short.MaxValue;
+
+		private static readonly ObjectDisposedException _disposedException = new ObjectDisposedException(typeof(MultiplexedSocketChannel).Name);
+
+		private static readonly LogWrapper _log = new LogWrapper();
+
+		private readonly EndPoint _endpoint;
+		private readonly int _connectTimeout;
+		private readonly bool _networkOrdered;
+		private readonly Socket _socket = new Socket(
+				AddressFamily.InterNetwork,
+				SocketType.Stream,
+				ProtocolType.Tcp)
+		{
+			Blocking = false
+		};
+
+		private readonly SocketAsyncEventArgs _sendArgs;
+		private readonly SocketAsyncEventArgs _receiveArgs;
+		private readonly WaitCallback _timeoutHandler;
+		private readonly WaitCallback _connectTimeoutHandler;
+		private readonly PendingRequest[] _pending;
+		private readonly int _slotMask;
+		private readonly Queue<OutgoingMessage> _sendQueue = new Queue<OutgoingMessage>();
+		private readonly List<OutgoingMessage> _sendBatch = new List<OutgoingMessage>(_maxSendBatch);
+		private readonly List<ArraySegment<byte>> _sendBuffers = new List<ArraySegment<byte>>(_maxSendBatch);
+		private readonly ServerMessageHeader _responseHeader = new ServerMessageHeader();
+		private volatile Exception _error;
+		private ITaskHandle _connectTimeoutHandle;
+		private State _state = State.Uninitialized;
+		private bool _sending;
+		private IPoolItem<MemoryStream> _responseData;
+		private int _nextMessageId;
+		private int _pendingCount;
+		private int _abandonedCount;
+
+		/// <summary>
+		/// 	<para>Initializes a new instance of the <see cref="MultiplexedSocketChannel"/> class.</para>
+		/// </summary>
+		/// <param name="endpoint">The endpoint to connect to.</param>
+		/// <param name="connectTimeout">
+		///	<para>The time, in milliseconds, to wait for a connection before timing out.</para>
+		///  </param>
+		/// <param name="maxPendingRequests">
+		///	<para>The most round trips that may await replies at once. Rounded up to a power of two.</para>
+		/// </param>
+		/// <param name="networkOrdered">
+		///	<para>Whether the server writes numbers in network order.</para>
+		/// </param>
+		/// <exception cref="ArgumentNullException">
+		///	<para><paramref name="endpoint"/> is <see langword="null"/>.</para>
+		/// </exception>
+		public MultiplexedSocketChannel(EndPoint endpoint, int connectTimeout, int maxPendingRequests, bool networkOrdered)
+		{
+			if (endpoint == null) throw new ArgumentNullException("endpoint");
+			if (connectTimeout < -1) throw new ArgumentOutOfRangeException("connectTimeout", "connectTimeout must be a positive integer, 0, or Timeout.Infinite (-1).");
+			if (maxPendingRequests < 1 || maxPendingRequests > (_maxMessageId + 1) / 2) throw new ArgumentOutOfRangeException("maxPendingRequests", "maxPendingRequests must be between 1 and 16384.");
+
+			_endpoint = endpoint;
+			_connectTimeout = connectTimeout;
+			_networkOrdered = networkOrdered;
+
+			int capacity = 1;
+			while (capacity < maxPendingRequests) capacity <<= 1;
+			_pending = new PendingRequest[capacity];
+			_slotMask = capacity - 1;
+
+			_sendArgs = new SocketAsyncEventArgs { RemoteEndPoint = endpoint };
+			_sendArgs.Completed += (s, e) => OnSendCompleted(e);
+			_receiveArgs = new SocketAsyncEventArgs { RemoteEndPoint = endpoint };
+			_receiveArgs.Completed += (s, e) => OnReceiveCompleted();
+			_receiveArgs.SetBuffer(new byte[_receiveBufferSize], 0, _receiveBufferSize);
+			_timeoutHandler = HandleTimeout;
+			_connectTimeoutHandler = HandleConnectTimeout;
+		}
+
+		/// <summary>
+		///	<para>Sends the data in <paramref name="sendData"/> to the remote end point
+		///	specified during construction. Calls <paramref name="resultAction"/> when all data
+		///	has been sent. Please note that this only indicates that the server received the data
+		///	and does not guarantee that data was processed.</para>
+		/// </summary>
+		/// <param name="sendData">
+		///	<para>The data to send. The pool item will be disposed, returned to the owning pool,
+		///	automatically when it is no longer needed. So it is important that consumers do not
+		///	access it after calling this method.</para>
+		/// </param>
+		/// <param name="resultAction">
+		///	<para>The method that will be called when the data has been sent or the operation fails.</para>
+		/// </param>
+		/// <exception cref="ArgumentNullException">
+		///	<para><paramref name="sendData"/> is <see langword="null"/>.</para>
+		/// </exception>
+		public void SendOneWayAsync(
+			IPoolItem<MemoryStream> sendData,
+			Action<OneWayAsyncEventArgs> resultAction)
+		{
+			if (sendData == null) throw new ArgumentNullException("sendData");
+
+			ValidateChannelForUse();
+			Enqueue(new OutgoingMessage(sendData, resultAction));
+		}
+
+		/// <summary>
+		///	<para>Reserves a message id, sends the message <paramref name="writeMessage"/> writes
+		///	for it, and calls <paramref name="resultAction"/> when the reply with that id has been
+		///	recieved, the operation times-out, or the operation fails. Other requests may be sent
+		///	and answered while this one is pending.</para>
+		/// </summary>
+		/// <param name="timeout">The time to wait, in milliseconds, before the operation times out.</param>
+		/// <param name="writeMessage">
+		///	<para>Writes the message with the message id given and returns it. The returned pool item
+		///	will be disposed automatically when it is no longer needed.</para>
+		/// </param>
+		/// <param name="resultAction">
+		///	<para>The method that will be called when the end point responds,
+		///	the operation fails, or the operation times out.</para>
+		/// </param>
+		/// <exception cref="ArgumentNullException">
+		///	<para><paramref name="writeMessage"/> is <see langword="null"/>.</para>
+		/// </exception>
+		/// <exception cref="InvalidOperationException">
+		///	<para>The channel has failed, or as many requests as it allows are already pending.</para>
+		/// </exception>
+		public void SendRoundTripAsync(
+			int timeout,
+			Func<short, IPoolItem<MemoryStream>> writeMessage,
+			Action<RoundTripAsyncEventArgs> resultAction)
+		{
+			if (writeMessage == null) throw new ArgumentNullException("writeMessage");
+
+			ValidateChannelForUse();
+
+			var request = Reserve(resultAction);
+			if (request == null)
+			{
+				throw new InvalidOperationException(string.Format(
+					"All {0} pending request slots for {1} are in use.",
+					_pending.Length,
+					_endpoint));
+			}
+
+			IPoolItem<MemoryStream> sendData;
+			try
+			{
+				sendData = writeMessage(request.MessageId);
+			}
+			catch
+			{
+				Release(request);
+				throw;
+			}
+
+			request.TimeoutHandle = TaskMonitor.RegisterMonitor(timeout, _timeoutHandler, request);
+			Enqueue(new OutgoingMessage(sendData, null));
+			// the channel may have failed after the request was reserved but before it was queued
+			if (_error != null) FailPending(_error);
+		}
+
+		/// <summary>
+		/// 	<para>Gets the end point this instance is connected or will connect to.</para>
+		/// </summary>
+		/// <value>
+		/// 	<para>The end point this instance is connected or will connect to.</para>
+		/// </value>
+		public EndPoint EndPoint
+		{
+			[DebuggerStepThrough]
+			get { return _endpoint; }
+		}
+
+		/// <summary>
+		/// 	<para>Gets a value indicating whether this instance has an error.</para>
+		/// </summary>
+		/// <value>
+		/// 	<para><see langword="true"/> if this instance has error; otherwise, <see langword="false"/>.</para>
+		/// </value>
+		public bool HasError
+		{
+			[DebuggerStepThrough]
+			get { return _error != null; }
+		}
+
+		/// <summary>
+		/// 	<para>Gets the number of round trips awaiting replies.</para>
+		/// </summary>
+		/// <value>
+		/// 	<para>The number of round trips awaiting replies.</para>
+		/// </value>
+		public int PendingCount
+		{
+			[DebuggerStepThrough]
+			get { return _pendingCount; }
+		}
+
+		private void ValidateChannelForUse()
+		{
+			if (_error != null)
+			{
+				if (ReferenceEquals(_error, _disposedException)) throw new ObjectDisposedException("MultiplexedSocketChannel");
+				throw new InvalidOperationException("MultiplexedSocketChannel was left in a bad state by a previous error.", _error);
+			}
+		}
+
+		#region Pending Requests
+
+		private PendingRequest Reserve(Action<RoundTripAsyncEventArgs> resultAction)
+		{
+			var request = new PendingRequest(resultAction);
+			// ids run through 1..short.MaxValue and map onto slots by their low bits, so a slot
+			// is only contended by an id that was handed out a full table earlier
+			for (int attempt = 0; attempt < _pending.Length; ++attempt)
+			{
+				int sequence = Interlocked.Increment(ref _nextMessageId) & int.MaxValue;
+				request.MessageId = (short)(sequence % _maxMessageId + 1);
+				if (Interlocked.CompareExchange(ref _pending[request.MessageId & _slotMask], request, null) == null)
+				{
+					Interlocked.Increment(ref _pendingCount);
+					return request;
+				}
+			}
+			return null;
+		}
+
+		private void Release(PendingRequest request)
+		{
+			if (Interlocked.CompareExchange(ref _pending[request.MessageId & _slotMask], null, request) == request)
+			{
+				Interlocked.Decrement(ref _pendingCount);
+			}
+		}
+
+		private void HandleTimeout(object state)
+		{
+			var request = (PendingRequest)state;
+			if (!request.TryComplete()) return;
+
+			// the slot stays taken until the late reply arrives so that its message id is not
+			// handed to another request in the meantime
+			Interlocked.Decrement(ref _pendingCount);
+			if (Interlocked.Increment(ref _abandonedCount) > _pending.Length / 2)
+			{
+				SetError(new SocketException((int)SocketError.TimedOut));
+			}
+			Complete(RoundTripAsyncEventArgs.Create(false, new SocketException((int)SocketError.TimedOut), null, request.ResultAction));
+		}
+
+		private void CompleteResponse(short messageId, IPoolItem<MemoryStream> response, Exception error)
+		{
+			var request = _pending[messageId & _slotMask];
+			if (request == null
+				|| request.MessageId != messageId
+				|| Interlocked.CompareExchange(ref _pending[messageId & _slotMask], null, request) != request)
+			{
+				if (response != null) response.Dispose();
+				_log.WarnFormat("{0} (Multiplexed) - Dropped a reply for message id {1} which was not pending.", _endpoint, messageId);
+				return;
+			}
+
+			if (request.TryComplete())
+			{
+				Interlocked.Decrement(ref _pendingCount);
+				request.TimeoutHandle.TrySetComplete();
+				Complete(RoundTripAsyncEventArgs.Create(false, error, response, request.ResultAction));
+			}
+			else
+			{
+				// the request already timed out; its reply only frees the slot
+				Interlocked.Decrement(ref _abandonedCount);
+				if (response != null) response.Dispose();
+			}
+		}
+
+		private void FailPending(Exception error)
+		{
+			for (int slot = 0; slot < _pending.Length; ++slot)
+			{
+				var request = Interlocked.Exchange(ref _pending[slot], null);
+				if (request == null || !request.TryComplete()) continue;
+
+				Interlocked.Decrement(ref _pendingCount);
+				if (request.TimeoutHandle != null) request.TimeoutHandle.TrySetComplete();
+				Complete(RoundTripAsyncEventArgs.Create(false, error, null, request.ResultAction));
+			}
+		}
+
+		private static void Complete(ICompletion completion)
+		{
+			// replies are handed off so that a slow consumer doesn't hold up the receive loop
+			// and every other request waiting behind it
+			ThreadPool.UnsafeQueueUserWorkItem(o => ((ICompletion)o).Complete(), completion);
+		}
+
+		#endregion
+
+		#region Send
+
+		private void Enqueue(OutgoingMessage message)
+		{
+			bool connect = false;
+			bool send = false;
+			lock (_sendQueue)
+			{
+				if (_state == State.Disposed)
+				{
+					message.Fail(_error ?? _disposedException);
+					return;
+				}
+				_sendQueue.Enqueue(message);
+				if (_state == State.Uninitialized)
+				{
+					_state = State.Connecting;
+					connect = true;
+				}
+				else if (_state == State.Connected && !_sending)
+				{
+					_sending = true;
+					send = true;
+				}
+			}
+
+			if (connect) Connect();
+			else if (send) SendQueued();
+		}
+
+		private void Connect()
+		{
+			_connectTimeoutHandle = TaskMonitor.RegisterMonitor(_connectTimeout, _connectTimeoutHandler, null);
+			bool pending;
+			try
+			{
+				pending = _socket.ConnectAsync(_sendArgs);
+			}
+			catch (Exception ex)
+			{
+				SetError(ex);
+				return;
+			}
+			if (!pending) OnConnected();
+		}
+
+		private void HandleConnectTimeout(object state)
+		{
+			SetError(new SocketException((int)SocketError.TimedOut));
+		}
+
+		private void OnConnected()
+		{
+			if (!_connectTimeoutHandle.TrySetComplete())
+			{
+				SetError(new SocketException((int)SocketError.TimedOut));
+				return;
+			}
+			if (_sendArgs.SocketError != SocketError.Success)
+			{
+				SetError(new SocketException((int)_sendArgs.SocketError));
+				return;
+			}
+
+			lock (_sendQueue)
+			{
+				if (_state != State.Connecting) return;
+				_state = State.Connected;
+				_sending = true;
+			}
+
+			ThreadPool.UnsafeQueueUserWorkItem(o => ((MultiplexedSocketChannel)o).Receive(), this);
+			SendQueued();
+		}
+
+		private void OnSendCompleted(SocketAsyncEventArgs e)
+		{
+			if (e.LastOperation == SocketAsyncOperation.Connect)
+			{
+				OnConnected();
+			}
+			else if (FinishSend())
+			{
+				SendQueued();
+			}
+		}
+
+		private void SendQueued()
+		{
+			while (true)
+			{
+				lock (_sendQueue)
+				{
+					if (_sendQueue.Count == 0 || _error != null)
+					{
+						_sending = false;
+						return;
+					}
+					// everything queued while the last send was in flight goes out in one gathered write
+					while (_sendQueue.Count > 0 && _sendBatch.Count < _maxSendBatch)
+					{
+						var message = _sendQueue.Dequeue();
+						var stream = message.Data.Item;
+						_sendBatch.Add(message);
+						_sendBuffers.Add(new ArraySegment<byte>(stream.GetBuffer(), (int)stream.Position, (int)(stream.Length - stream.Position)));
+					}
+				}
+
+				_sendArgs.BufferList = _sendBuffers;
+				// note - it seems this is necessary because of a bug in the SendAsync function
+				// see - http://social.msdn.microsoft.com/Forums/en-IE/ncl/thread/40fe397c-b1da-428e-a355-ee5a6b0b4d2c
+				Thread.MemoryBarrier();
+				bool pending;
+				try
+				{
+					pending = _socket.SendAsync(_sendArgs);
+				}
+				catch (Exception ex)
+				{
+					FinishBatch(ex);
+					SetError(ex);
+					return;
+				}
+				if (pending) return;
+				if (!FinishSend()) return;
+			}
+		}
+
+		private bool FinishSend()
+		{
+			Exception error = null;
+			if (_sendArgs.SocketError != SocketError.Success)
+			{
+				error = new SocketException((int)_sendArgs.SocketError);
+			}
+			FinishBatch(error);
+			if (error != null)
+			{
+				SetError(error);
+				return false;
+			}
+			return true;
+		}
+
+		private void FinishBatch(Exception error)
+		{
+			_sendArgs.BufferList = null;
+			foreach (var message in _sendBatch)
+			{
+				if (error == null) message.Sent();
+				else message.Fail(error);
+			}
+			_sendBatch.Clear();
+			_sendBuffers.Clear();
+		}
+
+		#endregion
+
+		#region Receive
+
+		private void Receive()
+		{
+			while (true)
+			{
+				if (_error != null) return;
+				bool pending;
+				try
+				{
+					// note - it seems this is necessary because of a bug in the SendAsync function
+					// see - http://social.msdn.microsoft.com/Forums/en-IE/ncl/thread/40fe397c-b1da-428e-a355-ee5a6b0b4d2c
+					Thread.MemoryBarrier();
+					pending = _socket.ReceiveAsync(_receiveArgs);
+				}
+				catch (Exception ex)
+				{
+					SetError(ex);
+					return;
+				}
+				if (pending) return;
+				if (!FinishReceive()) return;
+			}
+		}
+
+		private void OnReceiveCompleted()
+		{
+			if (FinishReceive()) Receive();
+		}
+
+		private bool FinishReceive()
+		{
+			if (_error != null) return false;
+
+			if (_receiveArgs.SocketError != SocketError.Success)
+			{
+				SetError(new SocketException((int)_receiveArgs.SocketError));
+				return false;
+			}
+
+			if (_receiveArgs.BytesTransferred == 0)
+			{
+				SetError(new SocketException((int)SocketError.ConnectionReset));
+				return false;
+			}
+
+			try
+			{
+				ReadResponses(_receiveArgs.Buffer, _receiveArgs.Offset, _receiveArgs.BytesTransferred);
+			}
+			catch (Exception ex)
+			{
+				SetError(ex);
+				return false;
+			}
+			return true;
+		}
+
+		private void ReadResponses(byte[] buffer, int offset, int count)
+		{
+			int position = offset;
+			int end = offset + count;
+			while (position < end)
+			{
+				if (_responseData == null)
+				{
+					position += _responseHeader.Read(buffer, position, end - position);
+					if (!_responseHeader.IsComplete) return;
+					_responseData = AsyncSocketClient.MemoryPool.Borrow();
+				}
+
+				int countNeeded = _responseHeader.MessageDataLength - (int)_responseData.Item.Length;
+				int countAvailable = Math.Min(countNeeded, end - position);
+				_responseData.Item.Write(buffer, position, countAvailable);
+				position += countAvailable;
+				if (countAvailable < countNeeded) return;
+
+				var response = _responseData;
+				_responseData = null;
+				response.Item.Seek(0, SeekOrigin.Begin);
+				ServerBusyException busyError = null;
+				int retryAfter;
+				if (_responseHeader.MessageLength == ServerMessage.EmptyReplyMessageLength
+					&& ServerMessage.IsEmptyMessage(response.Item.GetBuffer(), 0, _responseHeader.MessageLength))
+				{
+					response.Dispose();
+					response = null;
+				}
+				else if (_responseHeader.MessageLength == ServerMessage.BusyReplyMessageLength
+					&& ServerMessage.IsBusyMessage(response.Item.GetBuffer(), 0, _responseHeader.MessageLength, _networkOrdered, out retryAfter))
+				{
+					// only this request was refused; the rest of the channel carries on
+					busyError = new ServerBusyException(retryAfter);
+					response.Dispose();
+					response = null;
+				}
+				// the next call to Read starts a new header because this one is complete
+				CompleteResponse(_responseHeader.MessageId, response, busyError);
+			}
+		}
+
+		#endregion
+
+		private void SetError(Exception error)
+		{
+			List<OutgoingMessage> unsent;
+			lock (_sendQueue)
+			{
+				if (_error != null) return;
+				_error = error;
+				_state = State.Disposed;
+				unsent = new List<OutgoingMessage>(_sendQueue);
+				_sendQueue.Clear();
+			}
+
+			if (_log.IsDebugEnabled)
+			{
+				_log.Debug(string.Format("{0} (Multiplexed) - SetError called. Error = {1}", _endpoint, error));
+			}
+
+			Close();
+			foreach (var message in unsent)
+			{
+				message.Fail(error);
+			}
+			FailPending(error);
+		}
+
+		private void Close()
+		{
+			try
+			{
+				_socket.Shutdown(SocketShutdown.Both);
+			}
+			catch (Exception ex)
+			{
+				_log.Error("Failed to shut socket down.", ex);
+			}
+			try
+			{
+				_socket.Close();
+			}
+			catch (Exception ex)
+			{
+				_log.Error("Failed to close socket.", ex);
+			}
+			try
+			{
+				_sendArgs.Dispose();
+			}
+			catch (Exception ex)
+			{
+				_log.Error("Failed to dispose MultiplexedSocketChannel._sendArgs.", ex);
+			}
+			try
+			{
+				_receiveArgs.Dispose();
+			}
+			catch (Exception ex)
+			{
+				_log.Error("Failed to dispose MultiplexedSocketChannel._receiveArgs.", ex);
+			}
+		}
+
+		#region IDisposable Members
+
+		/// <summary>
+		/// Performs application-defined tasks associated with freeing, releasing, or resetting unmanaged resources.
+		/// </summary>
+		public void Dispose()
+		{
+			SetError(_disposedException);
+		}
+
+		#endregion
+
+		private sealed class PendingRequest
+		{
+			private readonly Action<RoundTripAsyncEventArgs> _resultAction;
+			private int _completed;
+
+			public PendingRequest(Action<RoundTripAsyncEventArgs> resultAction)
+			{
+				_resultAction = resultAction;
+			}
+
+			public short MessageId;
+
+			public ITaskHandle TimeoutHandle;
+
+			public Action<RoundTripAsyncEventArgs> ResultAction
+			{
+				[DebuggerStepThrough]
+				get { return _resultAction; }
+			}
+
+			/// <summary>
+			///	<para>Claims the right to complete the request; the reply, the timeout and a
+			///	channel failure race for it and only the first one wins.</para>
+			/// </summary>
+			public bool TryComplete()
+			{
+				return Interlocked.Exchange(ref _completed, 1) == 0;
+			}
+		}
+
+		private sealed class OutgoingMessage
+		{
+			private readonly IPoolItem<MemoryStream> _data;
+			private readonly Action<OneWayAsyncEventArgs> _oneWayResultAction;
+
+			public OutgoingMessage(IPoolItem<MemoryStream> data, Action<OneWayAsyncEventArgs> oneWayResultAction)
+			{
+				_data = data;
+				_oneWayResultAction = oneWayResultAction;
+			}
+
+			public IPoolItem<MemoryStream> Data
+			{
+				[DebuggerStepThrough]
+				get { return _data; }
+			}
+
+			public void Sent()
+			{
+				_data.Dispose();
+				if (_oneWayResultAction != null)
+				{
+					Complete(OneWayAsyncEventArgs.Create(false, null, _oneWayResultAction));
+				}
+			}
+
+			public void Fail(Exception error)
+			{
+				// round trips sent with this message fail through the pending table
+				_data.Dispose();
+				if (_oneWayResultAction != null)
+				{
+					Complete(OneWayAsyncEventArgs.Create(false, error, _oneWayResultAction));
+				}
+			}
+		}
+	}
+}
@@ -39,6 +39,7 @@ namespace MySpace.SocketTransport
 
 		private readonly EndPoint _endpoint;
 		private readonly int _connectTimeout;
+		private readonly bool _networkOrdered;
 		private readonly Socket _socket = new Socket(
 				AddressFamily.InterNetwork,
 				SocketType.Stream,
@@ -59,6 +60,7 @@ namespace MySpace.SocketTransport
 		private IPoolItem<MemoryStream> _sendData;
 		private IPoolItem<MemoryStream> _responseData;
 		private bool _responseReceived;
+		private ServerBusyException _busyError;
 		private Action<OneWayAsyncEventArgs> _oneWayResultAction;
 		private Action<RoundTripAsyncEventArgs> _roundTripResultAction;
 		private int _currentRequestId;
@@ -74,12 +76,31 @@ namespace MySpace.SocketTransport
 		///	<para><paramref name="endpoint"/> is <see langword="null"/>.</para>
 		/// </exception>
 		public SocketChannel(EndPoint endpoint, int connectTimeout)
+			: this(endpoint, connectTimeout, false)
+		{
+		}
+
+		/// <summary>
+		/// 	<para>Initializes a new instance of the <see cref="SocketChannel"/> class.</para>
+		/// </summary>
+		/// <param name="endpoint">The endpoint to connect to.</param>
+		/// <param name="connectTimeout">
+		///	<para>The time, in milliseconds, to wait for a connection before timing out.</para>
+		///  </param>
+		/// <param name="networkOrdered">
+		///	<para>Whether the server writes numbers in network order.</para>
+		///  </param>
+		/// <exception cref="ArgumentNullException">
+		///	<para><paramref name="endpoint"/> is <see langword="null"/>.</para>
+		/// </exception>
+		public SocketChannel(EndPoint endpoint, int connectTimeout, bool networkOrdered)
 		{
 			if (endpoint == null) throw new ArgumentNullException("endpoint");
 			if (connectTimeout < -1) throw new ArgumentOutOfRangeException("connectTimeout", "connectTimeout must be a positive integer, 0, or Timeout.Infinite (-1).");
 
 			_endpoint = endpoint;
 			_connectTimeout = connectTimeout;
+			_networkOrdered = networkOrdered;
 
 			EventHandler<SocketAsyncEventArgs> completed = (s, e) => ((ParameterlessDelegate)e.UserToken)();
 			_socketArgs = new SocketAsyncEventArgs { RemoteEndPoint = endpoint };
@@ -250,6 +271,11 @@ namespace MySpace.SocketTransport
 
 				if (_operationType == OperationType.RoundTrip && _roundTripResultAction != null)
 				{
+					if (_error == null && _busyError != null)
+					{
+						// the request was refused but the connection is still good
+						return RoundTripAsyncEventArgs.Create(wasSynchronous, _busyError, null, _roundTripResultAction);
+					}
 					if (_error == null)
 					{
 						var result = RoundTripAsyncEventArgs.Create(wasSynchronous, null, _responseData, _roundTripResultAction);
@@ -280,6 +306,7 @@ namespace MySpace.SocketTransport
 			_messageSent = false;
 			_responseHeader.Clear();
 			_responseReceived = false;
+			_busyError = null;
 
 			if (_sendData != null)
 			{
@@ -436,6 +463,7 @@ namespace MySpace.SocketTransport
 					int countNeeded = _responseHeader.MessageDataLength - (int)_responseData.Item.Length;
 					if (countNeeded <= countAvailable)
 					{
+						int retryAfter;
 						_responseData.Item.Write(_receiveArgs.Buffer, position, countNeeded);
 						_responseData.Item.Seek(0, SeekOrigin.Begin);
 						if (_responseHeader.MessageLength == ServerMessage.EmptyReplyMessageLength
@@ -444,6 +472,13 @@ namespace MySpace.SocketTransport
 							_responseData.Dispose();
 							_responseData = null;
 						}
+						else if (_responseHeader.MessageLength == ServerMessage.BusyReplyMessageLength
+							&& ServerMessage.IsBusyMessage(_responseData.Item.GetBuffer(), 0, _responseHeader.MessageLength, _networkOrdered, out retryAfter))
+						{
+							_busyError = new ServerBusyException(retryAfter);
+							_responseData.Dispose();
+							_responseData = null;
+						}
 						_responseReceived = true;
 					}
 					else
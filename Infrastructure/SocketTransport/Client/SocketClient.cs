@@ -387,7 +387,7 @@ namespace MySpace.SocketTransport
 			}
 			catch (SocketException ex)
 			{
-				if (socket != null)
+				if (socket != null && !socket.LastReplyBusy) //a busy reply leaves the socket usable
 				{
 					socket.LastError = ex.SocketErrorCode;
 				}
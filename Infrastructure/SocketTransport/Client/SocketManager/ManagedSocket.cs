@@ -18,6 +18,7 @@ namespace MySpace.SocketTransport
 		private static readonly LogWrapper log = new LogWrapper();
 		internal static Int32 ReplyEnvelopeLength = 4; //NOT for async receives
 		private static readonly Byte[] emptyReplyBytes = {241, 216, 255, 255};
+		private static readonly Byte[] busyReplyBytes = {241, 216, 254, 255}; //followed by the retry after milliseconds
 		
 		private const short ServerCapabilityRequestCommandId = Int16.MinValue;
 		private static readonly byte[] ServerCapabilityRequestMessage, ServerCapabilityRequestMessageNetworkOrdered;
@@ -148,10 +149,18 @@ namespace MySpace.SocketTransport
 						messageBuffer.Write(_receiveBuffer, 0, received);
 					}
 
-					replyStream = CreateGetReplyResponse(messageBuffer, replyLength);
+					int retryAfter;
+					if (IsBusyReply(messageBuffer, replyLength, _settings.UseNetworkOrder, out retryAfter))
+					{
+						PostBusy(messageId, retryAfter);
+					}
+					else
+					{
+						replyStream = CreateGetReplyResponse(messageBuffer, replyLength);
 
-					// Signal any waiting thread that the receive has completed
-					PostReply(messageId, replyStream);
+						// Signal any waiting thread that the receive has completed
+						PostReply(messageId, replyStream);
+					}
 
 					// A new BeginReceive() to call ReceiveCallback when the next reply message comes in.
 					BeginReceive(GetReceiveBuffer(_settings.ReceiveBufferSize), 0, _settings.ReceiveBufferSize, SocketFlags.None,
@@ -209,6 +218,24 @@ namespace MySpace.SocketTransport
 			return replyStream;
 		}
 
+		private static bool IsBusyReply(MemoryStream messageBuffer, Int32 replyLength, bool useNetworkOrder, out int retryAfter)
+		{
+			retryAfter = 0;
+			if (replyLength != busyReplyBytes.Length + 4) return false;
+
+			Byte[] message = messageBuffer.GetBuffer();
+			for (int i = 0; i < busyReplyBytes.Length; i++)
+			{
+				if (message[i] != busyReplyBytes[i]) return false;
+			}
+			retryAfter = BitConverter.ToInt32(message, busyReplyBytes.Length);
+			if (useNetworkOrder)
+			{
+				retryAfter = IPAddress.NetworkToHostOrder(retryAfter);
+			}
+			return true;
+		}
+
 		public void Release()
 		{
 			myPool.ReleaseSocket(this);
@@ -291,6 +318,13 @@ namespace MySpace.SocketTransport
 
 		private short currentMessageId = 1;
 		private MemoryStream _replyStream;
+		private int _busyRetryAfter = -1;
+
+		/// <summary>
+		/// Whether the last reply was the server refusing the request because it was busy;
+		/// the connection itself is still good.
+		/// </summary>
+		internal bool LastReplyBusy { get; private set; }
 		private readonly EventWaitHandle _waitHandle = new EventWaitHandle(false, EventResetMode.AutoReset);
 
 		private void PostError(SocketError error)
@@ -307,6 +341,23 @@ namespace MySpace.SocketTransport
 			}
 		}
 
+		private void PostBusy(short messageId, int retryAfter)
+		{
+			try
+			{
+				_replyStream = null;
+				if (messageId == currentMessageId)
+				{
+					_busyRetryAfter = retryAfter;
+				}
+				_waitHandle.Set();
+			}
+			catch (Exception ex)
+			{
+				log.Error(ex);
+			}
+		}
+
 		private void PostReply(short messageId, MemoryStream replyStream)
 		{
 			try
@@ -331,10 +382,20 @@ namespace MySpace.SocketTransport
 
 		internal MemoryStream GetReply()
 		{
+			LastReplyBusy = false;
 			if (_waitHandle.WaitOne(ReceiveTimeout, false))
 			{
 				var reply = _replyStream;
 				_replyStream = null;
+				int retryAfter = _busyRetryAfter;
+				_busyRetryAfter = -1;
+				if (retryAfter >= 0)
+				{
+					if (log.IsDebugEnabled)
+						log.DebugFormat("Server {0} is busy; retry after {1} milliseconds.", _remoteEndPoint, retryAfter);
+					LastReplyBusy = true;
+					throw new SocketException((int)SocketError.NoBufferSpaceAvailable);
+				}
 				// return a valid reply even if LastError might be set.  This error will be detected on the next request.
 				if (reply != null) return reply;
 
@@ -0,0 +1,41 @@
+﻿using System;
+using System.Net.Sockets;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// 	<para>The exception that is thrown when the server answered a request with a busy reply
+	/// 	because its queues were full. The request was not processed and can be sent again
+	/// 	after <see cref="RetryAfter"/>.</para>
+	/// </summary>
+	public class ServerBusyException : SocketException
+	{
+		private readonly TimeSpan _retryAfter;
+
+		/// <summary>
+		/// 	<para>Initializes a new instance of the <see cref="ServerBusyException"/> class.</para>
+		/// </summary>
+		/// <param name="retryAfterMilliseconds">How long the server asked the client to wait before retrying.</param>
+		public ServerBusyException(int retryAfterMilliseconds)
+			: base((int)SocketError.NoBufferSpaceAvailable)
+		{
+			_retryAfter = TimeSpan.FromMilliseconds(retryAfterMilliseconds);
+		}
+
+		/// <summary>
+		/// 	<para>Gets how long the server asked the client to wait before sending the request again.</para>
+		/// </summary>
+		public TimeSpan RetryAfter
+		{
+			get { return _retryAfter; }
+		}
+
+		/// <summary>
+		/// 	<para>Gets the error message for this exception.</para>
+		/// </summary>
+		public override string Message
+		{
+			get { return "The server is busy; retry after " + _retryAfter.TotalMilliseconds + " milliseconds."; }
+		}
+	}
+}
@@ -13,6 +13,7 @@ namespace MySpace.SocketTransport
 		private const int _messageLengthOffset = 0;
 		private const int _messageIdOffset = _messageLengthOffset + sizeof(int);
 		private static readonly byte[] _emptyReply = new byte[] { 241, 216, 255, 255 };
+		private static readonly byte[] _busyReply = new byte[] { 241, 216, 254, 255 };
 
 		/// <summary>
 		///	<para>The number of bytes in the header.</para>
@@ -25,6 +26,13 @@ namespace MySpace.SocketTransport
 		/// </summary>
 		public static readonly int EmptyReplyMessageLength = _headerSize + _emptyReply.Length;
 
+		/// <summary>
+		///	<para>The total message length, in bytes, of a busy reply, which the server sends in place
+		///	of a reply when its queues are full. If a message is recieved of this length it should be
+		///	checked for the busy reply condition via <see cref="IsBusyMessage"/>.</para>
+		/// </summary>
+		public static readonly int BusyReplyMessageLength = _headerSize + _busyReply.Length + sizeof(int);
+
 		/// <summary>
 		/// Reads a message header from <paramref name="source"/>.
 		/// <paramref name="source"/> must have at least <see cref="HeaderSize"/> bytes.
@@ -125,5 +133,57 @@ namespace MySpace.SocketTransport
 			}
 			return true;
 		}
+
+		/// <summary>
+		/// 	<para>Determines whether a message from the server is a special busy reply message,
+		/// 	sent instead of a reply when the server could not queue the request.</para>
+		/// </summary>
+		/// <param name="messageBuffer">The buffer containing the message.</param>
+		/// <param name="offset">
+		///	<para>The offset where the message data begins. This is the place where the data begins
+		///	and not where the message header begins.</para>
+		/// </param>
+		/// <param name="totalMessageLength">
+		///	<para>Total length of the message. This is the same message length value that is retrieved
+		///	from <see cref="ReadMessageHeader"/>. This value includes the length of message header.</para>
+		/// </param>
+		/// <param name="networkOrdered">
+		///	<para><see langword="true"/> if the retry-after value is expected to be in network order;
+		///	<see langword="false"/> otherwise.</para>
+		/// </param>
+		/// <param name="retryAfterMilliseconds">
+		///	<para>How long the server asked the client to wait before sending the request again.</para>
+		/// </param>
+		/// <returns>
+		/// 	<para><see langword="true"/> if the message is a special busy reply message;
+		/// 	otherwise, <see langword="false"/>.</para>
+		/// </returns>
+		/// <exception cref="ArgumentNullException">
+		///	<para><paramref name="messageBuffer"/> is <see langword="null"/></para>.
+		/// </exception>
+		public static bool IsBusyMessage(
+			byte[] messageBuffer,
+			int offset,
+			int totalMessageLength,
+			bool networkOrdered,
+			out int retryAfterMilliseconds)
+		{
+			if (messageBuffer == null) throw new ArgumentNullException("messageBuffer");
+
+			retryAfterMilliseconds = 0;
+			if (totalMessageLength != BusyReplyMessageLength) return false;
+			if (offset < 0 || offset + _busyReply.Length + sizeof(int) > messageBuffer.Length) return false;
+
+			for (int i = 0; i < _busyReply.Length; i++)
+			{
+				if (_busyReply[i] != messageBuffer[offset + i]) return false;
+			}
+			retryAfterMilliseconds = BitConverter.ToInt32(messageBuffer, offset + _busyReply.Length);
+			if (networkOrdered)
+			{
+				retryAfterMilliseconds = IPAddress.NetworkToHostOrder(retryAfterMilliseconds);
+			}
+			return true;
+		}
 	}
 }
@@ -0,0 +1,152 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Net;
+using System.Threading;
+
+namespace MySpace.SocketTransport.MultiplexBenchmark
+{
+	/// <summary>
+	/// Sends the same round trips through an <see cref="AsyncSocketClient"/> once with pooled
+	/// connections and once with <see cref="SocketPoolConfig.Multiplexed"/> connections, against
+	/// an echoing <see cref="SocketServer"/> in the same process, and reports the requests per
+	/// second and the most sockets the server held open for each.
+	/// </summary>
+	class Program
+	{
+		private const short _commandId = 1;
+		private const int _payloadSize = 256;
+		private const int _maxPendingRequests = 16384;
+
+		static int Main(string[] args)
+		{
+			int port = 9700;
+			int requests = 200000;
+			int concurrency = 256;
+			if (args.Length > 3
+				|| (args.Length > 0 && !int.TryParse(args[0], out port))
+				|| (args.Length > 1 && !int.TryParse(args[1], out requests))
+				|| (args.Length > 2 && !int.TryParse(args[2], out concurrency))
+				|| requests < 1 || concurrency < 1 || concurrency > _maxPendingRequests)
+			{
+				Console.WriteLine("Usage: MySpace.SocketTransport.MultiplexBenchmark [port] [requests] [concurrency, at most {0}]",
+					_maxPendingRequests);
+				return 1;
+			}
+
+			var server = new SocketServer("MultiplexBenchmark", port) { MessageHandler = new EchoHandler() };
+			server.Start();
+			try
+			{
+				var endPoint = new IPEndPoint(IPAddress.Loopback, port);
+				// the pool keeps as many connections as there are requests in flight, so none are
+				// closed and reopened between requests
+				var pooledRate = Run("Pooled", server, endPoint,
+					new SocketPoolConfig { PoolCapacity = concurrency },
+					requests, concurrency);
+				WaitForDisconnects(server);
+				var multiplexedRate = Run("Multiplexed", server, endPoint,
+					new SocketPoolConfig
+					{
+						Multiplexed = true,
+						MultiplexedConnections = 1,
+						MaxPendingRequests = Math.Max(concurrency, new SocketPoolConfig().MaxPendingRequests)
+					},
+					requests, concurrency);
+				Console.WriteLine("Multiplexed round trips are {0:F1}x pooled",
+					pooledRate > 0 ? multiplexedRate / pooledRate : 0);
+			}
+			finally
+			{
+				server.Stop();
+			}
+			return 0;
+		}
+
+		static double Run(string method, SocketServer server, IPEndPoint endPoint, SocketPoolConfig config,
+			int requests, int concurrency)
+		{
+			var payload = new byte[_payloadSize];
+			int issued = 0;
+			int failures = 0;
+			int peakSockets = 0;
+			using (var remaining = new CountdownEvent(requests))
+			using (var client = new AsyncSocketClient(endPoint, config))
+			{
+				Action sendNext = null;
+				Action<RoundTripAsyncEventArgs> onReply = e =>
+				{
+					if (e.Error != null) Interlocked.Increment(ref failures);
+					remaining.Signal();
+					if (e.CompletedSynchronously)
+					{
+						// keeps a run of synchronous completions from growing the stack
+						ThreadPool.QueueUserWorkItem(o => sendNext());
+					}
+					else
+					{
+						sendNext();
+					}
+				};
+				sendNext = () =>
+				{
+					if (Interlocked.Increment(ref issued) > requests) return;
+					try
+					{
+						client.SendRoundTripAsync(_commandId, payload, WritePayload, onReply);
+					}
+					catch (Exception)
+					{
+						Interlocked.Increment(ref failures);
+						remaining.Signal();
+						ThreadPool.QueueUserWorkItem(o => sendNext());
+					}
+				};
+
+				var watch = Stopwatch.StartNew();
+				for (var i = 0; i < Math.Min(concurrency, requests); ++i)
+				{
+					ThreadPool.QueueUserWorkItem(o => sendNext());
+				}
+				while (!remaining.Wait(10))
+				{
+					peakSockets = Math.Max(peakSockets, server.ConnectionCount);
+				}
+				watch.Stop();
+				peakSockets = Math.Max(peakSockets, server.ConnectionCount);
+
+				var rate = requests / Math.Max(watch.Elapsed.TotalSeconds, 0.001);
+				Console.WriteLine("{0}: {1} round trips, {2} failed, {3} in flight in {4} ms ({5:F0} requests/s, {6} sockets)",
+					method, requests, failures, concurrency, watch.ElapsedMilliseconds, rate, peakSockets);
+				return rate;
+			}
+		}
+
+		static void WritePayload(byte[] payload, Stream stream)
+		{
+			stream.Write(payload, 0, payload.Length);
+		}
+
+		// Lets the server notice the closed connections of one run before the next is counted.
+		static void WaitForDisconnects(SocketServer server)
+		{
+			for (var waits = 0; waits < 50 && server.ConnectionCount > 0; ++waits)
+			{
+				Thread.Sleep(100);
+			}
+		}
+
+		private class EchoHandler : IMessageHandler
+		{
+			public MemoryStream HandleMessage(int commandID, MemoryStream messageStream, int messageLength)
+			{
+				var reply = new MemoryStream(messageLength);
+				var buffer = new byte[messageLength];
+				var read = messageStream.Read(buffer, 0, messageLength);
+				reply.Write(buffer, 0, read);
+				reply.Seek(0, SeekOrigin.Begin);
+				return reply;
+			}
+		}
+	}
+}
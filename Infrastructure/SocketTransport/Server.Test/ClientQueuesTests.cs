@@ -0,0 +1,91 @@
+﻿using System.Net;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.SocketTransport.Server.Test
+{
+	[TestClass]
+	public class ClientQueuesTests
+	{
+		private static readonly IPAddress _first = IPAddress.Parse("10.0.0.1");
+		private static readonly IPAddress _second = IPAddress.Parse("10.0.0.2");
+
+		private static void Enter(ClientQueues queues, IPAddress client, int count)
+		{
+			for (var i = 0; i < count; ++i)
+			{
+				queues.Enter(client);
+			}
+		}
+
+		[TestMethod]
+		public void ClientWithNothingQueuedHasNoShare()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 10);
+
+			Assert.IsFalse(queues.HasFairShare(_second, 10));
+		}
+
+		[TestMethod]
+		public void LoneClientHasFairShareAtCapacity()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 9);
+
+			Assert.IsFalse(queues.HasFairShare(_first, 10));
+			queues.Enter(_first);
+			Assert.IsTrue(queues.HasFairShare(_first, 10));
+		}
+
+		[TestMethod]
+		public void ShareIsSplitBetweenQueuedClients()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 5);
+			Enter(queues, _second, 1);
+
+			// two clients with something queued share 10 slots 5 each
+			Assert.IsTrue(queues.HasFairShare(_first, 10));
+			Assert.IsFalse(queues.HasFairShare(_second, 10));
+		}
+
+		[TestMethod]
+		public void ExitGivesShareBack()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 5);
+			Enter(queues, _second, 1);
+
+			queues.Exit(_first);
+
+			Assert.IsFalse(queues.HasFairShare(_first, 10));
+		}
+
+		[TestMethod]
+		public void ClientThatEmptiesIsForgotten()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 3);
+			Enter(queues, _second, 1);
+
+			queues.Exit(_second);
+			// with the second client gone the first has all 4 slots to itself
+			Assert.IsFalse(queues.HasFairShare(_first, 4));
+			queues.Exit(_second);
+			queues.Enter(_first);
+
+			Assert.IsTrue(queues.HasFairShare(_first, 4));
+		}
+
+		[TestMethod]
+		public void ShareIsAtLeastOne()
+		{
+			var queues = new ClientQueues();
+			Enter(queues, _first, 1);
+			Enter(queues, _second, 1);
+
+			// more clients than capacity still leaves each one slot
+			Assert.IsTrue(queues.HasFairShare(_first, 1));
+		}
+	}
+}
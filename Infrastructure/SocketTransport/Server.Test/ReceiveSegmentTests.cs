@@ -0,0 +1,69 @@
+﻿using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.ResourcePool;
+
+namespace MySpace.SocketTransport.Server.Test
+{
+	/// <summary>
+	/// Tests that a <see cref="ReceiveSegment"/> goes back to its pool only once the connection
+	/// and every message read from it have let go.
+	/// </summary>
+	[TestClass]
+	public class ReceiveSegmentTests
+	{
+		private const int _size = 64;
+
+		private int _built;
+		private ResourcePool<ReceiveSegment> _pool;
+
+		[TestInitialize]
+		public void TestInitialize()
+		{
+			_built = 0;
+			_pool = new ResourcePool<ReceiveSegment>(() =>
+			{
+				++_built;
+				return new ReceiveSegment(_size);
+			});
+		}
+
+		[TestMethod]
+		public void AcquiredSegmentIsExclusive()
+		{
+			var segment = ReceiveSegment.Acquire(_pool);
+
+			Assert.IsTrue(segment.IsExclusive);
+			Assert.AreEqual(_size, segment.Buffer.Length);
+		}
+
+		[TestMethod]
+		public void MessageReadingTheSegmentEndsExclusivity()
+		{
+			var segment = ReceiveSegment.Acquire(_pool);
+
+			segment.AddReference();
+			Assert.IsFalse(segment.IsExclusive);
+
+			segment.Release();
+			Assert.IsTrue(segment.IsExclusive);
+		}
+
+		[TestMethod]
+		public void SegmentIsPooledAfterTheLastRelease()
+		{
+			var segment = ReceiveSegment.Acquire(_pool);
+			segment.AddReference();
+
+			// the connection lets go while a message still reads from the segment
+			segment.Release();
+			var other = ReceiveSegment.Acquire(_pool);
+			Assert.AreNotSame(segment, other);
+			Assert.AreEqual(2, _built);
+
+			segment.Release();
+			var reused = ReceiveSegment.Acquire(_pool);
+			Assert.AreSame(segment, reused);
+			Assert.AreEqual(2, _built);
+			Assert.IsTrue(reused.IsExclusive);
+		}
+	}
+}
@@ -0,0 +1,136 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using MySpace.ResourcePool;
+
+namespace MySpace.SocketTransport.Server.Test
+{
+	[TestClass]
+	public class ReplyBatchTests
+	{
+		private const int _budget = 100;
+
+		private readonly MemoryStreamPool _buffers = new MemoryStreamPool(64);
+		private Socket _socket;
+		private ReplyBatch _batch;
+
+		[TestInitialize]
+		public void TestInitialize()
+		{
+			_socket = new Socket(AddressFamily.InterNetwork, SocketType.Stream, ProtocolType.Tcp);
+			_batch = new ReplyBatch(_socket, new IPEndPoint(IPAddress.Loopback, 1), _budget);
+		}
+
+		[TestCleanup]
+		public void TestCleanup()
+		{
+			_socket.Close();
+		}
+
+		// A reply of size bytes, each set to fill.
+		private ProcessState Reply(int size, byte fill)
+		{
+			var state = new ProcessState(_socket, 1, 1, ReplyType.SendReply, null, 0);
+			state.ReplyBuffer = _buffers.GetItem();
+			for (var i = 0; i < size; ++i)
+			{
+				state.ReplyBuffer.Item.WriteByte(fill);
+			}
+			state.ReplySize = size;
+			return state;
+		}
+
+		private bool Enqueue(ProcessState state)
+		{
+			bool accepted;
+			var startSending = _batch.Enqueue(state, out accepted);
+			Assert.IsTrue(accepted);
+			return startSending;
+		}
+
+		[TestMethod]
+		public void FirstReplyStartsSendingAndLaterOnesWait()
+		{
+			Assert.IsTrue(Enqueue(Reply(10, 1)));
+			Assert.IsFalse(Enqueue(Reply(10, 2)));
+			Assert.IsFalse(Enqueue(Reply(10, 3)));
+		}
+
+		[TestMethod]
+		public void QueuedRepliesGoOutTogetherInOrder()
+		{
+			var replies = new[] { Reply(10, 1), Reply(20, 2), Reply(30, 3) };
+			foreach (var reply in replies)
+			{
+				Enqueue(reply);
+			}
+
+			var buffers = _batch.TakeBatch();
+
+			Assert.AreEqual(3, buffers.Count);
+			CollectionAssert.AreEqual(replies, _batch.InFlight);
+			for (var i = 0; i < replies.Length; ++i)
+			{
+				Assert.AreEqual(replies[i].ReplySize, buffers[i].Count);
+				Assert.AreEqual((byte)(i + 1), buffers[i].Array[buffers[i].Offset]);
+			}
+		}
+
+		[TestMethod]
+		public void BatchStopsAtTheByteBudget()
+		{
+			Enqueue(Reply(60, 1));
+			Enqueue(Reply(40, 2));
+			Enqueue(Reply(1, 3));
+
+			Assert.AreEqual(2, _batch.TakeBatch().Count);
+			var rest = _batch.TakeBatch();
+			Assert.AreEqual(1, rest.Count);
+			Assert.AreEqual(1, rest[0].Count);
+		}
+
+		[TestMethod]
+		public void ReplyLargerThanTheBudgetGoesOutAlone()
+		{
+			Enqueue(Reply(_budget * 2, 1));
+			Enqueue(Reply(10, 2));
+
+			var first = _batch.TakeBatch();
+			Assert.AreEqual(1, first.Count);
+			Assert.AreEqual(_budget * 2, first[0].Count);
+			Assert.AreEqual(1, _batch.TakeBatch().Count);
+		}
+
+		[TestMethod]
+		public void EmptyQueueEndsSendingUntilTheNextReply()
+		{
+			Enqueue(Reply(10, 1));
+			_batch.TakeBatch();
+
+			Assert.IsNull(_batch.TakeBatch());
+			Assert.AreEqual(0, _batch.InFlight.Count);
+			Assert.IsTrue(Enqueue(Reply(10, 2)), "The next reply must start sending again.");
+		}
+
+		[TestMethod]
+		public void FailHandsBackEveryUnsentReplyAndRefusesMore()
+		{
+			var inFlight = Reply(60, 1);
+			var queued = Reply(60, 2);
+			Enqueue(inFlight);
+			Enqueue(queued);
+			_batch.TakeBatch();
+
+			List<ProcessState> unsent = _batch.Fail();
+
+			CollectionAssert.AreEqual(new[] { inFlight, queued }, unsent);
+			Assert.AreEqual(0, _batch.InFlight.Count);
+			bool accepted;
+			Assert.IsFalse(_batch.Enqueue(Reply(10, 3), out accepted));
+			Assert.IsFalse(accepted, "A failed connection leaves the buffer with the caller.");
+		}
+	}
+}
@@ -0,0 +1,88 @@
+﻿using System;
+using System.Net;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+
+namespace MySpace.SocketTransport.Server.Test
+{
+	[TestClass]
+	public class ServerMessageTests
+	{
+		private static readonly byte[] _busyMarker = new byte[] { 241, 216, 254, 255 };
+		private static readonly byte[] _emptyMarker = new byte[] { 241, 216, 255, 255 };
+
+		// A busy reply's body, as the server writes it, at offset in a larger buffer.
+		private static byte[] BusyBody(int offset, int retryAfterMilliseconds, bool networkOrdered)
+		{
+			var buffer = new byte[offset + _busyMarker.Length + sizeof(int) + 3];
+			Buffer.BlockCopy(_busyMarker, 0, buffer, offset, _busyMarker.Length);
+			var retry = BitConverter.GetBytes(networkOrdered ? IPAddress.HostToNetworkOrder(retryAfterMilliseconds) : retryAfterMilliseconds);
+			Buffer.BlockCopy(retry, 0, buffer, offset + _busyMarker.Length, retry.Length);
+			return buffer;
+		}
+
+		[TestMethod]
+		public void BusyReplyCarriesRetryAfter()
+		{
+			int retry;
+
+			Assert.IsTrue(ServerMessage.IsBusyMessage(BusyBody(0, 250, false), 0, ServerMessage.BusyReplyMessageLength, false, out retry));
+			Assert.AreEqual(250, retry);
+		}
+
+		[TestMethod]
+		public void BusyReplyRetryAfterIsReadInNetworkOrder()
+		{
+			int retry;
+
+			Assert.IsTrue(ServerMessage.IsBusyMessage(BusyBody(5, 1000, true), 5, ServerMessage.BusyReplyMessageLength, true, out retry));
+			Assert.AreEqual(1000, retry);
+		}
+
+		[TestMethod]
+		public void BusyReplyLengthIsHeaderMarkerAndRetry()
+		{
+			Assert.AreEqual(ServerMessage.HeaderSize + 8, ServerMessage.BusyReplyMessageLength);
+			Assert.AreNotEqual(ServerMessage.EmptyReplyMessageLength, ServerMessage.BusyReplyMessageLength);
+		}
+
+		[TestMethod]
+		public void MessageOfOtherLengthIsNotBusy()
+		{
+			int retry;
+
+			Assert.IsFalse(ServerMessage.IsBusyMessage(BusyBody(0, 250, false), 0, ServerMessage.BusyReplyMessageLength + 1, false, out retry));
+			Assert.AreEqual(0, retry);
+		}
+
+		[TestMethod]
+		public void MessageWithOtherBytesIsNotBusy()
+		{
+			var body = BusyBody(0, 250, false);
+			body[2] = 0;
+			int retry;
+
+			Assert.IsFalse(ServerMessage.IsBusyMessage(body, 0, ServerMessage.BusyReplyMessageLength, false, out retry));
+		}
+
+		[TestMethod]
+		public void TruncatedBufferIsNotBusy()
+		{
+			var body = BusyBody(0, 250, false);
+			int retry;
+
+			Assert.IsFalse(ServerMessage.IsBusyMessage(body, body.Length - 6, ServerMessage.BusyReplyMessageLength, false, out retry));
+		}
+
+		[TestMethod]
+		public void EmptyAndBusyRepliesAreDistinct()
+		{
+			var empty = new byte[_emptyMarker.Length + sizeof(int)];
+			Buffer.BlockCopy(_emptyMarker, 0, empty, 0, _emptyMarker.Length);
+			int retry;
+
+			Assert.IsTrue(ServerMessage.IsEmptyMessage(empty, 0, ServerMessage.EmptyReplyMessageLength));
+			Assert.IsFalse(ServerMessage.IsBusyMessage(empty, 0, ServerMessage.BusyReplyMessageLength, false, out retry));
+			Assert.IsFalse(ServerMessage.IsEmptyMessage(BusyBody(0, 250, false), 0, ServerMessage.BusyReplyMessageLength));
+		}
+	}
+}
@@ -0,0 +1,56 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// Tracks how many queued messages each client address has, so that a busy server can
+	/// refuse a client holding more than its share while still admitting the others.
+	/// </summary>
+	internal class ClientQueues
+	{
+		private readonly Dictionary<IPAddress, int> depths = new Dictionary<IPAddress, int>();
+
+		/// <summary>
+		/// Gets whether <paramref name="client"/> already has at least an even share of
+		/// <paramref name="capacity"/> queued.
+		/// </summary>
+		public bool HasFairShare(IPAddress client, int capacity)
+		{
+			lock (depths)
+			{
+				int depth;
+				if (!depths.TryGetValue(client, out depth)) return false;
+				return depth >= Math.Max(1, capacity / depths.Count);
+			}
+		}
+
+		public void Enter(IPAddress client)
+		{
+			lock (depths)
+			{
+				int depth;
+				depths.TryGetValue(client, out depth);
+				depths[client] = depth + 1;
+			}
+		}
+
+		public void Exit(IPAddress client)
+		{
+			lock (depths)
+			{
+				int depth;
+				if (!depths.TryGetValue(client, out depth)) return;
+				if (depth <= 1)
+				{
+					depths.Remove(client);
+				}
+				else
+				{
+					depths[client] = depth - 1;
+				}
+			}
+		}
+	}
+}
@@ -94,6 +94,17 @@ namespace MySpace.SocketTransport
 		}
 		
 
+		public ConnectionState[] GetConnectionStates()
+		{
+			ConnectionState[] values = null;
+			connectionsLock.Read(delegate
+			{
+				values = new ConnectionState[connections.Count];
+				connections.Values.CopyTo(values, 0);
+			});
+			return values;
+		}
+
 		public void CheckConnections()
 		{
 			IPEndPoint[] keys = null;			
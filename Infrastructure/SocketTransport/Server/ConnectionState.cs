@@ -4,6 +4,7 @@ using System.Text;
 using System.IO;
 using System.Net.Sockets;
 using System.Net;
+using MySpace.ResourcePool;
 
 namespace MySpace.SocketTransport
 {
@@ -75,6 +76,32 @@ namespace MySpace.SocketTransport
 
 		public MemoryStream messageBuffer;
 
+		//segmented receive state, used instead of networkBuffer and messageBuffer when SocketServerConfig.SegmentedReceive is set
+		internal SocketAsyncEventArgs receiveArgs;
+		internal ReceiveSegment segment;
+		internal int frameStart; //where the next unread message starts in segment
+		internal int receiveEnd; //where received data ends in segment
+		internal ResourcePoolItem<MemoryStream> overflowBuffer; //collects a message too big for a segment
+		internal int overflowSize;
+		internal int skipRemaining; //bytes left of a discarded too big message
+		internal bool segmented; //whether the connection receives into segments
+
+		internal bool pauseRequested; //stop reading once the current receive is handled
+		internal Queue<ProcessState> heldMessages; //read while the queues were full, posted in order once they drain
+		internal ConnectionStatistics statistics;
+		internal ReplyBatch replies; //coalesces replies when batching is on
+
+		/// <summary>
+		/// Gets the admission control counters for the connection.
+		/// </summary>
+		public ConnectionStatistics Statistics
+		{
+			get
+			{
+				return statistics;
+			}
+		}
+
 		public ConnectionState(int bufferSize, int initialMessageSize)
 		{
 			this.bufferSize = bufferSize;
@@ -114,6 +141,10 @@ namespace MySpace.SocketTransport
 					{
 						messageBuffer.Dispose();
 					}
+					if (receiveArgs != null)
+					{
+						receiveArgs.Dispose();
+					}
 					try
 					{
 						if (workSocket != null)
@@ -0,0 +1,69 @@
+﻿using System;
+using System.Net;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// Counts how the messages from one connection fared under the <see cref="SocketServer"/>'s
+	/// admission control.
+	/// </summary>
+	public class ConnectionStatistics
+	{
+		internal int queueDepth;
+		internal long admitted;
+		internal long rejected;
+		internal long pauses;
+		internal volatile bool paused;
+
+		internal ConnectionStatistics(IPEndPoint remoteEndPoint)
+		{
+			RemoteEndPoint = remoteEndPoint;
+		}
+
+		/// <summary>
+		/// Gets the client end of the connection.
+		/// </summary>
+		public IPEndPoint RemoteEndPoint { get; private set; }
+
+		/// <summary>
+		/// Gets the number of messages from the connection that are queued or being handled.
+		/// </summary>
+		public int QueueDepth
+		{
+			get { return queueDepth; }
+		}
+
+		/// <summary>
+		/// Gets the number of messages from the connection that were queued.
+		/// </summary>
+		public long Admitted
+		{
+			get { return admitted; }
+		}
+
+		/// <summary>
+		/// Gets the number of messages from the connection that were answered with a busy reply
+		/// instead of being handled.
+		/// </summary>
+		public long Rejected
+		{
+			get { return rejected; }
+		}
+
+		/// <summary>
+		/// Gets the number of times reading from the connection was paused to let the queues drain.
+		/// </summary>
+		public long Pauses
+		{
+			get { return pauses; }
+		}
+
+		/// <summary>
+		/// Gets whether reading from the connection is paused until the queues drain.
+		/// </summary>
+		public bool IsPaused
+		{
+			get { return paused; }
+		}
+	}
+}
@@ -17,6 +17,8 @@ namespace MySpace.SocketTransport
 		/// <summary>
 		/// Gets the <see cref="MemoryStream"/> containing a complete message.
 		/// </summary>
+		/// <remarks>The stream may be a read only view over a receive buffer shared with other
+		/// messages, and is only valid until the handler returns.</remarks>
 		public MemoryStream Message { get; internal set; }
 
 		/// <summary>
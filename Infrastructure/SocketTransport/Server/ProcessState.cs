@@ -21,18 +21,25 @@ namespace MySpace.SocketTransport
 		internal readonly short CommandId;
 		internal readonly short MessageId;
 		internal readonly ReplyType ReplyType;
-		internal ResourcePoolItem<MemoryStream> Message;
+		internal MemoryStream MessageStream; //what the handler reads
+		internal ResourcePoolItem<MemoryStream> Message; //pooled buffer behind MessageStream, if any
+		internal ReceiveSegment Segment; //receive segment MessageStream is a view over, if any
 		internal readonly int MessageLength;
 		internal readonly IPEndPoint RemoteEndpoint; //when there's an error, the socket loses track of it.		
 		internal ResourcePoolItem<MemoryStream> ReplyBuffer; //for the reply + header
+		internal int ReplySize; //bytes of ReplyBuffer to send
+		internal ReplyBatch Replies; //of the connection, when replies are batched
+		internal ConnectionStatistics Statistics; //of the connection the message was admitted from
+		internal IPAddress Client; //address counted in the client queues while admitted
+		internal int Finished; //set once the admission has been given back
 
-		internal ProcessState(Socket socket, short commandId, short messageId, ReplyType replyType, ResourcePoolItem<MemoryStream> message, int messageLength)
+		internal ProcessState(Socket socket, short commandId, short messageId, ReplyType replyType, MemoryStream messageStream, int messageLength)
 		{
 			Socket = socket;
 			CommandId = commandId;
 			MessageId = messageId;
 			ReplyType = replyType;
-			Message = message;
+			MessageStream = messageStream;
 			MessageLength = messageLength;
 			RemoteEndpoint = (IPEndPoint)socket.RemoteEndPoint;
 		}
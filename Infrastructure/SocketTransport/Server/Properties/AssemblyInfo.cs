@@ -34,3 +34,4 @@ using System.Runtime.InteropServices;
 [assembly: AssemblyVersion("2.4.1.0")]
 [assembly: AssemblyFileVersion("2.4.1.0")]
 [assembly: InternalsVisibleTo("MySpace.DataRelay.RelayNode.Test")]
+[assembly: InternalsVisibleTo("MySpace.SocketTransport.Server.Test")]
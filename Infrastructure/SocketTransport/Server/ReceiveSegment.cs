@@ -0,0 +1,59 @@
+﻿using System;
+using System.Threading;
+using MySpace.ResourcePool;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// A pooled receive buffer that messages are framed from in place. The connection
+	/// receiving into it holds one reference, and so does every message handed to a
+	/// handler that reads from it; the segment goes back to its pool when the last
+	/// reference is released.
+	/// </summary>
+	internal sealed class ReceiveSegment
+	{
+		internal readonly byte[] Buffer;
+		private ResourcePoolItem<ReceiveSegment> owner;
+		private int references;
+
+		internal ReceiveSegment(int size)
+		{
+			Buffer = new byte[size];
+		}
+
+		/// <summary>
+		/// Takes a segment from <paramref name="pool"/> holding the caller's reference.
+		/// </summary>
+		internal static ReceiveSegment Acquire(ResourcePool<ReceiveSegment> pool)
+		{
+			ResourcePoolItem<ReceiveSegment> item = pool.GetItem();
+			ReceiveSegment segment = item.Item;
+			segment.owner = item;
+			segment.references = 1;
+			return segment;
+		}
+
+		/// <summary>
+		/// Gets whether the caller's reference is the only one, so nothing else reads from the buffer.
+		/// </summary>
+		internal bool IsExclusive
+		{
+			get { return Thread.VolatileRead(ref references) == 1; }
+		}
+
+		internal void AddReference()
+		{
+			Interlocked.Increment(ref references);
+		}
+
+		internal void Release()
+		{
+			if (Interlocked.Decrement(ref references) == 0)
+			{
+				ResourcePoolItem<ReceiveSegment> item = owner;
+				owner = null;
+				item.Release();
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+
+namespace MySpace.SocketTransport
+{
+	/// <summary>
+	/// Coalesces the replies to one connection. While a send to the connection is in flight,
+	/// replies that complete are queued, and when it finishes they all go out in a single
+	/// gathered send over their own reply buffers.
+	/// </summary>
+	internal sealed class ReplyBatch
+	{
+		internal readonly Socket Socket;
+		internal readonly IPEndPoint RemoteEndpoint;
+		private readonly int byteBudget;
+		private readonly Queue<ProcessState> pending = new Queue<ProcessState>();
+		private readonly List<ProcessState> inFlight = new List<ProcessState>();
+		private readonly List<ArraySegment<byte>> buffers = new List<ArraySegment<byte>>();
+		private bool sending;
+		private bool failed;
+
+		internal ReplyBatch(Socket socket, IPEndPoint remoteEndpoint, int byteBudget)
+		{
+			Socket = socket;
+			RemoteEndpoint = remoteEndpoint;
+			this.byteBudget = byteBudget;
+		}
+
+		/// <summary>
+		/// Gets the replies of the send in flight.
+		/// </summary>
+		internal List<ProcessState> InFlight
+		{
+			get { return inFlight; }
+		}
+
+		/// <summary>
+		/// Queues a reply whose <see cref="ProcessState.ReplyBuffer"/> is ready.
+		/// </summary>
+		/// <returns><see langword="true"/> if the caller should start sending; <see langword="false"/>
+		/// if a send already in flight will pick the reply up, or if the connection failed, in which
+		/// case <paramref name="accepted"/> is <see langword="false"/> and the caller keeps the buffer.</returns>
+		internal bool Enqueue(ProcessState state, out bool accepted)
+		{
+			lock (pending)
+			{
+				if (failed)
+				{
+					accepted = false;
+					return false;
+				}
+				accepted = true;
+				pending.Enqueue(state);
+				if (sending) return false;
+				sending = true;
+				return true;
+			}
+		}
+
+		/// <summary>
+		/// Moves queued replies into <see cref="InFlight"/>, at least one and then up to the
+		/// byte budget, and returns their buffers; <see langword="null"/> when nothing is queued,
+		/// which ends sending until the next <see cref="Enqueue"/>.
+		/// </summary>
+		internal IList<ArraySegment<byte>> TakeBatch()
+		{
+			inFlight.Clear();
+			buffers.Clear();
+			lock (pending)
+			{
+				int bytes = 0;
+				while (pending.Count > 0 && (bytes == 0 || bytes + pending.Peek().ReplySize <= byteBudget))
+				{
+					ProcessState state = pending.Dequeue();
+					inFlight.Add(state);
+					bytes += state.ReplySize;
+				}
+				if (inFlight.Count == 0)
+				{
+					sending = false;
+					return null;
+				}
+			}
+			foreach (ProcessState state in inFlight)
+			{
+				buffers.Add(new ArraySegment<byte>(state.ReplyBuffer.Item.GetBuffer(), 0, state.ReplySize));
+			}
+			return buffers;
+		}
+
+		/// <summary>
+		/// Stops sending and hands back every reply not yet sent, including those in flight.
+		/// </summary>
+		internal List<ProcessState> Fail()
+		{
+			lock (pending)
+			{
+				failed = true;
+				sending = false;
+				List<ProcessState> unsent = new List<ProcessState>(inFlight);
+				unsent.AddRange(pending);
+				pending.Clear();
+				inFlight.Clear();
+				buffers.Clear();
+				return unsent;
+			}
+		}
+	}
+}
@@ -1,4 +1,5 @@
 using System;
+using System.Collections.Generic;
 using System.Configuration;
 using System.Diagnostics;
 using System.IO;
@@ -68,6 +69,17 @@ namespace MySpace.SocketTransport
 		protected ResourcePool<ConnectionState> connectionStatePool;
 		protected ResourcePool<ConnectionState>.BuildItemDelegate buildConnectionStateDelegate;
 		protected ResourcePool<ConnectionState>.ResetItemDelegate resetConnectionStateDelegate;
+		private ResourcePool<ReceiveSegment> receiveSegmentPool;
+		private EventHandler<SocketAsyncEventArgs> segmentReceiveCompleted;
+
+		protected Byte[] busyReplyBytes = { 241, 216, 254, 255 }; //followed by the retry after milliseconds
+		private readonly ClientQueues clientQueues = new ClientQueues();
+		private readonly Queue<ResourcePoolItem<ConnectionState>> pausedConnections = new Queue<ResourcePoolItem<ConnectionState>>();
+		private int pausedCount;
+		private WaitCallback resumeReceive;
+
+		private AsyncCallback batchReplyCallBack;
+		private WaitCallback sendBatch;
 
 		protected AsyncCallback replyCallBack;
 
@@ -94,6 +106,10 @@ namespace MySpace.SocketTransport
 			this.portNumber = portNumber;
 			acceptCallBack = AcceptCallBack;
 			receiveCallBack = ReceiveCallBack;
+			segmentReceiveCompleted = SegmentReceiveCompleted;
+			resumeReceive = ResumeReceive;
+			batchReplyCallBack = BatchReplyCallback;
+			sendBatch = o => SendBatch((ReplyBatch)o);
 			replyCallBack = SendReplyCallback;
 
 			emptyReplyStream = new MemoryStream(4);
@@ -223,7 +239,11 @@ namespace MySpace.SocketTransport
 			"Free Worker Threads",
 			"Free Completion Threads",
 			"Active Worker Threads",
-			"Active Completion Port Threads"
+			"Active Completion Port Threads",
+			"Requests Rejected Per Sec",
+			"Paused Connections",
+			"Avg Replies Per Send",
+			"Avg Replies Per Send Base"
 		};
 		public static readonly string[] PerformanceCounterHelp =
 		{
@@ -238,7 +258,11 @@ namespace MySpace.SocketTransport
 			"The number of free worker threads available.",
 			"The number of free completion port threads available.",
 			"The number of active worker threads.",
-			"The number of active completion port threads."
+			"The number of active completion port threads.",
+			"The number of sync messages per second answered with a busy reply because the queues were full.",
+			"The number of connections not being read until the queues drain.",
+			"Average number of replies gathered into one send when replies are batched.",
+			"Base for average replies per send."
 		};
 		public static readonly PerformanceCounterType[] PerformanceCounterTypes =
 		{
@@ -253,7 +277,11 @@ namespace MySpace.SocketTransport
 			PerformanceCounterType.NumberOfItems32,
 			PerformanceCounterType.NumberOfItems32,
 			PerformanceCounterType.NumberOfItems32,
-			PerformanceCounterType.NumberOfItems32
+			PerformanceCounterType.NumberOfItems32,
+			PerformanceCounterType.RateOfCountsPerSecond32,
+			PerformanceCounterType.NumberOfItems32,
+			PerformanceCounterType.AverageCount64,
+			PerformanceCounterType.AverageBase
 		};
 
 		protected PerformanceCounter socketCountCounter;
@@ -273,6 +301,12 @@ namespace MySpace.SocketTransport
 		protected PerformanceCounter activeWorkerThreadCounter;
 		protected PerformanceCounter activeCompletionThreadCounter;
 
+		protected PerformanceCounter requestsRejectedCounter;
+		protected PerformanceCounter pausedConnectionsCounter;
+
+		protected PerformanceCounter avgRepliesPerSend;
+		protected PerformanceCounter avgRepliesPerSendBase;
+
 		protected string instanceName;
 
 		public string InstanceName
@@ -550,6 +584,8 @@ namespace MySpace.SocketTransport
 			connectionStatePool = new ResourcePool<ConnectionState>(buildConnectionStateDelegate, resetConnectionStateDelegate);
 			connectionStatePool.MaxItemReuses = config.ConnectionStateReuses;
 
+			receiveSegmentPool = new ResourcePool<ReceiveSegment>(BuildReceiveSegment);
+
 			listener = new Socket(AddressFamily.InterNetwork, SocketType.Stream, ProtocolType.Tcp);
 
 			connections = new ConnectionList(socketCountCounter);
@@ -648,6 +684,13 @@ namespace MySpace.SocketTransport
 				{
 					activeWorkerThreadCounter = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[10], InstanceName, false);
 					activeCompletionThreadCounter = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[11], InstanceName, false);
+					requestsRejectedCounter = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[12], InstanceName, false);
+					pausedConnectionsCounter = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[13], InstanceName, false);
+					pausedConnectionsCounter.RawValue = 0;
+					avgRepliesPerSend = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[14], InstanceName, false);
+					avgRepliesPerSendBase = new PerformanceCounter(SocketServer.PerformanceCategoryName, SocketServer.PerformanceCounterNames[15], InstanceName, false);
+					avgRepliesPerSend.RawValue = 0;
+					avgRepliesPerSendBase.RawValue = 0;
 				}
 				catch (Exception ex)
 				{
@@ -794,6 +837,7 @@ namespace MySpace.SocketTransport
 					avgHandlerTime.IncrementBy(Stopwatch.GetTimestamp() - lastReading);
 					CountAvailableThreads();
 					CountQueuedTasks();
+					ResumeConnections();
 				}
 			}
 			catch (Exception exc)
@@ -868,8 +912,21 @@ namespace MySpace.SocketTransport
 				ResourcePoolItem<ConnectionState> connectionStateItem = connectionStatePool.GetItem();
 				ConnectionState connectionState = connectionStateItem.Item;
 				connectionState.WorkSocket = connection;
+				connectionState.statistics = new ConnectionStatistics(connectionState.remoteEndPoint);
+				connectionState.segmented = config.SegmentedReceive;
+				if (config.BatchReplies)
+				{
+					connectionState.replies = new ReplyBatch(connectionState.ReplySocket, connectionState.remoteEndPoint, config.ReplyBatchBytes);
+				}
 				connections.Add(connectionState);
-				connection.BeginReceive(connectionState.networkBuffer, 0, connectionState.BufferSize, SocketFlags.None, receiveCallBack, connectionStateItem);
+				if (connectionState.segmented)
+				{
+					StartSegmentedReceive(connectionStateItem);
+				}
+				else
+				{
+					connection.BeginReceive(connectionState.networkBuffer, 0, connectionState.BufferSize, SocketFlags.None, receiveCallBack, connectionStateItem);
+				}
 			}
 			catch (SocketException sex)
 			{
@@ -916,6 +973,12 @@ namespace MySpace.SocketTransport
 			state.ReplySocket = null;
 			state.remoteEndPoint = null;
 			ResetConnectionStateMessageBuffer(state);
+			ResetConnectionStateSegments(state);
+			state.segmented = false;
+			state.pauseRequested = false;
+			ReleaseHeldMessages(state);
+			state.statistics = null;
+			state.replies = null;
 		}
 
 		private void ResetConnectionStateMessageBuffer(ConnectionState state)
@@ -936,11 +999,16 @@ namespace MySpace.SocketTransport
 
 
 		protected bool CheckForMessageStarter(byte[] networkBuffer)
+		{
+			return CheckForMessageStarter(networkBuffer, 0);
+		}
+
+		protected bool CheckForMessageStarter(byte[] networkBuffer, int offset)
 		{
 			byte[] messageStarterBytes = (useNetworkOrder ? this.messageStarterBytesNetwork : this.messageStarterBytesHost);
 			for (int i = 0; i < messageStarterBytes.Length; i++)
 			{
-				if (networkBuffer[i] != messageStarterBytes[i])
+				if (networkBuffer[offset + i] != messageStarterBytes[i])
 				{
 					return false;
 				}
@@ -949,11 +1017,16 @@ namespace MySpace.SocketTransport
 		}
 
 		protected bool CheckForMessageTerminator(byte[] buffer, int messageSize)
+		{
+			return CheckForMessageTerminator(buffer, 0, messageSize);
+		}
+
+		protected bool CheckForMessageTerminator(byte[] buffer, int offset, int messageSize)
 		{
 			byte[] messageTerminatorBytes = (useNetworkOrder ? this.messageTerminatorBytesNetwork : this.messageTerminatorBytesHost);
 			for (int i = 0; i < messageTerminatorBytes.Length; i++)
 			{
-				if (buffer[messageSize - messageTerminatorBytes.Length + i] != messageTerminatorBytes[i])
+				if (buffer[offset + messageSize - messageTerminatorBytes.Length + i] != messageTerminatorBytes[i])
 				{
 					return false;
 				}
@@ -1073,7 +1146,11 @@ namespace MySpace.SocketTransport
 						}
 					}
 
-					if (connection.Connected)
+					if (state.pauseRequested)
+					{
+						PauseConnection(stateItem);
+					}
+					else if (connection.Connected)
 					{
 						connection.BeginReceive(state.networkBuffer, 0, state.BufferSize, SocketFlags.None, out beginError, receiveCallBack, stateItem);
 						if (beginError != SocketError.Success)
@@ -1122,6 +1199,541 @@ namespace MySpace.SocketTransport
 			}
 		}
 
+		#region Segmented Receive
+
+		//Connections with SocketServerConfig.SegmentedReceive set receive straight into pooled segments
+		//and frame messages where they land. Handlers get read only views over the segment, which is
+		//held until every message in it has been processed, so nothing is copied and no lock is taken.
+		//Only the start of a message split across receives is copied, into the next segment, and
+		//messages bigger than a segment are collected in a pooled buffer.
+
+		private ReceiveSegment BuildReceiveSegment()
+		{
+			return new ReceiveSegment(config.ReceiveSegmentSize);
+		}
+
+		private void ResetConnectionStateSegments(ConnectionState state)
+		{
+			if (state.segment != null)
+			{
+				state.segment.Release();
+				state.segment = null;
+			}
+			if (state.overflowBuffer != null)
+			{
+				bufferPool.ReleaseItem(state.overflowBuffer);
+				state.overflowBuffer = null;
+			}
+			state.frameStart = 0;
+			state.receiveEnd = 0;
+			state.overflowSize = 0;
+			state.skipRemaining = 0;
+		}
+
+		private void StartSegmentedReceive(ResourcePoolItem<ConnectionState> stateItem)
+		{
+			ConnectionState state = stateItem.Item;
+			if (state.receiveArgs == null)
+			{
+				state.receiveArgs = new SocketAsyncEventArgs();
+				state.receiveArgs.Completed += segmentReceiveCompleted;
+			}
+			state.receiveArgs.UserToken = stateItem;
+			ReceiveSegments(stateItem, false);
+		}
+
+		private void SegmentReceiveCompleted(object sender, SocketAsyncEventArgs e)
+		{
+			ReceiveSegments((ResourcePoolItem<ConnectionState>)e.UserToken, true);
+		}
+
+		private void ReceiveSegments(ResourcePoolItem<ConnectionState> stateItem, bool received)
+		{
+			ConnectionState state = stateItem.Item;
+			try
+			{
+				if (received && !ReadSegment(stateItem)) return;
+
+				while (true)
+				{
+					Socket connection = state.WorkSocket;
+					if (connection == null) return;
+					if (state.pauseRequested)
+					{
+						PauseConnection(stateItem);
+						return;
+					}
+
+					PrepareSegment(state);
+					state.receiveArgs.SetBuffer(state.segment.Buffer, state.receiveEnd, state.segment.Buffer.Length - state.receiveEnd);
+					if (connection.ReceiveAsync(state.receiveArgs)) return;
+					if (!ReadSegment(stateItem)) return;
+				}
+			}
+			catch (SocketException se)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Exception during ReceiveSegments: {0}. Removing Connection.", se.SocketErrorCode);
+				try
+				{
+					CloseConnection(stateItem);
+				}
+				catch (Exception e)
+				{
+					if (log.IsErrorEnabled)
+						log.ErrorFormat("Socket Server Exception removing socket: {0}", e.ToString());
+				}
+			}
+			catch (ObjectDisposedException)
+			{
+			}
+		}
+
+		/// <summary>
+		/// Makes sure the connection's segment has room for the next receive and for the rest of
+		/// any message it holds part of.
+		/// </summary>
+		private void PrepareSegment(ConnectionState state)
+		{
+			ReceiveSegment segment = state.segment;
+			if (segment == null)
+			{
+				state.segment = ReceiveSegment.Acquire(receiveSegmentPool);
+				state.frameStart = 0;
+				state.receiveEnd = 0;
+				return;
+			}
+
+			int pending = state.receiveEnd - state.frameStart;
+			if (pending == 0 && segment.IsExclusive)
+			{
+				//nothing handed out still reads from it
+				state.frameStart = 0;
+				state.receiveEnd = 0;
+				return;
+			}
+
+			int length = segment.Buffer.Length;
+			int pendingSize = pending >= 6 ? GetHostOrdered(BitConverter.ToInt32(segment.Buffer, state.frameStart + 2), useNetworkOrder) : 0;
+			if (length - state.receiveEnd >= length / 16 && state.frameStart + pendingSize <= length)
+			{
+				return;
+			}
+
+			ReceiveSegment next = ReceiveSegment.Acquire(receiveSegmentPool);
+			Buffer.BlockCopy(segment.Buffer, state.frameStart, next.Buffer, 0, pending);
+			segment.Release();
+			state.segment = next;
+			state.frameStart = 0;
+			state.receiveEnd = pending;
+		}
+
+		/// <summary>
+		/// Handles a completed receive.
+		/// </summary>
+		/// <returns>Returns <see langword="false"/> if the connection was closed.</returns>
+		private bool ReadSegment(ResourcePoolItem<ConnectionState> stateItem)
+		{
+			ConnectionState state = stateItem.Item;
+			SocketAsyncEventArgs e = state.receiveArgs;
+			if (e.SocketError != SocketError.Success)
+			{
+				if (e.SocketError != SocketError.ConnectionReset) //that just means the client had its app domain shut off; happens all the time.
+				{
+					if (log.IsErrorEnabled)
+						log.ErrorFormat("Socket Error during ReceiveAsync from {0}: {1}.", state.remoteEndPoint, e.SocketError);
+				}
+				CloseConnection(stateItem);
+				return false;
+			}
+			if (e.BytesTransferred == 0) //the client disconnected cleanly.
+			{
+				CloseConnection(stateItem);
+				return false;
+			}
+
+			state.receiveEnd += e.BytesTransferred;
+			if (!ReadMessages(state))
+			{
+				CloseConnection(stateItem);
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Frames and queues every complete message in the connection's segment.
+		/// </summary>
+		/// <returns>Returns <see langword="false"/> we can't handle any more requests from this client.</returns>
+		private bool ReadMessages(ConnectionState state)
+		{
+			byte[] buffer = state.segment.Buffer;
+			bool malformed;
+			while (state.frameStart < state.receiveEnd)
+			{
+				int available = state.receiveEnd - state.frameStart;
+
+				if (state.skipRemaining > 0)
+				{
+					int skipped = Math.Min(available, state.skipRemaining);
+					state.skipRemaining -= skipped;
+					state.frameStart += skipped;
+					continue;
+				}
+
+				if (state.overflowBuffer != null)
+				{
+					int needed = state.overflowSize - (int)state.overflowBuffer.Item.Length;
+					int copied = Math.Min(available, needed);
+					state.overflowBuffer.Item.Write(buffer, state.frameStart, copied);
+					state.frameStart += copied;
+					if (copied < needed) return true;
+
+					ResourcePoolItem<MemoryStream> overflow = state.overflowBuffer;
+					state.overflowBuffer = null;
+					if (!HandleMessage(state, overflow.Item.GetBuffer(), 0, state.overflowSize, null, overflow, out malformed))
+					{
+						return false;
+					}
+					continue;
+				}
+
+				if (available < 2) return true;
+				if (!CheckForMessageStarter(buffer, state.frameStart))
+				{
+					if (log.IsWarnEnabled)
+						log.WarnFormat("Expected message start, received other from {0}.  Waiting for next receive that starts with valid message start.", state.remoteEndPoint);
+					state.frameStart = state.receiveEnd;
+					return true;
+				}
+				if (available < 6) return true;
+
+				int messageSize = GetHostOrdered(BitConverter.ToInt32(buffer, state.frameStart + 2), useNetworkOrder);
+				if (messageSize < 13)
+				{
+					if (log.IsWarnEnabled)
+						log.WarnFormat("Message with invalid size {0} from {1}. Waiting for next receive that starts with valid message start.", messageSize, state.remoteEndPoint);
+					state.frameStart = state.receiveEnd;
+					return true;
+				}
+
+				if (messageSize > maximumMessageSize)
+				{
+					if (log.IsWarnEnabled)
+						log.WarnFormat("Message with size {0} from {1}. {2}.",
+						messageSize.ToString("N0"),
+						state.remoteEndPoint,
+						discardTooBigMessages ? "Discarding data from this message." : "Message buffer will be disposed immediately after processing."
+						);
+					if (discardTooBigMessages)
+					{
+						state.skipRemaining = messageSize;
+						continue;
+					}
+				}
+
+				if (available >= messageSize && messageSize <= maximumMessageSize)
+				{
+					if (!HandleMessage(state, buffer, state.frameStart, messageSize, state.segment, null, out malformed))
+					{
+						return false;
+					}
+					state.frameStart += messageSize;
+					continue;
+				}
+
+				if (messageSize > buffer.Length || messageSize > maximumMessageSize)
+				{
+					//too big to wait for in a segment
+					state.overflowBuffer = bufferPool.GetItem();
+					state.overflowSize = messageSize;
+					continue;
+				}
+
+				return true;
+			}
+			return true;
+		}
+
+		#endregion
+
+		#region Admission Control
+
+		/// <summary>
+		/// Gets the admission control counters of every open connection.
+		/// </summary>
+		/// <returns>The counters, one per connection.</returns>
+		public IList<ConnectionStatistics> GetConnectionStatistics()
+		{
+			ConnectionState[] states = connections.GetConnectionStates();
+			List<ConnectionStatistics> statistics = new List<ConnectionStatistics>(states.Length);
+			foreach (ConnectionState state in states)
+			{
+				ConnectionStatistics connectionStatistics = state.Statistics;
+				if (connectionStatistics != null)
+				{
+					statistics.Add(connectionStatistics);
+				}
+			}
+			return statistics;
+		}
+
+		private bool Admit(ConnectionState state, ProcessState processState, bool fairShare)
+		{
+			int pending, depth;
+			if (processState.ReplyType == ReplyType.SendReply)
+			{
+				pending = SyncDispatcher.PendingTaskCount;
+				depth = config.SyncQueueDepth;
+			}
+			else
+			{
+				pending = OnewayDispatcher.PendingTaskCount;
+				depth = config.OnewayQueueDepth;
+			}
+			if (pending >= depth || !AcceptingRequestsDelegate())
+			{
+				return false;
+			}
+			//past half full, a client already holding an even share of the queue waits for the others
+			return !fairShare || pending < depth / 2 || !clientQueues.HasFairShare(state.remoteEndPoint.Address, depth);
+		}
+
+		private void PostMessage(ConnectionState state, ProcessState processState)
+		{
+			EnterAdmission(state, processState);
+			if (processState.ReplyType == ReplyType.SendReply)
+			{
+				SyncMessagePort.Post(processState);
+			}
+			else
+			{
+				OnewayMessagePort.Post(processState);
+			}
+		}
+
+		private static void HoldMessage(ConnectionState state, ProcessState processState)
+		{
+			if (state.heldMessages == null)
+			{
+				state.heldMessages = new Queue<ProcessState>();
+			}
+			state.heldMessages.Enqueue(processState);
+			state.pauseRequested = true;
+		}
+
+		/// <summary>
+		/// Posts the messages held while the connection was paused, in the order they were read.
+		/// </summary>
+		/// <returns>Whether every held message was posted; if not the connection stays paused.</returns>
+		private bool PostHeldMessages(ConnectionState state)
+		{
+			Queue<ProcessState> held = state.heldMessages;
+			if (held == null) return true;
+			while (held.Count > 0)
+			{
+				//held messages have already waited their turn, so only the queue depth applies
+				if (!Admit(state, held.Peek(), false))
+				{
+					return false;
+				}
+				ProcessState processState = held.Dequeue();
+				try
+				{
+					PostMessage(state, processState);
+				}
+				catch
+				{
+					ReleaseMessage(processState);
+					FinishAdmission(processState);
+					throw;
+				}
+			}
+			return true;
+		}
+
+		private void ReleaseHeldMessages(ConnectionState state)
+		{
+			Queue<ProcessState> held = state.heldMessages;
+			if (held == null) return;
+			while (held.Count > 0)
+			{
+				ReleaseMessage(held.Dequeue());
+			}
+		}
+
+		private void EnterAdmission(ConnectionState state, ProcessState processState)
+		{
+			processState.Client = state.remoteEndPoint.Address;
+			processState.Statistics = state.statistics;
+			clientQueues.Enter(processState.Client);
+			if (processState.Statistics != null)
+			{
+				Interlocked.Increment(ref processState.Statistics.queueDepth);
+				Interlocked.Increment(ref processState.Statistics.admitted);
+			}
+		}
+
+		private void FinishAdmission(ProcessState state)
+		{
+			if (state.Client == null || Interlocked.Exchange(ref state.Finished, 1) != 0)
+			{
+				return;
+			}
+			clientQueues.Exit(state.Client);
+			if (state.Statistics != null)
+			{
+				Interlocked.Decrement(ref state.Statistics.queueDepth);
+			}
+			if (pausedCount > 0)
+			{
+				ResumeConnections();
+			}
+		}
+
+		private bool SendBusyReply(ConnectionState connectionState, ProcessState state)
+		{
+			if (connectionState.statistics != null)
+			{
+				Interlocked.Increment(ref connectionState.statistics.rejected);
+			}
+			if (countersInitialized && requestsRejectedCounter != null)
+			{
+				requestsRejectedCounter.Increment();
+			}
+
+			MemoryStream busyReply = new MemoryStream(busyReplyBytes.Length + 4);
+			busyReply.Write(busyReplyBytes, 0, busyReplyBytes.Length);
+			busyReply.Write(BitConverter.GetBytes(GetNetworkOrdered(config.BusyRetryAfterMilliseconds, useNetworkOrder)), 0, 4);
+			return SendReply(state, busyReply, (int)busyReply.Length);
+		}
+
+		private void PauseConnection(ResourcePoolItem<ConnectionState> stateItem)
+		{
+			ConnectionState state = stateItem.Item;
+			state.pauseRequested = false;
+			if (state.statistics != null)
+			{
+				state.statistics.paused = true;
+				Interlocked.Increment(ref state.statistics.pauses);
+			}
+			lock (pausedConnections)
+			{
+				pausedConnections.Enqueue(stateItem);
+				pausedCount = pausedConnections.Count;
+			}
+			if (countersInitialized && pausedConnectionsCounter != null)
+			{
+				pausedConnectionsCounter.Increment();
+			}
+			//the queues may have drained while the connection was being paused
+			ResumeConnections();
+		}
+
+		private bool QueuesDrained()
+		{
+			return isRunning
+				&& SyncDispatcher.PendingTaskCount <= config.SyncQueueDepth / 2
+				&& OnewayDispatcher.PendingTaskCount <= config.OnewayQueueDepth / 2
+				&& AcceptingRequestsDelegate();
+		}
+
+		private void ResumeConnections()
+		{
+			ResourcePoolItem<ConnectionState>[] resuming;
+			try
+			{
+				if (!QueuesDrained()) return;
+			}
+			catch (ObjectDisposedException) //just for shutdown
+			{
+				return;
+			}
+			lock (pausedConnections)
+			{
+				if (pausedConnections.Count == 0) return;
+				resuming = pausedConnections.ToArray();
+				pausedConnections.Clear();
+				pausedCount = 0;
+			}
+			if (countersInitialized && pausedConnectionsCounter != null)
+			{
+				pausedConnectionsCounter.IncrementBy(-resuming.Length);
+			}
+			foreach (ResourcePoolItem<ConnectionState> stateItem in resuming)
+			{
+				ThreadPool.UnsafeQueueUserWorkItem(resumeReceive, stateItem);
+			}
+		}
+
+		private void ResumeReceive(object o)
+		{
+			ResourcePoolItem<ConnectionState> stateItem = (ResourcePoolItem<ConnectionState>)o;
+			ConnectionState state = stateItem.Item;
+			if (state.statistics != null)
+			{
+				state.statistics.paused = false;
+			}
+			Socket connection = state.WorkSocket;
+			if (connection == null)
+			{
+				//closed by the connection check while paused
+				connectionStatePool.ReleaseItem(stateItem);
+				return;
+			}
+			try
+			{
+				if (!PostHeldMessages(state))
+				{
+					//the queues filled again before every held message got in
+					PauseConnection(stateItem);
+					return;
+				}
+			}
+			catch (Exception ex)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Server Exception posting held messages for {0}: {1}. Removing Connection.", state.remoteEndPoint, ex);
+				CloseConnection(stateItem);
+				return;
+			}
+			if (state.segmented)
+			{
+				ReceiveSegments(stateItem, false);
+				return;
+			}
+			try
+			{
+				SocketError beginError;
+				connection.BeginReceive(state.networkBuffer, 0, state.BufferSize, SocketFlags.None, out beginError, receiveCallBack, stateItem);
+				if (beginError != SocketError.Success)
+				{
+					if (log.IsErrorEnabled)
+						log.ErrorFormat("Error resuming receive: {0}", beginError);
+					CloseConnection(stateItem);
+				}
+			}
+			catch (SocketException se)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Exception resuming receive: {0}. Removing Connection.", se.SocketErrorCode);
+				try
+				{
+					CloseConnection(stateItem);
+				}
+				catch (Exception e)
+				{
+					if (log.IsErrorEnabled)
+						log.ErrorFormat("Socket Server Exception removing socket: {0}", e.ToString());
+				}
+			}
+			catch (ObjectDisposedException)
+			{
+			}
+		}
+
+		#endregion
+
 		private void CloseConnection(ResourcePoolItem<ConnectionState> stateItem)
 		{
 			ConnectionState state = stateItem.Item;
@@ -1146,27 +1758,52 @@ namespace MySpace.SocketTransport
 		/// <param name="state">The state.</param>
 		/// <returns>Returns <see langword="false"/> we can't handle any more requests from this client.</returns>
 		protected bool HandleCompleteSentData(ConnectionState state)
+		{
+			bool malformed;
+			bool accepted = HandleMessage(state, state.messageBuffer.GetBuffer(), 0, state.messageSize, null, null, out malformed);
+			if (malformed)
+			{
+				ResetConnectionStateMessageBuffer(state);
+			}
+			return accepted;
+		}
+
+		/// <summary>
+		/// Queues the complete message at <paramref name="offset"/> in <paramref name="buff"/> for processing.
+		/// </summary>
+		/// <param name="state">The connection the message came from.</param>
+		/// <param name="buff">The buffer holding the message, header and terminator included.</param>
+		/// <param name="offset">Where the message starts in <paramref name="buff"/>.</param>
+		/// <param name="messageSize">The size of the message, header and terminator included.</param>
+		/// <param name="segment">The receive segment <paramref name="buff"/> belongs to, if the handler
+		/// should read the message in place; a reference to it is held until the message is processed.</param>
+		/// <param name="frameBuffer">The pooled buffer <paramref name="buff"/> belongs to, if the handler
+		/// should read the message in place; it is released once the message is processed.</param>
+		/// <param name="malformed">Set to <see langword="true"/> when the message was dropped because it could not be read.</param>
+		/// <returns>Returns <see langword="false"/> we can't handle any more requests from this client.</returns>
+		private bool HandleMessage(ConnectionState state, byte[] buff, int offset, int messageSize,
+			ReceiveSegment segment, ResourcePoolItem<MemoryStream> frameBuffer, out bool malformed)
 		{
 			bool sendReply, sendAck;
 
-			byte[] buff = state.messageBuffer.GetBuffer();
 			short commandId = 0;
 			short messageId;
+			malformed = false;
 
 			try
 			{
 				if (useNetworkOrder)
 				{
-					messageId = GetHostOrdered(BitConverter.ToInt16(buff, 6), true);
-					commandId = GetHostOrdered(BitConverter.ToInt16(buff, 8), true);
+					messageId = GetHostOrdered(BitConverter.ToInt16(buff, offset + 6), true);
+					commandId = GetHostOrdered(BitConverter.ToInt16(buff, offset + 8), true);
 				}
 				else
 				{
-					commandId = BitConverter.ToInt16(buff, 6);
-					messageId = BitConverter.ToInt16(buff, 8);
+					commandId = BitConverter.ToInt16(buff, offset + 6);
+					messageId = BitConverter.ToInt16(buff, offset + 8);
 				}
 
-				sendReply = BitConverter.ToBoolean(buff, 10);
+				sendReply = BitConverter.ToBoolean(buff, offset + 10);
 				sendAck = (messageId == SendAckMessageId);
 				if (countersInitialized)
 				{
@@ -1180,27 +1817,40 @@ namespace MySpace.SocketTransport
 			{
 				if (log.IsErrorEnabled)
 					log.ErrorFormat("Socket Server Exception extracting message info from {0}: {1} . Resetting connection state.", state.remoteEndPoint, e);
-				ResetConnectionStateMessageBuffer(state);
+				if (frameBuffer != null) bufferPool.ReleaseItem(frameBuffer);
+				malformed = true;
 				return true;
 			}
 
-			if (!CheckForMessageTerminator(buff, state.messageSize))
+			if (!CheckForMessageTerminator(buff, offset, messageSize))
 			{
 				if (log.IsErrorEnabled)
 					log.ErrorFormat("Message without end terminator found from {0}. Resetting connection state.", state.remoteEndPoint);
 
-				ResetConnectionStateMessageBuffer(state);
+				if (frameBuffer != null) bufferPool.ReleaseItem(frameBuffer);
+				malformed = true;
 				return true;
 			}
 
 			try
 			{
-
-				ResourcePoolItem<MemoryStream> messageBuffer = bufferPool.GetItem();
+				ProcessState processState = null;
+				ResourcePoolItem<MemoryStream> messageBuffer = frameBuffer;
 				try
 				{
-					messageBuffer.Item.Write(buff, 11, state.messageSize - 13);
-					messageBuffer.Item.Seek(0, SeekOrigin.Begin);
+					MemoryStream messageStream;
+					if (segment != null || frameBuffer != null)
+					{
+						//a read only view; the payload isn't copied again
+						messageStream = new MemoryStream(buff, offset + 11, messageSize - 13, false, false);
+					}
+					else
+					{
+						messageBuffer = bufferPool.GetItem();
+						messageStream = messageBuffer.Item;
+						messageStream.Write(buff, offset + 11, messageSize - 13);
+						messageStream.Seek(0, SeekOrigin.Begin);
+					}
 
 					ReplyType replyType = ReplyType.None;
 					if (sendAck)
@@ -1212,30 +1862,35 @@ namespace MySpace.SocketTransport
 						replyType = ReplyType.SendReply;
 					}
 
-					ProcessState processState = new ProcessState(state.ReplySocket, commandId, messageId, replyType, messageBuffer,
-					                                             state.messageSize - 13);
+					processState = new ProcessState(state.ReplySocket, commandId, messageId, replyType, messageStream,
+					                                messageSize - 13);
+					processState.Message = messageBuffer;
+					processState.Replies = state.replies;
+					if (segment != null)
+					{
+						segment.AddReference();
+						processState.Segment = segment;
+					}
 
-					if (sendReply)
+					if (state.heldMessages != null && state.heldMessages.Count > 0)
 					{
-						if (SyncDispatcher.PendingTaskCount < config.SyncQueueDepth && AcceptingRequestsDelegate())
-						{
-							SyncMessagePort.Post(processState);
-						}
-						else
+						//stays behind the connection's earlier messages
+						HoldMessage(state, processState);
+					}
+					else if (!Admit(state, processState, true))
+					{
+						if (sendReply && config.BusyRetryAfterMilliseconds > 0)
 						{
-							return false; //will cause connection to close
+							ReleaseMessage(processState);
+							return SendBusyReply(state, processState);
 						}
+						//stop reading from the client until the queues drain instead of closing the connection,
+						//which only has the client reconnect and send again
+						HoldMessage(state, processState);
 					}
 					else
 					{
-						if (OnewayDispatcher.PendingTaskCount < config.OnewayQueueDepth && AcceptingRequestsDelegate())
-						{
-							OnewayMessagePort.Post(processState);
-						}
-						else
-						{
-							return false; //will cause connection to close
-						}
+						PostMessage(state, processState);
 					}
 				}
 				catch (Exception ex)
@@ -1244,7 +1899,15 @@ namespace MySpace.SocketTransport
 					if (log.IsErrorEnabled)
 						log.ErrorFormat("Socket Server Exception enqueueing message work item for {0}: {1}. Releasing buffer.",
 						                state.remoteEndPoint, ex);
-					bufferPool.ReleaseItem(messageBuffer);
+					if (processState != null)
+					{
+						ReleaseMessage(processState);
+						FinishAdmission(processState);
+					}
+					else if (messageBuffer != null)
+					{
+						bufferPool.ReleaseItem(messageBuffer);
+					}
 				}
 			}
 			catch (Exception ex)
@@ -1252,7 +1915,7 @@ namespace MySpace.SocketTransport
 
 				if (log.IsErrorEnabled)
 					log.ErrorFormat("Socket Server Exception while handling message for {0}: {1}. Resetting message state.", state.remoteEndPoint, ex);
-				ResetConnectionStateMessageBuffer(state);
+				malformed = true;
 				return true;
 			}
 
@@ -1271,7 +1934,7 @@ namespace MySpace.SocketTransport
 					ackSuccessful = SendReply(state, null); //sendack is mutually exclusive with sendreply, so we just do this and then carry on. 
 				}
 
-				MemoryStream messageStream = state.Message.Item;
+				MemoryStream messageStream = state.MessageStream;
 
 				if (sendSeverCapabilities && state.CommandId == ServerCapabilitiesRequestCommandId)
 				{
@@ -1299,6 +1962,7 @@ namespace MySpace.SocketTransport
 						                                                		}
 						                                                		catch (Exception exc)
 						                                                		{
+						                                                			FinishAdmission(state);
 						                                                			if (log.IsErrorEnabled)
 						                                                				log.Error(exc);
 						                                                		}
@@ -1336,15 +2000,31 @@ namespace MySpace.SocketTransport
 					message.Message = null;
 					message.Length = 0;
 				}
-				bufferPool.ReleaseItem(state.Message);
-				state.Message = null;
+				ReleaseMessage(state);
 			}
 
 			CompleteProcessCall(state, replyStream);
 		}
 
+		private void ReleaseMessage(ProcessState state)
+		{
+			state.MessageStream = null;
+			if (state.Message != null)
+			{
+				bufferPool.ReleaseItem(state.Message);
+				state.Message = null;
+			}
+			if (state.Segment != null)
+			{
+				state.Segment.Release();
+				state.Segment = null;
+			}
+		}
+
 		private void CompleteProcessCall(ProcessState state, MemoryStream replyStream)
 		{
+			FinishAdmission(state);
+
 			if (countersInitialized)
 			{
 				avgHandlerTimeBase.Increment();
@@ -1400,6 +2080,12 @@ namespace MySpace.SocketTransport
 					}
 					state.ReplyBuffer.Item.Write(reply.GetBuffer(), 0, replyLength);
 				}
+
+				if (state.Replies != null)
+				{
+					state.ReplySize = replySize;
+					return QueueReply(state);
+				}
 				
 				if (state.Socket.Connected)
 				{
@@ -1546,6 +2232,125 @@ namespace MySpace.SocketTransport
 			}
 		}
 
+		#region Reply Batching
+
+		private bool QueueReply(ProcessState state)
+		{
+			bool accepted;
+			bool startSending = state.Replies.Enqueue(state, out accepted);
+			if (!accepted)
+			{
+				//an earlier send to the connection failed and closed it
+				bufferPool.ReleaseItem(state.ReplyBuffer);
+				state.ReplyBuffer = null;
+				return false;
+			}
+			if (startSending)
+			{
+				SendBatch(state.Replies);
+			}
+			return true;
+		}
+
+		private void SendBatch(ReplyBatch batch)
+		{
+			IList<ArraySegment<byte>> buffers = batch.TakeBatch();
+			if (buffers == null) return;
+
+			try
+			{
+				SocketError socketError;
+				batch.Socket.BeginSend(buffers, SocketFlags.None, out socketError, batchReplyCallBack, batch);
+				if (socketError != SocketError.Success)
+				{
+					if (log.IsErrorEnabled)
+						log.ErrorFormat("Error sending replies to {0}: {1}.", batch.RemoteEndpoint, socketError);
+					FailBatch(batch);
+				}
+			}
+			catch (SocketException ex)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Exception during SendBatch to {0}: {1}.  Removing connection.", batch.RemoteEndpoint, ex);
+				FailBatch(batch);
+			}
+			catch (ObjectDisposedException)
+			{
+				FailBatch(batch);
+			}
+		}
+
+		private void BatchReplyCallback(IAsyncResult ar)
+		{
+			ReplyBatch batch = (ReplyBatch)ar.AsyncState;
+			try
+			{
+				batch.Socket.EndSend(ar);
+			}
+			catch (SocketException ex)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Exception during BatchReplyCallback to {0}: {1}. Removing connection.", batch.RemoteEndpoint, ex);
+				FailBatch(batch);
+				return;
+			}
+			catch (ObjectDisposedException)
+			{
+				FailBatch(batch);
+				return;
+			}
+
+			List<ProcessState> sent = batch.InFlight;
+			foreach (ProcessState state in sent)
+			{
+				bufferPool.ReleaseItem(state.ReplyBuffer);
+				state.ReplyBuffer = null;
+			}
+			if (countersInitialized && avgRepliesPerSend != null)
+			{
+				avgRepliesPerSend.IncrementBy(sent.Count);
+				avgRepliesPerSendBase.Increment();
+			}
+
+			if (ar.CompletedSynchronously)
+			{
+				//don't recurse on the sending thread while replies keep arriving
+				ThreadPool.UnsafeQueueUserWorkItem(sendBatch, batch);
+			}
+			else
+			{
+				SendBatch(batch);
+			}
+		}
+
+		private void FailBatch(ReplyBatch batch)
+		{
+			foreach (ProcessState state in batch.Fail())
+			{
+				if (state.ReplyBuffer != null)
+				{
+					bufferPool.ReleaseItem(state.ReplyBuffer);
+					state.ReplyBuffer = null;
+				}
+			}
+			try
+			{
+				if (batch.Socket.Connected)
+				{
+					batch.Socket.Shutdown(SocketShutdown.Both);
+					batch.Socket.Close();
+				}
+				RemoveConnection(batch.RemoteEndpoint);
+			}
+			catch (Exception exc)
+			{
+				if (log.IsErrorEnabled)
+					log.ErrorFormat("Socket Server Exception attempted to remove connection in FailBatch cleanup: {0}", exc);
+			}
+		}
+
+		#endregion
+
 		public void CheckConnections(object state)
 		{
 			log.Debug("Starting Connection Check");
@@ -55,5 +55,43 @@ namespace MySpace.SocketTransport
 		public int MaximumOpenSockets = 0;
 		[XmlElement("SendServerCapabilities")] //whether or not to treat Int16.MinValue as a special command to request sever capabilities
 		public bool SendServerCapabilities = true;
+		/// <summary>
+		/// When <see langword="true"/> new connections receive into pooled segments and
+		/// hand messages to handlers as views over them rather than copies. Applies to
+		/// connections accepted after the setting changes.
+		/// </summary>
+		[XmlElement("SegmentedReceive")]
+		public bool SegmentedReceive = false;
+		/// <summary>
+		/// The size of the segments used by <see cref="SegmentedReceive"/>. Messages larger
+		/// than a segment are copied into a pooled buffer instead. The default stays below
+		/// the large object heap threshold.
+		/// </summary>
+		[XmlElement("ReceiveSegmentSize")]
+		public int ReceiveSegmentSize = 65536;
+		/// <summary>
+		/// When greater than zero, sync messages that arrive while their queue is full, or while
+		/// the client already holds its share of a queue more than half full, are answered at once
+		/// with a busy reply telling the client to retry after this many milliseconds, and the
+		/// connection goes on being read. When zero they, like oneway messages, are held by the
+		/// connection and queued in order once the queues drain, and the connection stops being
+		/// read until then.
+		/// Only enable this once clients understand busy replies.
+		/// </summary>
+		[XmlElement("BusyRetryAfterMilliseconds")]
+		public int BusyRetryAfterMilliseconds = 0;
+		/// <summary>
+		/// When <see langword="true"/> replies that complete while a send to the same connection
+		/// is in flight are queued and sent together in one gathered send. Applies to connections
+		/// accepted after the setting changes.
+		/// </summary>
+		[XmlElement("BatchReplies")]
+		public bool BatchReplies = false;
+		/// <summary>
+		/// The most reply bytes gathered into one send by <see cref="BatchReplies"/>. A single
+		/// larger reply is still sent on its own.
+		/// </summary>
+		[XmlElement("ReplyBatchBytes")]
+		public int ReplyBatchBytes = 65536;
 	}
 }